@@ -0,0 +1,236 @@
+/*
+** EEBNCH.C    - MECAFF fullscreen tools: command lookup benchmark
+**
+** This file is part of the MECAFF based fullscreen tools of MECAFF
+** for VM/370 R6 "SixPack".
+**
+** This module is a benchmark and check for the command lookup of EE
+** (findCommand() resp. fndcmd() in EEUTL2), built and run outside CMS:
+**
+**   gcc -O2 -D_NOCMS -o eebnch eebnch.c eeutl1.c eeutl2.c
+**   eebnch [ profile-lines [ repeats ] ]
+**
+** First all abbreviations of the EE commands (in different cases and with
+** parameters) and all alphabetic tokens up to 3 characters are looked up
+** with fndcmd() and with the linear scan used before the command index,
+** checking that both find the same command.
+** Then a synthetic profile with 'profile-lines' command lines (EE commands
+** with random abbreviations and parameters, locate targets, unknown words)
+** is dispatched 'repeats' times with both lookups and the time per command
+** line is reported.
+**
+** The command list is built from the command table EECMDTB.H shared with
+** 'eeCmds' in EECMDS.
+**
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012,2013
+** Released to the public domain.
+*/
+ 
+#ifdef _NOCMS
+ 
+#include "glblpre.h"
+ 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+ 
+#include "eeutil.h"
+ 
+#include "glblpost.h"
+ 
+#define EECMD(name, impl) {name, NULL},
+static CmdDef eeCmds[] = {
+#include "eecmdtb.h"
+};
+#undef EECMD
+ 
+#define CMDCOUNT (sizeof(eeCmds) / sizeof(CmdDef))
+ 
+/* the command lookup before the index: a simple loop */
+static CmdDef* linearFind(char *cand, CmdDef *cmdList, unsigned int cmdCount) {
+  if (!cand || !*cand) { return NULL; }
+  unsigned int i;
+  for (i = 0; i < cmdCount; i++) {
+    if (isAbbrev(cand, cmdList->commandName)) { return cmdList; }
+    cmdList++;
+  }
+  return NULL;
+}
+ 
+static int checks = 0;
+static int mismatches = 0;
+ 
+static void check(char *cand) {
+  CmdDef *expected = linearFind(cand, eeCmds, CMDCOUNT);
+  CmdDef *found = fndcmd(cand, eeCmds, CMDCOUNT);
+  checks++;
+  if (found != expected) {
+    mismatches++;
+    if (mismatches <= 10) {
+      printf("** mismatch for '%s': expected %s, found %s\n",
+        cand,
+        (expected) ? expected->commandName : "(none)",
+        (found) ? found->commandName : "(none)");
+    }
+  }
+}
+ 
+/* check all abbreviations of the commands and all short alpha tokens */
+static void checkAll() {
+  static char *suffixes[] = { "", " 1", " * /x/", "1", "/abc/", "." };
+  char cand[64];
+  unsigned int cmdNo;
+  int len;
+  int s;
+ 
+  for (cmdNo = 0; cmdNo < CMDCOUNT; cmdNo++) {
+    char *name = eeCmds[cmdNo].commandName;
+    int nameLen = strlen(name);
+    for (len = 1; len <= nameLen + 1; len++) {
+      for (s = 0; s < sizeof(suffixes) / sizeof(char*); s++) {
+        memset(cand, '\0', sizeof(cand));
+        strncpy(cand, name, len);
+        if (len > nameLen) { cand[nameLen] = 'x'; }
+        strcat(cand, suffixes[s]);
+        check(cand);
+        s_upper(cand, cand);
+        check(cand);
+        s_lower(cand, cand);
+        check(cand);
+      }
+    }
+  }
+ 
+  char c1, c2, c3;
+  for (c1 = 'a'; c1 <= 'z'; c1++) {
+    sprintf(cand, "%c", c1);
+    check(cand);
+    for (c2 = 'a'; c2 <= 'z'; c2++) {
+      sprintf(cand, "%c%c", c1, c2);
+      check(cand);
+      for (c3 = 'a'; c3 <= 'z'; c3++) {
+        sprintf(cand, "%c%c%c params", c1, c2, c3);
+        check(cand);
+      }
+    }
+  }
+ 
+  check(":12");
+  check("+3");
+  check("-/x/");
+  check("/");
+  check("=");
+  check("?");
+  check("*");
+}
+ 
+/* build a synthetic profile with 'count' command lines */
+static char** buildProfile(int count) {
+  static char *words[] = {
+    "xedit", "set", "wrap", "hex", "zone", "verify", "stay", "ctl" };
+  char line[80];
+  char **lines = (char**)malloc(count * sizeof(char*));
+  int i;
+ 
+  srand(4711);
+  for (i = 0; i < count; i++) {
+    int kind = rand() % 10;
+    if (kind < 8) {
+      /* EE command: random abbreviation, random case, parameters */
+      char *name = eeCmds[rand() % CMDCOUNT].commandName;
+      int nameLen = strlen(name);
+      int minLen = 0;
+      while(name[minLen] && c_lower(name[minLen]) != name[minLen]) {
+        minLen++;
+      }
+      int len = minLen + rand() % (nameLen - minLen + 1);
+      int j;
+      for (j = 0; j < len; j++) {
+        line[j] = (rand() & 1) ? c_upper(name[j]) : c_lower(name[j]);
+      }
+      line[len] = '\0';
+      if (rand() & 1) { sprintf(&line[len], " %d", rand() % 80); }
+    } else if (kind == 8) {
+      /* locate targets */
+      static char *targets[] = { ":120", "+5", "-3", "/pattern/", ".a" };
+      strcpy(line, targets[rand() % (sizeof(targets) / sizeof(char*))]);
+    } else {
+      /* unknown command */
+      sprintf(line, "%s on",
+        words[rand() % (sizeof(words) / sizeof(char*))]);
+    }
+    lines[i] = strdup(line);
+  }
+  return lines;
+}
+ 
+static double nowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+ 
+typedef CmdDef* (*Finder)(char *cand, CmdDef *cmdList, unsigned int cmdCount);
+ 
+/* dispatch the profile 'repeats' times, returning ns per command line */
+static double timeProfile(Finder finder, char **lines, int count, int repeats,
+                          int *foundCount) {
+  int found = 0;
+  int r;
+  int i;
+  double start = nowNanos();
+  for (r = 0; r < repeats; r++) {
+    for (i = 0; i < count; i++) {
+      if (finder(lines[i], eeCmds, CMDCOUNT)) { found++; }
+    }
+  }
+  double elapsed = nowNanos() - start;
+  *foundCount = found / repeats;
+  return elapsed / ((double)count * repeats);
+}
+ 
+int main(int argc, char *argv[]) {
+  int count = (argc > 1) ? atoi(argv[1]) : 5000;
+  int repeats = (argc > 2) ? atoi(argv[2]) : 200;
+  if (count < 1) { count = 5000; }
+  if (repeats < 1) { repeats = 200; }
+ 
+  printf("EE command lookup benchmark, %d commands\n\n", (int)CMDCOUNT);
+ 
+  checkAll();
+  printf("check: %d lookups, %d mismatches\n\n", checks, mismatches);
+ 
+  char **lines = buildProfile(count);
+  int foundLinear;
+  int foundIndexed;
+ 
+  /* warm up (and build the index) before timing */
+  timeProfile(&fndcmd, lines, count, 1, &foundIndexed);
+  timeProfile(&linearFind, lines, count, 1, &foundLinear);
+ 
+  double nsLinear = timeProfile(&linearFind, lines, count, repeats,
+                                &foundLinear);
+  double nsIndexed = timeProfile(&fndcmd, lines, count, repeats,
+                                 &foundIndexed);
+ 
+  printf("profile: %d lines x %d repeats, %d lines are EE commands\n",
+    count, repeats, foundIndexed);
+  printf("  linear scan   : %8.1f ns/line\n", nsLinear);
+  printf("  command index : %8.1f ns/line  (%.1fx)\n",
+    nsIndexed, nsLinear / nsIndexed);
+ 
+  if (mismatches || foundLinear != foundIndexed) {
+    printf("** FAILED\n");
+    return 8;
+  }
+  return 0;
+}
+ 
+#endif
@@ -2037,6 +2037,177 @@ static bool CmdHelp(ScreenPtr scr, char *params, char *msg) {
   return false;
 }
  
+/*
+** keystroke macros
+**
+** While recording, each screen interaction is saved as a step holding the
+** prefix commands entered (with the line addressed relative to the current
+** line) and the command from the command line or the PF key pressed.
+** PLAY replays the steps on the host without any screen i/o in between, so
+** repeating an edit on many lines costs a single screen roundtrip.
+** Commands doing own screen i/o or leaving the file are not recorded.
+*/
+ 
+#define MACRO_STEPS 32
+#define MACRO_PREFIXES 8
+ 
+typedef struct _macroprefix {
+  int offset; /* line of the prefix command relative to the current line */
+  char prefixCmd[PREFIXLENGTH + 1];
+} MacroPrefix;
+ 
+typedef struct _macrostep {
+  char cmd[CMDLINELENGTH + 1]; /* the command, empty if only prefixes */
+  int prefixCount;
+  MacroPrefix prefixes[MACRO_PREFIXES];
+} MacroStep;
+ 
+static MacroStep macroSteps[MACRO_STEPS];
+static int macroStepCount = 0;
+static bool macroRecording = false;
+ 
+static bool CmdRecord(ScreenPtr scr, char *params, char *msg) {
+  if (!*params || isAbbrev(params, "ON")) {
+    memset(macroSteps, '\0', sizeof(macroSteps));
+    macroStepCount = 0;
+    macroRecording = true;
+    strcpy(msg, "Recording started, stop with RECORD OFF");
+  } else if (isAbbrev(params, "OFf")) {
+    if (macroRecording) {
+      sprintf(msg, "Recording stopped, %d steps recorded", macroStepCount);
+    }
+    macroRecording = false;
+  } else {
+    sprintf(msg, "invalid parameter for RECORD: '%s'", params);
+    return false;
+  }
+  params = getCmdParam(params);
+  checkNoParams(params, msg);
+  return false;
+}
+ 
+/* get the line 'offset' lines away from the current line, returning false
+   if this is outside the file (the top-of-file line has no LinePtr)
+*/
+static bool getRelativeLine(EditorPtr ed, int offset,
+                            LinePtr *line, unsigned int *lineNo) {
+  int no = getCurrLineNo(ed) + offset;
+  if (no < 0 || no > getLineCount(ed)) { return false; }
+  LinePtr l = getCurrentLine(ed);
+  while(offset > 0) { l = getNextLine(ed, l); offset--; }
+  while(offset < 0) { l = getPrevLine(ed, l); offset++; }
+  *line = l;
+  *lineNo = no;
+  return true;
+}
+ 
+/* execute a recorded step as if entered on the screen, returning false
+   if a prefix command addresses a line outside the file
+*/
+static bool playStep(ScreenPtr scr, MacroStep *step, bool *doneWithEE) {
+  int i;
+  for (i = 0; i < step->prefixCount; i++) {
+    MacroPrefix *mp = &step->prefixes[i];
+    PrefixInput *pi = &scr->cmdPrefixes[i];
+    if (!getRelativeLine(scr->ed, mp->offset, &pi->line, &pi->lineNo)) {
+      return false;
+    }
+    strcpy(pi->prefixCmd, mp->prefixCmd);
+  }
+  scr->cmdPrefixesAvail = step->prefixCount;
+  scr->inputLinesAvail = 0;
+  scr->aidCode = Aid_Enter;
+  strcpy(scr->cmdLine, step->cmd);
+ 
+  execPrefixesCmds(scr, false);
+  if (*scr->cmdLine && scr->aidCode == Aid_Enter) {
+    *doneWithEE = execCommand(scr, scr->cmdLine, scr->msgText, false);
+  }
+  return true;
+}
+ 
+static bool CmdPlay(ScreenPtr scr, char *params, char *msg) {
+  if (!scr->ed) { return false; }
+  int count = 1;
+  bool toEOF = false;
+  if (*params == '*') {
+    toEOF = true;
+    params = getCmdParam(params);
+  } else if (tryParseInt(params, &count)) {
+    params = getCmdParam(params);
+  }
+  checkNoParams(params, msg);
+  if (macroRecording) {
+    strcpy(msg, "PLAY not possible while recording");
+    return false;
+  }
+  if (macroStepCount == 0) {
+    strcpy(msg, "No macro recorded");
+    return false;
+  }
+  if (count < 1) { return false; }
+ 
+  /* the steps use the screen input fields, so save the real input */
+  char savedCmdLine[CMDLINELENGTH + 1];
+  memcpy(savedCmdLine, scr->cmdLine, sizeof(savedCmdLine));
+  int savedAidCode = scr->aidCode;
+  unsigned int savedPrefixesAvail = scr->cmdPrefixesAvail;
+  unsigned int savedInputLinesAvail = scr->inputLinesAvail;
+  char *savedMsgText = scr->msgText;
+ 
+  /* messages of the steps are dropped, except the last one */
+  char stepMsg[512];
+  scr->msgText = stepMsg;
+ 
+  bool doneWithEE = false;
+  bool outOfFile = false;
+  int iterations = 0;
+  while(!doneWithEE && scr->ed && (toEOF || iterations < count)) {
+    /* with '*', each iteration must come closer to the end of file */
+    int distanceToEOF = getLineCount(scr->ed) - getCurrLineNo(scr->ed);
+ 
+    int i;
+    for (i = 0; i < macroStepCount && !doneWithEE && scr->ed; i++) {
+      stepMsg[0] = '\0';
+      if (!playStep(scr, &macroSteps[i], &doneWithEE)) {
+        outOfFile = true;
+        break;
+      }
+    }
+    if (outOfFile) { break; }
+    iterations++;
+ 
+    if (toEOF && !doneWithEE && scr->ed
+        && (getLineCount(scr->ed) - getCurrLineNo(scr->ed)) >= distanceToEOF) {
+      break;
+    }
+  }
+ 
+  memcpy(scr->cmdLine, savedCmdLine, sizeof(savedCmdLine));
+  scr->aidCode = savedAidCode;
+  scr->cmdPrefixesAvail = savedPrefixesAvail;
+  scr->inputLinesAvail = savedInputLinesAvail;
+  scr->msgText = savedMsgText;
+ 
+  if (doneWithEE) { return true; }
+ 
+  if (*msg) { strcat(msg, "\n"); }
+  char *m = &msg[strlen(msg)];
+  if (*stepMsg) {
+    strncpy(m, stepMsg, 240);
+    m[240] = '\0';
+    strcat(m, "\n");
+    m = &m[strlen(m)];
+  }
+  if (outOfFile) {
+    sprintf(m, "PLAY stopped after %d iterations: line outside of file",
+      iterations);
+  } else {
+    sprintf(m, "PLAY: %d iterations executed", iterations);
+  }
+  return false;
+}
+ 
 typedef struct _lockblock {
   struct _lockblock *next;
   char dummy[40956];
@@ -2076,74 +2247,11 @@ typedef struct _mycmddef {
   CmdImpl impl;
 } MyCmdDef;
  
+#define EECMD(name, impl) {name, &impl},
 static MyCmdDef eeCmds[] = {
-  {"ATTR", &CmdAttr},
-  {"BOTtom", &CmdBottom},
-  {"CASe", &CmdCase},
-  {"Change", &CmdChange},
-  {"CMDLine", &CmdCmdline},
-  {"CMS", &CmdCms},
-  {"CURRLine", &CmdCurrline},
-  {"DELete", &CmdDelete},
-  {"EEdit", &CmdEditFile},
-  {"EXIt", &CmdExit},
-  {"FFILe", &CmdFFile},
-  {"FILe", &CmdFile},
-  {"FSLIst", &CmdFSList},
-  {"FTDEFaults", &CmdFtDefaults},
-  {"FTTABDEFaults", &CmdFtTabs},
-  {"GAPFill", &CmdGapFill},
-  {"GET", &CmdGet},
-  {"GETD", &CmdGetD},
-  {"Help", &CmdHelp},
-  {"INFOLines", &CmdInfolines},
-  {"Input", &CmdInput},
-  {"Locate", &CmdLocate},
-  {"LRECL", &CmdLrecl},
-  {"MARK", &CmdMark},
-#if 0
-  {"MEMLOCK", &CmdMemLock},     /* consume all memory to test EE's behaviour */
-  {"MEMUNLOCK", &CmdMemUnLock}, /* release the memory again */
-#endif
-  {"MOVEHere", &CmdMoveHere},
-  {"MSGLines", &CmdMsglines},
-  {"Next", &CmdNext},
-  {"NULls", &CmdNulls},
-  {"NUMbers", &CmdNumbers},
-  {"PF", &CmdPf},
-  {"PGDOwn", &CmdPgDown},
-  {"PGUP", &CmdPgUp},
-  {"PInput", &CmdProgrammersInput},
-  {"PREFIX", &CmdPrefix},
-  {"PPUT", &CmdPPut},
-  {"PPUTD", &CmdPPutD},
-  {"PUT", &CmdPut},
-  {"PUTD", &CmdPutD},
-  {"Previous", &CmdPrevious},
-  {"QQuit", &CmdQQuit},
-  {"Quit", &CmdQuit},
-  {"RECFM", &CmdRecfm},
-  {"RESet", &CmdReset},
-  {"REVSEArchnext", &CmdReverseSearchNext},
-  {"RSEArchnext", &CmdReverseSearchNext},
-  {"RINGNext", &CmdRingNext},
-  {"RINGPrev", &CmdRingPrev},
-  {"RN", &CmdRingNext},
-  {"RP", &CmdRingPrev},
-  {"SAVe", &CmdSave},
-  {"SCALe", &CmdScale},
-  {"SEArchnext", &CmdSearchNext},
-  {"SHIFT", &CmdShift},
-  {"SHIFTCONFig", &CmdShiftConfig},
-  {"SPLTJoin", &CmdSplitjoin},
-  {"SSAVe", &CmdSSave},
-  {"TABBackward", &CmdTabBackward},
-  {"TABforward", &CmdTabForward},
-  {"TABSet", &CmdTabs},
-  {"TOp", &CmdTop},
-  {"UNBINARY", &CmdUnbinary},
-  {"WORKLrecl", &CmdWorkLrecl}
+#include "eecmdtb.h"
 };
+#undef EECMD
  
 void initCmds() {
   memset(pfCmds, '\0', sizeof(pfCmds));
@@ -2265,6 +2373,84 @@ void unrHist() {
   moveToBOF(commandHistory);
 }
  
+/* can the command be replayed without screen i/o and in the same file ? */
+static bool isRecordable(char *cmd) {
+  MyCmdDef *cmdDef = (MyCmdDef*)findCommand(
+    cmd,
+    (CmdDef*)eeCmds,
+    sizeof(eeCmds) / sizeof(MyCmdDef));
+  if (!cmdDef) { return true; }
+  CmdImpl impl = cmdDef->impl;
+  if (impl == &CmdInput) {
+    char *params = getCmdParam(cmd);
+    return (params && *params); /* input mode is interactive */
+  }
+  return (impl != &CmdRecord
+          && impl != &CmdPlay
+          && impl != &CmdProgrammersInput
+          && impl != &CmdHelp
+          && impl != &CmdFSList
+          && impl != &CmdCms
+          && impl != &CmdEditFile
+          && impl != &CmdQuit
+          && impl != &CmdQQuit
+          && impl != &CmdFile
+          && impl != &CmdFFile
+          && impl != &CmdExit);
+}
+ 
+/* prefix commands entered on the screen, except the overtype protection */
+static bool isRecordablePrefix(PrefixInput *pi) {
+  return (pi->prefixCmd[0] && strcmp(pi->prefixCmd, "@") != 0);
+}
+ 
+void rcStep(ScreenPtr scr) {
+  if (!macroRecording || !scr->ed) { return; }
+ 
+  char *cmd = NULL;
+  int aidIdx = aidPfIndex(scr->aidCode);
+  if (aidIdx == 0) {
+    cmd = scr->cmdLine;
+  } else if (aidIdx > 0 && aidIdx < 25) {
+    cmd = pfCmds[aidIdx];
+    if (sncmp(cmd, "RECALL") == 0 || sncmp(cmd, "CLRCMD") == 0) {
+      cmd = NULL;
+    }
+  }
+  if (cmd) {
+    while(*cmd == ' ') { cmd++; }
+    if (isAbbrev(cmd, "Quit") || isAbbrev(cmd, "QQuit")) { return; }
+    if (!isRecordable(cmd)) { cmd = NULL; }
+  }
+ 
+  int prefixCount = 0;
+  int i;
+  for (i = 0; i < scr->cmdPrefixesAvail; i++) {
+    if (isRecordablePrefix(&scr->cmdPrefixes[i])) { prefixCount++; }
+  }
+  if (prefixCount == 0 && (!cmd || !*cmd)) { return; }
+ 
+  if (macroStepCount >= MACRO_STEPS || prefixCount > MACRO_PREFIXES) {
+    macroRecording = false;
+    if (*scr->msgText) { strcat(scr->msgText, "\n"); }
+    sprintf(&scr->msgText[strlen(scr->msgText)],
+      "Macro too long, recording stopped after %d steps", macroStepCount);
+    return;
+  }
+ 
+  MacroStep *step = &macroSteps[macroStepCount++];
+  memset(step, '\0', sizeof(MacroStep));
+  if (cmd) { strncpy(step->cmd, cmd, CMDLINELENGTH); }
+  int currLineNo = getCurrLineNo(scr->ed);
+  for (i = 0; i < scr->cmdPrefixesAvail; i++) {
+    PrefixInput *pi = &scr->cmdPrefixes[i];
+    if (!isRecordablePrefix(pi)) { continue; }
+    MacroPrefix *mp = &step->prefixes[step->prefixCount++];
+    mp->offset = (int)pi->lineNo - currLineNo;
+    strcpy(mp->prefixCmd, pi->prefixCmd);
+  }
+}
+ 
 static bool handleProfileLine(void *userdata, char *cmdline, char *msg) {
   ScreenPtr scr = (ScreenPtr)userdata;
   return execCmd(scr, cmdline, msg, false);
@@ -0,0 +1,89 @@
+/*
+** EECMDTB.H   - MECAFF EE-editor command table
+**
+** This file is part of the MECAFF based fullscreen tools of MECAFF
+** for VM/370 R6 "SixPack".
+**
+** This file lists the commands of EE with their abbreviation and the name
+** of the implementing routine, each as EECMD(name, impl). It is included by
+** EECMDS for the command table 'eeCmds' and by the command lookup benchmark
+** EEBNCH, each defining the macro EECMD() for its table entries.
+**
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012,2013
+** Released to the public domain.
+*/
+ 
+  EECMD("ATTR", CmdAttr)
+  EECMD("BOTtom", CmdBottom)
+  EECMD("CASe", CmdCase)
+  EECMD("Change", CmdChange)
+  EECMD("CMDLine", CmdCmdline)
+  EECMD("CMS", CmdCms)
+  EECMD("CURRLine", CmdCurrline)
+  EECMD("DELete", CmdDelete)
+  EECMD("EEdit", CmdEditFile)
+  EECMD("EXIt", CmdExit)
+  EECMD("FFILe", CmdFFile)
+  EECMD("FILe", CmdFile)
+  EECMD("FSLIst", CmdFSList)
+  EECMD("FTDEFaults", CmdFtDefaults)
+  EECMD("FTTABDEFaults", CmdFtTabs)
+  EECMD("GAPFill", CmdGapFill)
+  EECMD("GET", CmdGet)
+  EECMD("GETD", CmdGetD)
+  EECMD("Help", CmdHelp)
+  EECMD("INFOLines", CmdInfolines)
+  EECMD("Input", CmdInput)
+  EECMD("Locate", CmdLocate)
+  EECMD("LRECL", CmdLrecl)
+  EECMD("MARK", CmdMark)
+#if 0
+  EECMD("MEMLOCK", CmdMemLock)       /* consume all memory to test EE's behaviour */
+  EECMD("MEMUNLOCK", CmdMemUnLock)   /* release the memory again */
+#endif
+  EECMD("MOVEHere", CmdMoveHere)
+  EECMD("MSGLines", CmdMsglines)
+  EECMD("Next", CmdNext)
+  EECMD("NULls", CmdNulls)
+  EECMD("NUMbers", CmdNumbers)
+  EECMD("PF", CmdPf)
+  EECMD("PGDOwn", CmdPgDown)
+  EECMD("PGUP", CmdPgUp)
+  EECMD("PInput", CmdProgrammersInput)
+  EECMD("PLAY", CmdPlay)
+  EECMD("PREFIX", CmdPrefix)
+  EECMD("PPUT", CmdPPut)
+  EECMD("PPUTD", CmdPPutD)
+  EECMD("PUT", CmdPut)
+  EECMD("PUTD", CmdPutD)
+  EECMD("Previous", CmdPrevious)
+  EECMD("QQuit", CmdQQuit)
+  EECMD("Quit", CmdQuit)
+  EECMD("RECFM", CmdRecfm)
+  EECMD("RECord", CmdRecord)
+  EECMD("RESet", CmdReset)
+  EECMD("REVSEArchnext", CmdReverseSearchNext)
+  EECMD("RSEArchnext", CmdReverseSearchNext)
+  EECMD("RINGNext", CmdRingNext)
+  EECMD("RINGPrev", CmdRingPrev)
+  EECMD("RN", CmdRingNext)
+  EECMD("RP", CmdRingPrev)
+  EECMD("SAVe", CmdSave)
+  EECMD("SCALe", CmdScale)
+  EECMD("SEArchnext", CmdSearchNext)
+  EECMD("SHIFT", CmdShift)
+  EECMD("SHIFTCONFig", CmdShiftConfig)
+  EECMD("SPLTJoin", CmdSplitjoin)
+  EECMD("SSAVe", CmdSSave)
+  EECMD("TABBackward", CmdTabBackward)
+  EECMD("TABforward", CmdTabForward)
+  EECMD("TABSet", CmdTabs)
+  EECMD("TOp", CmdTop)
+  EECMD("UNBINARY", CmdUnbinary)
+  EECMD("WORKLrecl", CmdWorkLrecl)
@@ -574,7 +574,7 @@ static void recomputeCurrentLineNo(EditorPtr ed) {
     ed->lineCurrentNo = 0;
     return;
   }
-  LinePtr _cand = ed->lineBOF;
+  LinePtr _cand = ed->lineBOF->next;
   LinePtr _guard = ed->lineEOF;
   int currNo = 0;
   while(_cand != _guard) {
@@ -1167,6 +1167,7 @@ LinePtr insline(EditorPtr ed, char *lineText) {
  
   /* set new line as current line */
   ed->lineCurrent = linep;
+  ed->lineCurrentNo++;
  
   /* return the new line */
   return linep;
@@ -1051,6 +1051,9 @@ int doEdit(char *fn, char *ft, char *fm, char *messages) {
           }
         }
  
+        /* save the input as macro step if recording (overwrites excluded) */
+        recordMacroStep(scr);
+ 
         /* process prefix operations */
         cursorPlaced = execPrefixesCmds(scr, cursorPlaced);
  
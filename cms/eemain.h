@@ -235,6 +235,16 @@ extern void unrHist();
   unrHist()
  
  
+/* if a keystroke macro is being recorded (command RECORD), add the prefix
+   commands and the command (command line or PF key) entered on the screen
+   as next step of the macro.
+   Must be called before the screen input is processed.
+*/
+extern void rcStep(ScreenPtr scr);
+#define recordMacroStep(scr) \
+  rcStep(scr)
+ 
+ 
 /* process the command file 'fn EE *', returning if EE is to be closed.
    The outcome is given in 'rc':
      0 => ok
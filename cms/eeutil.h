@@ -231,6 +231,8 @@ typedef bool (*CmdLineHandler)(void *userdata, char *cmdline, char *msg);
  
 /* read a profile '<fn> EE *' and invoke 'handler' for each command line
    found, stopping at the first 'true' returned from 'handler'.
+   The command lines are cached in the work file '<fn> EE$CACHE A1' and
+   replayed from there as long as the profile is unchanged.
 */
 extern bool doCmdFil(CmdLineHandler handler, void *userdata, char *fn, int *rc);
  
@@ -240,8 +242,10 @@ typedef struct _cmddef {
 } CmdDef;
  
 /* find an (abbreviated) command in a command-definition-list
-   'cmdList' must be sorted
-   returns NULL is 'candidate' was not found
+   returns the first command in 'cmdList' matching 'cand' (see isAbbrev)
+   or NULL if 'cand' was not found.
+   'cmdList' must be a static array, as an index is built for longer lists
+   on the first lookup and kept for later lookups
 */
 extern CmdDef* fndcmd(char *cand, CmdDef *cmdList, unsigned int cmdCount);
 #define findCommand(cand, cmdlist, cmdcount) \
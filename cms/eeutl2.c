@@ -20,6 +20,7 @@
 #include "glblpre.h"
  
 #include <stdio.h>
+#include <string.h>
  
 #include "eeutil.h"
  
@@ -86,45 +87,415 @@ bool tryParseInt(char *arg, int *value) {
   return true;
 }
  
-/* find a command in the command list
+/*
+** command lookup
+**
+** Looking up a command with a linear scan over the command list costs one
+** isAbbrev() per command for each command line (typed, from PF-keys or from
+** profiles).
+** So for longer lists, an index is built on the first lookup holding the
+** positions of the commands sorted by their minimal abbreviation (the leading
+** uppercase part of the command name, e.g. "CMDL" for "CMDLine").
+** A candidate can only match commands whose minimal abbreviation is a prefix
+** of the (uppercased) first token of the candidate, so the index is walked
+** like a trie: the range of commands whose abbreviation starts with the first
+** n characters of the token is narrowed with a binary search on the next
+** character, and only the commands with an abbreviation of exactly n characters
+** (coming first in the range) are checked with isAbbrev().
 */
-CmdDef* fndcmd(char *cand, CmdDef *cmdList, unsigned int cmdCount) {
-  if (!cand || !*cand) { return NULL; }
-  if (cmdCount == 0) { return NULL; }
  
-  /* binary search does not work, as 'cand' may be an abbreviation
-  ** that could break the sort order:
-  **   cand: i
-  **   cmds: .. FILe INFOLine Input ...
-  ** (if 'INFOLine' is checked before 'Input', next 'FILe' will be tested...)
-  int first = 0;
-  int last = cmdCount - 1;
-  int middle = first;
-  while(first <= last) {
-    int middle = (first + last) / 2;
-    CmdDef *currCmd = &cmdList[middle];
-    if (isAbbrev(cand, currCmd->commandName)) { return currCmd; }
-    if (sncmp(cand, currCmd->commandName) < 0) {
-      last = middle - 1;
-    } else {
-      first = middle + 1;
+/* lists shorter than this are simply scanned */
+#define MIN_INDEXED_CMDS 12
+ 
+/* max. number of indexed lists and of commands in all indexed lists */
+#define MAX_CMDINDEXES 8
+#define MAX_INDEXED_CMDS 256
+ 
+/* max. length of a minimal abbreviation for the index */
+#define MAX_CMDTOKEN 32
+ 
+typedef struct _cmdindex {
+  CmdDef *cmdList;          /* the command list ... */
+  unsigned int cmdCount;    /* ... and its length identify the index */
+  bool usable;              /* false if an abbreviation is too long */
+  unsigned int first;       /* start of the index in 'idxCmdNo' */
+  int maxAbbrevLen;         /* longest minimal abbreviation */
+} CmdIndex;
+ 
+static CmdIndex cmdIndexes[MAX_CMDINDEXES];
+static int cmdIndexCount = 0;
+ 
+/* the indexes: position of the command in the list and the length of
+   its minimal abbreviation, sorted by minimal abbreviation */
+static unsigned short idxCmdNo[MAX_INDEXED_CMDS];
+static unsigned char idxAbbrevLen[MAX_INDEXED_CMDS];
+static unsigned int idxUsed = 0;
+ 
+/* compare 2 uppercase keys, with the shorter one being less if it is a
+   prefix of the longer one
+*/
+static int cmpkey(char *key1, int len1, char *key2, int len2) {
+  int len = (len1 < len2) ? len1 : len2;
+  int i;
+  for (i = 0; i < len; i++) {
+    if (key1[i] != key2[i]) {
+      return (int)((unsigned char)key1[i]) - (int)((unsigned char)key2[i]);
     }
   }
-  if (isAbbrev(cand, cmdList[middle].commandName)) {
-    return &cmdList[middle];
+  return len1 - len2;
+}
+ 
+/* get the index for a command list, building it if necessary, returning
+   NULL if the list is to be scanned linearly
+*/
+static CmdIndex* getCmdIndex(CmdDef *cmdList, unsigned int cmdCount) {
+  if (cmdCount < MIN_INDEXED_CMDS) { return NULL; }
+ 
+  int i;
+  for (i = 0; i < cmdIndexCount; i++) {
+    CmdIndex *idx = &cmdIndexes[i];
+    if (idx->cmdList == cmdList && idx->cmdCount == cmdCount) {
+      return (idx->usable) ? idx : NULL;
+    }
+  }
+ 
+  if (cmdIndexCount >= MAX_CMDINDEXES
+      || (idxUsed + cmdCount) > MAX_INDEXED_CMDS) {
+    return NULL;
+  }
+ 
+  CmdIndex *idx = &cmdIndexes[cmdIndexCount++];
+  idx->cmdList = cmdList;
+  idx->cmdCount = cmdCount;
+  idx->usable = false;
+  idx->first = idxUsed;
+  idx->maxAbbrevLen = 0;
+ 
+  /* insertion sort, keeping the list order for equal abbreviations */
+  unsigned short *cmdNos = &idxCmdNo[idxUsed];
+  unsigned char *abbrevLens = &idxAbbrevLen[idxUsed];
+  unsigned int cmdNo;
+  for (cmdNo = 0; cmdNo < cmdCount; cmdNo++) {
+    char *name = cmdList[cmdNo].commandName;
+    int len = 0;
+    while(name[len] && c_lower(name[len]) != name[len]) { len++; }
+    if (len > MAX_CMDTOKEN) { return NULL; }
+    idx->maxAbbrevLen = maxInt(idx->maxAbbrevLen, len);
+ 
+    int pos = cmdNo;
+    while(pos > 0
+          && cmpkey(cmdList[cmdNos[pos-1]].commandName, abbrevLens[pos-1],
+                    name, len) > 0) {
+      cmdNos[pos] = cmdNos[pos-1];
+      abbrevLens[pos] = abbrevLens[pos-1];
+      pos--;
+    }
+    cmdNos[pos] = cmdNo;
+    abbrevLens[pos] = len;
   }
-  */
+  idxUsed += cmdCount;
+  idx->usable = true;
  
-  /* instead -> simple impl. == a simple loop */
+  return idx;
+}
+ 
+/* find a command with a linear scan of the command list
+*/
+static CmdDef* scancmd(char *cand, CmdDef *cmdList, unsigned int cmdCount) {
   unsigned int i;
   for (i = 0; i < cmdCount; i++) {
     if (isAbbrev(cand, cmdList->commandName)) { return cmdList; }
     cmdList++;
   }
- 
   return NULL;
 }
  
+/* find a command in the command list
+*/
+CmdDef* fndcmd(char *cand, CmdDef *cmdList, unsigned int cmdCount) {
+  if (!cand || !*cand) { return NULL; }
+  if (cmdCount == 0) { return NULL; }
+ 
+  CmdIndex *idx = getCmdIndex(cmdList, cmdCount);
+  if (!idx) { return scancmd(cand, cmdList, cmdCount); }
+ 
+  /* get the uppercased command token as isAbbrev() sees it, as far as
+     relevant for the minimal abbreviations */
+  char token[MAX_CMDTOKEN];
+  int tokLen = 0;
+  while(tokLen < idx->maxAbbrevLen && c_isalpha(cand[tokLen])) {
+    token[tokLen] = c_upper(cand[tokLen]);
+    tokLen++;
+  }
+ 
+  /* walk the index: the commands in lo..hi-1 have a minimal abbreviation
+     starting with the first 'len' chars of the token, the ones having
+     exactly these chars as abbreviation come first; if more than one command
+     matches, the first in the list wins (as with the scan) */
+  unsigned short *cmdNos = &idxCmdNo[idx->first];
+  unsigned char *abbrevLens = &idxAbbrevLen[idx->first];
+  unsigned int found = cmdCount;
+  unsigned int lo = 0;
+  unsigned int hi = cmdCount;
+  int len = 0;
+  while(lo < hi) {
+    while(lo < hi && abbrevLens[lo] == len) {
+      if (cmdNos[lo] < found
+          && isAbbrev(cand, cmdList[cmdNos[lo]].commandName)) {
+        found = cmdNos[lo];
+      }
+      lo++;
+    }
+    if (len >= tokLen) { break; }
+ 
+    /* narrow the range to the commands having the next token char */
+    unsigned char c = (unsigned char)token[len];
+    unsigned int first = lo;
+    unsigned int last = hi;
+    while(first < last) {
+      unsigned int middle = (first + last) / 2;
+      if ((unsigned char)cmdList[cmdNos[middle]].commandName[len] < c) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    lo = first;
+    last = hi;
+    while(first < last) {
+      unsigned int middle = (first + last) / 2;
+      if ((unsigned char)cmdList[cmdNos[middle]].commandName[len] <= c) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    hi = first;
+    len++;
+  }
+ 
+  return (found < cmdCount) ? &cmdList[found] : NULL;
+}
+ 
+/* pass a command line to the handler, printing the message produced */
+static void dispatch(CmdLineHandler handler, void *userdata, char *line,
+                     char *msg, int *rc, bool *doneWithFile) {
+  msg[0] = '\0';
+  *doneWithFile |= handler(userdata, line, msg);
+  if (msg[0]) {
+    printf("%s\n", msg);
+    *rc = 2; /* some message issued */
+  }
+}
+ 
+#ifndef _NOCMS
+ 
+/*
+** profile cache
+**
+** The command lines of a profile '<fn> EE *' (after removing comments and
+** empty lines and merging continuation lines) are saved in the binary work
+** file '<fn> EE$CACHE A1': a header record identifying the profile by its
+** date/time, size and format, followed by one record for each command line.
+** The header also holds the number of command lines and their total length,
+** so the cache is checked to be complete before the first line is replayed.
+** If the profile did not change since the cache was written, the command lines
+** are replayed from the cache instead of reading and parsing the profile,
+** else the cache is rebuilt while processing the profile.
+** The cache is written under a temporary name and renamed when complete, so
+** a '<fn> EE$CACHE' file always holds all command lines of the profile.
+** As the FST time has a resolution of minutes, the cache is only used if it
+** was written in a later minute than the profile (the profile could have been
+** changed again in the minute the cache was written).
+*/
+ 
+#define CACHE_FT "EE$CACHE"
+#define CACHE_TMP_FT "EE$CTEMP"
+#define CACHE_VERSION 2
+#define CACHE_LRECL 513
+ 
+typedef struct _cachehdr {
+  char magic[8];            /* "EEPCACHE" */
+  short version;            /* CACHE_VERSION */
+  short fileYear;           /* date/time of the profile ... */
+  short filedate;
+  short filetime;
+  int numRecords;           /* ... and its size and format */
+  int lrecl;
+  char format;
+  int numLines;             /* content of the cache (not part of the stamp) */
+  int numBytes;
+} CacheHeader;
+ 
+static const char *_FILE_NAME_ = "eeutl2.c";
+ 
+/* build the CMS fileid for 'fn ft fm' */
+static void buildFid(char *fid, char *fn, char *ft, char *fm) {
+  memset(fid, ' ', 18);
+  fid[18] = '\0';
+  int i;
+  for (i = 0; i < 8 && fn[i]; i++) { fid[i] = c_upper(fn[i]); }
+  for (i = 0; i < 8 && ft[i]; i++) { fid[8+i] = c_upper(ft[i]); }
+  for (i = 0; i < 2 && fm[i]; i++) { fid[16+i] = c_upper(fm[i]); }
+}
+ 
+/* get the header identifying the current version of the profile 'fn EE *',
+   returning false if the profile does not exist
+*/
+static bool getProfileStamp(char *fn, CacheHeader *hdr) {
+  char fid[19];
+  CMSFILEINFO *fInfo;
+ 
+  buildFid(fid, fn, "EE", "*");
+  if (CMSfileState(fid, &fInfo) != 0) { return false; }
+ 
+  memset(hdr, '\0', sizeof(CacheHeader));
+  memcpy(hdr->magic, "EEPCACHE", sizeof(hdr->magic));
+  hdr->version = CACHE_VERSION;
+  hdr->fileYear = (short)fInfo->fileYear;
+  hdr->filedate = (short)fInfo->filedate;
+  hdr->filetime = (short)fInfo->filetime;
+  hdr->numRecords = fInfo->numRecords;
+  hdr->lrecl = fInfo->lrecl;
+  hdr->format = fInfo->format;
+  return true;
+}
+ 
+/* check if the file 'fInfo' was written in a later minute than the profile
+   identified by 'stamp'
+*/
+static bool isYounger(CMSFILEINFO *fInfo, CacheHeader *stamp) {
+  unsigned short year = (unsigned short)fInfo->fileYear;
+  unsigned short date = (unsigned short)fInfo->filedate;
+  unsigned short time = (unsigned short)fInfo->filetime;
+  if (year != (unsigned short)stamp->fileYear) {
+    return (year > (unsigned short)stamp->fileYear);
+  }
+  if (date != (unsigned short)stamp->filedate) {
+    return (date > (unsigned short)stamp->filedate);
+  }
+  return (time > (unsigned short)stamp->filetime);
+}
+ 
+/* replay the command lines of the cache for the profile 'fn', returning
+   false if there is no complete cache for the current version of the profile
+   (the cache is read completely before the first line is dispatched, so the
+   profile is either replayed completely or must be processed from source)
+*/
+static bool replayCache(CmdLineHandler handler, void *userdata, char *fn,
+                        CacheHeader *stamp, int *rc, bool *doneWithFile) {
+  char buffer[CACHE_LRECL + 1];
+  char msg[512];
+  char fid[19];
+  CMSFILE cmsfile;
+  CMSFILE *f = &cmsfile;
+  int bytesRead;
+ 
+  CMSFILEINFO *fInfo;
+  buildFid(fid, fn, CACHE_FT, "A1");
+  if (CMSfileState(fid, &fInfo) != 0) { return false; }
+  if (!isYounger(fInfo, stamp)) { return false; }
+  if (CMSfileOpen(fid, buffer, CACHE_LRECL, 'V', 1, 1, f) != 0) {
+    return false;
+  }
+  CacheHeader hdr;
+  int numLines = -1;
+  int numBytes = -1;
+  int cmsrc = CMSfileRead(f, 0, &bytesRead);
+  if (cmsrc == 0 && bytesRead == sizeof(CacheHeader)) {
+    memcpy(&hdr, buffer, sizeof(CacheHeader));
+    numLines = hdr.numLines;
+    numBytes = hdr.numBytes;
+    hdr.numLines = stamp->numLines;
+    hdr.numBytes = stamp->numBytes;
+  }
+  if (numLines < 0
+      || numBytes < 0
+      || memcmp(&hdr, stamp, sizeof(CacheHeader)) != 0) {
+    CMSfileClose(f);
+    return false;
+  }
+ 
+  /* read all command lines, each null-terminated in 'lines' */
+  char *lines = (char*)allocMem(numBytes + numLines + 1);
+  if (!lines) {
+    CMSfileClose(f);
+    return false;
+  }
+  char *l = lines;
+  int lineCount = 0;
+  int rest = numBytes;
+  cmsrc = CMSfileRead(f, 0, &bytesRead);
+  while(cmsrc == 0 && lineCount < numLines && bytesRead <= rest) {
+    memcpy(l, buffer, bytesRead);
+    l += bytesRead + 1;
+    rest -= bytesRead;
+    lineCount++;
+    cmsrc = CMSfileRead(f, 0, &bytesRead);
+  }
+  CMSfileClose(f);
+ 
+  /* a damaged cache is ignored and rebuilt from the profile */
+  if (cmsrc != 12 || lineCount != numLines || rest != 0) {
+    freeMem(lines);
+    CMSfileErase(fid);
+    return false;
+  }
+ 
+  l = lines;
+  while(lineCount-- > 0) {
+    dispatch(handler, userdata, l, msg, rc, doneWithFile);
+    l += strlen(l) + 1;
+  }
+  freeMem(lines);
+ 
+  return true;
+}
+ 
+/* start writing a new cache for the profile 'fn', returning false if
+   the cache cannot be written
+*/
+static bool createCache(char *fn, CacheHeader *stamp,
+                        CMSFILE *f, char *buffer) {
+  char fid[19];
+ 
+  buildFid(fid, fn, CACHE_TMP_FT, "A1");
+  CMSfileErase(fid);
+  int cmsrc = CMSfileOpen(fid, buffer, CACHE_LRECL, 'V', 1, 0, f);
+  if (cmsrc != 0 && cmsrc != 28) { return false; }
+  memcpy(buffer, stamp, sizeof(CacheHeader));
+  if (CMSfileWrite(f, 1, sizeof(CacheHeader)) != 0) {
+    CMSfileClose(f);
+    CMSfileErase(fid);
+    return false;
+  }
+  return true;
+}
+ 
+/* finish the new cache for the profile 'fn' by rewriting the header with
+   the counts in 'stamp', making it the current cache if it was completely
+   written
+*/
+static void finishCache(char *fn, CacheHeader *stamp,
+                        CMSFILE *f, char *buffer, bool ok) {
+  char fid[19];
+  char tmpFid[19];
+ 
+  if (ok) {
+    memcpy(buffer, stamp, sizeof(CacheHeader));
+    ok = (CMSfileWrite(f, 1, sizeof(CacheHeader)) == 0);
+  }
+  CMSfileClose(f);
+  buildFid(fid, fn, CACHE_FT, "A1");
+  buildFid(tmpFid, fn, CACHE_TMP_FT, "A1");
+  CMSfileErase(fid);
+  if (!ok || CMSfileRename(tmpFid, fid) != 0) {
+    CMSfileErase(tmpFid);
+  }
+}
+ 
+#endif
+ 
 /* read a profile '<fn> EE *' and invoke 'handler' for each command line
    found, stopping at the first 'false' returned from 'handler'.
 */
@@ -137,19 +508,38 @@ bool doCmdFil(CmdLineHandler handler, void *userdata, char *fn, int *rc) {
   int mergedRest = 0;
   char *merged = NULL;
  
-  memcpy(buffer, '\0', sizeof(buffer));
+  memset(buffer, '\0', sizeof(buffer));
+  memset(mergedLines, '\0', sizeof(mergedLines));
  
-  memcpy(buffer, '\0', sizeof(buffer));
   strncpy(buffer, fn, 8);
   sprintf(fspec, "%s EE * V 255", buffer);
  
+  bool doneWithFile = false;
   *rc = 1; /* file not found */
+ 
+#ifndef _NOCMS
+  char cacheBuffer[CACHE_LRECL + 1];
+  CMSFILE cachefile;
+  CacheHeader stamp;
+  if (!getProfileStamp(fn, &stamp)) { return false; }
+  *rc = 0; /* ok */
+  if (replayCache(handler, userdata, fn, &stamp, rc, &doneWithFile)) {
+    return doneWithFile;
+  }
+  *rc = 1;
+#else
   if (!f_exists(buffer, "EE", "*")) { return false; }
+#endif
+ 
   FILE *cmdfile = fopen(fspec, "r");
   if (!cmdfile) { return false; }
   *rc = 0; /* ok */
  
-  bool doneWithFile = false;
+#ifndef _NOCMS
+  bool caching = createCache(fn, &stamp, &cachefile, cacheBuffer);
+  bool cacheOk = caching;
+#endif
+ 
   char *line = fgets(buffer, sizeof(buffer), cmdfile);
   while(!feof(cmdfile)) {
     int len = strlen(line);
@@ -165,10 +555,11 @@ bool doCmdFil(CmdLineHandler handler, void *userdata, char *fn, int *rc) {
         mergedRest = sizeof(mergedLines) - 1; /* keep last null char */
       }
       len = minInt(len - 1, mergedRest);
-      if (len <= 0) { continue; }
-      memcpy(merged, line, len);
-      merged += len;
-      mergedRest -= len;
+      if (len > 0) {
+        memcpy(merged, line, len);
+        merged += len;
+        mergedRest -= len;
+      }
  
       line = fgets(buffer, sizeof(buffer), cmdfile);
       continue;
@@ -180,16 +571,19 @@ bool doCmdFil(CmdLineHandler handler, void *userdata, char *fn, int *rc) {
         memcpy(merged, line, len);
       }
       line = mergedLines;
-      len = 1;
+      len = strlen(line);
     }
  
     if (len > 0 && *line != '*') {
-      msg[0] = '\0';
-      doneWithFile |= handler(userdata, line, msg);
-      if (msg[0]) {
-        printf("%s\n", msg);
-        *rc = 2; /* some message issued */
+#ifndef _NOCMS
+      if (cacheOk) {
+        memcpy(cacheBuffer, line, len);
+        cacheOk = (CMSfileWrite(&cachefile, 0, len) == 0);
+        stamp.numLines++;
+        stamp.numBytes += len;
       }
+#endif
+      dispatch(handler, userdata, line, msg, rc, &doneWithFile);
     }
     memset(mergedLines, '\0', sizeof(mergedLines));
     merged = NULL;
@@ -197,6 +591,10 @@ bool doCmdFil(CmdLineHandler handler, void *userdata, char *fn, int *rc) {
   }
   fclose(cmdfile);
  
+#ifndef _NOCMS
+  if (caching) { finishCache(fn, &stamp, &cachefile, cacheBuffer, cacheOk); }
+#endif
+ 
   return doneWithFile;
 }
  
@@ -815,6 +815,8 @@ static int consoleConnected = false;
 static int transportVersion = -1;
 static int consoleSessionId = -1;
 static int consoleSessionMode = -1;
+static bool localFsRestore = false; /* MECAFF restores an overwritten fullscreen? */
+static int dftBufferSize = 0; /* terminal's buffer size for DFT transfers, 0 = no DFT */
  
 /* chunksize: size in bytes of a chunk of a 3270 stream block before encoding */
 #define CHUNKSIZE_3215 60
@@ -937,6 +939,18 @@ int __qtrm2(
     Version_Sub_MECAFF = decodeInt();
   }
  
+  localFsRestore = false;
+  if (transportVersion > 3) {
+    localFsRestore = (decodeInt() != 0);
+    if (_hadEncodingError) { localFsRestore = false; }
+  }
+ 
+  dftBufferSize = 0;
+  if (transportVersion > 4) {
+    dftBufferSize = decodeInt();
+    if (_hadEncodingError || dftBufferSize < 0) { dftBufferSize = 0; }
+  }
+ 
   /* session and connection specific data */
   consoleSessionId = *sessionId;
   consoleSessionMode = *sessionMode;
@@ -1214,6 +1228,30 @@ bool __fsqvrs(
   return havingConsole;
 }
  
+bool __fsdlta() {
+  /* check known connection status */
+  if (!consoleTested || !consoleConnected) {
+    if (checkConsoleFails()) { return false; }
+  }
+ 
+  /* with DIAG58, the screen is lost when CP writes to the console */
+  if (useDIAG58) { return false; }
+ 
+  return localFsRestore;
+}
+ 
+int __fsqdft() {
+  /* check known connection status */
+  if (!consoleTested || !consoleConnected) {
+    if (checkConsoleFails()) { return 0; }
+  }
+ 
+  /* with DIAG58, PGT3270 can only do EraseWrite, so no WSF */
+  if (useDIAG58) { return 0; }
+ 
+  return dftBufferSize;
+}
+ 
 /* full screen write via MECAFF-console
  
   retval:
@@ -1221,7 +1259,7 @@ bool __fsqvrs(
     1 = 3270-command EraseWrite[Alternate] needed (e.g. Write not allowed)
     2 = no fs-support
     3 = re-query console information, ensure for a MECAFF-console
-    4 = unsupported 3270-command (i.e. WSF, RB, RM, RMA)
+    4 = unsupported 3270-command (i.e. RB, RM, RMA, WSF with DIAG58)
 */
 int __fswr(char *rawdata, int rawdatalength) {
   /* check known connection status */
@@ -1245,6 +1283,8 @@ int __fswr(char *rawdata, int rawdatalength) {
     cmdType = 2;
   } else if (*rawdata == (char)0x6F) { /* EraseAllUnprotected */
     cmdType = 3;
+  } else if (*rawdata == (char)0xF3) { /* WriteStructuredField */
+    cmdType = 4;
   } else {
     return 4; /* other command -> unsupported */
   }
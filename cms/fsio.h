@@ -143,6 +143,30 @@ extern bool __fsqvrs(
     int *apiMajor, int *apiMinor, int *apiSub);
  
  
+/* check if the MECAFF-console restores the last fullscreen content by itself
+   after the screen was overwritten (e.g. by CP messages), so a program may
+   continue with a Write (i.e. only the changes) instead of EraseWrite[Alternate]
+ 
+  retval: screen restored by MECAFF (true) or full repaint needed (false)?
+*/
+extern bool __fsdlta();
+ 
+ 
+/* get the buffer size for DFT file transfers (data sent with WSF and received
+   as inbound structured fields), as announced by the terminal in the DDM reply
+   to the WSF-query; DFT needs a MECAFF-console (WSF is unsupported with DIAG58)
+ 
+  retval: max. length of a DFT transmission, 0 if DFT is not available
+*/
+extern int __fsqdft();
+ 
+ 
+/* use the fast DIAG-58 write+read for the next __fswr/__fsrdp pair
+   (ignored when connected to a MECAFF-console)
+*/
+extern void __fast58();
+ 
+ 
 /* full screen write via MECAFF-console
  
  retval:
@@ -150,7 +174,7 @@ extern bool __fsqvrs(
     1 = 3270-command EraseWrite[Alternate] needed (i.e. Write not allowed)
     2 = no fs-support
     3 = re-query console information, ensure for a MECAFF-console
-    4 = unsupported 3270-command (i.e. WSF, RB, RM, RMA)
+    4 = unsupported 3270-command (i.e. RB, RM, RMA, WSF with DIAG58)
 */
 extern int __fswr(char *rawdata, int rawdatalength);
  
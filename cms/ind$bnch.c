@@ -0,0 +1,684 @@
+/*
+** IND$BNCH - loopback throughput benchmark for IND$FILE
+**
+** This file is part of the MECAFF-API based IND$FILE implementation
+** for VM/370 R6 "SixPack".
+**
+** This module allows to measure the IND$FILE CUT-mode protocol outside
+** from CMS (i.e. on Linux): it provides in-memory stand-ins for the CMS file
+** interface and for the fullscreen i/o of the MECAFF-API, where a scripted
+** CUT-mode terminal on the other side acknowledges the panels, decodes the
+** data of downloads, sends the encoded data of uploads and finally checks the
+** file transferred.
+** The transfers are done for text (ASCII) and binary data, with the default
+** 24x80 screen and larger alternate screens, each transfer being run in
+** a child process to start with the initial state of the IND$FILE modules.
+**
+** Reported are the encoded bytes and the panels (frames) per MByte of file
+** data, the throughput and the CPU time per encoded byte on the host side
+** (i.e. without the time spent in the simulated terminal) and the number of
+** CMS file calls (including the checkpoint file of downloads).
+** Finally the round-trip of all byte values through the encoding and decoding
+** tables is checked for binary and ascii transfers.
+** The exit code is 0 if all transfers and round-trips were correct, else 1.
+**
+** Build (the GCC for CMS has unsigned chars):
+**
+**   gcc -O2 -funsigned-char -D_NOCMS -o indbnch ind\$bnch.c ind\$file.c \
+**       ind\$denc.c ind\$scrn.c ind\$dft.c
+**
+** Invocation:
+**
+**   indbnch [ KBytes ]
+**
+** with KBytes being the size of the binary test file (default: 1024), the
+** text test file has the same number of records.
+**
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2012,2013
+** Released to the public domain.
+*/
+ 
+#ifdef _NOCMS
+ 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+ 
+#include "fsio.h"
+#include "ind$file.h"
+ 
+/*
+** in-memory files
+*/
+ 
+#define MAX_FILES 8
+ 
+typedef struct _memfile {
+  bool   used;
+  char   fid[18];
+  char   format;
+  int    lrecl;
+  int    count;     /* number of records in the file */
+  int    capacity;  /* allocated record slots */
+  char **recs;
+  int   *lens;
+} MemFile;
+ 
+static MemFile files[MAX_FILES];
+static CMSFILEINFO fileInfo;
+static int fileCalls = 0; /* number of CMS read and write calls */
+ 
+static MemFile* findFile(char *fid) {
+  int i;
+  for (i = 0; i < MAX_FILES; i++) {
+    if (files[i].used && memcmp(files[i].fid, fid, 18) == 0) {
+      return &files[i];
+    }
+  }
+  return NULL;
+}
+ 
+static MemFile* createFile(char *fid, char format, int lrecl) {
+  int i;
+  for (i = 0; i < MAX_FILES; i++) {
+    if (!files[i].used) {
+      MemFile *m = &files[i];
+      memset(m, '\0', sizeof(MemFile));
+      m->used = true;
+      memcpy(m->fid, fid, 18);
+      m->format = format;
+      m->lrecl = lrecl;
+      return m;
+    }
+  }
+  return NULL;
+}
+ 
+/* store a record in the file at the (0-based) position */
+static void putRecord(MemFile *m, int recNo, char *data, int len) {
+  if (recNo >= m->capacity) {
+    int capacity = (m->capacity < 1024) ? 1024 : m->capacity;
+    while (capacity <= recNo) { capacity *= 2; }
+    m->recs = (char**)realloc(m->recs, capacity * sizeof(char*));
+    m->lens = (int*)realloc(m->lens, capacity * sizeof(int));
+    m->capacity = capacity;
+  }
+  if (recNo < m->count) {
+    free(m->recs[recNo]);
+  } else {
+    /* records skipped when writing beyond the end are empty */
+    int i;
+    for (i = m->count; i < recNo; i++) {
+      m->recs[i] = (char*)calloc(1, 1);
+      m->lens[i] = 0;
+    }
+    m->count = recNo + 1;
+  }
+  m->recs[recNo] = (char*)malloc(len + 1);
+  memcpy(m->recs[recNo], data, len);
+  m->lens[recNo] = len;
+}
+ 
+static void dropFile(MemFile *m) {
+  int i;
+  for (i = 0; i < m->count; i++) { free(m->recs[i]); }
+  free(m->recs);
+  free(m->lens);
+  memset(m, '\0', sizeof(MemFile));
+}
+ 
+/*
+** stand-ins for the CMS file interface
+*/
+ 
+int CMSfileState(char *fid, CMSFILEINFO **fInfo) {
+  MemFile *m = findFile(fid);
+  if (!m) { return 28; }
+  fileInfo.format = m->format;
+  fileInfo.lrecl = m->lrecl;
+  fileInfo.fileYear = 0x0013;
+  fileInfo.filedate = 0x0101;
+  fileInfo.filetime = 0x1200;
+  *fInfo = &fileInfo;
+  return 0;
+}
+ 
+int CMSfileOpen(
+    char *fid, char *buffer, int bufferSize, char format,
+    int numRecords, int recordNum, CMSFILE *file) {
+  int rc = 0;
+  MemFile *m = findFile(fid);
+  if (!m) {
+    m = createFile(fid, format, bufferSize / numRecords);
+    if (!m) { return 20; }
+    rc = 28;
+  }
+  file->buffer = buffer;
+  file->bufferSize = bufferSize;
+  file->format = m->format;
+  file->numRecords = numRecords;
+  file->fileIndex = m - files;
+  file->nextRecord = (recordNum > 0) ? recordNum - 1 : m->count;
+  return rc;
+}
+ 
+int CMSfileRead(CMSFILE *file, int recordNum, int *bytesRead) {
+  MemFile *m = &files[file->fileIndex];
+  int recs = 0;
+  fileCalls++;
+  *bytesRead = 0;
+  if (recordNum > 0) { file->nextRecord = recordNum - 1; }
+  while (recs < file->numRecords && file->nextRecord < m->count) {
+    int len = m->lens[file->nextRecord];
+    memcpy(&file->buffer[*bytesRead], m->recs[file->nextRecord], len);
+    *bytesRead += len;
+    file->nextRecord++;
+    recs++;
+  }
+  return (recs < file->numRecords) ? 12 : 0;
+}
+ 
+int CMSfileWrite(CMSFILE *file, int recordNum, int bufferSize) {
+  MemFile *m = &files[file->fileIndex];
+  fileCalls++;
+  if (recordNum > 0) { file->nextRecord = recordNum - 1; }
+  int recLen = (m->format == 'F') ? m->lrecl : bufferSize;
+  int offset;
+  for (offset = 0; offset < bufferSize; offset += recLen) {
+    putRecord(m, file->nextRecord++, &file->buffer[offset], recLen);
+  }
+  return 0;
+}
+ 
+int CMSfileClose(CMSFILE *file) {
+  return 0;
+}
+ 
+int CMSfileErase(char *fid) {
+  MemFile *m = findFile(fid);
+  if (!m) { return 28; }
+  dropFile(m);
+  return 0;
+}
+ 
+void CMSconsoleWrite(char *line, int edit) {
+  /* the messages of IND$FILE are not of interest here */
+}
+ 
+/*
+** the simulated CUT-mode terminal
+*/
+ 
+/* characters to encode the integers (see IND$SCRN) */
+static char *codes6bit =
+  "abcdefghijklmnopqrstuvwxyz"
+  "&-.,:+"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "012345";
+ 
+#define AID_ENTER 0x7d
+#define AID_PF2   0xf2
+ 
+static int altRows = 24;
+static int altCols = 80;
+ 
+static char reply[MAX_FRAME_SEND_LEN + 64];
+static int  replyLen = 0;
+ 
+static MemFile *received = NULL;  /* file received by downloads */
+static char recvRec[512];          /* record buffer for decoding */
+ 
+static char *upData = NULL;        /* encoded data for uploads */
+static int   upLen = 0;
+static int   upPos = 0;
+ 
+static char finalStatus[100];      /* message of the last status panel */
+static int  frames = 0;            /* data panels transferred */
+static long encodedBytes = 0;      /* data bytes in the panels */
+static int  panelErrors = 0;       /* checksum or protocol errors */
+static long termNanos = 0;         /* CPU time spent in the terminal */
+ 
+static long cpuNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+ 
+static char checksum(char *data, int dataLen) {
+  unsigned char csum = 0;
+  while(dataLen-- > 0) { csum ^= (unsigned char)*data++; }
+  return codes6bit[csum & 0x3f];
+}
+ 
+static int decodeLength(char c1, char c2) {
+  char *p1 = strchr(codes6bit, c1);
+  char *p2 = strchr(codes6bit, c2);
+  if (!p1 || !p2) { return -1; }
+  return ((p1 - codes6bit) << 6) + (p2 - codes6bit);
+}
+ 
+/* writer for the records decoded from download panels */
+static bool receiveRecord(int len) {
+  putRecord(received, received->count, recvRec, len);
+  return false;
+}
+ 
+/* handle a download data panel: 'A' seq csum len(2) data */
+static void doDownloadPanel(char *p) {
+  char csum = p[2];
+  int len = decodeLength(p[3], p[4]);
+  char *data = &p[5];
+  if (len < 0) { panelErrors++; return; }
+  if (len == 2 && data[0] == '*' && data[1] == 'z') { return; }
+  if (checksum(data, len) != csum) { panelErrors++; }
+  frames++;
+  encodedBytes += len;
+ 
+  char *errMsg = NULL;
+  writer = receiveRecord;
+  put_convert(
+    (unsigned char*)data, len,
+    (unsigned char*)recvRec, sizeof(recvRec) - 1,
+    &errMsg);
+  if (errMsg) { panelErrors++; }
+}
+ 
+/* handle an upload request panel: 'B' SF(2) 'A' seq ... */
+static void doUploadPanel(char *p, int positions) {
+  char seq = p[4];
+  int maxLen = positions - 8;
+  if (maxLen > MAX_FRAME_SEND_LEN) { maxLen = MAX_FRAME_SEND_LEN; }
+ 
+  char *data = "*z";
+  int len = 2;
+  if (upPos < upLen) {
+    data = &upData[upPos];
+    len = upLen - upPos;
+    if (len > maxLen) { len = maxLen; }
+    if (upLen - upPos - len == 2) { len--; } /* a 2 byte panel is the EOF */
+    upPos += len;
+    frames++;
+    encodedBytes += len;
+  }
+ 
+  /* aid cursor(2) SBA(3) 'A' seq csum len(2) data */
+  reply[3] = 0x11;
+  reply[4] = 0x40;
+  reply[5] = 0x40;
+  reply[6] = 'A';
+  reply[7] = seq;
+  reply[8] = checksum(data, len);
+  reply[9] = codes6bit[(len >> 6) & 0x3f];
+  reply[10] = codes6bit[len & 0x3f];
+  memcpy(&reply[11], data, len);
+  replyLen = 11 + len;
+}
+ 
+/* the terminal's reaction on a panel written by IND$FILE:
+   EW|EWA(2) SBA(3) SBA(3) panel-type ... */
+int __fswr(char *rawdata, int rawdatalength) {
+  long start = cpuNanos();
+  int positions = (rawdata[0] == (char)0x7e) ? altRows * altCols : 24 * 80;
+  char *p = &rawdata[8];
+ 
+  reply[0] = (char)AID_ENTER;
+  reply[1] = 0x40;
+  reply[2] = 0x40;
+  replyLen = 3;
+ 
+  if (*p == 'C') {
+    /* status: 'C' seq code(2) message */
+    strncpy(finalStatus, &p[4], sizeof(finalStatus) - 1);
+  } else if (*p == 'A') {
+    doDownloadPanel(p);
+  } else if (*p == 'B') {
+    doUploadPanel(p, positions);
+  } else {
+    reply[0] = (char)AID_PF2;
+    panelErrors++;
+  }
+ 
+  termNanos += cpuNanos() - start;
+  return 0;
+}
+ 
+int __fsrdp(
+    char *outbuffer,
+    int outbufferlength,
+    int *transferCount,
+    int fsTimeout) {
+  if (replyLen > outbufferlength) { return 4; }
+  memcpy(outbuffer, reply, replyLen);
+  *transferCount = replyLen;
+  return 0;
+}
+ 
+void __fast58() { }
+ 
+void __fslkto(int fsLockTimeout) { }
+ 
+int __fsqdft() { return 0; }
+ 
+bool __fsqvrs(
+    int *mecaffMajor, int *mecaffMinor, int *mecaffSub,
+    int *apiMajor, int *apiMinor, int *apiSub) {
+  *mecaffMajor = 1;
+  *mecaffMinor = 2;
+  *mecaffSub = 5;
+  *apiMajor = 1;
+  *apiMinor = 2;
+  *apiSub = 5;
+  return true;
+}
+ 
+int __qtrm(
+    char *termName,
+    int   termNameLength,
+    int  *numAltRows,
+    int  *numAltCols,
+    bool *canAltScreenSize,
+    bool *canExtHighLight,
+    bool *canColors,
+    int  *sessionId,
+    int  *sessionMode) {
+  strncpy(termName, "IBM-3278-2-E", termNameLength);
+  *numAltRows = altRows;
+  *numAltCols = altCols;
+  *canAltScreenSize = (altRows * altCols > 24 * 80);
+  *canExtHighLight = true;
+  *canColors = true;
+  *sessionId = 1;
+  *sessionMode = 3270;
+  return 0;
+}
+ 
+/*
+** the test files
+*/
+ 
+#define LRECL 80
+ 
+static MemFile *textFile = NULL;
+static MemFile *binaryFile = NULL;
+ 
+static unsigned int seed = 4711;
+static int rnd(int limit) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % limit;
+}
+ 
+/* source-like text in EBCDIC: words of letters and digits, with some
+   punctuation, in variable length lines without trailing blanks (these
+   would not be stripped for ASCII downloads, as the blank of the IND$FILE
+   sources is the ASCII blank outside from CMS) */
+static void createTextFile(char *fid, int kbytes) {
+  static char *chars =
+    "\xc1\xc2\xc3\xc4\xc5\xc6\xc7\xc8\xc9\xd1\xd2\xd3\xd4\xd5\xd6\xd7"
+    "\xd8\xd9\xe2\xe3\xe4\xe5\xe6\xe7\xe8\xe9\x81\x82\x83\x84\x85\x86"
+    "\x87\x88\x89\x91\x92\x93\x94\x95\x96\x97\x98\x99\xa2\xa3\xa4\xa5"
+    "\xa6\xa7\xa8\xa9\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9";
+  static char *punct = "\x4b\x6b\x5e\x4d\x5d\x7e\x60\x61\x7d\x5c";
+  int charCount = strlen(chars);
+  int punctCount = strlen(punct);
+  char line[LRECL];
+ 
+  textFile = createFile(fid, 'V', LRECL);
+  int recs = kbytes * 1024 / LRECL;
+  int i;
+  for (i = 0; i < recs; i++) {
+    memset(line, 0x40, LRECL);
+    int indent = rnd(4) * 2;
+    int len = indent + 1 + rnd(72 - indent);
+    int pos = indent;
+    while (pos < len) {
+      int wordLen = 1 + rnd(8);
+      while (wordLen-- > 0 && pos < len) {
+        line[pos++] = chars[rnd(charCount)];
+      }
+      if (pos < len - 1 && rnd(4) == 0) { line[pos++] = punct[rnd(punctCount)]; }
+      if (pos < len - 1) { pos++; } /* blank */
+    }
+    line[len - 1] = chars[rnd(charCount)]; /* no trailing blank */
+    putRecord(textFile, i, line, len);
+  }
+}
+ 
+static void createBinaryFile(char *fid, int kbytes) {
+  char rec[LRECL];
+  binaryFile = createFile(fid, 'F', LRECL);
+  int recs = kbytes * 1024 / LRECL;
+  int i;
+  int j;
+  for (i = 0; i < recs; i++) {
+    for (j = 0; j < LRECL; j++) { rec[j] = (char)rnd(256); }
+    putRecord(binaryFile, i, rec, LRECL);
+  }
+}
+ 
+/* check that the records of 'got' have the content of 'org', comparing
+   the data bytes as stream if not 'recordWise' */
+static bool checkFile(MemFile *org, MemFile *got, bool recordWise) {
+  if (!got) { return false; }
+  if (recordWise) {
+    if (org->count != got->count) { return false; }
+    int i;
+    for (i = 0; i < org->count; i++) {
+      int len = org->lens[i];
+      if (got->lens[i] != len) { return false; }
+      if (memcmp(org->recs[i], got->recs[i], len) != 0) { return false; }
+    }
+    return true;
+  }
+ 
+  int oRec = 0, oPos = 0;
+  int gRec = 0, gPos = 0;
+  while (oRec < org->count && gRec < got->count) {
+    if (org->recs[oRec][oPos] != got->recs[gRec][gPos]) { return false; }
+    if (++oPos >= org->lens[oRec]) { oRec++; oPos = 0; }
+    if (++gPos >= got->lens[gRec]) { gRec++; gPos = 0; }
+  }
+  return (oRec == org->count && gRec == got->count);
+}
+ 
+/* encode the file for an upload like the terminal does */
+static void encodeUpload(MemFile *m, bool ascii) {
+  char rec[LRECL + 2];
+  char *errMsg = NULL;
+ 
+  prepareTables();
+  doAscii = ascii;
+  postpareTables();
+ 
+  upData = (char*)malloc(m->count * (LRECL + 2) * 2 + 16);
+  upLen = 0;
+  upPos = 0;
+  int i;
+  for (i = 0; i < m->count; i++) {
+    int len = m->lens[i];
+    memcpy(rec, m->recs[i], len);
+    if (ascii) {
+      rec[len++] = 0x0d;
+      rec[len++] = 0x0a;
+    }
+    upLen += get_convert(
+      (unsigned char*)rec, len,
+      (unsigned char*)&upData[upLen], (LRECL + 2) * 2 + 16,
+      &errMsg);
+  }
+ 
+  curr_q_h2t = -1;
+  doAscii = false;
+}
+ 
+/*
+** the transfers
+*/
+ 
+typedef struct _transfer {
+  char *name;
+  bool  upload;
+  bool  ascii;
+  char *options;
+} Transfer;
+ 
+static Transfer transfers[] = {
+  { "GET text  ASCII", false, true,  "ASCII CRLF" },
+  { "GET binary     ", false, false, "" },
+  { "PUT text  ASCII", true,  true,  "ASCII CRLF" },
+  { "PUT binary     ", true,  false, "RECFM F LRECL 80" }
+};
+ 
+typedef struct _screen {
+  int rows;
+  int cols;
+} Screen;
+ 
+static Screen screens[] = { { 24, 80 }, { 32, 80 }, { 62, 160 } };
+ 
+typedef struct _result {
+  bool  ok;
+  long  fileBytes;
+  long  encodedBytes;
+  int   frames;
+  long  hostNanos;
+  int   fileCalls;
+  char  status[100];
+} Result;
+ 
+/* do a transfer with the terminal having the given screen (in a child
+   process), returning the results */
+static void runTransfer(Transfer *t, Screen *s, Result *r) {
+  char fidData[19];
+  char fidUpload[19];
+  memcpy(fidData,   "BENCH   DATA    A1", 18);
+  memcpy(fidUpload, "BENCH   UPLOAD  A1", 18);
+  MemFile *org = (t->ascii) ? textFile : binaryFile;
+ 
+  altRows = s->rows;
+  altCols = s->cols;
+ 
+  /* prepare the terminal */
+  if (t->upload) {
+    encodeUpload(org, t->ascii);
+    CMSfileErase(fidUpload);
+    CMSfileErase(fidData);
+  } else {
+    CMSfileErase(fidData);
+    memcpy(org->fid, fidData, 18);
+    received = createFile("PC      FILE    A1", 'V', 255);
+    lrecl = 255;
+  }
+ 
+  /* build the command line (the alternate screen is only used on request) */
+  char cmdline[128];
+  char *argv[16];
+  int argc = 0;
+  sprintf(cmdline, "IND$FILE %s BENCH %s A1 ( ALTSCRN %s",
+    (t->upload) ? "PUT" : "GET",
+    (t->upload) ? "UPLOAD" : "DATA",
+    t->options);
+  char *p = strtok(cmdline, " ");
+  while (p && argc < 15) {
+    argv[argc++] = p;
+    p = strtok(NULL, " ");
+  }
+  argv[argc] = NULL;
+ 
+  /* transfer */
+  fileCalls = 0;
+  long start = cpuNanos();
+  indfile(argc, argv);
+  long used = cpuNanos() - start;
+ 
+  /* results (the data bytes of text files include the CR-LF) */
+  int i;
+  r->fileBytes = 0;
+  for (i = 0; i < org->count; i++) {
+    r->fileBytes += org->lens[i] + ((t->ascii) ? 2 : 0);
+  }
+  r->encodedBytes = encodedBytes;
+  r->frames = frames;
+  r->hostNanos = used - termNanos;
+  r->fileCalls = fileCalls;
+  snprintf(r->status, sizeof(r->status), "%s", finalStatus);
+  if (t->upload) {
+    r->ok = checkFile(org, findFile(fidUpload), true);
+  } else {
+    if (currLineLen > 0) { receiveRecord(currLineLen); }
+    r->ok = checkFile(org, received, t->ascii);
+  }
+  r->ok = r->ok && (panelErrors == 0) && (strncmp(finalStatus, "TRANS03", 7) == 0);
+}
+ 
+int main(int argc, char *argv[]) {
+  int kbytes = 1024;
+  if (argc > 1) { kbytes = atoi(argv[1]); }
+  if (kbytes < 1) { kbytes = 1024; }
+ 
+  createTextFile("BENCH   TEXT    A1", kbytes);
+  createBinaryFile("BENCH   BINARY  A1", kbytes);
+ 
+  printf("IND$FILE loopback benchmark, %d records per file "
+         "(binary: RECFM F LRECL %d, text: RECFM V)\n\n",
+    binaryFile->count, LRECL);
+  printf("transfer         screen  "
+         " data-KB  enc-KB  enc/data  frames/MB  host-MB/s  ns/enc-byte"
+         "  file-calls  check\n");
+ 
+  bool allOk = true;
+  int t;
+  int s;
+  for (s = 0; s < sizeof(screens) / sizeof(Screen); s++) {
+    for (t = 0; t < sizeof(transfers) / sizeof(Transfer); t++) {
+      Result r;
+      int pipefd[2];
+      memset(&r, '\0', sizeof(r));
+      if (pipe(pipefd) != 0) { return 8; }
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+        close(pipefd[0]);
+        runTransfer(&transfers[t], &screens[s], &r);
+        write(pipefd[1], &r, sizeof(r));
+        _exit(0);
+      }
+      close(pipefd[1]);
+      if (read(pipefd[0], &r, sizeof(r)) != sizeof(r)) {
+        strcpy(r.status, "transfer failed");
+      }
+      close(pipefd[0]);
+      waitpid(pid, NULL, 0);
+ 
+      double fileMB = r.fileBytes / 1048576.0;
+      double hostSecs = r.hostNanos / 1000000000.0;
+      printf("%s  %3dx%-3d  %7ld %7ld     %5.3f    %7.1f   %8.1f     %8.2f"
+             "    %8d  %s\n",
+        transfers[t].name, screens[s].rows, screens[s].cols,
+        r.fileBytes / 1024, r.encodedBytes / 1024,
+        (r.fileBytes) ? (double)r.encodedBytes / r.fileBytes : 0.0,
+        (fileMB > 0) ? r.frames / fileMB : 0.0,
+        (hostSecs > 0) ? fileMB / hostSecs : 0.0,
+        (r.encodedBytes) ? (double)r.hostNanos / r.encodedBytes : 0.0,
+        r.fileCalls,
+        (r.ok) ? "ok" : r.status);
+      allOk = allOk && r.ok;
+    }
+  }
+  printf("\n");
+ 
+  if (chkcset() != 0) { allOk = false; }
+  printf("\n");
+ 
+  return (allOk) ? 0 : 1;
+}
+ 
+#endif
@@ -142,6 +142,18 @@ unsigned char q_identifiers[Q_COUNT] = {
   /* the char maps with same index as 'q_identifiers'  */
 static unsigned char *q_maps[Q_COUNT] = { Q0_map, Q1_map, Q2_map, Q3_map };
  
+  /* direct lookup tables built by 'pstpTbls' for the transfer mode and the
+     translation deltas, replacing the searches in the maps for each byte */
+#define NO_ALPHA     0x00  /* host byte cannot be mapped in the quadrant */
+#define T2H_QUAD     0x80  /* terminal char is the identifier of quadrant (code & 0x03) */
+#define T2H_INVALID  0xFF  /* terminal char is neither an alpha nor a quadrant identifier */
+ 
+static unsigned char h2t_alpha[Q_COUNT][256]; /* host byte -> alpha in the quadrant */
+static signed char h2t_quad[256];             /* host byte -> first quadrant mapping it */
+static unsigned char h2t_qmask[256];          /* host byte -> bit mask of quadrants mapping it */
+static unsigned char t2h_code[256];           /* term char -> alpha index or quadrant */
+static unsigned char t2h_host[Q_COUNT][Q_SIZE]; /* quadrant + alpha index -> host byte */
+ 
 /* which quadrant is current for data stream characters? (< 0 : none) */
 int curr_q_t2h = -1; /* term -> host */
 int curr_q_h2t = -1; /* host -> term */
@@ -239,13 +251,66 @@ void addcmap(unsigned char hostChar, unsigned char termChar) {
   eterm2ehost[termChar] = hostChar;
 }
  
-/* finalize the adaptation tables (merge with other inernal tables) */
+/* finalize the adaptation tables (merge with other inernal tables) and
+   build the lookup tables for the current transfer mode (ascii/binary) */
 void pstpTbls() {
   unsigned short idx;
+  unsigned short q;
+  unsigned short ix;
   for (idx = 0; idx < 256; idx++) {
     e2a[idx] = e2a_base[ehost2eterm[idx]];
     a2e[idx] = eterm2ehost[a2e_base[idx]];
   }
+ 
+  /* host -> term: the first position of the byte in each quadrant, with
+     the replacements for ascii transfers and the translation to ASCII */
+  memset(h2t_alpha, NO_ALPHA, sizeof(h2t_alpha));
+  for (idx = 0; idx < 256; idx++) {
+    unsigned char c = (unsigned char)idx;
+    if (doAscii) {
+      if (c == 0x0d || c == 0x0a) {
+        /* record end chars are transferred as is */
+      } else if (c == '\t') {
+        c = ' '; /* TBD: jump to next TAB-column with configurable TAB-width */
+      } else if (c < 0x20 || c == 0xff) {
+        c = '.'; /* non printable char */
+      }
+      c = e2a[c];
+    }
+    h2t_quad[idx] = -1;
+    h2t_qmask[idx] = 0;
+    for (q = 0; q < Q_COUNT; q++) {
+      for (ix = 0; ix < Q_SIZE; ix++) {
+        if (q_maps[q][ix] == c) {
+          h2t_alpha[q][idx] = alphas[ix];
+          h2t_qmask[idx] |= 1 << q;
+          if (h2t_quad[idx] < 0) { h2t_quad[idx] = q; }
+          break;
+        }
+      }
+    }
+  }
+  if (!doAscii) {
+    /* binary: the null-character has a special code in the binary quadrant */
+    for (q = 0; q < Q_COUNT; q++) { h2t_alpha[q][0] = NO_ALPHA; }
+    h2t_alpha[Q_BINARY][0] = NULL_REPR;
+    h2t_quad[0] = Q_BINARY;
+    h2t_qmask[0] = 1 << Q_BINARY;
+  }
+ 
+  /* term -> host: the meaning of each data stream char and the host byte
+     for each quadrant position */
+  memset(t2h_code, T2H_INVALID, sizeof(t2h_code));
+  for (ix = 0; ix < Q_SIZE; ix++) {
+    t2h_code[(unsigned char)alphas[ix]] = ix;
+  }
+  for (q = 0; q < Q_COUNT; q++) {
+    t2h_code[q_identifiers[q]] = T2H_QUAD | q;
+    for (ix = 0; ix < Q_SIZE; ix++) {
+      unsigned char c = q_maps[q][ix];
+      t2h_host[q][ix] = (doAscii) ? a2e[c] : c;
+    }
+  }
 }
  
  
@@ -294,14 +359,11 @@ int put_cnv(
  
     while (len-- && obuf_len) {
         unsigned char c = *buf++;
-        char *ixp;
-        int ix;
-        int oq = -1;
+        unsigned char code = t2h_code[c];
  
         /* check for quadrant change */
-        ixp = strchr(q_identifiers, c);
-        if (ixp) {
-          curr_q_t2h = (unsigned char*)ixp - q_identifiers;
+        if (code != T2H_INVALID && (code & T2H_QUAD)) {
+          curr_q_t2h = code & 0x03;
           continue;
         }
         if (curr_q_t2h < 0) {
@@ -318,18 +380,16 @@ int put_cnv(
           continue;
         }
  
-        /* try to translate to a quadrant index */
-        ixp = strchr(alphas, c);
-        if (ixp == (char *)NULL) {
+        /* check for a valid quadrant index */
+        if (code == T2H_INVALID) {
           *errMsg = "TRANS99 - Conversion error (invalid alpha-code)";
           return -1;
         }
-        ix = ixp - alphas;
  
-        /* map the code using the curr quadrant to the final character */
-        c = q_maps[curr_q_t2h][ix];
+        /* map the code using the curr quadrant to the final character
+           (already translated to EBCDIC if ascii) */
+        c = t2h_host[curr_q_t2h][code];
         if (doAscii) {
-          c = a2e[c];
           if (c == 0x0d) {
             continue; /* ignore CR */
           } else if (c == 0x0a) {
@@ -367,7 +427,35 @@ int put_cnv(
 }
  
 /*
-** Convert the char 'c' to be downloaded (host -> terminal).
+ * Store binary data uploaded in DFT-mode (no conversion): terminal -> VM-Host.
+ * Returns the length of the data in the current record or -1 if writing
+ * a record failed.
+ */
+int put_bin(
+    unsigned char *buf,
+    int len,
+    unsigned char *outbuf,
+    int outbuf_len)
+{
+    unsigned char *ob = &outbuf[currLineLen];
+ 
+    while (len-- > 0) {
+        *ob++ = *buf++;
+        currLineLen++;
+        if (currLineLen >= lrecl || currLineLen >= outbuf_len) {
+            bool failed = (*writer)(currLineLen);
+            currLineLen = 0;
+            ob = outbuf;
+            if (failed) { return -1; }
+        }
+    }
+ 
+    return currLineLen;
+}
+ 
+/*
+** Convert the char 'c' to be downloaded (host -> terminal), switching
+** to the first quadrant mapping it if the current quadrant does not.
 ** Returns the number of bytes stored in 'ob'.
 */
 static int get_cnv_char(
@@ -375,56 +463,41 @@ static int get_cnv_char(
     unsigned char *ob,
     char **errMsg)
 {
-    unsigned char *ixp;
-    unsigned ix;
-    int oq;
- 
-    /* get the byte to be converted, either ASCII or binary(1:1) */
-    unsigned char c = (doAscii) ? e2a[ec] : ec;
+    /* the tables map the byte as is (binary) or translated to ASCII */
+    unsigned char alpha;
+    int q;
  
     *errMsg = NULL;
  
     /* try if the char can be mapped with the current quadrant */
     if (curr_q_h2t >= 0) {
-      ixp = (unsigned char *)memchr(q_maps[curr_q_h2t], c, Q_SIZE);
-      if (ixp != (unsigned char *)NULL) {
-        ix = ixp - q_maps[curr_q_h2t];
-        if (ix < 0 || ix >= Q_SIZE) {
-          *errMsg = "TRANS99 - ix outside range(1)";
-          return 0;
-        }
-        *ob++ = alphas[ix];
+      alpha = h2t_alpha[curr_q_h2t][ec];
+      if (alpha != NO_ALPHA) {
+        *ob = alpha;
         return 1;
       }
     }
  
-    /* find another quadrant where the char can be mapped */
-    oq = curr_q_h2t;
-    for (curr_q_h2t = 0; curr_q_h2t < Q_COUNT; curr_q_h2t++) {
-      if (curr_q_h2t == oq) { continue; } /* we know this one won't work... */
-      ixp = (unsigned char *)memchr(q_maps[curr_q_h2t], c, Q_SIZE);
-      if (ixp == (unsigned char *)NULL) { continue; }
-      ix = ixp - q_maps[curr_q_h2t];
-      if (ix < 0 || ix >= Q_SIZE) {
-        *errMsg = "TRANS99 - ix outside range(2)";
-        return 0;
-      }
-      *ob++ = q_identifiers[curr_q_h2t];
-      *ob++ = alphas[ix];
-      return 2;
+    /* switch to the first quadrant where the char can be mapped */
+    q = h2t_quad[ec];
+    if (q < 0) {
+      /* error: this char cannot be mapped with any of the quadrants ... ? */
+      curr_q_h2t = -1;
+      *errMsg = "TRANS99 - Conversion error (no quadrant found)";
+      return 0;
     }
- 
-    /* error: this char cannot be mapped with any of the quadrants ... ? */
-    curr_q_h2t = -1;
-    *errMsg = "TRANS99 - Conversion error (no quadrant found)";
-    return 0;
+    curr_q_h2t = q;
+    *ob++ = q_identifiers[q];
+    *ob = h2t_alpha[q][ec];
+    return 2;
 }
  
 /*
- * Convert a buffer for receiving/download: VM-Host -> terminal.
+ * Convert a buffer for receiving/download: VM-Host -> terminal, switching
+ * the quadrant whenever the current one cannot map the next byte.
  * Returns the length of appended target data, obuf will be null-terminated.
  */
-int get_cnv(
+int get_cnvg(
     unsigned char *buf,
     int len,
     unsigned char *obuf,
@@ -435,40 +508,8 @@ int get_cnv(
     *errMsg = NULL;
  
     while (len && obuf_len > 2 && !*errMsg) {
-        unsigned char c = *buf++;
+        int cnvLen = get_cnv_char(*buf++, obuf, errMsg);
         len--;
- 
-        int cnvLen = 0;
- 
-        if (c == 0x00) {
-          /* special handling for null-character */
-          if (doAscii) {
-            cnvLen = get_cnv_char('.', obuf, errMsg);
-          } else {
-            if (curr_q_h2t != Q_BINARY) {
-              curr_q_h2t = Q_BINARY;
-              obuf[0] = q_identifiers[curr_q_h2t];
-              obuf[1] = NULL_REPR;
-              cnvLen = 2;
-            } else {
-              obuf[0] = NULL_REPR;
-              cnvLen = 1;
-            }
-          }
-        } else if(!doAscii) {
-          cnvLen = get_cnv_char(c, obuf, errMsg);
-        } else if (c == 0x0d) {
-            cnvLen = get_cnv_char(c, obuf, errMsg);
-        } else if (c == 0x0a) {
-            cnvLen = get_cnv_char(c, obuf, errMsg);
-        } else if (c == '\t') {
-            /* TBD: jump to next TAB-column with configurable TAB-width */
-            cnvLen = get_cnv_char(' ', obuf, errMsg);
-        } else if (c < 0x20 || c == 0xff) {
-            cnvLen = get_cnv_char('.', obuf, errMsg);
-        } else {
-            cnvLen = get_cnv_char(c, obuf, errMsg);
-        }
         if (cnvLen == 0) { break; }
         outLen += cnvLen;
         obuf_len -= cnvLen;
@@ -478,3 +519,80 @@ int get_cnv(
     return outLen;
 }
  
+/*
+** Quadrant choice for the download: as each quadrant switch costs an additional
+** byte in the data stream, the encoded length is minimal with the fewest switches.
+** Staying in the current quadrant as long as possible never needs more switches,
+** so only the quadrant to switch to must be chosen, which is the quadrant mapping
+** the longest run of the following bytes (the 'furthest reach' rule yields the
+** same minimal length as a dynamic program over the 4 quadrants per byte, with
+** each byte being looked at at most once per quadrant).
+*/
+static int best_quadrant(unsigned char *buf, int len) {
+  int best = h2t_quad[buf[0]];
+  int bestRun = 0;
+  int q;
+  unsigned char mask = h2t_qmask[buf[0]];
+  if ((mask & (mask - 1)) == 0) { return best; } /* no choice */
+  for (q = 0; q < Q_COUNT; q++) {
+    if (h2t_alpha[q][buf[0]] == NO_ALPHA) { continue; }
+    int run = 1;
+    while (run < len && h2t_alpha[q][buf[run]] != NO_ALPHA) { run++; }
+    if (run > bestRun) {
+      best = q;
+      bestRun = run;
+      if (run == len) { break; }
+    }
+  }
+  return best;
+}
+ 
+/*
+ * Convert a buffer for receiving/download: VM-Host -> terminal, choosing the
+ * quadrant switches to minimize the encoded length.
+ * Returns the length of appended target data, obuf will be null-terminated.
+ */
+int get_cnv(
+    unsigned char *buf,
+    int len,
+    unsigned char *obuf,
+    int obuf_len,
+    char **errMsg)
+{
+    int outLen = 0;
+    *errMsg = NULL;
+ 
+    while (len && obuf_len > 2) {
+        unsigned char c = *buf;
+        unsigned char alpha;
+ 
+        /* stay in the current quadrant if possible ... */
+        if (curr_q_h2t >= 0) {
+          alpha = h2t_alpha[curr_q_h2t][c];
+          if (alpha != NO_ALPHA) {
+            *obuf++ = alpha;
+            outLen++;
+            obuf_len--;
+            buf++;
+            len--;
+            continue;
+          }
+        }
+ 
+        /* ... else switch to the quadrant mapping most of the next bytes */
+        if (h2t_quad[c] < 0) {
+          curr_q_h2t = -1;
+          *errMsg = "TRANS99 - Conversion error (no quadrant found)";
+          break;
+        }
+        curr_q_h2t = best_quadrant(buf, len);
+        *obuf++ = q_identifiers[curr_q_h2t];
+        *obuf++ = h2t_alpha[curr_q_h2t][c];
+        outLen += 2;
+        obuf_len -= 2;
+        buf++;
+        len--;
+    }
+    *obuf = '\0';
+    return outLen;
+}
@@ -0,0 +1,289 @@
+/*
+** IND$DFT - structured field interface for IND$FILE in DFT-mode
+**
+** This file is part of the MECAFF-API based IND$FILE implementation
+** for VM/370 R6 "SixPack".
+**
+** This module implements the DFT-mode (Distributed Function Terminal)
+** file transfer: the data is sent to the terminal as binary data in
+** Write Structured Field (WSF) transmissions and received from the terminal
+** in inbound structured fields (AID 0x88), so neither the quadrant encoding
+** nor the 3270 panel formatting of the CUT-mode is necessary.
+**
+** DFT-mode requires a MECAFF-console (for passing WSF transmissions to the
+** terminal) and a terminal announcing the DDM capability in its reply to the
+** WSF-query done by the MECAFF process.
+**
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2012,2013
+** Released to the public domain.
+*/
+ 
+#include <string.h>
+ 
+#include "fsio.h"
+#include "ind$file.h"
+ 
+/* special timeout for fullscreen reads to reserve the screen to IND$FILE */
+#define TIMEOUT 143 /* 14.3 secs = 143 * (1/10 sec) */
+ 
+/* 3270 command, AID and structured field id */
+#define WSF     0xf3
+#define AID_SF  0x88
+#define SF_DFT  0xd0
+ 
+/* DFT request types: host -> terminal */
+#define TR_OPEN_REQ      0x0012
+#define TR_CLOSE_REQ     0x4112
+#define TR_GET_REQ       0x4611
+#define TR_INSERT_REQ    0x4711
+#define TR_DATA_INSERT   0x4704
+ 
+/* DFT reply types: terminal -> host */
+#define TR_OPEN_ACK      0x0009
+#define TR_CLOSE_REPLY   0x4109
+#define TR_GET_REPLY     0x4605
+#define TR_NORMAL_REPLY  0x4705
+#define TR_ERROR_REPLY   0x08   /* low byte of the reply type */
+ 
+/* headers in requests and replies */
+#define TR_RECNUM_HDR    0x6306
+#define TR_ERROR_HDR     0x6904
+#define TR_NOT_COMPRESSED 0xc080
+#define TR_BEGIN_DATA    0x61
+ 
+/* error code in the reply to a get request past the end of file */
+#define TR_ERR_EOF       0x2200
+ 
+/* length of the headers of a WSF transmission with data:
+   WSF + insert request (5) + data insert header (10) */
+#define DATA_OVERHEAD 16
+ 
+/* minimal DFT buffer size to be worth the DFT-mode */
+#define MIN_DFT_BUF 256
+ 
+/* the names identifying the open request, in ASCII */
+static char openData[7] = { 0x46, 0x54, 0x3a, 0x44, 0x41, 0x54, 0x41 }; /* FT:DATA */
+static char openMsg[7]  = { 0x46, 0x54, 0x3a, 0x4d, 0x53, 0x47, 0x20 }; /* FT:MSG  */
+ 
+static char  io_buff[MAX_DFT_DATA_LEN + 64];
+static char *wsf = NULL;
+static int   wsf_len = 0;
+static int   inp_len = 0;
+ 
+static int  dftBufSize = 0;         /* terminal's buffer size, 0 = no DFT */
+static bool fsInitialized = false;  /* did we request the screen lock? */
+static bool dataOpen = false;       /* is the FT:DATA transfer open? */
+ 
+#define _start()  { wsf = io_buff; *wsf++ = (char)WSF; }
+#define _end()    { wsf_len = wsf - io_buff; }
+#define _cc(c)    { *wsf++ = (char)(c); }
+#define _c16(v)   { _cc(((v) >> 8) & 0xff); _cc((v) & 0xff); }
+#define _csl(s,l) { memcpy(wsf, s, l); wsf += l; }
+ 
+/* get a 16 bit value from the inbound data */
+#define get16(p)  ((((unsigned char*)(p))[0] << 8) | ((unsigned char*)(p))[1])
+ 
+/* check if a DFT transfer is possible with the terminal, returning the max.
+   number of data bytes per transmission (0 = use CUT-mode) */
+int dft_init() {
+  dftBufSize = __fsqdft();
+  if (dftBufSize < MIN_DFT_BUF) {
+    dftBufSize = 0;
+    return 0;
+  }
+  if (dftBufSize > MAX_DFT_DATA_LEN + DATA_OVERHEAD) {
+    dftBufSize = MAX_DFT_DATA_LEN + DATA_OVERHEAD;
+  }
+  return dftBufSize - DATA_OVERHEAD;
+}
+ 
+/* add a structured field header for a DFT request to the WSF stream */
+static void addRequest(int sfLen, int reqType) {
+  _c16(sfLen);
+  _cc(SF_DFT);
+  _c16(reqType);
+}
+ 
+/* transmit the WSF stream, read the terminal's reply and check that it is
+   a DFT reply of the expected type
+ 
+  rc:
+  -2 = fsio error
+  -1 = timeout
+   0 = expected reply received
+   3 = error reply from the terminal (abort)
+   4 = protocol error
+   5 = error reply "end of file" (get request)
+*/
+static int do_dft_io(int replyType, bool releaseFsLock) {
+  /* transmit the request */
+  int rc = __fswr(io_buff, wsf_len);
+  if (rc != 0) {
+    if (releaseFsLock) {
+      __fslkto(0);
+    }
+    return -2;
+  }
+ 
+  /* request lock-in into fullscreen */
+  if (!fsInitialized) {
+    __fslkto(TIMEOUT);
+    fsInitialized = true;
+  }
+ 
+  /* get the reply */
+  inp_len = 0;
+  int resplen;
+  rc = __fsrdp(io_buff, sizeof(io_buff), &resplen, TIMEOUT);
+  if (releaseFsLock) {
+    __fslkto(0);
+  }
+  if (rc == FSRDP_RC_TIMEDOUT) { return -1; }
+  if (rc != 0) { return -2; }
+  if (resplen < 6 || resplen > sizeof(io_buff)) { return 4; }
+  inp_len = resplen;
+ 
+  /* interpret the reply: AID len(2) 0xD0 type(2) ... */
+  unsigned char *r = (unsigned char*)io_buff;
+  if (r[0] != AID_SF || r[3] != SF_DFT) { return 4; }
+  int type = get16(&r[4]);
+  if (type == replyType) { return 0; }
+  if ((type & 0xff) == TR_ERROR_REPLY
+      && (type >> 8) == (replyType >> 8)
+      && resplen >= 10
+      && get16(&r[6]) == TR_ERROR_HDR) {
+    return (get16(&r[8]) == TR_ERR_EOF) ? 5 : 3;
+  }
+  return 4;
+}
+ 
+/* open a transfer with the given name (the parameter bytes are
+   irrelevant, the terminal identifies the transfer by the name) */
+static int openTransfer(char *name) {
+  _start();
+  addRequest(0x23, TR_OPEN_REQ);
+  int i;
+  for (i = 0; i < 23; i++) { _cc(0x00); }
+  _csl(name, 7);
+  _end();
+  return do_dft_io(TR_OPEN_ACK, false);
+}
+ 
+/* close the current transfer */
+static int closeTransfer(bool releaseFsLock) {
+  _start();
+  addRequest(5, TR_CLOSE_REQ);
+  _end();
+  return do_dft_io(TR_CLOSE_REPLY, releaseFsLock);
+}
+ 
+/* insert data into the current transfer */
+static int insertData(char *data, int dataLen) {
+  _start();
+  addRequest(5, TR_INSERT_REQ);
+  addRequest(dataLen + 10, TR_DATA_INSERT);
+  _c16(TR_NOT_COMPRESSED);
+  _cc(TR_BEGIN_DATA);
+  _c16(dataLen + 5);
+  _csl(data, dataLen);
+  _end();
+  return do_dft_io(TR_NORMAL_REPLY, false);
+}
+ 
+/* open the data transfer */
+int dft_open() {
+  int rc = openTransfer(openData);
+  dataOpen = (rc == 0);
+  return rc;
+}
+ 
+/* send data to the terminal: host -> terminal */
+int dft_put(char *data, int dataLen) {
+  return insertData(data, dataLen);
+}
+ 
+/* get the next data from the terminal: terminal -> host */
+int dft_get(char **bufPtr, int *len) {
+  *bufPtr = NULL;
+  *len = 0;
+ 
+  _start();
+  addRequest(5, TR_GET_REQ);
+  _end();
+  int rc = do_dft_io(TR_GET_REPLY, false);
+  if (rc != 0) { return rc; }
+ 
+  /* AID len(2) 0xD0 type(2) recnum-hdr(2) recnum(4) compr(2) begin(1) len(2) */
+  unsigned char *r = (unsigned char*)io_buff;
+  if (inp_len < 17
+      || get16(&r[6]) != TR_RECNUM_HDR
+      || r[14] != TR_BEGIN_DATA) {
+    return 4;
+  }
+  int dataLen = get16(&r[15]) - 5;
+  if (dataLen < 0 || dataLen > inp_len - 17) { return 4; }
+  *bufPtr = &io_buff[17];
+  *len = dataLen;
+  return 0;
+}
+ 
+/* close the data transfer */
+int dft_close() {
+  dataOpen = false;
+  return closeTransfer(false);
+}
+ 
+/* characters allowed in messages and their ASCII codes */
+static char *msgChars =
+  " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+  "-.,:;()/=<>'!?";
+static char msgPunct[] = {
+  0x2d, 0x2e, 0x2c, 0x3a, 0x3b, 0x28, 0x29, 0x2f, 0x3d, 0x3c, 0x3e, 0x27,
+  0x21, 0x3f };
+ 
+/* translate a message character to ASCII */
+static char toAscii(char c) {
+  char *p = (c) ? strchr(msgChars, c) : NULL;
+  if (!p) { return 0x3f; } /* ? */
+  int i = p - msgChars;
+  if (i == 0) { return 0x20; }
+  if (i <= 26) { return 0x40 + i; }
+  if (i <= 52) { return 0x60 + (i - 26); }
+  if (i <= 62) { return 0x30 + (i - 53); }
+  return msgPunct[i - 63];
+}
+ 
+/* send the final message to the terminal, closing the data transfer
+   if it is still open */
+int dft_msg(char *msgtext) {
+  char msg[128];
+  int len = 0;
+  int rc;
+ 
+  if (dataOpen) {
+    dataOpen = false;
+    rc = closeTransfer(false);
+    if (rc < 0) { __fslkto(0); return rc; }
+  }
+ 
+  while (*msgtext && *msgtext != '\n' && len < sizeof(msg) - 1) {
+    msg[len++] = toAscii(*msgtext++);
+  }
+  msg[len++] = 0x24; /* $ terminates the message */
+ 
+  rc = openTransfer(openMsg);
+  if (rc == 0) { rc = insertData(msg, len); }
+  if (rc >= 0) {
+    int closeRc = closeTransfer(true);
+    if (rc == 0) { rc = closeRc; }
+  } else {
+    __fslkto(0);
+  }
+  return rc;
+}
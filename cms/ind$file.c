@@ -22,6 +22,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _NOCMS
+#include <ctype.h>
+#endif
  
 #include "ind$file.h"
 #include "fsio.h"
@@ -32,6 +35,14 @@ unsigned int lrecl = 80;
 static bool doAppend = false;
 static bool doTest = false;
 static bool doDump = false;
+static bool doDft = false;
+static bool doResume = false;
+static bool doAltScreen = false;
+ 
+/* max. data bytes per DFT-mode transmission, 0 = use CUT-mode */
+static int dftLen = 0;
+ 
+#ifndef _NOCMS
  
 /* EBCDIC 'bracket' charset uppercase translation */
  
@@ -87,6 +98,8 @@ static const char tbl_toupper[] = {
  
 #define toupper(c) tbl_toupper[c]
  
+#endif
+ 
 /* test if 2 strings are case-insensitive equal */
 static bool strequiv(char *s1, char *s2) {
   if (!s1 && !s2) { return true; }
@@ -183,6 +196,15 @@ static bool sendStatus(char *code, char *message) {
     return false;
   }
   int rc;
+  if (dftLen > 0) {
+    /* DFT-mode: only the final message is sent to the terminal */
+    if (code[1] == CODE_HOST_ACK[1]) { return false; }
+    rc = dft_msg(message);
+    if (code[1] == CODE_ABORT_FILE[1] || code[1] == CODE_ABORT_XMIT[1]) {
+      writeOutStatus(message);
+    }
+    return (rc != 0);
+  }
   if (!sentInitialAck && code[1] != CODE_HOST_ACK[1]) {
     rc = snd_stat(frameSeq++, CODE_HOST_ACK, blank);
     if (rc != 0) { return true; }
@@ -232,6 +254,23 @@ static CMSFILE cmsfile;
 static CMSFILE *f = NULL;
 static int recordNum = 1;
  
+/* staging buffer for the block i/o of RECFM F files: CMS reads and writes
+   up to 'blkRecs' records per call (records of variable length files can
+   only be read or written one per call, these use 'io_buffer' directly) */
+#define BLOCK_LEN 8192
+static char blk_buffer[BLOCK_LEN];
+static int blkRecs = 1;       /* records per CMS read/write */
+static int blkLrecl = 0;      /* record length in the block */
+static int blkCount = 0;      /* records in the block (read: got, write: pending) */
+static int blkNext = 0;       /* next record to deliver from the block (read) */
+static bool blkEof = false;   /* was the last block of the file read? */
+ 
+/* the record data got by 'readRecord' (in 'io_buffer' or 'blk_buffer') */
+static char *recData = io_buffer;
+ 
+/* the timestamp of the file opened for reading, as hex string */
+static char fileStamp[13];
+ 
 /* build a FID string from the components fn ft fm */
 static void buildFid(char *fid, char *fn, char *ft, char *fm) {
   strcpy(fid, "                  ");
@@ -305,17 +344,50 @@ static bool openFile(
       "TRANS99 - LRECL > 255 unsupported: file transfer canceled");
     return false;
   }
+  if (openForRead) {
+    sprintf(fileStamp, "%04X%04X%04X",
+      (unsigned short)fInfo->fileYear,
+      (unsigned short)fInfo->filedate,
+      (unsigned short)fInfo->filetime);
+  }
+ 
+  /* use block i/o for fixed length records */
+  char format = recfm;
+  blkRecs = 1;
+  blkLrecl = lrecl;
+  blkCount = 0;
+  blkNext = 0;
+  blkEof = false;
+  recData = io_buffer;
+  if (openForRead && rc == 0 && fInfo->format == 'F') {
+    format = 'F';
+    blkLrecl = fInfo->lrecl;
+    blkRecs = BLOCK_LEN / blkLrecl;
+  } else if (!openForRead && recfm == 'F') {
+    blkRecs = BLOCK_LEN / blkLrecl;
+  }
  
   int firstLine = 1;
   if (!openForRead && doAppend) { firstLine = 0; }
-  rc = CMSfileOpen(
-         fid,
-         io_buffer,
-         (openForRead) ? sizeof(io_buffer)-1 : lrecl,
-         recfm,
-         1,         /* number of lines read/written per operation */
-         firstLine, /* first line to read/write */
-         &cmsfile);
+  if (blkRecs > 1) {
+    rc = CMSfileOpen(
+           fid,
+           blk_buffer,
+           blkRecs * blkLrecl,
+           format,
+           blkRecs,   /* number of lines read/written per operation */
+           firstLine, /* first line to read/write */
+           &cmsfile);
+  } else {
+    rc = CMSfileOpen(
+           fid,
+           io_buffer,
+           (openForRead) ? sizeof(io_buffer)-1 : lrecl,
+           format,
+           1,         /* number of lines read/written per operation */
+           firstLine, /* first line to read/write */
+           &cmsfile);
+  }
   if (rc == 0 || rc == 28) {
     f = &cmsfile;
     if (openForRead) {
@@ -351,17 +423,25 @@ static void closeFile() {
 static char CRLF[3] = { (char)0x0d, (char)0x0a, (char)0x00 };
 static char LF[2]   = { (char)0x0a, (char)0x00 };
  
-/* read a record of the file into 'io_buffer',
+/* read the next block of records (or the next record if not using
+   block i/o) from the file into the file buffer,
    set 'eof' to true if no more records are available,
-   return the length of the record just read.
+   return the number of bytes read.
 */
-static int readRecord(bool *eof) {
+static int readBlock(bool *eof) {
   int len = 0;
   *eof = false;
   char msg[80];
+  if (blkEof) {
+    *eof = true;
+    return 0;
+  }
   int rc = CMSfileRead(f, recordNum, &len);
   recordNum = 0;
-  if (rc == 12) {
+  if (rc == 12 && blkRecs > 1 && len >= blkLrecl) {
+    /* last block is only partially filled */
+    blkEof = true;
+  } else if (rc == 12) {
     *eof = true;
     len = 0;
   } else if (rc == 1) {
@@ -378,7 +458,39 @@ static int readRecord(bool *eof) {
       rc);
     sendStatus(CODE_ABORT_FILE, msg);
     len = -1;
-  } else if (doAscii) {
+  }
+  return len;
+}
+ 
+/* read a record of the file, setting 'recData' to the record data
+   (in ASCII mode: always in 'io_buffer', with the line end appended),
+   set 'eof' to true if no more records are available,
+   return the length of the record just read.
+*/
+static int readRecord(bool *eof) {
+  int len;
+  *eof = false;
+  if (blkRecs > 1) {
+    if (blkNext >= blkCount) {
+      len = readBlock(eof);
+      if (len <= 0) { return len; }
+      blkCount = len / blkLrecl;
+      blkNext = 0;
+    }
+    recData = &blk_buffer[blkNext * blkLrecl];
+    blkNext++;
+    len = blkLrecl;
+    if (doAscii) {
+      memcpy(io_buffer, recData, len);
+      recData = io_buffer;
+    }
+  } else {
+    len = readBlock(eof);
+    if (len <= 0) { return len; }
+    recData = io_buffer;
+  }
+ 
+  if (doAscii) {
     char *p = &io_buffer[len-1];
     while (p > io_buffer && *p == ' ') { len--; p--; } /* strip blanks a end */
     io_buffer[len] = '\0';
@@ -393,24 +505,10 @@ static int readRecord(bool *eof) {
   return len;
 }
  
-/* write a record from 'io_buffer' with the specified record len,
+/* write the 'len' bytes in the file buffer to the file,
    return true if writing failed
 */
-static bool writeRecord(int len) {
-  char fillChar = (doAscii) ? ' ' : '\0';
- 
-  if (len < 1) { /* avoid a "non-write" for empty records */
-    io_buffer[0] = fillChar;
-    len = 1;
-  }
-  if (recfm == 'F' && len < lrecl) { /* fill fixed length records to LRECL */
-    char *tail = &io_buffer[len];
-    while(len < lrecl) {
-      *tail++ = fillChar;
-      len++;
-    }
-  }
- 
+static bool writeBlock(int len) {
   int rc = CMSfileWrite(f, recordNum, len);
   recordNum = 0;
   if (rc == 4 || rc == 5 || rc == 20 || rc == 21) {
@@ -436,6 +534,173 @@ static bool writeRecord(int len) {
   return false;
 }
  
+/* write the records pending in the block buffer (if any),
+   return true if writing failed
+*/
+static bool flushRecords() {
+  if (blkCount == 0) { return false; }
+  int len = blkCount * blkLrecl;
+  blkCount = 0;
+  return writeBlock(len);
+}
+ 
+/* write a record from 'io_buffer' with the specified record len
+   (with block i/o: add it to the block buffer, writing full blocks),
+   return true if writing failed
+*/
+static bool writeRecord(int len) {
+  char fillChar = (doAscii) ? ' ' : '\0';
+ 
+  if (len < 1) { /* avoid a "non-write" for empty records */
+    io_buffer[0] = fillChar;
+    len = 1;
+  }
+  if (recfm == 'F' && len < lrecl) { /* fill fixed length records to LRECL */
+    char *tail = &io_buffer[len];
+    while(len < lrecl) {
+      *tail++ = fillChar;
+      len++;
+    }
+  }
+ 
+  if (blkRecs > 1) {
+    memcpy(&blk_buffer[blkCount * blkLrecl], io_buffer, blkLrecl);
+    blkCount++;
+    if (blkCount < blkRecs) { return false; }
+    return flushRecords();
+  }
+ 
+  return writeBlock(len);
+}
+ 
+/*
+** checkpoints for resuming interrupted downloads (CUT-mode)
+**
+** After each panel acknowledged by the terminal, the position of the first
+** file byte not yet at the terminal is written to the checkpoint file
+** together with the identification of the file and the transfer mode.
+** A GET with the RESUME option continues at this position if the file is
+** unchanged (the terminal side must append to the partially received file).
+** The checkpoint file is kept open during the transfer, each checkpoint
+** overwriting its single record.
+** As a new transfer starts with no current quadrant on both sides, only
+** the record number and the byte offset in the record are needed.
+*/
+static char chkptFid[19];
+static char chkptId[64]; /* identification of the file and transfer mode */
+static char chkptRec[81];
+static CMSFILE chkptFile;
+static bool chkptOpen = false;
+static bool chkptFailed = false;
+ 
+/* encoded lengths of the records (by record number) with encoded data
+   in the output buffer of the GET (each record has at least 1 char there) */
+#define ENC_RING (MAX_FRAME_SEND_LEN + 2048)
+static short encLens[ENC_RING];
+ 
+/* build the checkpoint identification for the GET of the opened file */
+static void initCheckpoint(char *fn, char *ft, char *fm) {
+  char fid[19];
+  buildFid(fid, fn, ft, fm);
+  buildFid(chkptFid, "IND$FILE", "CHKPOINT", "A1");
+  sprintf(chkptId, "GET %.8s %.8s %.2s %s %c%c",
+    fid, &fid[8], &fid[16], fileStamp,
+    (doAscii) ? 'A' : 'B',
+    (doCrLf) ? 'C' : 'L');
+}
+ 
+/* close the checkpoint file if it was opened by the transfer */
+static void closeCheckpoint() {
+  if (chkptOpen) {
+    CMSfileClose(&chkptFile);
+    chkptOpen = false;
+  }
+}
+ 
+/* write the checkpoint: resume at 'offset' in the record 'recNo'
+   (if the checkpoint cannot be written, this is reported once and
+   no further checkpoints are written for the transfer) */
+static void writeCheckpoint(int recNo, int offset) {
+  if (chkptFailed) { return; }
+  memset(chkptRec, ' ', sizeof(chkptRec));
+  int len = sprintf(chkptRec, "%s %d %d %d", chkptId, recNo, offset, frameSeq);
+  chkptRec[len] = ' ';
+  if (!chkptOpen) {
+    int rc = CMSfileOpen(chkptFid, chkptRec, 80, 'F', 1, 1, &chkptFile);
+    chkptOpen = (rc == 0 || rc == 28); /* 28: new file */
+  }
+  if (!chkptOpen || CMSfileWrite(&chkptFile, 1, 80) != 0) {
+    closeCheckpoint();
+    chkptFailed = true;
+    logf0("Checkpoint file IND$FILE CHKPOINT A1 cannot be written, "
+          "RESUME will not be possible\n");
+  }
+}
+ 
+/* read the checkpoint, returning false if there is no checkpoint for the
+   file to be transferred with the current transfer mode */
+static bool readCheckpoint(int *recNo, int *offset) {
+  char rec[81];
+  CMSFILE chkfile;
+  CMSFILEINFO *fInfo;
+  int len = 0;
+  int frames = 0;
+  if (CMSfileState(chkptFid, &fInfo) != 0) { return false; }
+  if (CMSfileOpen(chkptFid, rec, 80, 'F', 1, 1, &chkfile) != 0) {
+    return false;
+  }
+  int rc = CMSfileRead(&chkfile, 1, &len);
+  CMSfileClose(&chkfile);
+  if (rc != 0) { return false; }
+  rec[len] = '\0';
+  int idLen = strlen(chkptId);
+  if (strncmp(rec, chkptId, idLen) != 0) { return false; }
+  if (sscanf(&rec[idLen], "%d %d %d", recNo, offset, &frames) != 3) {
+    return false;
+  }
+  if (*recNo < 1 || *offset < 0 || frames < 0) { return false; }
+  logf3("Resuming at record %d, offset %d (%d panels were sent)\n",
+    *recNo, *offset, frames);
+  return true;
+}
+ 
+/* remove the checkpoint after the transfer completed */
+static void dropCheckpoint() {
+  closeCheckpoint();
+  CMSfileErase(chkptFid);
+}
+ 
+/* write the checkpoint after 'sentLen' encoded bytes of 'sent' were
+   acknowledged by the terminal, with 'unsent' encoded bytes remaining for
+   the records up to 'lastRec' (the record 'firstRec' was encoded starting
+   at 'firstOffset') */
+static void checkpointGet(
+    char *sent, int sentLen, int unsent,
+    int lastRec, int firstRec, int firstOffset) {
+  if (unsent == 0) {
+    writeCheckpoint(lastRec + 1, 0);
+    return;
+  }
+ 
+  /* find the record with the first unsent encoded byte ... */
+  int recNo = lastRec;
+  while (unsent > encLens[recNo % ENC_RING]) {
+    unsent -= encLens[recNo % ENC_RING];
+    recNo--;
+  }
+ 
+  /* ... and count the file bytes of the encoded bytes already sent for it,
+     each one not being a quadrant switch represents one byte */
+  int acked = encLens[recNo % ENC_RING] - unsent;
+  int offset = acked;
+  char *p = &sent[sentLen - acked];
+  while (acked-- > 0) {
+    if (memchr(q_identifiers, *p++, Q_COUNT)) { offset--; }
+  }
+  if (recNo == firstRec) { offset += firstOffset; }
+  writeCheckpoint(recNo, offset);
+}
+ 
 /* test for symmetric encoding and decoding of data for the given file,
    records with a difference after decoding are dummped with additional
    informations.
@@ -451,6 +716,10 @@ static void do_test(
   char *errRetMsg = NULL;
   int lines = 0;
   int errors = 0;
+  int fileBytes = 0;
+  int encodedBytes = 0;
+  int greedyBytes = 0;
+  int greedy_q_h2t = curr_q_h2t;
  
   if (!openFile(fn, ft, fm, true)) {
     return;
@@ -460,16 +729,29 @@ static void do_test(
   char *inBuffer = io_buffer;
   int len = readRecord(&eof);
   while(!eof && !errMsg && len >= 0) {
+    if (recData != inBuffer) { memcpy(inBuffer, recData, len); }
     inBuffer[len] = '\0';
     lines++;
  
     int start_q_h2t = curr_q_h2t;
     int start_q_t2h = curr_q_t2h;
  
+    /* encoded length with per-char quadrant switching (for comparison) */
+    curr_q_h2t = greedy_q_h2t;
+    greedyBytes += get_cnvg(
+      inBuffer, len,
+      outBuffer, sizeof(outBuffer),
+      &errMsg);
+    greedy_q_h2t = curr_q_h2t;
+    curr_q_h2t = start_q_h2t;
+    errMsg = NULL;
+ 
     int outLen = get_convert(
       inBuffer, len,
       outBuffer, sizeof(outBuffer),
       &errMsg);
+    fileBytes += len;
+    encodedBytes += outLen;
  
     memset(retBuffer, '\0', sizeof(retBuffer));
     currLineLen = 0; /* patch put_convert's current position in the out line */
@@ -510,7 +792,131 @@ static void do_test(
     len = readRecord(&eof);
   }
   closeFile();
-  printf("\nTest completed, lines = %d, errors = %d\n\n", lines, errors);
+  printf("\nTest completed, lines = %d, errors = %d\n", lines, errors);
+  printf("Encoded bytes: %d for %d file bytes (per-char switching: %d)\n",
+    encodedBytes, fileBytes, greedyBytes);
+ 
+  /* download roundtrips per MByte of file data with 24x80 panels
+     and with the panels for the current terminal */
+  int maxSendLen = sel_scrn(false, doAltScreen);
+  if (fileBytes > 0) {
+    int perMB = (int)((double)encodedBytes * 1048576.0 / fileBytes);
+    printf("Roundtrips per MByte: %d with 24x80 panels (%d bytes), "
+           "%d with this terminal (%d bytes)\n",
+      (perMB + MAX_DATA_SEND_LEN - 1) / MAX_DATA_SEND_LEN, MAX_DATA_SEND_LEN,
+      (perMB + maxSendLen - 1) / maxSendLen, maxSendLen);
+  }
+  printf("\n");
+}
+ 
+/* round-trip all byte values through the encoding and decoding tables
+   for the given transfer mode, returning the number of bytes not coming
+   back unchanged; in ascii mode only the printable EBCDIC chars where the
+   translation deltas are symmetric are checked, as the others are
+   replaced or interpreted as record ends.
+*/
+static int check_charset(bool ascii, int *checked) {
+  unsigned char inBuffer[256];
+  unsigned char outBuffer[1024];
+  unsigned char retBuffer[512];
+  char *errMsg = NULL;
+  int len = 0;
+  int errors = 0;
+  int i;
+ 
+  for (i = 0; i < 256; i++) {
+    if (ascii
+        && (i < 0x40 || i == 0xff || eterm2ehost[ehost2eterm[i]] != i)) {
+      continue;
+    }
+    inBuffer[len++] = (unsigned char)i;
+  }
+  *checked = len;
+ 
+  bool savedAscii = doAscii;
+  doAscii = ascii;
+  postpareTables(); /* rebuild the lookup tables for the mode */
+  curr_q_h2t = -1;
+  curr_q_t2h = -1;
+  currLineLen = 0;
+ 
+  int outLen = get_convert(
+    inBuffer, len,
+    outBuffer, sizeof(outBuffer),
+    &errMsg);
+  int retLen = (errMsg) ? 0 : put_convert(
+    outBuffer, outLen,
+    retBuffer, sizeof(retBuffer),
+    &errMsg);
+  if (errMsg) { printf("%s\n", errMsg); }
+ 
+  for (i = 0; i < len; i++) {
+    if (i >= retLen || retBuffer[i] != inBuffer[i]) {
+      printf("byte 0x%02X: %s\n",
+        inBuffer[i], (i < retLen) ? "changed" : "missing");
+      errors++;
+    }
+  }
+ 
+  doAscii = savedAscii;
+  postpareTables();
+  curr_q_h2t = -1;
+  curr_q_t2h = -1;
+  currLineLen = 0;
+  return errors;
+}
+ 
+/* do the GET for the given file in DFT-mode */
+static void process_dft_get(
+    char *fn,
+    char *ft,
+    char *fm)
+{
+  static char outBuffer[MAX_DFT_DATA_LEN + sizeof(io_buffer)];
+  int outLen = 0;
+  int rc;
+ 
+  /* open the file and the data transfer */
+  if (!openFile(fn, ft, fm, true)) {
+    return;
+  }
+  rc = dft_open();
+  if (rc != 0) {
+    closeFile();
+    if (rc > 0) { sendStatus(CODE_ABORT_XMIT, "TRANS99 - Protocol error"); }
+    return;
+  }
+ 
+  /* loop over the records of the file, sending the binary content
+     in transmissions of the max. length */
+  bool eof;
+  int len = readRecord(&eof);
+  while(!eof && len >= 0) {
+    memcpy(&outBuffer[outLen], recData, len);
+    outLen += len;
+ 
+    if (outLen >= dftLen) {
+      rc = dft_put(outBuffer, dftLen);
+      if (rc != 0) { break; }
+      outLen -= dftLen;
+      memmove(outBuffer, &outBuffer[dftLen], outLen);
+    }
+ 
+    len = readRecord(&eof);
+  }
+ 
+  /* close the file and send the remaining bytes */
+  closeFile();
+  if (len < 0) { return; } /* status already sent by readRecord() */
+  if (rc == 0 && outLen > 0) { rc = dft_put(outBuffer, outLen); }
+  if (rc == 0) { rc = dft_close(); }
+  if (rc != 0) {
+    if (rc > 0) { sendStatus(CODE_ABORT_XMIT, "TRANS99 - Protocol error"); }
+    return;
+  }
+ 
+  sendStatus(CODE_XFER_COMPLETE, "TRANS03 - File transfer complete");
+  logf0("File transfer host -> terminal complete (DFT)\n");
 }
  
 /* do the GET for the given file */
@@ -519,7 +925,12 @@ static void process_get(
     char *ft,
     char *fm)
 {
-  char outBuffer[4096];
+  if (dftLen > 0) {
+    process_dft_get(fn, ft, fm);
+    return;
+  }
+ 
+  char outBuffer[MAX_FRAME_SEND_LEN + 2048];
   char *errMsg = NULL;
  
   char *wb = outBuffer;
@@ -529,22 +940,43 @@ static void process_get(
   int recs = 0;
   int fileBytes = 0;
  
-  /* open the file and send the status to the terminal */
+  /* open the file and check for the checkpoint if resuming */
   if (!openFile(fn, ft, fm, true)) {
     return;
   }
+  int firstRec = 1;
+  int firstOffset = 0;
+  initCheckpoint(fn, ft, fm);
+  if (doResume && !readCheckpoint(&firstRec, &firstOffset)) {
+    sendStatus(CODE_ABORT_XMIT,
+      "TRANS99 - No checkpoint for this file to RESUME: "
+      "file transfer canceled");
+    closeFile();
+    return;
+  }
+ 
+  /* send the status to the terminal */
+  int maxSendLen = sel_scrn(false, doAltScreen);
   sendStatus(CODE_HOST_ACK, blank);
  
-  /* loop over the records of the file */
+  /* skip the records already transferred if resuming */
   bool eof;
   int len = readRecord(&eof);
+  while(!eof && len >= 0 && recs + 1 < firstRec) {
+    recs++;
+    len = readRecord(&eof);
+  }
+ 
+  /* loop over the records of the file */
   while(!eof && len >= 0 && !errMsg) {
-    fileBytes += len;
     recs++;
+    int skip = (recs == firstRec) ? firstOffset : 0;
+    if (skip > len) { skip = len; }
+    fileBytes += len - skip;
  
     /* encoded the record content, appending to current encoded data */
     int appended = get_convert(
-      io_buffer, len,
+      &recData[skip], len - skip,
       wb, wbRest,
       &errMsg);
     if (errMsg) {
@@ -552,25 +984,31 @@ static void process_get(
       closeFile();
       return;
     }
+    encLens[recs % ENC_RING] = appended;
     wb += appended;
     wbLen += appended;
     wbRest -= appended;
  
     /* if we have enough encoded bytes to send a panel: send it ... */
-    if (wbLen > MAX_DATA_SEND_LEN) {
-      bool abort = sendData(outBuffer, MAX_DATA_SEND_LEN);
+    if (wbLen > maxSendLen) {
+      bool abort = sendData(outBuffer, maxSendLen);
       if (abort) {
         closeFile();
+        logf0("Transfer interrupted, use the RESUME option to continue\n");
         return;
       }
+      checkpointGet(
+        outBuffer, maxSendLen, wbLen - maxSendLen,
+        recs, firstRec, firstOffset);
+ 
       /* ... and remove the data sent from the front of the buffer */
-      wbLen -= MAX_DATA_SEND_LEN;
+      wbLen -= maxSendLen;
       memmove(
         outBuffer,
-        &outBuffer[MAX_DATA_SEND_LEN],
+        &outBuffer[maxSendLen],
         wbLen);
       wb = &outBuffer[wbLen];
-      wbRest += MAX_DATA_SEND_LEN;
+      wbRest += maxSendLen;
     }
  
     len = readRecord(&eof);
@@ -578,12 +1016,18 @@ static void process_get(
  
   /* close the file and send the remining encoded bytes */
   closeFile();
+  if (len < 0) { return; } /* status already sent by readRecord() */
   if (wbLen > 0) {
-    if (sendData(outBuffer, wbLen)) { return; }
+    if (sendData(outBuffer, wbLen)) {
+      logf0("Transfer interrupted, use the RESUME option to continue\n");
+      return;
+    }
+    checkpointGet(outBuffer, wbLen, 0, recs, firstRec, firstOffset);
   }
  
   /* tell the terminal that the file has ended */
   if (sendData("*z", 2)) { return; }
+  dropCheckpoint();
   sendStatus(CODE_XFER_COMPLETE, "TRANS03 - File transfer complete");
  
   /*
@@ -594,12 +1038,80 @@ static void process_get(
   logf0("File transfer host -> terminal complete\n");
 }
  
+/* do the PUT for the given file name in DFT-mode */
+static void process_dft_put(
+    char *fn,
+    char *ft,
+    char *fm)
+{
+  char *inData = NULL;
+  int  inLen = 0;
+  int rc;
+ 
+  /* open the output file and the data transfer */
+  if (!openFile(fn, ft, fm, false)) {
+    return;
+  }
+  rc = dft_open();
+  if (rc != 0) {
+    closeFile();
+    if (rc > 0) { sendStatus(CODE_ABORT_XMIT, "TRANS99 - Protocol error"); }
+    return;
+  }
+ 
+  /* set the writer routine used to output the file records */
+  writer = writeRecord;
+  currLineLen = 0;
+ 
+  /* get the data up to the end of file, splitting it into records */
+  rc = dft_get(&inData, &inLen);
+  while (rc == 0) {
+    if (put_bin(
+          (unsigned char*)inData, inLen,
+          (unsigned char*)io_buffer, sizeof(io_buffer)) < 0
+        || flushRecords()) {
+      closeFile();
+      return;
+    }
+    rc = dft_get(&inData, &inLen);
+  }
+  if (rc != 5) {
+    closeFile();
+    if (rc > 0) { sendStatus(CODE_ABORT_XMIT, "TRANS99 - Protocol error"); }
+    return;
+  }
+  if (currLineLen > 0) {
+    if (writeRecord(currLineLen)) {
+      closeFile();
+      return;
+    }
+  }
+  if (flushRecords()) {
+    closeFile();
+    return;
+  }
+ 
+  closeFile();
+  rc = dft_close();
+  if (rc != 0) {
+    if (rc > 0) { sendStatus(CODE_ABORT_XMIT, "TRANS99 - Protocol error"); }
+    return;
+  }
+  sendStatus(CODE_XFER_COMPLETE, "TRANS03 - File transfer complete");
+  logf0("File transfer terminal -> host complete (DFT)\n");
+}
+ 
 /* do the PUT for the given file name */
 static void process_put(
     char *fn,
     char *ft,
     char *fm)
 {
+  if (dftLen > 0) {
+    process_dft_put(fn, ft, fm);
+    return;
+  }
+ 
   char *errMsg = NULL;
   char *inData = NULL;
   int  inLen = 0;
@@ -610,6 +1122,7 @@ static void process_put(
   if (!openFile(fn, ft, fm, false)) {
     return;
   }
+  sel_scrn(true, doAltScreen);
   sendStatus(CODE_HOST_ACK, blank);
  
   /* set the writer routine used by the decoder to output the file records */
@@ -625,7 +1138,7 @@ static void process_put(
   while(inData != NULL
         && (inLen != 2 || (inData[0] != '*' && inData[1] != 'z'))) {
     int outLen = put_convert(inData, inLen, outBuf, outBufLen, &errMsg);
-    if (outLen < 0) {
+    if (outLen < 0 || flushRecords()) {
       closeFile();
       return;
     }
@@ -641,6 +1154,10 @@ static void process_put(
       return;
     }
   }
+  if (flushRecords()) {
+    closeFile();
+    return;
+  }
  
   closeFile();
   sendStatus(CODE_XFER_COMPLETE,
@@ -764,6 +1281,28 @@ static void loadTranslationDeltas(char *fn, bool reportMissing) {
   fclose(f);
 }
  
+#ifdef _NOCMS
+/* run the charset round-trips in binary and ascii mode with the default
+   translation tables (for the benchmark), returning the number of bytes
+   not coming back unchanged */
+int chkcset() {
+  prepareTables();
+  loadTranslationDeltas("DEFAULT", false);
+  postpareTables();
+ 
+  int checked;
+  int errors = check_charset(false, &checked);
+  int allErrors = errors;
+  printf("Charset round-trip binary: bytes = %d, errors = %d\n",
+    checked, errors);
+  errors = check_charset(true, &checked);
+  allErrors += errors;
+  printf("Charset round-trip ascii : bytes = %d, errors = %d\n",
+    checked, errors);
+  return allErrors;
+}
+#endif
+ 
 /*
 ** main line code
 */
@@ -773,10 +1312,17 @@ static int usage(char *cmdname, bool isRemote) {
   sprintf(msg, "Usage: %s PUT|GET%s fn ft fm [ options ]\n",
     cmdname, (isRemote) ? "" : "|TST");
   printf(msg);
+  printf("  ALTSCRN : use the alternate screen for CUT-mode panels\n");
+  printf("  DFT     : use DFT-mode for binary transfers\n");
+  printf("  RESUME  : continue an interrupted GET at its last checkpoint\n");
   return 4;
 }
  
+#ifdef _NOCMS
+int indfile(int argc, char *argv[]) {
+#else
 int main(int argc, char *argv[]) {
+#endif
  
   /* if the command name is FS$$FILE, the progam is used locally in test mode */
   bool isRemote = true;
@@ -824,6 +1370,12 @@ int main(int argc, char *argv[]) {
       doAppend = true;
     } else if (strequiv(p, "DUMP")) {
       doDump = true;
+    } else if (strequiv(p, "DFT")) {
+      doDft = true;
+    } else if (strequiv(p, "RESUME")) {
+      doResume = true;
+    } else if (strequiv(p, "ALTSCRN")) {
+      doAltScreen = true;
     } else if (strequiv(p, "RECFM")) {
       i++;
       recfm = 'X';
@@ -895,13 +1447,30 @@ int main(int argc, char *argv[]) {
   }
   postpareTables();
  
+  /* use DFT-mode if requested and possible (binary transfers only,
+     resuming is only supported in CUT-mode) */
+  if (doDft && !doAscii && !doResume && isRemote) {
+    dftLen = dft_init();
+  }
+ 
   /* execute the operation requested */
-  if (strequiv(op, "PUT")) {
+  if (strequiv(op, "PUT") && doResume) {
+    sendStatus(CODE_ABORT_XMIT,
+      "TRANS99 - RESUME is supported for GET only: file transfer canceled");
+    return 4;
+  } else if (strequiv(op, "PUT")) {
     process_put(fn, ft, fm);
   } else if (strequiv(op, "GET")) {
     process_get(fn, ft, fm);
   } else if (strequiv(op, "TST") && !isRemote) {
     doTest = true;
+    int checked;
+    int errors = check_charset(false, &checked);
+    printf("\nCharset round-trip binary: bytes = %d, errors = %d\n",
+      checked, errors);
+    errors = check_charset(true, &checked);
+    printf("Charset round-trip ascii : bytes = %d, errors = %d\n",
+      checked, errors);
     do_test(fn, ft, fm);
     printf("-- cmd   : %s\n", argv[0]);
     printf("-- ascii : %s\n", (doAscii) ? "true" : "false");
@@ -917,6 +1486,9 @@ int main(int argc, char *argv[]) {
     }
   }
  
+  /* keep the last checkpoint of an interrupted GET */
+  closeCheckpoint();
+ 
   /* write out the messages collected and finish */
   writeLog();
   return 0;
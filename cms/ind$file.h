@@ -34,7 +34,8 @@ extern void prepTbls();
 extern void addcmap(unsigned char hostChar, unsigned char termChar);
 #define addCharMapping(hostChar,termChar) addcmap(hostChar,termChar)
  
-/* finalize the adaptation tables (merge with other inernal tables) */
+/* finalize the adaptation tables (merge with other inernal tables) and build
+   the conversion lookup tables, so 'doAscii' must be set before calling it */
 extern void pstpTbls();
 #define postpareTables() pstpTbls()
  
@@ -74,6 +75,17 @@ extern int put_cnv(
 #define put_convert(buf,len,outbuf,outbuf_len,errMsg) \
   put_cnv(buf,len,outbuf,outbuf_len,errMsg)
  
+/*
+ * Store binary data uploaded in DFT-mode (no conversion): terminal -> VM-Host.
+ * Returns the length of the data in the current record or -1 if writing
+ * a record failed.
+ */
+extern int put_bin(
+    unsigned char *buf,
+    int len,
+    unsigned char *outbuf,
+    int outbuf_len);
+ 
 /*
  * Convert a buffer for receiving/download: VM-Host -> terminal.
  * Returns the length of appended target data, obuf will be null-terminated.
@@ -87,15 +99,36 @@ extern int get_cnv(
 #define get_convert(buf,len,obuf,obuf_len,errMsg) \
   get_cnv(buf,len,obuf,obuf_len,errMsg)
  
+/*
+ * Convert a buffer for download like 'get_cnv', but switching the quadrant
+ * for each char not mappable in the current one (for comparing the encoded
+ * lengths in test mode).
+ */
+extern int get_cnvg(
+    unsigned char *buf,
+    int len,
+    unsigned char *obuf,
+    int obuf_len,
+    char **errMsg);
+ 
 /* handshake codes for CUT-mode screens: host -> term */
 #define CODE_HOST_ACK       "aa"
 #define CODE_XFER_COMPLETE  "ai"
 #define CODE_ABORT_FILE     "am"
 #define CODE_ABORT_XMIT     "aq"
  
-/* number of bytes that can be transmitted with a single CUT-mode panel */
+/* number of bytes that can be transmitted with a single CUT-mode panel
+   on a 24x80 screen */
 #define MAX_DATA_SEND_LEN 1909
  
+/* max. number of bytes in a CUT-mode panel (12-bit length in the frame) */
+#define MAX_FRAME_SEND_LEN 4095
+ 
+/* select the screen for the panels of a transfer (default 24x80 or the
+   larger alternate screen of the terminal if requested and usable),
+   returning the max. number of data bytes per panel */
+extern int sel_scrn(bool forUpload, bool useAltScreen);
+ 
 /* switch to visible output (for test) instead of CUT-mode invisible output */
 extern void show3270();
  
@@ -131,6 +164,79 @@ extern int rcv_data(
       char  *csum,   /* out param */
       int   *len);   /* out param */
  
+/* max. number of data bytes in a DFT-mode transmission */
+#define MAX_DFT_DATA_LEN 32752
+ 
+/* the DFT-mode routines have the common rc-values of the panel routines,
+   with 3 for an error reply from the terminal and additionally:
+   5 = end of file (terminal -> host transfer)
+*/
+ 
+/* check if a DFT transfer is possible with the terminal, returning the max.
+   number of data bytes per transmission (0 = use CUT-mode) */
+extern int dft_init();
+ 
+/* open the data transfer */
+extern int dft_open();
+ 
+/* send data to the terminal: host -> terminal */
+extern int dft_put(char *data, int dataLen);
+ 
+/* get the next data from the terminal: terminal -> host */
+extern int dft_get(
+      char **bufPtr, /* out param */
+      int   *len);   /* out param */
+ 
+/* close the data transfer */
+extern int dft_close();
+ 
+/* send the final message to the terminal, closing the data transfer
+   if it is still open */
+extern int dft_msg(char *msgtext);
+ 
+#ifdef _NOCMS
+/* stand-ins for the CMS file and console interface of the GCC CMS library,
+   implemented by the loopback benchmark (IND$BNCH) for building IND$FILE
+   outside from CMS */
+ 
+#define CMS_NOEDIT 0
+ 
+typedef struct _cmsfile {
+  char *buffer;      /* record buffer */
+  int   bufferSize;  /* size of the buffer */
+  char  format;      /* record format 'F' or 'V' */
+  int   numRecords;  /* number of records read/written per operation */
+  int   fileIndex;   /* the in-memory file */
+  int   nextRecord;  /* next record to read/write (0-based) */
+} CMSFILE;
+ 
+typedef struct _cmsfileinfo {
+  char  format;
+  int   lrecl;
+  int   fileYear;
+  int   filedate;
+  int   filetime;
+} CMSFILEINFO;
+ 
+extern int CMSfileState(char *fid, CMSFILEINFO **fileInfo);
+extern int CMSfileOpen(
+    char *fid, char *buffer, int bufferSize, char format,
+    int numRecords, int recordNum, CMSFILE *file);
+extern int CMSfileRead(CMSFILE *file, int recordNum, int *bytesRead);
+extern int CMSfileWrite(CMSFILE *file, int recordNum, int bufferSize);
+extern int CMSfileClose(CMSFILE *file);
+extern int CMSfileErase(char *fid);
+extern void CMSconsoleWrite(char *line, int edit);
+ 
+/* the IND$FILE main routine when invoked by the benchmark */
+extern int indfile(int argc, char *argv[]);
+ 
+/* the charset round-trip check of IND$FILE run by the benchmark,
+   returning the number of errors */
+extern int chkcset();
+ 
+#endif
+ 
 /* make sure NULL is defined */
 #ifndef NULL
 #define NULL 0
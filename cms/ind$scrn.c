@@ -17,6 +17,8 @@
 ** Released to the public domain.
 */
  
+#include <string.h>
+ 
 #include "fsio.h"
 #include "ind$file.h"
  
@@ -25,10 +27,10 @@
  
 /* constants and functions for building 3270 screens */
 #define EW_reset_restore "\xf5\xc2"
+#define EWA_reset_restore "\x7e\xc2"
  
 #define SBA_01_01 "\x11\x40\x40"
-#define SBA_24_75 "\x11\x5d\x7a"
-#define SBA_24_80 "\x11\x5d\x7f"
+#define SBA "\x11"
  
 #define SF_modified "\x1d\xc1"
 #define SF_protected_skip_nondisplay_hide "\x1d\x7c"
@@ -40,7 +42,24 @@ static char *SF_protected_skip_nondisplay = SF_protected_skip_nondisplay_hide;
  
 #define CNull '\0'
  
-static char  io_buff[4096];
+/* size of the default 3270 screen */
+#define DFLT_ROWS 24
+#define DFLT_COLS 80
+ 
+/* panel positions not available for data: download panels have 'A' seq
+   csum len(2) before the data and the response field (attribute + 4 chars)
+   and the closing attribute at the end, upload panels have 'B' attribute
+   'A' seq csum len(2) before the data and the closing attribute at the end
+   (the terminal derives the available data length from its screen size)
+*/
+#define DNLD_OVERHEAD 11
+#define UPLD_OVERHEAD 8
+ 
+/* screen used for the panels of the current transfer */
+static char *ew_cmd = EW_reset_restore;
+static int   scr_positions = DFLT_ROWS * DFLT_COLS;
+ 
+static char  io_buff[MAX_FRAME_SEND_LEN + 64];
 static char *scr = NULL;
 static int   scr_len = 0;
 static int   inp_len = 0;
@@ -60,6 +79,18 @@ static char *codes6bit =
   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
   "012345";
  
+/* 3270 codes for the 6-bit parts of 12-bit buffer addresses */
+static char codes3270[] = {
+  0x40, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+  0x50, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+  0xd8, 0xd9, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+  0x60, 0x61, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7,
+  0xe8, 0xe9, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+  0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+  0xf8, 0xf9, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f
+};
+ 
 /* did we send the request to reserve the screen? */
 static bool fsInitialized = false;
  
@@ -69,6 +100,67 @@ void show3270() {
   SF_protected_skip_nondisplay = SF_protected_skip_nondisplay_show;
 }
  
+/* select the screen for the panels of a transfer and return the max.
+   number of data bytes in a panel.
+   The alternate screen is used only if requested ('useAltScreen', as not
+   all emulators support CUT-mode transfers on other screens than 24x80),
+   if it is larger than 24x80 and if the screen is written through a
+   MECAFF-console (with DIAG-58, the fast write+read of PGT3270 always
+   does an EraseWrite). As the terminal fills
+   upload panels up to the end of the screen, uploads use the alternate
+   screen only if all its positions can be expressed with the 12-bit length
+   of the CUT-mode frame.
+*/
+int sel_scrn(bool forUpload, bool useAltScreen) {
+  char termName[TERM_NAME_LENGTH + 1];
+  int altRows;
+  int altCols;
+  bool canAltScreenSize;
+  bool canExtHighLight;
+  bool canColors;
+  int sessionId;
+  int sessionMode;
+ 
+  ew_cmd = EW_reset_restore;
+  scr_positions = DFLT_ROWS * DFLT_COLS;
+  if (useAltScreen
+      && __qtrm(
+          termName,
+          sizeof(termName),
+          &altRows,
+          &altCols,
+          &canAltScreenSize,
+          &canExtHighLight,
+          &canColors,
+          &sessionId,
+          &sessionMode) == 0
+      && canAltScreenSize
+      && (sessionMode == 3270 || sessionMode == 3215)) {
+    int altPositions = altRows * altCols;
+    if (altPositions > scr_positions
+        && (!forUpload || altPositions - UPLD_OVERHEAD <= MAX_FRAME_SEND_LEN)) {
+      ew_cmd = EWA_reset_restore;
+      scr_positions = altPositions;
+    }
+  }
+ 
+  int maxLen = scr_positions - ((forUpload) ? UPLD_OVERHEAD : DNLD_OVERHEAD);
+  return (maxLen > MAX_FRAME_SEND_LEN) ? MAX_FRAME_SEND_LEN : maxLen;
+}
+ 
+/* add a set-buffer-address order for the screen position to the panel
+   stream, using 14-bit addressing for positions beyond 4095 */
+static void encodeSba(int pos) {
+  _cs(SBA);
+  if (pos > 4095) {
+    _cc((pos >> 8) & 0x3f);
+    _cc(pos & 0xff);
+  } else {
+    _cc(codes3270[(pos >> 6) & 0x3f]);
+    _cc(codes3270[pos & 0x3f]);
+  }
+}
+ 
 /* add the length to the panel stream */
 static void encodeLength(int len) {
   short upper = (len >> 6) & 0x3f;
@@ -164,8 +256,8 @@ int snd_stat(
   int i;
   /* build screen */
   _start();
-  _cs(EW_reset_restore);
-  _cs(SBA_24_80);
+  _cs(ew_cmd);
+  encodeSba(scr_positions - 1);
   _cs(SBA_01_01);
   _cc('C');
   if (code[1] == 'm' || code[1] == 'q') {
@@ -179,7 +271,7 @@ int snd_stat(
   i = 96 - strlen(msgtext);
   while(i > 0) { _cc('\0'); i--; } /* fill up to 96 chars with 0x00 */
 #endif
-  _cs(SBA_24_75);
+  encodeSba(scr_positions - 6);
   _cs(SF_modified);
   _cs(IC);
   _cc(CNull); _cc(CNull); _cc(CNull); _cc(CNull);
@@ -209,15 +301,15 @@ int snd_data(
  
   /* build screen */
   _start();
-  _cs(EW_reset_restore);
-  _cs(SBA_24_80);
+  _cs(ew_cmd);
+  encodeSba(scr_positions - 1);
   _cs(SBA_01_01);
   _cc('A');
   encodeFrameseq(frameSeq);
   encodeChecksum(data, dataLen);
   encodeLength(dataLen);
   _csl(data, dataLen);
-  _cs(SBA_24_75);
+  encodeSba(scr_positions - 6);
   _cs(SF_modified);
   _cs(IC);
   _cc(CNull); _cc(CNull); _cc(CNull); _cc(CNull);
@@ -239,8 +331,8 @@ int rcv_data(
       int   *len) {   /* out param */
   /* build screen */
   _start();
-  _cs(EW_reset_restore);
-  _cs(SBA_24_80);
+  _cs(ew_cmd);
+  encodeSba(scr_positions - 1);
   _cs(SBA_01_01);
   _cc('B');
   _cs(SF_modified);
@@ -248,7 +340,7 @@ int rcv_data(
   char seqChar = encodeFrameseq(frameSeq);
   _cs(IC);
   _cs("aaa"); /* initial data: 'a' => checksum == 0, 'aa' => length == 0 */
-  _cs(SBA_24_80);
+  encodeSba(scr_positions - 1);
   _cs(SF_protected_skip_nondisplay);
   _end();
  
@@ -280,7 +372,7 @@ int rcv_data(
       printf("rcv_data: codedlen = %d, buf-len = %d\n", codedlen, *len);
     }*/
     if (codedlen < *len) { *len = codedlen; }
-    bufPtr[*len] = CNull;
+    (*bufPtr)[*len] = CNull;
   } else {
     *bufPtr = NULL;
     *csum = CNull;
@@ -0,0 +1,451 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InterruptedIOException;
+import java.io.OutputStream;
+import java.net.Socket;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedList;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Replay of a session trace recorded by MECAFF (parameter <code>-traceDir:</code>)
+ * through a new stream filter connected to simulated sockets, allowing to
+ * benchmark and profile the processing of real traffic without terminal and host.
+ * <p>
+ * The data read from the terminal and the host is fed to the filter in the recorded
+ * order and with the recorded read sizes, each chunk being passed only after the
+ * previous one was read by the filter, so the interleaving of both directions is
+ * the same in each replay. The data written by the filter is discarded.
+ * <br/>
+ * The replay runs either at full speed (the default, with the send delay and the
+ * pacing gaps to the host set to 0) or with the original timing and filter parameters
+ * (parameter <code>-timing</code>).
+ * <br/>
+ * If the traced session used a cached WSF-query reply, the cache is primed with
+ * the same terminal characteristics before each replay.
+ * <p>
+ * Usage:
+ * <pre>
+ *   java -cp bin dev.hawala.vm370.SessionReplay [-timing] [-iterations:&lt;n&gt;] &lt;trace-file&gt;
+ * </pre>
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class SessionReplay {
+
+	private static final String PTiming = "-timing";
+	private static final String PIterations = "-iterations:";
+
+	private static final long ConsumeTimeoutMs = 2000;
+
+	/**
+	 * A data or parameter event of the trace.
+	 */
+	private static class Event {
+		public final byte type;
+		public final long timeMicros;
+		public final byte[] data;
+
+		public Event(byte type, long timeMicros, byte[] data) {
+			this.type = type;
+			this.timeMicros = timeMicros;
+			this.data = data;
+		}
+	}
+
+	/**
+	 * Input stream delivering the chunks passed by the replay, a chunk of length 0
+	 * meaning the end of the stream.
+	 */
+	private static class ReplayInputStream extends InputStream {
+		private final LinkedList<byte[]> chunks = new LinkedList<byte[]>();
+		private byte[] current = null;
+		private int pos = 0;
+		private boolean atEnd = false;
+		private boolean closed = false;
+
+		public synchronized void deliver(byte[] chunk) {
+			this.chunks.add(chunk);
+			this.notifyAll();
+		}
+
+		// wait until all delivered chunks have been read, returning false on timeout
+		public synchronized boolean awaitConsumed(long timeoutMs) throws InterruptedException {
+			long deadline = System.currentTimeMillis() + timeoutMs;
+			while (!this.closed && !this.atEnd && (this.current != null || !this.chunks.isEmpty())) {
+				long remaining = deadline - System.currentTimeMillis();
+				if (remaining <= 0) { return false; }
+				this.wait(remaining);
+			}
+			return true;
+		}
+
+		@Override
+		public synchronized int read(byte[] b, int off, int len) throws IOException {
+			if (len == 0) { return 0; }
+			try {
+				while (this.current == null && !this.atEnd && !this.closed) {
+					if (this.chunks.isEmpty()) {
+						this.wait();
+					} else {
+						this.current = this.chunks.removeFirst();
+						this.pos = 0;
+						if (this.current.length == 0) {
+							this.current = null;
+							this.atEnd = true;
+							this.notifyAll();
+						}
+					}
+				}
+			} catch (InterruptedException exc) {
+				throw new InterruptedIOException("replay read interrupted");
+			}
+			if (this.current == null || this.closed) { return -1; }
+			int count = Math.min(len, this.current.length - this.pos);
+			System.arraycopy(this.current, this.pos, b, off, count);
+			this.pos += count;
+			if (this.pos >= this.current.length) {
+				this.current = null;
+				this.notifyAll();
+			}
+			return count;
+		}
+
+		@Override
+		public int read() throws IOException {
+			byte[] single = new byte[1];
+			int count = this.read(single, 0, 1);
+			return (count < 0) ? -1 : (single[0] & 0xFF);
+		}
+
+		@Override
+		public synchronized void close() {
+			this.closed = true;
+			this.notifyAll();
+		}
+	}
+
+	/**
+	 * Output stream counting and discarding the data written by the filter.
+	 */
+	private static class DiscardingOutputStream extends OutputStream {
+		private volatile long count = 0;
+
+		@Override
+		public void write(int b) { this.count++; }
+
+		@Override
+		public void write(byte[] b, int off, int len) { this.count += len; }
+
+		public long getCount() { return this.count; }
+	}
+
+	/**
+	 * Unconnected socket providing the replay streams to the filter.
+	 */
+	private static class ReplaySocket extends Socket {
+		public final ReplayInputStream in = new ReplayInputStream();
+		public final DiscardingOutputStream out = new DiscardingOutputStream();
+		private volatile boolean socketClosed = false;
+
+		@Override
+		public InputStream getInputStream() { return this.in; }
+
+		@Override
+		public OutputStream getOutputStream() { return this.out; }
+
+		@Override
+		public void setTcpNoDelay(boolean on) { }
+
+		@Override
+		public synchronized void close() {
+			this.socketClosed = true;
+			this.in.close();
+		}
+
+		@Override
+		public boolean isClosed() { return this.socketClosed; }
+	}
+
+	private final String filterName;
+	private final int connectionNo;
+	private final List<Event> events = new ArrayList<Event>();
+	private final Map<String,String> parameters = new HashMap<String,String>();
+	private long bytesFromTerminal = 0;
+	private long bytesFromHost = 0;
+
+	/**
+	 * Load a trace file into memory.
+	 * @param file the trace file.
+	 * @throws IOException
+	 */
+	public SessionReplay(File file) throws IOException {
+		SessionTrace.Reader reader = new SessionTrace.Reader(file);
+		try {
+			this.filterName = reader.getFilterName();
+			this.connectionNo = reader.getConnectionNo();
+			while (reader.next()) {
+				byte[] data = new byte[reader.getLength()];
+				System.arraycopy(reader.getData(), 0, data, 0, data.length);
+				if (reader.getType() == SessionTrace.Parameter) {
+					String param = new String(data, "UTF-8");
+					int sep = param.indexOf('=');
+					if (sep > 0) { this.parameters.put(param.substring(0, sep), param.substring(sep + 1)); }
+				} else if (reader.getType() == SessionTrace.FromTerminal) {
+					this.events.add(new Event(reader.getType(), reader.getTimeMicros(), data));
+					this.bytesFromTerminal += data.length;
+				} else if (reader.getType() == SessionTrace.FromHost) {
+					this.events.add(new Event(reader.getType(), reader.getTimeMicros(), data));
+					this.bytesFromHost += data.length;
+				}
+			}
+		} finally {
+			reader.close();
+		}
+	}
+
+	private long getParameter(String name, long defaultValue) {
+		String value = this.parameters.get(name);
+		if (value == null) { return defaultValue; }
+		try {
+			return Long.parseLong(value);
+		} catch (NumberFormatException exc) {
+			return defaultValue;
+		}
+	}
+
+	// create the filter as the traced one, without delays if not replaying with the original timing
+	private BaseStreamFilter createFilter(Socket term, Socket host, boolean originalTiming) {
+		boolean noDynamic = "true".equals(this.parameters.get("noDynamic"));
+		short sendDelay = (short)((originalTiming) ? this.getParameter("sendDelay", 0) : 0);
+		short minColorCount = (short)this.getParameter("minColorCount", 4);
+		if (this.filterName.equals(Tn3215StreamFilter.class.getName())) {
+			return new Tn3215StreamFilter(this.connectionNo, term, host, noDynamic, sendDelay, minColorCount, null);
+		}
+		long handshakeGap = (originalTiming)
+				? this.getParameter("handshakeGap", Tn3270StreamFilter.DefaultMinHandshakeGapMs) : 0;
+		long inputGap = (originalTiming)
+				? this.getParameter("inputGap", Tn3270StreamFilter.DefaultMinInteractionGapMs) : 0;
+		return new Tn3270StreamFilter(
+				this.connectionNo,
+				this.parameters.get("luName"),
+				term,
+				host,
+				noDynamic,
+				sendDelay,
+				minColorCount,
+				handshakeGap,
+				inputGap,
+				null);
+	}
+
+	// get the terminal type name as sent by the terminal in the traced negotiation
+	private String findTerminalType() throws IOException {
+		byte[] data = new byte[4096];
+		int length = 0;
+		for (Event ev : this.events) {
+			if (ev.type != SessionTrace.FromTerminal) { continue; }
+			int count = Math.min(ev.data.length, data.length - length);
+			System.arraycopy(ev.data, 0, data, length, count);
+			length += count;
+			if (length >= data.length) { break; }
+		}
+		for (int i = 0; i < (length - 4); i++) {
+			if (data[i] == (byte)0xFF && data[i+1] == (byte)0xFA && data[i+2] == (byte)0x18 && data[i+3] == (byte)0x00) {
+				for (int j = i + 4; j < (length - 1); j++) {
+					if (data[j] == (byte)0xFF && data[j+1] == (byte)0xF0) {
+						return new String(data, i + 4, j - i - 4);
+					}
+				}
+			}
+		}
+		return null;
+	}
+
+	// give the filter the same cached terminal characteristics as in the traced session
+	private void primeTerminalPropertiesCache() throws IOException {
+		TerminalPropertiesCache.clear();
+		String cached = this.parameters.get("cachedQueryReply");
+		if (cached == null) { return; }
+		TerminalPropertiesCache.Entry entry = TerminalPropertiesCache.Entry.parse(cached);
+		String terminalType = this.findTerminalType();
+		if (entry != null && terminalType != null) {
+			TerminalPropertiesCache.store(TerminalPropertiesCache.keyFor(terminalType, null), entry);
+		}
+	}
+
+	/**
+	 * Result of a single replay.
+	 */
+	public static class Result {
+		public final long elapsedNanos;
+		public final long bytesToTerminal;
+		public final long bytesToHost;
+		public final int stalls;
+
+		public Result(long elapsedNanos, long bytesToTerminal, long bytesToHost, int stalls) {
+			this.elapsedNanos = elapsedNanos;
+			this.bytesToTerminal = bytesToTerminal;
+			this.bytesToHost = bytesToHost;
+			this.stalls = stalls;
+		}
+	}
+
+	/**
+	 * Replay the trace once through a new filter.
+	 * @param originalTiming if <code>true</code>, the events are passed with the recorded
+	 *   timing and the filter uses the traced delay parameters.
+	 * @return the result of the replay.
+	 * @throws Exception
+	 */
+	public Result replay(final boolean originalTiming) throws Exception {
+		final ReplaySocket term = new ReplaySocket();
+		final ReplaySocket host = new ReplaySocket();
+		final int[] stalls = { 0 };
+
+		this.primeTerminalPropertiesCache();
+
+		// the feeder must run before creating the filter, as the filter
+		// does the telnet negotiations in its constructor
+		Thread feeder = new Thread(new Runnable() {
+			public void run() {
+				try {
+					long startNanos = System.nanoTime();
+					for (Event ev : events) {
+						if (originalTiming) {
+							long waitNanos = startNanos + ev.timeMicros * 1000 - System.nanoTime();
+							if (waitNanos > 0) { Thread.sleep(waitNanos / 1000000, (int)(waitNanos % 1000000)); }
+						}
+						ReplayInputStream target = (ev.type == SessionTrace.FromTerminal) ? term.in : host.in;
+						target.deliver(ev.data);
+						if (!target.awaitConsumed(ConsumeTimeoutMs)) { stalls[0]++; }
+					}
+				} catch (InterruptedException exc) {
+					// replay aborted
+				}
+				term.in.deliver(new byte[0]);
+				host.in.deliver(new byte[0]);
+			}
+		}, "replay-feeder");
+		feeder.setDaemon(true);
+
+		long start = System.nanoTime();
+		feeder.start();
+		BaseStreamFilter filter = this.createFilter(term, host, originalTiming);
+		feeder.join();
+		filter.shutdown();
+		long elapsed = System.nanoTime() - start;
+		return new Result(elapsed, term.out.getCount(), host.out.getCount(), stalls[0]);
+	}
+
+	private static void usage() {
+		System.out.println(
+			"Usage: SessionReplay [options] <trace-file>\n"
+			+ "\n"
+			+ "with options:\n"
+			+ "\n"
+			+ "  -timing\n"
+			+ "     replay with the recorded timing and delay parameters\n"
+			+ "     (default: full speed without delays)\n"
+			+ "\n"
+			+ "  -iterations:<n>\n"
+			+ "     number of replays (1..10000), default: 1\n"
+			);
+	}
+
+	/**
+	 * Main startup method for replaying a trace file.
+	 * @param args the command line parameters.
+	 * @throws Exception
+	 */
+	public static void main(String[] args) throws Exception {
+		boolean originalTiming = false;
+		int iterations = 1;
+		String traceFile = null;
+		boolean hadErrors = false;
+
+		for (String arg : args) {
+			String a = arg.toLowerCase();
+			if (a.equals("-h")) {
+				usage();
+				return;
+			} else if (a.equals(PTiming)) {
+				originalTiming = true;
+			} else if (a.startsWith(PIterations)) {
+				try {
+					iterations = Integer.parseInt(a.substring(PIterations.length()));
+				} catch (NumberFormatException exc) {
+					iterations = -1;
+				}
+				if (iterations < 1 || iterations > 10000) {
+					System.out.println("Invalid parameter for '" + PIterations + "' (1..10000)");
+					hadErrors = true;
+				}
+			} else if (a.startsWith("-")) {
+				System.out.println("Unknown parameter: '" + arg + "'");
+				hadErrors = true;
+			} else if (traceFile == null) {
+				traceFile = arg;
+			} else {
+				System.out.println("Only one trace file can be replayed");
+				hadErrors = true;
+			}
+		}
+		if (traceFile == null || hadErrors) {
+			usage();
+			return;
+		}
+
+		try {
+			SessionReplay replay = new SessionReplay(new File(traceFile));
+			System.out.println(String.format(
+					"trace: %s, filter: %s, %d events, %d bytes from terminal, %d bytes from host",
+					traceFile, replay.filterName, replay.events.size(),
+					replay.bytesFromTerminal, replay.bytesFromHost));
+			long totalInput = replay.bytesFromTerminal + replay.bytesFromHost;
+			long minNanos = Long.MAX_VALUE;
+			long sumNanos = 0;
+			for (int i = 1; i <= iterations; i++) {
+				Result r = replay.replay(originalTiming);
+				minNanos = Math.min(minNanos, r.elapsedNanos);
+				sumNanos += r.elapsedNanos;
+				System.out.println(String.format(
+						"replay %4d: %10.2f ms, %8.2f MB/s input, %d bytes to terminal, %d bytes to host%s",
+						i,
+						r.elapsedNanos / 1.0e6,
+						(totalInput / (1024.0 * 1024.0)) / (r.elapsedNanos / 1.0e9),
+						r.bytesToTerminal,
+						r.bytesToHost,
+						(r.stalls > 0) ? ", " + r.stalls + " stalls" : ""));
+			}
+			if (iterations > 1) {
+				System.out.println(String.format("mean: %10.2f ms, best: %10.2f ms",
+						sumNanos / 1.0e6 / iterations, minNanos / 1.0e6));
+			}
+		} catch (IOException exc) {
+			System.out.println("** replay aborted, IOException: " + exc.getMessage());
+		} finally {
+			TimeoutScheduler.shutdown();
+			Log.shutdown();
+		}
+	}
+}
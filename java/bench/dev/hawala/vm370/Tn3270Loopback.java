@@ -0,0 +1,209 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.DataInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+
+/**
+ * A <code>Tn3270StreamFilter</code> connected over loopback sockets to a
+ * simulated IBM-3278-4-E terminal and a simulated VM/370 host, both doing
+ * the TN3270 negotiation and then discarding all data they receive.
+ * <p>
+ * This allows to feed 3270 data streams as coming from the host directly
+ * into the filter, measuring the processing without a real host or terminal.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class Tn3270Loopback {
+
+	private static final byte[] TN_DO_TERMINAL_TYPE = { (byte)0xFF, (byte)0xFD, (byte)0x18 };
+	private static final byte[] TN_WILL_TERMINAL_TYPE = { (byte)0xFF, (byte)0xFB, (byte)0x18 };
+	private static final byte[] TN_SB_SEND_TERMINAL_TYPE
+		= { (byte)0xFF, (byte)0xFA, (byte)0x18, (byte)0x01, (byte)0xFF, (byte)0xF0 };
+	private static final byte[] TN_SB_TERMINAL_TYPE_IS_3278_4_E
+		= { (byte)0xFF, (byte)0xFA, (byte)0x18, (byte)0x00,
+			(byte)0x49, (byte)0x42, (byte)0x4d, (byte)0x2d, // IBM-
+			(byte)0x33, (byte)0x32, (byte)0x37, (byte)0x38, // 3278
+			(byte)0x2d, (byte)0x34, (byte)0x2d, (byte)0x45, // -4-E
+			(byte)0xFF, (byte)0xF0 };
+	private static final byte[] TN_DO_END_OF_RECORD = { (byte)0xFF, (byte)0xFD, (byte)0x19 };
+	private static final byte[] TN_WILL_END_OF_RECORD = { (byte)0xFF, (byte)0xFB, (byte)0x19 };
+	private static final byte[] TN_DO_BINARY = { (byte)0xFF, (byte)0xFD, (byte)0x00 };
+	private static final byte[] TN_WILL_BINARY = { (byte)0xFF, (byte)0xFB, (byte)0x00 };
+
+	// the request-response pairs of the negotiation done by the filter with the terminal
+	private static final byte[][] TerminalNegotiation = {
+		TN_DO_TERMINAL_TYPE, TN_WILL_TERMINAL_TYPE,
+		TN_SB_SEND_TERMINAL_TYPE, TN_SB_TERMINAL_TYPE_IS_3278_4_E,
+		TN_DO_END_OF_RECORD, TN_WILL_END_OF_RECORD,
+		TN_WILL_END_OF_RECORD, TN_DO_END_OF_RECORD,
+		TN_DO_BINARY, TN_WILL_BINARY,
+		TN_WILL_BINARY, TN_DO_BINARY
+	};
+
+	private final Socket terminal; // the simulated terminal's end of the terminal connection
+	private final Socket host;     // the simulated host's end of the host connection
+	private final Tn3270StreamFilter filter;
+
+	private volatile long bytesToTerminal = 0;
+	private volatile long bytesToHost = 0;
+
+	/**
+	 * Create the filter with its simulated terminal and host, returning when
+	 * both negotiations are done.
+	 * @throws IOException
+	 */
+	public Tn3270Loopback() throws IOException {
+		InetAddress loopback = InetAddress.getByName("127.0.0.1");
+		ServerSocket termListener = new ServerSocket(0, 1, loopback);
+		ServerSocket hostListener = new ServerSocket(0, 1, loopback);
+		Socket filterTermSide;
+		Socket filterHostSide;
+		try {
+			this.terminal = new Socket(loopback, termListener.getLocalPort());
+			filterTermSide = termListener.accept();
+			filterHostSide = new Socket(loopback, hostListener.getLocalPort());
+			this.host = hostListener.accept();
+		} finally {
+			termListener.close();
+			hostListener.close();
+		}
+		this.terminal.setTcpNoDelay(true);
+		this.host.setTcpNoDelay(true);
+
+		this.startTerminal();
+		this.startHost();
+
+		this.filter = new Tn3270StreamFilter(
+				0,
+				null,
+				filterTermSide,
+				filterHostSide,
+				true, // no WSF query
+				(short)0,
+				(short)4,
+				Tn3270StreamFilter.DefaultMinHandshakeGapMs,
+				Tn3270StreamFilter.DefaultMinInteractionGapMs,
+				null);
+		if (this.filter.isClosed()) {
+			throw new IOException("TN3270 negotiation failed");
+		}
+	}
+
+	// answer the terminal negotiation, then discard the data sent to the terminal
+	private void startTerminal() {
+		Thread thr = new Thread(new Runnable() {
+			public void run() {
+				try {
+					DataInputStream is = new DataInputStream(terminal.getInputStream());
+					OutputStream os = terminal.getOutputStream();
+					for (int i = 0; i < TerminalNegotiation.length; i += 2) {
+						is.readFully(new byte[TerminalNegotiation[i].length]);
+						os.write(TerminalNegotiation[i + 1]);
+						os.flush();
+					}
+					byte[] buffer = new byte[8192];
+					int count = is.read(buffer);
+					while (count >= 0) {
+						bytesToTerminal += count;
+						count = is.read(buffer);
+					}
+				} catch (IOException exc) {
+					// connection closed
+				}
+			}
+		}, "loopback-terminal");
+		thr.setDaemon(true);
+		thr.start();
+	}
+
+	// request the TN3270 options from the filter, then discard the data sent to the host
+	private void startHost() {
+		Thread thr = new Thread(new Runnable() {
+			public void run() {
+				try {
+					OutputStream os = host.getOutputStream();
+					byte[] requests = new byte[
+						TN_DO_TERMINAL_TYPE.length + TN_SB_SEND_TERMINAL_TYPE.length
+						+ 2 * TN_DO_END_OF_RECORD.length + 2 * TN_DO_BINARY.length];
+					int pos = 0;
+					for (byte[] req : new byte[][] {
+							TN_DO_TERMINAL_TYPE, TN_SB_SEND_TERMINAL_TYPE,
+							TN_DO_END_OF_RECORD, TN_WILL_END_OF_RECORD,
+							TN_DO_BINARY, TN_WILL_BINARY }) {
+						System.arraycopy(req, 0, requests, pos, req.length);
+						pos += req.length;
+					}
+					os.write(requests);
+					os.flush();
+					InputStream is = host.getInputStream();
+					byte[] buffer = new byte[8192];
+					int count = is.read(buffer);
+					while (count >= 0) {
+						bytesToHost += count;
+						count = is.read(buffer);
+					}
+				} catch (IOException exc) {
+					// connection closed
+				}
+			}
+		}, "loopback-host");
+		thr.setDaemon(true);
+		thr.start();
+	}
+
+	/**
+	 * Process a 3270 data stream as if received from the host, in the calling thread.
+	 * @param buffer the byte buffer with the data stream (usually a complete record
+	 *   ending with the telnet EOR).
+	 * @param count the number of bytes to process.
+	 * @throws IOException
+	 * @throws InterruptedException
+	 */
+	public void processFromHost(byte[] buffer, int count) throws IOException, InterruptedException {
+		this.filter.processBytesHostToTerm(buffer, count);
+	}
+
+	/**
+	 * Get the number of bytes sent to the simulated terminal after the negotiation.
+	 * @return the byte count.
+	 */
+	public long getBytesToTerminal() {
+		return this.bytesToTerminal;
+	}
+
+	/**
+	 * Get the number of bytes sent to the simulated host after the negotiation.
+	 * @return the byte count.
+	 */
+	public long getBytesToHost() {
+		return this.bytesToHost;
+	}
+
+	/**
+	 * Close the simulated connections and shut down the filter.
+	 */
+	public void close() {
+		try { this.terminal.close(); } catch (IOException exc) { }
+		try { this.host.close(); } catch (IOException exc) { }
+		this.filter.shutdown();
+	}
+}
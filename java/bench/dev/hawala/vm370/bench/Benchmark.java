@@ -0,0 +1,75 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+/**
+ * Base class for a single benchmark executed by the <code>BenchmarkRunner</code>.
+ * <p>
+ * A benchmark prepares its data in <code>setUp()</code> and then executes
+ * a given number of operations in <code>run()</code>, returning a value
+ * derived from the results of the operations so the JIT compiler cannot
+ * eliminate the measured code.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public abstract class Benchmark {
+
+	private final String name;
+
+	/**
+	 * Construct the benchmark with the given name.
+	 * @param name the name identifying the benchmark in the results.
+	 */
+	protected Benchmark(String name) {
+		this.name = name;
+	}
+
+	/**
+	 * Get the name of the benchmark.
+	 * @return the benchmark name.
+	 */
+	public String getName() {
+		return this.name;
+	}
+
+	/**
+	 * Prepare the data used by the benchmark, invoked once before the
+	 * warmup iterations.
+	 * @throws Exception
+	 */
+	public void setUp() throws Exception { }
+
+	/**
+	 * Execute the given number of operations.
+	 * @param ops the number of operations to execute.
+	 * @return a value computed from the results of the operations.
+	 * @throws Exception
+	 */
+	public abstract long run(int ops) throws Exception;
+
+	/**
+	 * Get the number of data bytes processed by a single operation, allowing to
+	 * report the throughput of the benchmark.
+	 * @return the bytes processed per operation or 0 if the throughput is not relevant.
+	 */
+	public long getBytesPerOp() { return 0; }
+
+	/**
+	 * Release the resources of the benchmark, invoked once after the
+	 * measurement iterations.
+	 * @throws Exception
+	 */
+	public void tearDown() throws Exception { }
+}
@@ -0,0 +1,327 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.text.SimpleDateFormat;
+import java.util.ArrayList;
+import java.util.Date;
+import java.util.List;
+
+import dev.hawala.vm370.Log;
+import dev.hawala.vm370.TimeoutScheduler;
+
+/**
+ * Runner for the benchmark suite of the MECAFF Java classes.
+ * <p>
+ * Each benchmark is calibrated to batches of at least 10 ms, then executed
+ * for a number of warmup iterations (for the JIT compiler to settle) and
+ * measured over a number of timed iterations, reporting the mean time per
+ * operation with its standard deviation and the best iteration.
+ * <br/>
+ * For results comparable over time, the runner should be started on an otherwise
+ * idle machine with a fixed heap and garbage collector, e.g.:
+ * <pre>
+ *   java -Xms256m -Xmx256m -XX:+UseSerialGC -cp bin dev.hawala.vm370.bench.BenchmarkRunner -csv:bench.csv
+ * </pre>
+ * and the results should be appended to a CSV file (parameter <code>-csv:</code>),
+ * which records the date, the JVM and the OS with each result line.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class BenchmarkRunner {
+
+	private static final String PFilter = "-filter:";
+	private static final String PWarmup = "-warmup:";
+	private static final String PIterations = "-iterations:";
+	private static final String PTime = "-time:";
+	private static final String PCsv = "-csv:";
+	private static final String PList = "-list";
+
+	private static final long MinBatchNanos = 10000000L; // 10 ms
+
+	// sink for the benchmark results, preventing the JIT from eliminating the measured code
+	private static volatile long blackhole = 0;
+
+	private final int warmupIterations;
+	private final int measureIterations;
+	private final long iterationNanos;
+
+	/**
+	 * Construct the runner with the given measurement parameters.
+	 * @param warmupIterations number of unmeasured iterations before measuring.
+	 * @param measureIterations number of measured iterations.
+	 * @param iterationMs duration of a single iteration in milliseconds.
+	 */
+	public BenchmarkRunner(int warmupIterations, int measureIterations, int iterationMs) {
+		this.warmupIterations = warmupIterations;
+		this.measureIterations = measureIterations;
+		this.iterationNanos = iterationMs * 1000000L;
+	}
+
+	/**
+	 * Result of a single benchmark run.
+	 */
+	public static class Result {
+		public final String name;
+		public final int iterations;
+		public final double meanNsPerOp;
+		public final double stdDevNsPerOp;
+		public final double minNsPerOp;
+		public final double mbPerSec;
+
+		public Result(String name, double[] nsPerOp, long bytesPerOp) {
+			this.name = name;
+			this.iterations = nsPerOp.length;
+			double sum = 0;
+			double min = Double.MAX_VALUE;
+			for (double v : nsPerOp) {
+				sum += v;
+				min = Math.min(min, v);
+			}
+			this.meanNsPerOp = sum / nsPerOp.length;
+			double sqSum = 0;
+			for (double v : nsPerOp) {
+				sqSum += (v - this.meanNsPerOp) * (v - this.meanNsPerOp);
+			}
+			this.stdDevNsPerOp = (nsPerOp.length > 1) ? Math.sqrt(sqSum / (nsPerOp.length - 1)) : 0;
+			this.minNsPerOp = min;
+			this.mbPerSec = (bytesPerOp > 0) ? (bytesPerOp * 1.0e9 / this.meanNsPerOp) / (1024 * 1024) : 0;
+		}
+
+		@Override
+		public String toString() {
+			String result = String.format(
+					"%-44s %14.1f ns/op  +- %10.1f  (min %14.1f, %12.0f ops/s)",
+					this.name,
+					this.meanNsPerOp,
+					this.stdDevNsPerOp,
+					this.minNsPerOp,
+					1.0e9 / this.meanNsPerOp);
+			if (this.mbPerSec > 0) {
+				result += String.format("  %10.1f MB/s", this.mbPerSec);
+			}
+			return result;
+		}
+	}
+
+	// run batches of 'ops' operations for the iteration time, returning the nanoseconds per operation
+	private double runIteration(Benchmark bench, int ops) throws Exception {
+		long totalOps = 0;
+		long start = System.nanoTime();
+		long elapsed = 0;
+		while (elapsed < this.iterationNanos) {
+			blackhole += bench.run(ops);
+			totalOps += ops;
+			elapsed = System.nanoTime() - start;
+		}
+		return (double)elapsed / totalOps;
+	}
+
+	// find the number of operations taking at least 'MinBatchNanos'
+	private int calibrate(Benchmark bench) throws Exception {
+		int ops = 1;
+		while (ops < (1 << 30)) {
+			long start = System.nanoTime();
+			blackhole += bench.run(ops);
+			if ((System.nanoTime() - start) >= MinBatchNanos) { break; }
+			ops *= 2;
+		}
+		return ops;
+	}
+
+	/**
+	 * Execute a single benchmark.
+	 * @param bench the benchmark to execute.
+	 * @return the measurement result.
+	 * @throws Exception
+	 */
+	public Result run(Benchmark bench) throws Exception {
+		bench.setUp();
+		try {
+			int ops = this.calibrate(bench);
+			for (int i = 0; i < this.warmupIterations; i++) {
+				this.runIteration(bench, ops);
+			}
+			double[] nsPerOp = new double[this.measureIterations];
+			for (int i = 0; i < this.measureIterations; i++) {
+				nsPerOp[i] = this.runIteration(bench, ops);
+			}
+			return new Result(bench.getName(), nsPerOp, bench.getBytesPerOp());
+		} finally {
+			bench.tearDown();
+		}
+	}
+
+	/**
+	 * Get all benchmarks of the suite.
+	 * @return the list of benchmarks.
+	 */
+	public static List<Benchmark> getSuite() {
+		List<Benchmark> suite = new ArrayList<Benchmark>();
+		EbcdicBenchmarks.addTo(suite);
+		TransportBenchmarks.addTo(suite);
+		Stream3270Benchmarks.addTo(suite);
+		LineBufferBenchmarks.addTo(suite);
+		HostStreamBenchmarks.addTo(suite);
+		return suite;
+	}
+
+	private static boolean isSelected(Benchmark bench, String[] filters) {
+		if (filters == null) { return true; }
+		String name = bench.getName().toLowerCase();
+		for (String f : filters) {
+			if (name.contains(f)) { return true; }
+		}
+		return false;
+	}
+
+	private static String getEnvironment() {
+		Runtime rt = Runtime.getRuntime();
+		return System.getProperty("java.vm.name") + " " + System.getProperty("java.version")
+			+ " / " + System.getProperty("os.name") + " " + System.getProperty("os.version")
+			+ " " + System.getProperty("os.arch")
+			+ " / " + rt.availableProcessors() + " cpus, " + (rt.maxMemory() / (1024 * 1024)) + " MB heap";
+	}
+
+	private static int parseNumeric(String arg, String argName, int minValue, int maxValue) {
+		try {
+			int value = Integer.parseInt(arg.substring(argName.length()));
+			if (value >= minValue && value <= maxValue) { return value; }
+		} catch(NumberFormatException exc) {
+			// handled below
+		}
+		System.out.println("Invalid parameter for '" + argName + "' (" + minValue + ".." + maxValue + ")");
+		return -1;
+	}
+
+	private static void usage() {
+		System.out.println(
+			"Usage: BenchmarkRunner [options]\n"
+			+ "\n"
+			+ "with options:\n"
+			+ "\n"
+			+ "  -filter:<text>[,<text>...]\n"
+			+ "     run only the benchmarks with a name containing one of the texts\n"
+			+ "\n"
+			+ "  -warmup:<n>\n"
+			+ "     number of warmup iterations (1..100), default: 5\n"
+			+ "\n"
+			+ "  -iterations:<n>\n"
+			+ "     number of measured iterations (1..100), default: 10\n"
+			+ "\n"
+			+ "  -time:<ms>\n"
+			+ "     duration of an iteration in milliseconds (100..60000), default: 1000\n"
+			+ "\n"
+			+ "  -csv:<file>\n"
+			+ "     append the results to the given CSV file\n"
+			+ "\n"
+			+ "  -list\n"
+			+ "     list the benchmark names and exit\n"
+			);
+	}
+
+	/**
+	 * Main startup method for the benchmark suite.
+	 * @param args the command line parameters.
+	 * @throws Exception
+	 */
+	public static void main(String[] args) throws Exception {
+		String[] filters = null;
+		int warmup = 5;
+		int iterations = 10;
+		int timeMs = 1000;
+		String csvFile = null;
+		boolean doList = false;
+		boolean hadErrors = false;
+
+		for (String arg : args) {
+			String a = arg.toLowerCase();
+			if (a.equals("-h")) {
+				usage();
+				return;
+			} else if (a.startsWith(PFilter)) {
+				filters = a.substring(PFilter.length()).split(",");
+			} else if (a.startsWith(PWarmup)) {
+				warmup = parseNumeric(a, PWarmup, 1, 100);
+				hadErrors |= (warmup < 0);
+			} else if (a.startsWith(PIterations)) {
+				iterations = parseNumeric(a, PIterations, 1, 100);
+				hadErrors |= (iterations < 0);
+			} else if (a.startsWith(PTime)) {
+				timeMs = parseNumeric(a, PTime, 100, 60000);
+				hadErrors |= (timeMs < 0);
+			} else if (a.startsWith(PCsv)) {
+				csvFile = arg.substring(PCsv.length());
+			} else if (a.equals(PList)) {
+				doList = true;
+			} else {
+				System.out.println("Unknown parameter: '" + arg + "'");
+				hadErrors = true;
+			}
+		}
+		if (hadErrors) {
+			usage();
+			return;
+		}
+
+		List<Benchmark> suite = getSuite();
+		if (doList) {
+			for (Benchmark bench : suite) { System.out.println(bench.getName()); }
+			return;
+		}
+
+		String env = getEnvironment();
+		String timestamp = new SimpleDateFormat("yyyy-MM-dd HH:mm:ss").format(new Date());
+		System.out.println("MECAFF benchmarks -- " + timestamp);
+		System.out.println(env);
+		System.out.println("warmup: " + warmup + " x " + timeMs + " ms, measured: " + iterations + " x " + timeMs + " ms");
+		System.out.println();
+
+		PrintWriter csv = null;
+		if (csvFile != null) {
+			boolean isNew = !new File(csvFile).exists();
+			csv = new PrintWriter(new FileWriter(csvFile, true));
+			if (isNew) {
+				csv.println("timestamp,benchmark,iterations,mean_ns_op,stddev_ns_op,min_ns_op,mb_s,environment");
+			}
+		}
+
+		BenchmarkRunner runner = new BenchmarkRunner(warmup, iterations, timeMs);
+		try {
+			for (Benchmark bench : suite) {
+				if (!isSelected(bench, filters)) { continue; }
+				Result r = runner.run(bench);
+				System.out.println(r);
+				if (csv != null) {
+					csv.println(String.format(
+							"%s,%s,%d,%.1f,%.1f,%.1f,%.1f,\"%s\"",
+							timestamp, r.name, r.iterations, r.meanNsPerOp, r.stdDevNsPerOp, r.minNsPerOp, r.mbPerSec, env));
+					csv.flush();
+				}
+			}
+		} catch(IOException exc) {
+			System.out.println("** benchmark aborted, IOException: " + exc.getMessage());
+		} finally {
+			if (csv != null) { csv.close(); }
+			TimeoutScheduler.shutdown();
+			Log.shutdown();
+		}
+		if (blackhole == 42) { System.out.println(); } // keep the results alive
+	}
+}
@@ -0,0 +1,191 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.util.List;
+
+import dev.hawala.vm370.ebcdic.Ebcdic;
+import dev.hawala.vm370.ebcdic.EbcdicHandler;
+
+/**
+ * Benchmarks for the ASCII/EBCDIC conversions, using typical console
+ * lines (80 characters) as well as full screen contents (43x80) and
+ * larger blocks (64 KByte), reporting the throughput in MB/s.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class EbcdicBenchmarks {
+
+	/** Text of a typical CMS console line (80 characters). */
+	public static final String ConsoleLine
+		= "PROFILE  EXEC     A1 F         80         42          1  3/14/12 10:23:45     ";
+
+	// build a text of the given length from the console line
+	private static String makeText(int length) {
+		StringBuilder sb = new StringBuilder(length);
+		while (sb.length() < length) { sb.append(ConsoleLine); }
+		sb.setLength(length);
+		return sb.toString();
+	}
+
+	private static class ToEbcdic extends Benchmark {
+		private final String text;
+
+		public ToEbcdic(String name, int length) {
+			super(name);
+			this.text = makeText(length);
+		}
+
+		@Override
+		public long getBytesPerOp() {
+			return this.text.length();
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				sum += Ebcdic.toEbcdic(this.text).length;
+			}
+			return sum;
+		}
+	}
+
+	private static class ToAscii extends Benchmark {
+		private final byte[] ebcdic;
+
+		public ToAscii(String name, int length) {
+			super(name);
+			this.ebcdic = Ebcdic.toEbcdic(makeText(length));
+		}
+
+		@Override
+		public long getBytesPerOp() {
+			return this.ebcdic.length;
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				sum += Ebcdic.toAscii(this.ebcdic, 0, this.ebcdic.length).length();
+			}
+			return sum;
+		}
+	}
+
+	private static class HandlerRoundtrip extends Benchmark {
+		private final String text = ConsoleLine;
+		private final EbcdicHandler handler = new EbcdicHandler();
+
+		public HandlerRoundtrip() {
+			super("ebcdic.handler.appendUnicode+getString.80");
+		}
+
+		@Override
+		public long getBytesPerOp() {
+			return this.text.length();
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				sum += this.handler.reset().appendUnicode(this.text).getString().length();
+			}
+			return sum;
+		}
+	}
+
+	/**
+	 * Bulk conversion of a byte array slice into another byte array.
+	 */
+	private static class BulkConvert extends Benchmark {
+		private final boolean toEbcdic;
+		private final byte[] src;
+		private final byte[] dst;
+
+		public BulkConvert(boolean toEbcdic, int length) {
+			super((toEbcdic ? "ebcdic.bulk.asciiToEbcdic." : "ebcdic.bulk.ebcdicToAscii.") + length);
+			this.toEbcdic = toEbcdic;
+			String text = makeText(length);
+			this.src = toEbcdic ? text.getBytes() : Ebcdic.toEbcdic(text);
+			this.dst = new byte[length];
+		}
+
+		@Override
+		public long getBytesPerOp() {
+			return this.src.length;
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				if (this.toEbcdic) {
+					Ebcdic.asciiToEbcdic(this.src, 0, this.dst, 0, this.src.length);
+				} else {
+					Ebcdic.ebcdicToAscii(this.src, 0, this.dst, 0, this.src.length);
+				}
+				sum += this.dst[i % this.dst.length];
+			}
+			return sum;
+		}
+	}
+
+	/**
+	 * Append ASCII host output lines (as coming in over a 3215 connection)
+	 * to an EBCDIC string.
+	 */
+	private static class HandlerAppendAscii extends Benchmark {
+		private final byte[] ascii = ConsoleLine.getBytes();
+		private final EbcdicHandler handler = new EbcdicHandler();
+
+		public HandlerAppendAscii() {
+			super("ebcdic.handler.appendAscii.80");
+		}
+
+		@Override
+		public long getBytesPerOp() {
+			return this.ascii.length;
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				sum += this.handler.reset().appendAscii(this.ascii, 0, this.ascii.length).getLength();
+			}
+			return sum;
+		}
+	}
+
+	/**
+	 * Add the EBCDIC benchmarks to the suite.
+	 * @param suite the list of benchmarks to add to.
+	 */
+	public static void addTo(List<Benchmark> suite) {
+		suite.add(new ToEbcdic("ebcdic.toEbcdic.80", 80));
+		suite.add(new ToEbcdic("ebcdic.toEbcdic.3440", 43 * 80));
+		suite.add(new ToAscii("ebcdic.toAscii.80", 80));
+		suite.add(new ToAscii("ebcdic.toAscii.3440", 43 * 80));
+		suite.add(new HandlerRoundtrip());
+		suite.add(new HandlerAppendAscii());
+		suite.add(new BulkConvert(true, 43 * 80));
+		suite.add(new BulkConvert(false, 43 * 80));
+		suite.add(new BulkConvert(true, 65536));
+		suite.add(new BulkConvert(false, 65536));
+	}
+}
@@ -0,0 +1,101 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.IOException;
+import java.lang.management.ManagementFactory;
+
+import dev.hawala.vm370.LineBuffer;
+import dev.hawala.vm370.Vm3270Console;
+import dev.hawala.vm370.ebcdic.EbcdicHandler;
+
+/**
+ * Measurement of the heap allocation per host output line in the steady
+ * state of the MECAFF-console, i.e. after the output history has reached
+ * its maximal size.
+ * <p>
+ * The allocated bytes are taken from the per-thread allocation counter
+ * of the (HotSpot) JVM, so this program must be run on a JVM providing
+ * <code>com.sun.management.ThreadMXBean</code>.
+ * <p>
+ * Usage: <code>java dev.hawala.vm370.bench.HostOutputAllocBench [lines]</code>
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class HostOutputAllocBench {
+
+	private static final int WarmupLines = 200000; // more than the console's output history
+
+	private static final com.sun.management.ThreadMXBean threadBean
+		= (com.sun.management.ThreadMXBean)ManagementFactory.getThreadMXBean();
+
+	private static long allocatedBytes() {
+		return threadBean.getThreadAllocatedBytes(Thread.currentThread().getId());
+	}
+
+	private static void report(String what, long bytes, int lines, long nanos) {
+		System.out.printf(
+				"%-32s: %8.2f bytes/line, %8.0f ns/line\n",
+				what,
+				(double)bytes / lines,
+				(double)nanos / lines);
+	}
+
+	/**
+	 * Main startup method.
+	 * @param args the optional number of lines to measure.
+	 * @throws IOException
+	 */
+	public static void main(String[] args) throws IOException {
+		int lines = (args.length > 0) ? Integer.parseInt(args[0]) : 1000000;
+
+		EbcdicHandler[] texts = new EbcdicHandler[16];
+		for (int i = 0; i < texts.length; i++) {
+			StringBuilder sb = new StringBuilder();
+			sb.append("R; T=0.01/0.01 12:34:").append(10 + i).append(' ');
+			for (int j = 0; j < i * 7; j++) { sb.append((char)('A' + (j % 26))); }
+			texts[i] = new EbcdicHandler(sb.toString());
+		}
+
+		// the line buffer alone
+		LineBuffer lineBuffer = new LineBuffer(65536, 80, 42);
+		for (int i = 0; i < WarmupLines; i++) {
+			lineBuffer.append(texts[i % texts.length], (byte)0);
+		}
+		long startBytes = allocatedBytes();
+		long startNanos = System.nanoTime();
+		for (int i = 0; i < lines; i++) {
+			lineBuffer.append(texts[i % texts.length], (byte)0);
+		}
+		report("LineBuffer.append", allocatedBytes() - startBytes, lines, System.nanoTime() - startNanos);
+
+		// the complete console output path (line buffer + 3270 output stream)
+		Vm3270Console console = new Vm3270Console(
+				new NullInputSink(),
+				new NullOutputStream(),
+				43, 80, true, (short)0);
+		console.setFlowMode(true);
+		for (int i = 0; i < WarmupLines; i++) {
+			console.appendHostLine(texts[i % texts.length]);
+		}
+		startBytes = allocatedBytes();
+		startNanos = System.nanoTime();
+		for (int i = 0; i < lines; i++) {
+			console.appendHostLine(texts[i % texts.length]);
+		}
+		report("Vm3270Console.appendHostLine", allocatedBytes() - startBytes, lines, System.nanoTime() - startNanos);
+		console.close();
+	}
+}
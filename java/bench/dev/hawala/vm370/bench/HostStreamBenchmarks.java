@@ -0,0 +1,184 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.util.ArrayList;
+import java.util.List;
+
+import dev.hawala.vm370.Tn3270Loopback;
+import dev.hawala.vm370.stream3270.DataOutStream3270;
+import dev.hawala.vm370.transport.DataEncoder;
+import dev.hawala.vm370.transport.ITransportEncoding;
+import dev.hawala.vm370.transport.TransportEncoding3270;
+
+/**
+ * Benchmark for parsing the 3270 output stream of CP in the <code>Tn3270StreamFilter</code>,
+ * feeding CP output records into a filter connected to a simulated terminal and host.
+ * <p>
+ * By default, the records are synthetic CP screen updates (4 output lines and the
+ * RUNNING status on a 3278-4). If the system property <code>mecaff.bench.h2tRecording</code>
+ * names a file with a recorded host-to-terminal data stream, the telnet records in
+ * this file are processed instead.
+ * <p>
+ * Remark: the host-to-terminal pipeline of the filter pauses 1 ms after each output
+ * line to give the terminal a chance to keep up, so the results of this benchmark
+ * are dominated by this pause for records with output lines.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class HostStreamBenchmarks {
+
+	private static final int Rows = 43;
+	private static final int Cols = 80;
+	private static final int StateRow = 43;
+	private static final int StateCol = 61;
+
+	private static final String RecordingProperty = "mecaff.bench.h2tRecording";
+
+	// get the bytes of the stream as telnet record
+	private static byte[] toRecord(DataOutStream3270 stream) throws IOException {
+		ByteArrayOutputStream bos = new ByteArrayOutputStream();
+		stream.telnetEOR().writeToSink(bos, true);
+		return bos.toByteArray();
+	}
+
+	// split a recorded data stream into the telnet records
+	private static List<byte[]> loadRecording(String filename) throws IOException {
+		File file = new File(filename);
+		byte[] data = new byte[(int)file.length()];
+		InputStream is = new FileInputStream(file);
+		try {
+			int pos = 0;
+			while (pos < data.length) {
+				int count = is.read(data, pos, data.length - pos);
+				if (count < 0) { break; }
+				pos += count;
+			}
+		} finally {
+			is.close();
+		}
+
+		List<byte[]> records = new ArrayList<byte[]>();
+		int start = 0;
+		for (int i = 1; i < data.length; i++) {
+			if (data[i - 1] == (byte)0xFF && data[i] == (byte)0xEF) {
+				byte[] record = new byte[i + 1 - start];
+				System.arraycopy(data, start, record, 0, record.length);
+				records.add(record);
+				start = i + 1;
+			}
+		}
+		return records;
+	}
+
+	/**
+	 * Process CP screen updates in the filter.
+	 */
+	private static class ParseCpOutput extends Benchmark {
+		private final List<byte[]> records = new ArrayList<byte[]>();
+		private Tn3270Loopback loopback;
+
+		public ParseCpOutput() {
+			super("tn3270Filter.handleDataStreamH2T.cpOutput");
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			this.loopback = new Tn3270Loopback();
+			DataOutStream3270 stream = new DataOutStream3270(Cols, Rows, true);
+
+			// the Hercules logo screen (ignored by the filter up to the title line)
+			stream
+				.cmdEraseWrite(false, true, true)
+				.setBufferAddress(5, 2)
+				.appendUnicode("           HHH          HHH   The S/370, ESA/390 and z/Architecture");
+			this.feed(toRecord(stream));
+
+			// the initial CP screen, the MECAFF-console being switched to flow mode by a FSIO command
+			ITransportEncoding encoding = new TransportEncoding3270();
+			DataEncoder encoder = new DataEncoder(encoding);
+			encoder.reset(encoding.getCmdStartSequence())
+				.append(encoding.getRequSETFLOWMODE())
+				.encodeInt(1);
+			byte[] cmd = new byte[encoder.getLength()];
+			encoder.writeTo(cmd, 0);
+			stream
+				.cmdEraseWriteAlternate(false, true, true)
+				.setBufferAddress(1, 1)
+				.appendEbcdic(cmd)
+				.setBufferAddress(StateRow, StateCol)
+				.appendUnicode("RUNNING          ");
+			this.feed(toRecord(stream));
+
+			String recording = System.getProperty(RecordingProperty);
+			if (recording != null) {
+				this.records.addAll(loadRecording(recording));
+				if (this.records.isEmpty()) {
+					throw new IOException("No telnet records in recording " + recording);
+				}
+				return;
+			}
+
+			// screen updates by CP as for a running program writing output lines
+			for (int rec = 0; rec < 10; rec++) {
+				stream.cmdWrite(false, true, false);
+				for (int line = 0; line < 4; line++) {
+					int row = (rec * 4 + line) % (Rows - 2) + 1;
+					stream
+						.setBufferAddress(row, 1)
+						.appendUnicode(EbcdicBenchmarks.ConsoleLine.substring(line * 5));
+				}
+				stream
+					.setBufferAddress(StateRow, StateCol)
+					.appendUnicode("RUNNING          ");
+				this.records.add(toRecord(stream));
+			}
+		}
+
+		private void feed(byte[] record) throws Exception {
+			this.loopback.processFromHost(record, record.length);
+		}
+
+		@Override
+		public long run(int ops) throws Exception {
+			int recCount = this.records.size();
+			for (int i = 0; i < ops; i++) {
+				this.feed(this.records.get(i % recCount));
+			}
+			return this.loopback.getBytesToTerminal();
+		}
+
+		@Override
+		public void tearDown() {
+			if (this.loopback != null) {
+				this.loopback.close();
+				this.loopback = null;
+			}
+		}
+	}
+
+	/**
+	 * Add the host data stream benchmarks to the suite.
+	 * @param suite the list of benchmarks to add to.
+	 */
+	public static void addTo(List<Benchmark> suite) {
+		suite.add(new ParseCpOutput());
+	}
+}
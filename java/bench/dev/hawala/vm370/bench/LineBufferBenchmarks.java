@@ -0,0 +1,133 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.util.List;
+
+import dev.hawala.vm370.LineBuffer;
+import dev.hawala.vm370.ebcdic.Ebcdic;
+
+/**
+ * Benchmarks for the output history of the MECAFF-console with history
+ * sizes from 10k to 1M lines, the line buffer being completely filled
+ * before measuring (so each appended line drops the oldest line).
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class LineBufferBenchmarks {
+
+	private static final int Cols = 80;
+	private static final int OutRows = 41;
+
+	// texts of different lengths (1 to 2 screen rows)
+	private static byte[][] makeLines() {
+		byte[][] lines = new byte[8][];
+		String text = EbcdicBenchmarks.ConsoleLine + EbcdicBenchmarks.ConsoleLine;
+		for (int i = 0; i < lines.length; i++) {
+			lines[i] = Ebcdic.toEbcdic(text.substring(0, 20 + (i * 19)));
+		}
+		return lines;
+	}
+
+	private static LineBuffer makeFilledBuffer(int historySize, byte[][] lines) {
+		LineBuffer buffer = new LineBuffer(historySize, Cols, OutRows);
+		for (int i = 0; i < historySize; i++) {
+			byte[] line = lines[i % lines.length];
+			buffer.append(line, 0, line.length, (byte)0);
+		}
+		return buffer;
+	}
+
+	private static class Append extends Benchmark {
+		private final int historySize;
+		private final byte[][] lines = makeLines();
+		private LineBuffer buffer;
+
+		public Append(int historySize) {
+			super("lineBuffer.append." + historySize);
+			this.historySize = historySize;
+		}
+
+		@Override
+		public void setUp() {
+			this.buffer = makeFilledBuffer(this.historySize, this.lines);
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				byte[] line = this.lines[i & 7];
+				sum += this.buffer.append(line, 0, line.length, (byte)0);
+			}
+			return sum;
+		}
+
+		@Override
+		public void tearDown() {
+			this.buffer = null;
+		}
+	}
+
+	private static class GetPage extends Benchmark {
+		private final int historySize;
+		private final byte[][] lines = makeLines();
+		private final byte[][] frameLines = new byte[OutRows][];
+		private final int[] frameLengths = new int[OutRows];
+		private final byte[] frameFlags = new byte[OutRows];
+		private LineBuffer buffer;
+
+		public GetPage(int historySize) {
+			super("lineBuffer.pageAndGetLines." + historySize);
+			this.historySize = historySize;
+		}
+
+		@Override
+		public void setUp() {
+			this.buffer = makeFilledBuffer(this.historySize, this.lines);
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				if ((i & 15) == 0) {
+					this.buffer.pageToYoungest();
+				} else {
+					this.buffer.pageTowardsOldest();
+				}
+				sum += this.buffer.getPageLinesAndFlags(this.frameLines, this.frameLengths, this.frameFlags);
+			}
+			return sum;
+		}
+
+		@Override
+		public void tearDown() {
+			this.buffer = null;
+		}
+	}
+
+	/**
+	 * Add the line buffer benchmarks to the suite.
+	 * @param suite the list of benchmarks to add to.
+	 */
+	public static void addTo(List<Benchmark> suite) {
+		suite.add(new Append(10000));
+		suite.add(new Append(100000));
+		suite.add(new Append(1000000));
+		suite.add(new GetPage(10000));
+		suite.add(new GetPage(1000000));
+	}
+}
@@ -0,0 +1,47 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.IOException;
+
+import dev.hawala.vm370.IVm3270ConsoleCompletedSink;
+import dev.hawala.vm370.IVm3270ConsoleInputSink;
+import dev.hawala.vm370.ebcdic.EbcdicHandler;
+import dev.hawala.vm370.transport.ByteBuffer;
+
+/**
+ * Host side of a MECAFF-console ignoring all user interactions, allowing
+ * to run a console without a host connection.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class NullInputSink implements IVm3270ConsoleInputSink {
+
+	public void sendUserInput(EbcdicHandler inputLine) throws IOException { }
+
+	public boolean sendInterrupt_CP(EbcdicHandler drainGuard) throws IOException { return false; }
+
+	public boolean sendInterrupt_HT(EbcdicHandler drainGuard) throws IOException { return false; }
+
+	public boolean sendInterrupt_HX(EbcdicHandler drainGuard) throws IOException { return false; }
+
+	public boolean sendPF03() throws IOException { return false; }
+
+	public void sendFullScreenInput(ByteBuffer buffer, IVm3270ConsoleCompletedSink completedCallBack) throws IOException { }
+
+	public void sendFullScreenDataAvailability(boolean isAvailable) throws IOException { }
+
+	public void sendFullScreenTimedOut() throws IOException { }
+}
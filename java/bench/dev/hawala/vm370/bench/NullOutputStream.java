@@ -0,0 +1,58 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.IOException;
+import java.io.OutputStream;
+
+/**
+ * Output stream swallowing all data written, counting the bytes and the
+ * write calls for the benchmark results.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class NullOutputStream extends OutputStream {
+
+	private long byteCount = 0;
+	private long writeCount = 0;
+
+	@Override
+	public void write(int b) throws IOException {
+		this.byteCount++;
+		this.writeCount++;
+	}
+
+	@Override
+	public void write(byte[] b, int off, int len) throws IOException {
+		this.byteCount += len;
+		this.writeCount++;
+	}
+
+	/**
+	 * Get the number of bytes written so far.
+	 * @return the byte count.
+	 */
+	public long getByteCount() {
+		return this.byteCount;
+	}
+
+	/**
+	 * Get the number of write calls so far (each being a separate send on a socket).
+	 * @return the write count.
+	 */
+	public long getWriteCount() {
+		return this.writeCount;
+	}
+}
@@ -0,0 +1,103 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.ByteArrayOutputStream;
+
+import dev.hawala.vm370.Log;
+import dev.hawala.vm370.TimeoutScheduler;
+import dev.hawala.vm370.Vm3270Console;
+import dev.hawala.vm370.ebcdic.Ebcdic;
+import dev.hawala.vm370.ebcdic.EbcdicHandler;
+import dev.hawala.vm370.stream3270.DataOutStream3270;
+import dev.hawala.vm370.transport.ByteBuffer;
+
+/**
+ * Check of the number of write calls issued to the terminal connection per
+ * 3270 record sent by the MECAFF-console, as each write becomes a separate
+ * send on the socket and (with TCP_NODELAY) usually a separate TCP segment.
+ * <p>
+ * Each record should go out with exactly one write, also for fullscreen
+ * output containing bytes to be escaped for telnet (0xFF).
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class RecordWriteCount {
+
+	private static final int Rows = 43;
+	private static final int Cols = 80;
+	private static final int Records = 1000;
+
+	// build a fullscreen output stream with a 0xFF byte in each line
+	private static ByteBuffer makeFullscreen() throws Exception {
+		byte[] text = Ebcdic.toEbcdic(EbcdicBenchmarks.ConsoleLine.substring(0, Cols - 1));
+		text[40] = (byte)0xFF;
+		DataOutStream3270 stream = new DataOutStream3270(Cols, Rows, true);
+		stream.cmdEraseWriteAlternate(false, true, true);
+		for (int row = 1; row <= Rows; row++) {
+			stream
+				.setBufferAddress(row, 1)
+				.appendEbcdic(text, 0, text.length);
+		}
+		ByteArrayOutputStream bos = new ByteArrayOutputStream();
+		stream.writeToSink(bos, true);
+		ByteBuffer buffer = new ByteBuffer(8192, 2048);
+		buffer.append(bos.toByteArray());
+		return buffer;
+	}
+
+	private static boolean report(String what, NullOutputStream sink, long writesBefore) {
+		long writes = sink.getWriteCount() - writesBefore;
+		double perRecord = (double)writes / Records;
+		System.out.println(String.format("%-36s %8.2f writes/record", what, perRecord));
+		return perRecord <= 1.0;
+	}
+
+	/**
+	 * Main startup method for the write count check.
+	 * @param args (ignored)
+	 * @throws Exception
+	 */
+	public static void main(String[] args) throws Exception {
+		boolean ok = true;
+		NullOutputStream sink = new NullOutputStream();
+		Vm3270Console console = new Vm3270Console(new NullInputSink(), sink, Rows, Cols, true, (short)0);
+		try {
+			console.setFlowMode(true);
+			EbcdicHandler line = new EbcdicHandler(EbcdicBenchmarks.ConsoleLine);
+			long writesBefore = sink.getWriteCount();
+			for (int i = 0; i < Records; i++) {
+				console.appendHostLine(line);
+			}
+			ok &= report("console output line (flow mode)", sink, writesBefore);
+
+			ByteBuffer screen = makeFullscreen();
+			if (!console.acquireFullScreen(false)) {
+				System.out.println("** unable to acquire the fullscreen mode");
+				return;
+			}
+			writesBefore = sink.getWriteCount();
+			for (int i = 0; i < Records; i++) {
+				console.writeFullscreen(screen);
+			}
+			ok &= report("fullscreen write (with 0xFF bytes)", sink, writesBefore);
+		} finally {
+			console.close();
+			TimeoutScheduler.shutdown();
+			Log.shutdown();
+		}
+		System.out.println(ok ? "OK: single write per record" : "** FAILED: multiple writes per record");
+	}
+}
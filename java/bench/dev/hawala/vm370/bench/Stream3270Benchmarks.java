@@ -0,0 +1,127 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.util.List;
+
+import dev.hawala.vm370.Vm3270Console;
+import dev.hawala.vm370.ebcdic.Ebcdic;
+import dev.hawala.vm370.ebcdic.EbcdicHandler;
+import dev.hawala.vm370.stream3270.Color3270;
+import dev.hawala.vm370.stream3270.DataOutStream3270;
+import dev.hawala.vm370.stream3270.ExtHighlight3270;
+
+/**
+ * Benchmarks for building 3270 output streams for a complete colored
+ * console screen on a 3278-4 (43x80) terminal.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class Stream3270Benchmarks {
+
+	private static final int Rows = 43;
+	private static final int Cols = 80;
+
+	private static final Color3270[] LineColors = {
+		Color3270.Green, Color3270.Turquoise, Color3270.White, Color3270.Yellow };
+
+	/**
+	 * Build the screen of the MECAFF-console with <code>DataOutStream3270</code>
+	 * the way the console does: one colored line per output row, the status
+	 * and the input field in the last 2 rows.
+	 */
+	private static class BuildScreen extends Benchmark {
+		private final DataOutStream3270 stream = new DataOutStream3270(Cols, Rows, true);
+		private final NullOutputStream sink = new NullOutputStream();
+		private final byte[][] lines = new byte[Rows - 2][];
+		private final EbcdicHandler status = new EbcdicHandler("VM READ  >>");
+
+		public BuildScreen() {
+			super("stream3270.buildScreen.43x80");
+			for (int i = 0; i < this.lines.length; i++) {
+				this.lines[i] = Ebcdic.toEbcdic(EbcdicBenchmarks.ConsoleLine.substring(i % 20));
+			}
+		}
+
+		@Override
+		public long run(int ops) throws Exception {
+			for (int i = 0; i < ops; i++) {
+				this.stream.cmdEraseWriteAlternate(false, true, true);
+				for (int row = 1; row <= this.lines.length; row++) {
+					byte[] line = this.lines[row - 1];
+					this.stream
+						.setBufferAddress(row, 1)
+						.setAttributeColor(LineColors[row % LineColors.length])
+						.appendEbcdic(line, 0, line.length);
+				}
+				this.stream
+					.setBufferAddress(Rows - 1, 1)
+					.startFieldExtended(true, false, true, false, false, ExtHighlight3270.Default, Color3270.Blue)
+					.appendEbcdic(this.status)
+					.startFieldExtended(false, false, false, false, false, ExtHighlight3270.Underscore, Color3270.Green)
+					.insertCursor()
+					.setBufferAddress(Rows, Cols)
+					.startField(true, false, false, false, false)
+					.telnetEOR()
+					.writeToSink(this.sink, true);
+			}
+			return this.sink.getByteCount();
+		}
+	}
+
+	/**
+	 * Redraw the complete screen of a MECAFF-console filled with output lines.
+	 */
+	private static class ConsoleRedraw extends Benchmark {
+		private final NullOutputStream sink = new NullOutputStream();
+		private Vm3270Console console;
+
+		public ConsoleRedraw() {
+			super("stream3270.consoleRedraw.43x80");
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			this.console = new Vm3270Console(new NullInputSink(), this.sink, Rows, Cols, true, (short)0);
+			this.console.setFlowMode(true);
+			EbcdicHandler line = new EbcdicHandler(EbcdicBenchmarks.ConsoleLine);
+			for (int i = 0; i < 1000; i++) {
+				this.console.appendHostLine(line);
+			}
+		}
+
+		@Override
+		public long run(int ops) throws Exception {
+			for (int i = 0; i < ops; i++) {
+				this.console.redrawScreen();
+			}
+			return this.sink.getByteCount();
+		}
+
+		@Override
+		public void tearDown() {
+			this.console.close();
+		}
+	}
+
+	/**
+	 * Add the 3270 output stream benchmarks to the suite.
+	 * @param suite the list of benchmarks to add to.
+	 */
+	public static void addTo(List<Benchmark> suite) {
+		suite.add(new BuildScreen());
+		suite.add(new ConsoleRedraw());
+	}
+}
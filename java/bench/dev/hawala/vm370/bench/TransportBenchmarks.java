@@ -0,0 +1,293 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.bench;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+
+import dev.hawala.vm370.Vm3270Console;
+import dev.hawala.vm370.ebcdic.Ebcdic;
+import dev.hawala.vm370.stream3270.Color3270;
+import dev.hawala.vm370.stream3270.DataOutStream3270;
+import dev.hawala.vm370.transport.ByteBuffer;
+import dev.hawala.vm370.transport.DataDecoder;
+import dev.hawala.vm370.transport.DataEncoder;
+import dev.hawala.vm370.transport.EncodedTransport;
+import dev.hawala.vm370.transport.ITransportEncoding;
+import dev.hawala.vm370.transport.TransportEncoding3270;
+
+/**
+ * Benchmarks for the MECAFF encoded transport over a 3270 connection, using
+ * 3270 streams for a full 43x80 or 62x160 screen as exchanged by a fullscreen program.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class TransportBenchmarks {
+
+	private static final int Rows = 43;
+	private static final int Cols = 80;
+
+	/**
+	 * Build the 3270 output stream for a full screen of a fullscreen application
+	 * (like EE), with a colored field per screen line.
+	 * @param rows the screen height.
+	 * @param cols the screen width.
+	 * @return the 3270 output stream bytes (without the telnet EOR).
+	 * @throws IOException
+	 */
+	public static byte[] makeScreenStream(int rows, int cols) throws IOException {
+		StringBuilder sb = new StringBuilder(cols);
+		while (sb.length() < cols - 1) { sb.append(EbcdicBenchmarks.ConsoleLine); }
+		sb.setLength(cols - 1);
+		byte[] text = Ebcdic.toEbcdic(sb.toString());
+		DataOutStream3270 stream = new DataOutStream3270(cols, rows, true);
+		stream.cmdEraseWriteAlternate(false, true, true);
+		for (int row = 1; row <= rows; row++) {
+			stream
+				.setBufferAddress(row, 1)
+				.startFieldExtended((row & 1) == 0, false, false, false, false, null, Color3270.Turquoise)
+				.appendEbcdic(text, 0, text.length);
+		}
+		ByteArrayOutputStream bos = new ByteArrayOutputStream();
+		stream.writeToSink(bos, true);
+		return bos.toByteArray();
+	}
+
+	// get the bytes currently held by an encoder
+	private static byte[] toBytes(DataEncoder encoder) {
+		byte[] bytes = new byte[encoder.getLength()];
+		encoder.writeTo(bytes, 0);
+		return bytes;
+	}
+
+	/**
+	 * Encode the 3270 input stream of a full screen (as returned by a read-modified-all)
+	 * into response chunks and write them out, as done for a fullscreen read.
+	 */
+	private static class EncodeFsInput extends Benchmark {
+		private final int rows;
+		private final int cols;
+		private final NullOutputStream sink = new NullOutputStream();
+		private final ByteBuffer input = new ByteBuffer(8192, 2048);
+		private Vm3270Console console;
+		private EncodedTransport transport;
+
+		public EncodeFsInput(int rows, int cols) {
+			super("transport.encodeFsInput." + rows + "x" + cols);
+			this.rows = rows;
+			this.cols = cols;
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			this.input.append(makeScreenStream(this.rows, this.cols));
+			this.console = new Vm3270Console(new NullInputSink(), new NullOutputStream(), this.rows, this.cols, true, (short)0);
+			this.transport = new EncodedTransport(
+					new TransportEncoding3270(), this.console, "IBM-3278-4-E", true, true, true, this.rows, this.cols, 0);
+		}
+
+		@Override
+		public long run(int ops) throws Exception {
+			for (int i = 0; i < ops; i++) {
+				this.transport.prepareFullScreenInputTransfer(this.input);
+				while (this.transport.getAvailableChunks() > 0) {
+					this.transport.writeNextChunkTo(this.sink);
+				}
+			}
+			return this.sink.getByteCount();
+		}
+
+		@Override
+		public void tearDown() {
+			this.console.close();
+		}
+	}
+
+	/**
+	 * Encode a full screen into a new (empty) encoder, as done for each new
+	 * connection, measuring the buffer growing.
+	 */
+	private static class BuildEncodedScreen extends Benchmark {
+		private final int rows;
+		private final int cols;
+		private final ITransportEncoding encoding = new TransportEncoding3270();
+		private byte[] screen;
+
+		public BuildEncodedScreen(int rows, int cols) {
+			super("transport.encodeScreenNewEncoder." + rows + "x" + cols);
+			this.rows = rows;
+			this.cols = cols;
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			this.screen = makeScreenStream(this.rows, this.cols);
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				DataEncoder encoder = new DataEncoder(this.encoding);
+				encoder.reset().encodeData(this.screen, 0, this.screen.length);
+				sum += encoder.getLength();
+				encoder.release();
+			}
+			return sum;
+		}
+	}
+
+	/**
+	 * Decode the chunks of a full screen (as sent by the host for a fullscreen write).
+	 */
+	private static class DecodeFsOutput extends Benchmark {
+		private final int rows;
+		private final int cols;
+		private final ITransportEncoding encoding = new TransportEncoding3270();
+		private final DataDecoder decoder = new DataDecoder(this.encoding);
+		private final ByteBuffer target = new ByteBuffer(8192, 2048);
+		private final List<byte[]> chunks = new ArrayList<byte[]>();
+
+		public DecodeFsOutput(int rows, int cols) {
+			super("transport.decodeFsOutput." + rows + "x" + cols);
+			this.rows = rows;
+			this.cols = cols;
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			byte[] screen = makeScreenStream(this.rows, this.cols);
+			int chunkSize = this.encoding.getChunkSize();
+			DataEncoder encoder = new DataEncoder(this.encoding);
+			for (int pos = 0; pos < screen.length; pos += chunkSize) {
+				encoder.reset(null).encodeData(screen, pos, Math.min(chunkSize, screen.length - pos));
+				this.chunks.add(toBytes(encoder));
+			}
+		}
+
+		@Override
+		public long run(int ops) {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				this.target.clear();
+				for (byte[] chunk : this.chunks) {
+					this.decoder.useBuffer(chunk, 0, chunk.length).decodeData(this.target);
+				}
+				sum += this.target.getLength();
+			}
+			return sum;
+		}
+	}
+
+	/**
+	 * Check host output lines for FSIO commands, either plain CP/CMS output lines
+	 * (the common case) or the command sequence for a fullscreen write of a 43x80
+	 * screen (init-fullscreen followed by the write chunks, the final chunk writing
+	 * the screen through the console).
+	 */
+	private static class IsEncodedFsCommand extends Benchmark {
+		private final boolean fsWrite;
+		private final List<byte[]> lines = new ArrayList<byte[]>();
+		private Vm3270Console console;
+		private EncodedTransport transport;
+
+		public IsEncodedFsCommand(boolean fsWrite) {
+			super(fsWrite ? "transport.isEncodedFsCommand.fsWrite.43x80" : "transport.isEncodedFsCommand.cpLine");
+			this.fsWrite = fsWrite;
+		}
+
+		@Override
+		public void setUp() throws Exception {
+			ITransportEncoding encoding = new TransportEncoding3270();
+			this.console = new Vm3270Console(new NullInputSink(), new NullOutputStream(), Rows, Cols, true, (short)0);
+			this.transport = new EncodedTransport(
+					encoding, this.console, "IBM-3278-4-E", true, true, true, Rows, Cols, 0);
+
+			if (!this.fsWrite) {
+				this.lines.add(Ebcdic.toEbcdic(EbcdicBenchmarks.ConsoleLine));
+				return;
+			}
+
+			byte[] screen = makeScreenStream(Rows, Cols);
+			int chunkSize = encoding.getChunkSize();
+			DataEncoder encoder = new DataEncoder(encoding);
+			int sessionId = this.getSessionId(encoding, encoder);
+			encoder.reset(encoding.getCmdStartSequence())
+				.append(encoding.getRequINITFS())
+				.encodeInt(sessionId)
+				.encodeInt(1) // EraseWrite
+				.encodeInt(screen.length);
+			this.lines.add(toBytes(encoder));
+			for (int pos = 0; pos < screen.length; pos += chunkSize) {
+				int length = Math.min(chunkSize, screen.length - pos);
+				encoder.reset(encoding.getCmdStartSequence())
+					.append((pos + length < screen.length) ? encoding.getRequWRFSCHUNK() : encoding.getRequWRFSCHUNKFINAL())
+					.encodeData(screen, pos, length);
+				this.lines.add(toBytes(encoder));
+			}
+		}
+		
+		// get the session id of the transport from the response to a get-terminal-characteristics command
+		private int getSessionId(ITransportEncoding encoding, DataEncoder encoder) throws IOException {
+			encoder.reset(encoding.getCmdStartSequence()).append(encoding.getRequGETTERM());
+			byte[] cmd = toBytes(encoder);
+			this.transport.isEncodedFsCommand(cmd, 0, cmd.length);
+			ByteArrayOutputStream bos = new ByteArrayOutputStream();
+			this.transport.writeNextChunkTo(bos);
+			byte[] resp = bos.toByteArray();
+			
+			DataDecoder decoder = new DataDecoder(encoding);
+			decoder.useBuffer(resp, 0, resp.length);
+			decoder.testFor(encoding.getRespStartSequence());
+			decoder.getNextByte(); // response code
+			decoder.decodeInt(); // transport version
+			decoder.decodeData(new ByteBuffer()); // terminal type
+			for (int i = 0; i < 5; i++) { decoder.decodeInt(); } // geometry and capabilities
+			return decoder.decodeInt();
+		}
+
+		@Override
+		public long run(int ops) throws Exception {
+			long sum = 0;
+			for (int i = 0; i < ops; i++) {
+				for (byte[] line : this.lines) {
+					if (this.transport.isEncodedFsCommand(line, 0, line.length)) { sum++; }
+				}
+			}
+			return sum;
+		}
+
+		@Override
+		public void tearDown() {
+			this.console.close();
+		}
+	}
+
+	/**
+	 * Add the transport benchmarks to the suite.
+	 * @param suite the list of benchmarks to add to.
+	 */
+	public static void addTo(List<Benchmark> suite) {
+		suite.add(new EncodeFsInput(Rows, Cols));
+		suite.add(new EncodeFsInput(62, 160));
+		suite.add(new DecodeFsOutput(Rows, Cols));
+		suite.add(new DecodeFsOutput(62, 160));
+		suite.add(new BuildEncodedScreen(62, 160));
+		suite.add(new IsEncodedFsCommand(false));
+		suite.add(new IsEncodedFsCommand(true));
+	}
+}
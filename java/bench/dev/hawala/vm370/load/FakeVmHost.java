@@ -0,0 +1,561 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.load;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.text.SimpleDateFormat;
+import java.util.ArrayList;
+import java.util.Date;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+
+import dev.hawala.vm370.ebcdic.Ebcdic;
+import dev.hawala.vm370.stream3270.DataOutStream3270;
+import dev.hawala.vm370.transport.ByteBuffer;
+import dev.hawala.vm370.transport.DataDecoder;
+import dev.hawala.vm370.transport.DataEncoder;
+import dev.hawala.vm370.transport.ITransportEncoding;
+import dev.hawala.vm370.transport.TransportEncoding3270;
+
+/**
+ * Simulated VM/370 host accepting TN3270 connections and driving each of them
+ * like CP does for a 3278-4 console, for load testing MECAFF without Hercules.
+ * <p>
+ * Each connection gets the Hercules logo, the "VM/370 ONLINE" screen and then
+ * accepts the following commands entered at the console:
+ * <ul>
+ * <li><code>LOGON &lt;user&gt;</code>: writes a logon banner, identifies the MECAFF-console
+ * (FSIO GETTERM), switches it to flow mode and responds with <code>SESSION &lt;user&gt; READY</code></li>
+ * <li><code>PING &lt;token&gt;</code>: responds with <code>PONG &lt;token&gt;</code></li>
+ * <li><code>TYPE &lt;token&gt; &lt;n&gt;</code>: writes <i>n</i> output lines, followed by
+ * <code>END &lt;token&gt;</code></li>
+ * <li><code>FS &lt;token&gt;</code>: writes a fullscreen image containing
+ * <code>FSCREEN &lt;token&gt;</code> with the FSIO protocol, reads the fullscreen input
+ * (expecting PF03) and responds with <code>FSEND &lt;token&gt;</code> (or <code>FSERR &lt;token&gt;</code>
+ * if the fullscreen interaction failed)</li>
+ * </ul>
+ * The console output is done on the 43 rows screen as CP does, with the CP states
+ * (RUNNING, VM READ, CP READ, MORE..., HOLDING) in the status area and the echo
+ * of the input lines. The FSIO commands are written as console output lines and the
+ * responses are read as input lines in VM READ state, as the CMS side of MECAFF
+ * does.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class FakeVmHost implements Runnable {
+
+	private static final int Rows = 43;
+	private static final int Cols = 80;
+	private static final int OutputRows = 41;
+	private static final int StateRow = 43;
+	private static final int StateCol = 61;
+	private static final int LinesPerRecord = 8;
+	private static final int FsChunkSize = 800; // raw bytes per WRFSCHUNK, as the CMS side for 3270
+
+	private static final byte AidEnter = (byte)0x7D;
+	private static final byte AidClear = (byte)0x6D;
+	private static final byte AidPF03 = (byte)0xF3;
+
+	private static final String StRunning = "RUNNING          ";
+	private static final String StVmRead  = "VM READ          ";
+	private static final String StCpRead  = "CP READ          ";
+	private static final String StMore    = "MORE...          ";
+	private static final String StHolding = "HOLDING          ";
+
+	private static final String HerculesTitle
+		= "           HHH          HHH   The S/370, ESA/390 and z/Architecture";
+
+	private static final String FillerText
+		= "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 ";
+
+	// the TN3270 options requested by the host, sent in one write as Hercules does
+	private static final byte[] TN_REQUESTS = {
+		(byte)0xFF, (byte)0xFD, (byte)0x18,                                     // DO TERMINAL-TYPE
+		(byte)0xFF, (byte)0xFA, (byte)0x18, (byte)0x01, (byte)0xFF, (byte)0xF0, // SB TERMINAL-TYPE SEND SE
+		(byte)0xFF, (byte)0xFD, (byte)0x19,                                     // DO END-OF-RECORD
+		(byte)0xFF, (byte)0xFB, (byte)0x19,                                     // WILL END-OF-RECORD
+		(byte)0xFF, (byte)0xFD, (byte)0x00,                                     // DO BINARY
+		(byte)0xFF, (byte)0xFB, (byte)0x00                                      // WILL BINARY
+	};
+	private static final int TN_RESPONSE_COUNT = 6;
+
+	private final ServerSocket listener;
+	private final List<Socket> connections = new ArrayList<Socket>();
+	private volatile boolean closed = false;
+
+	private final AtomicInteger sessionCount = new AtomicInteger();
+	private final AtomicLong linesWritten = new AtomicLong();
+	private final AtomicLong fullscreenCount = new AtomicLong();
+
+	/**
+	 * Start the simulated host listening on the loopback interface.
+	 * @param port the port to listen on (0 for any free port).
+	 * @throws IOException
+	 */
+	public FakeVmHost(int port) throws IOException {
+		this.listener = new ServerSocket(port, 50, InetAddress.getByName("127.0.0.1"));
+		Thread thr = new Thread(this, "fakevm-listener");
+		thr.setDaemon(true);
+		thr.start();
+	}
+
+	/**
+	 * Get the port where the simulated host listens.
+	 * @return the port number.
+	 */
+	public int getPort() {
+		return this.listener.getLocalPort();
+	}
+
+	/**
+	 * Get the number of connections accepted so far.
+	 * @return the session count.
+	 */
+	public int getSessionCount() {
+		return this.sessionCount.get();
+	}
+
+	/**
+	 * Get the number of output lines written to all connections so far.
+	 * @return the line count.
+	 */
+	public long getLinesWritten() {
+		return this.linesWritten.get();
+	}
+
+	/**
+	 * Get the number of fullscreen images written to all connections so far.
+	 * @return the fullscreen count.
+	 */
+	public long getFullscreenCount() {
+		return this.fullscreenCount.get();
+	}
+
+	/**
+	 * Worker routine for the listener thread, starting a session thread
+	 * for each new connection.
+	 */
+	@Override
+	public void run() {
+		while (!this.closed) {
+			Socket socket;
+			try {
+				socket = this.listener.accept();
+				socket.setTcpNoDelay(true);
+			} catch (IOException exc) {
+				if (this.closed) { return; }
+				continue;
+			}
+			synchronized(this.connections) {
+				this.connections.add(socket);
+			}
+			int sessionNo = this.sessionCount.incrementAndGet();
+			Thread thr = new Thread(new HostSession(socket), "fakevm-session-" + sessionNo);
+			thr.setDaemon(true);
+			thr.start();
+		}
+	}
+
+	/**
+	 * Stop listening and close all connections.
+	 */
+	public void close() {
+		this.closed = true;
+		try {
+			this.listener.close();
+		} catch (IOException exc) {
+			// ignored
+		}
+		synchronized(this.connections) {
+			for (Socket socket : this.connections) {
+				try {
+					socket.close();
+				} catch (IOException exc) {
+					// ignored
+				}
+			}
+			this.connections.clear();
+		}
+	}
+
+	/**
+	 * The CP/CMS simulation for a single connection.
+	 */
+	private class HostSession implements Runnable {
+
+		private final Socket socket;
+		private TelnetRecordReader reader;
+		private OutputStream os;
+
+		// the 3270 record being assembled
+		private final DataOutStream3270 stream = new DataOutStream3270(Cols, Rows, true);
+		private boolean recordOpen = false;
+		private int recordLines = 0;
+		private int row = 1; // next output row on the screen
+
+		// the last input line received
+		private byte[] input = new byte[256];
+		private int inputLength = 0;
+		private byte lastAid = 0;
+
+		// FSIO transport with the MECAFF-console
+		private final ITransportEncoding encoding = new TransportEncoding3270();
+		private final DataEncoder encoder = new DataEncoder(this.encoding);
+		private final DataDecoder decoder = new DataDecoder(this.encoding);
+		private final ByteBuffer data = new ByteBuffer(4096, 4096);
+		private byte[] cmdBytes = new byte[2048];
+		private int sessionId = 0;
+		private int termRows = Rows;
+		private int termCols = Cols;
+
+		private final SimpleDateFormat timeFormat = new SimpleDateFormat("HH:mm:ss");
+		private boolean loggedOn = false;
+
+		public HostSession(Socket socket) {
+			this.socket = socket;
+		}
+
+		@Override
+		public void run() {
+			try {
+				this.reader = new TelnetRecordReader(this.socket.getInputStream());
+				this.os = this.socket.getOutputStream();
+				this.negotiate();
+				this.sendLogo();
+				this.newScreen();
+				this.writeLine("VM/370 ONLINE");
+				this.dialog();
+			} catch (IOException exc) {
+				// connection closed
+			} finally {
+				try {
+					this.socket.close();
+				} catch (IOException exc) {
+					// ignored
+				}
+				synchronized(connections) {
+					connections.remove(this.socket);
+				}
+			}
+		}
+
+		private void negotiate() throws IOException {
+			this.os.write(TN_REQUESTS);
+			this.os.flush();
+			for (int i = 0; i < TN_RESPONSE_COUNT; i++) {
+				if (this.reader.readCommand() == null) {
+					throw new IOException("Connection closed during TN3270 negotiation");
+				}
+			}
+		}
+
+		// the Hercules logo screen, ignored by the filter up to the title line
+		private void sendLogo() throws IOException {
+			this.stream
+				.clear()
+				.cmdEraseWrite(false, true, true)
+				.setBufferAddress(5, 2)
+				.appendUnicode(HerculesTitle)
+				.telnetEOR()
+				.writeToSink(this.os, true);
+		}
+
+		//
+		// CP screen handling
+		//
+
+		// start a new record erasing the screen, the output restarting on the first row
+		private void newScreen() {
+			this.stream.clear().cmdEraseWriteAlternate(false, true, true);
+			this.recordOpen = true;
+			this.recordLines = 0;
+			this.row = 1;
+		}
+
+		// send the current record with the given CP state
+		private void flush(String state) throws IOException {
+			if (!this.recordOpen) { this.stream.clear().cmdWrite(false, true, false); }
+			this.stream
+				.setBufferAddress(StateRow, StateCol)
+				.appendUnicode(state)
+				.telnetEOR()
+				.writeToSink(this.os, true);
+			this.recordOpen = false;
+			this.recordLines = 0;
+		}
+
+		private void writeLine(String line) throws IOException {
+			byte[] text = Ebcdic.toEbcdic(line);
+			this.writeLine(text, text.length);
+		}
+
+		// write an output line on the screen, possibly spanning several rows
+		private void writeLine(byte[] text, int length) throws IOException {
+			int rows = Math.max(1, (length + Cols - 1) / Cols);
+			if (this.row + rows - 1 > OutputRows) { this.more(); }
+			if (!this.recordOpen) {
+				this.stream.clear().cmdWrite(false, true, false);
+				this.recordOpen = true;
+			}
+			this.stream
+				.setBufferAddress(this.row, 1)
+				.appendEbcdic(text, 0, length);
+			this.row += rows;
+			this.recordLines++;
+			linesWritten.incrementAndGet();
+			if (this.recordLines >= LinesPerRecord || rows > 1) {
+				this.flush(StRunning);
+			}
+		}
+
+		// the screen is full: enter MORE... and wait for CLEAR (possibly going to
+		// HOLDING on an empty Enter before), then continue on an erased screen
+		private void more() throws IOException {
+			this.flush(StMore);
+			while (true) {
+				int length = this.reader.readRecord();
+				if (length < 0) { throw new IOException("Connection closed in MORE state"); }
+				byte aid = (length > 0) ? this.reader.getRecord()[0] : 0;
+				if (aid == AidClear) { break; }
+				if (aid == AidEnter && length <= 6) { this.flush(StHolding); }
+			}
+			this.newScreen();
+		}
+
+		// read the next input record from the terminal
+		private boolean readInput() throws IOException {
+			int length = this.reader.readRecord();
+			if (length < 0) { return false; }
+			byte[] record = this.reader.getRecord();
+			this.lastAid = (length > 0) ? record[0] : 0;
+			this.inputLength = 0;
+			if (length > 6 && record[3] == (byte)0x11) {
+				this.inputLength = length - 6;
+				if (this.inputLength > this.input.length) {
+					this.input = new byte[this.inputLength * 2];
+				}
+				System.arraycopy(record, 6, this.input, 0, this.inputLength);
+			}
+			return true;
+		}
+
+		// wait in the given read state for an input line, echo the line and go RUNNING
+		private void readLine(String state) throws IOException {
+			this.flush(state);
+			while (true) {
+				if (!this.readInput()) { throw new IOException("Connection closed while reading"); }
+				if (this.lastAid == AidClear) {
+					this.newScreen();
+					this.flush(state);
+				} else if (this.lastAid == AidEnter && this.inputLength > 0) {
+					break;
+				}
+			}
+			this.writeLine(this.input, this.inputLength);
+			this.flush(StRunning);
+		}
+
+		private void ready() throws IOException {
+			this.writeLine("R; T=0.01/0.01 " + this.timeFormat.format(new Date()));
+		}
+
+		//
+		// FSIO protocol with the MECAFF-console
+		//
+
+		private DataEncoder fsioCommand(byte cmd) {
+			return this.encoder.reset(this.encoding.getCmdStartSequence()).append(cmd);
+		}
+
+		private void sendFsioCommand() throws IOException {
+			int length = this.encoder.getLength();
+			if (length > this.cmdBytes.length) { this.cmdBytes = new byte[length * 2]; }
+			this.encoder.writeTo(this.cmdBytes, 0);
+			this.writeLine(this.cmdBytes, length);
+		}
+
+		// read the response to the last FSIO command, the decoder being positioned
+		// behind the returned response code
+		private byte readResponse() throws IOException {
+			this.readLine(StVmRead);
+			this.decoder.useBuffer(this.input, 0, this.inputLength);
+			if (!this.decoder.testFor(this.encoding.getRespStartSequence())) {
+				throw new IOException("Input is not a FSIO response");
+			}
+			return this.decoder.getNextByte();
+		}
+
+		private void setFlowMode() throws IOException {
+			this.fsioCommand(this.encoding.getRequSETFLOWMODE()).encodeInt(1);
+			this.sendFsioCommand();
+		}
+
+		//
+		// the commands
+		//
+
+		private void dialog() throws IOException {
+			while (!closed) {
+				this.readLine(this.loggedOn ? StVmRead : StCpRead);
+				String[] parts = Ebcdic.toAscii(this.input, 0, this.inputLength).trim().split(" +");
+				String cmd = parts[0].toUpperCase();
+				if (cmd.equals("LOGON") && parts.length > 1) {
+					this.logon(parts[1]);
+				} else if (cmd.equals("PING") && parts.length > 1) {
+					this.writeLine("PONG " + parts[1]);
+					this.ready();
+				} else if (cmd.equals("TYPE") && parts.length > 2) {
+					this.type(parts[1], parts[2]);
+				} else if (cmd.equals("FS") && parts.length > 1) {
+					this.fullscreen(parts[1]);
+				} else {
+					this.writeLine("Unknown CP/CMS command");
+					if (this.loggedOn) { this.ready(); }
+				}
+			}
+		}
+
+		private void logon(String user) throws IOException {
+			String now = new SimpleDateFormat("HH:mm:ss zzz EEEEEEEE MM/dd/yy").format(new Date());
+			this.writeLine("LOGMSG - MECAFF LOAD TEST HOST");
+			this.writeLine("LOGON AT " + now);
+			this.writeLine("VM/370 CMS (SIMULATED) " + user);
+
+			// identify the console as the MECAFF tools do
+			this.fsioCommand(this.encoding.getRequGETTERM());
+			this.sendFsioCommand();
+			if (this.readResponse() != this.encoding.getRespGETTERM()) {
+				this.writeLine("FSIO GETTERM failed, no MECAFF-console");
+				return;
+			}
+			this.decoder.decodeInt(); // transport version
+			this.data.clear();
+			this.decoder.decodeData(this.data); // terminal type
+			int rows = this.decoder.decodeInt();
+			int cols = this.decoder.decodeInt();
+			this.decoder.decodeInt(); // can alternate screen size
+			this.decoder.decodeInt(); // can extended highlighting
+			this.decoder.decodeInt(); // can colors
+			this.sessionId = this.decoder.decodeInt();
+			if (this.decoder.hasParseError()) {
+				this.writeLine("FSIO GETTERM response invalid");
+				return;
+			}
+			this.termRows = rows;
+			this.termCols = cols;
+			this.setFlowMode();
+
+			this.loggedOn = true;
+			this.writeLine("SESSION " + user + " READY");
+			this.ready();
+		}
+
+		private void type(String token, String countText) throws IOException {
+			int count;
+			try {
+				count = Integer.parseInt(countText);
+			} catch (NumberFormatException exc) {
+				this.writeLine("Invalid line count: " + countText);
+				this.ready();
+				return;
+			}
+			StringBuilder sb = new StringBuilder();
+			for (int i = 1; i <= count; i++) {
+				sb.setLength(0);
+				sb.append("LINE ").append(token).append('.').append(i).append(' ');
+				while (sb.length() < Cols - 1) { sb.append(FillerText); }
+				sb.setLength(Cols - 1);
+				this.writeLine(sb.toString());
+			}
+			this.writeLine("END " + token);
+			this.ready();
+		}
+
+		// build the fullscreen image: EWA with the token on the first row, filler on the others
+		private byte[] makeFullscreen(String token) throws IOException {
+			DataOutStream3270 fs = new DataOutStream3270(this.termCols, this.termRows, true);
+			fs
+				.cmdEraseWriteAlternate(false, true, true)
+				.setBufferAddress(1, 1)
+				.appendUnicode("FSCREEN " + token);
+			StringBuilder sb = new StringBuilder();
+			while (sb.length() < this.termCols - 1) { sb.append(FillerText); }
+			sb.setLength(this.termCols - 1);
+			String filler = sb.toString();
+			for (int r = 2; r <= this.termRows; r++) {
+				fs.setBufferAddress(r, 1).appendUnicode(filler);
+			}
+			ByteArrayOutputStream bos = new ByteArrayOutputStream();
+			fs.writeToSink(bos, true);
+			return bos.toByteArray();
+		}
+
+		private void fullscreen(String token) throws IOException {
+			byte[] screen = this.makeFullscreen(token);
+
+			// acquire the fullscreen mode and write the image in chunks
+			this.fsioCommand(this.encoding.getRequINITFS())
+				.encodeInt(this.sessionId)
+				.encodeInt(2) // EraseWriteAlternate
+				.encodeInt(screen.length);
+			this.sendFsioCommand();
+			if (this.readResponse() != this.encoding.getRespINITFS() || this.decoder.decodeInt() != 0) {
+				this.writeLine("FSERR " + token + " INITFS");
+				this.ready();
+				return;
+			}
+			int pos = 0;
+			while (pos < screen.length) {
+				int chunk = Math.min(FsChunkSize, screen.length - pos);
+				boolean isLast = (pos + chunk) >= screen.length;
+				this.fsioCommand(isLast
+						? this.encoding.getRequWRFSCHUNKFINAL()
+						: this.encoding.getRequWRFSCHUNK())
+					.encodeData(screen, pos, chunk);
+				this.sendFsioCommand();
+				pos += chunk;
+			}
+			fullscreenCount.incrementAndGet();
+
+			// read the fullscreen input, transmitted in chunks
+			this.fsioCommand(this.encoding.getRequREADFS()).encodeInt(this.sessionId);
+			this.sendFsioCommand();
+			this.data.clear();
+			byte resp = this.readResponse();
+			while (resp == this.encoding.getRespRDFSCHUNK()) {
+				this.decoder.decodeData(this.data);
+				resp = this.readResponse();
+			}
+			boolean ok = (resp == this.encoding.getRespRDFSCHUNKFINAL());
+			if (ok) {
+				this.decoder.decodeData(this.data);
+				ok = !this.decoder.hasParseError()
+					&& this.data.getLength() > 0
+					&& this.data.getInternalBuffer()[0] == AidPF03;
+			}
+
+			// back to line mode
+			this.setFlowMode();
+			this.writeLine((ok ? "FSEND " : "FSERR ") + token);
+			this.ready();
+		}
+	}
+}
@@ -0,0 +1,126 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.load;
+
+import java.util.Arrays;
+
+/**
+ * Collection of latency samples of one operation type, giving the mean,
+ * percentiles and maximum of the samples.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class LatencyStats {
+
+	private long[] samples = new long[256];
+	private int count = 0;
+	private long sum = 0;
+	private long max = 0;
+
+	/**
+	 * Add a sample.
+	 * @param nanos the measured latency in nanoseconds.
+	 */
+	public synchronized void add(long nanos) {
+		if (this.count >= this.samples.length) {
+			long[] newSamples = new long[this.samples.length * 2];
+			System.arraycopy(this.samples, 0, newSamples, 0, this.count);
+			this.samples = newSamples;
+		}
+		this.samples[this.count++] = nanos;
+		this.sum += nanos;
+		this.max = Math.max(this.max, nanos);
+	}
+
+	/**
+	 * Add all samples of another collection.
+	 * @param other the collection to copy the samples from.
+	 */
+	public void addAll(LatencyStats other) {
+		long[] otherSamples = other.getSamples();
+		synchronized(this) {
+			for (long nanos : otherSamples) { this.add(nanos); }
+		}
+	}
+
+	private synchronized long[] getSamples() {
+		long[] copy = new long[this.count];
+		System.arraycopy(this.samples, 0, copy, 0, this.count);
+		return copy;
+	}
+
+	/**
+	 * Get the number of samples.
+	 * @return the sample count.
+	 */
+	public synchronized int getCount() {
+		return this.count;
+	}
+
+	/**
+	 * Get the mean latency.
+	 * @return the mean in milliseconds (0 if no samples).
+	 */
+	public synchronized double getMeanMs() {
+		return (this.count > 0) ? (this.sum / 1.0e6) / this.count : 0;
+	}
+
+	/**
+	 * Get the maximal latency.
+	 * @return the maximum in milliseconds.
+	 */
+	public synchronized double getMaxMs() {
+		return this.max / 1.0e6;
+	}
+
+	/**
+	 * Get a percentile of the latencies (nearest rank).
+	 * @param percent the percentile to get (0..100).
+	 * @return the percentile in milliseconds (0 if no samples).
+	 */
+	public double getPercentileMs(double percent) {
+		long[] sorted = this.getSamples();
+		if (sorted.length == 0) { return 0; }
+		Arrays.sort(sorted);
+		int idx = (int)Math.ceil(percent / 100.0 * sorted.length) - 1;
+		idx = Math.max(0, Math.min(sorted.length - 1, idx));
+		return sorted[idx] / 1.0e6;
+	}
+
+	/**
+	 * Get the column headers for <code>format()</code>.
+	 * @return the header line.
+	 */
+	public static String getHeader() {
+		return String.format("%-10s %8s %10s %10s %10s %10s %10s",
+				"operation", "count", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+	}
+
+	/**
+	 * Format the statistics as a single line.
+	 * @param name the operation name to start the line with.
+	 * @return the formatted line.
+	 */
+	public String format(String name) {
+		return String.format("%-10s %8d %10.2f %10.2f %10.2f %10.2f %10.2f",
+				name,
+				this.getCount(),
+				this.getMeanMs(),
+				this.getPercentileMs(50),
+				this.getPercentileMs(90),
+				this.getPercentileMs(99),
+				this.getMaxMs());
+	}
+}
@@ -0,0 +1,553 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.load;
+
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.lang.management.ManagementFactory;
+import java.lang.management.MemoryMXBean;
+import java.lang.management.ThreadMXBean;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.text.SimpleDateFormat;
+import java.util.ArrayList;
+import java.util.Date;
+import java.util.List;
+
+import dev.hawala.vm370.AsyncConnectSocket;
+import dev.hawala.vm370.BaseStreamFilter;
+import dev.hawala.vm370.IConnectionClosedSink;
+import dev.hawala.vm370.Log;
+import dev.hawala.vm370.TimeoutScheduler;
+import dev.hawala.vm370.Tn3270StreamFilter;
+
+/**
+ * Load test for the MECAFF process: a number of scripted 3270 terminals
+ * (<code>SimulatedTerminal</code>) work concurrently through MECAFF with a
+ * simulated VM/370 host (<code>FakeVmHost</code>), reporting the latency
+ * percentiles of the operations, the throughput per session and the heap
+ * and thread usage per session.
+ * <p>
+ * By default, the MECAFF connections are handled in-process by <code>Tn3270StreamFilter</code>s
+ * created the same way as by the <code>Mecaff</code> listener, so the heap and thread
+ * figures include the filters; alternatively an external MECAFF process can be tested
+ * (parameter <code>-proxy:</code>) which must be started with the port of the
+ * simulated host (parameter <code>-hostPort:</code>) as VM/370 host port, e.g.:
+ * <pre>
+ *   java -cp bin dev.hawala.vm370.load.LoadHarness -hostPort:3270 -proxy:localhost:3277 ...
+ * </pre>
+ * As the filters pace the input to the host (default: 200 ms between user inputs),
+ * the latencies are dominated by the input gap unless reduced with <code>-inputGap:</code>.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class LoadHarness implements Runnable, IConnectionClosedSink {
+
+	private static final String PSessions = "-sessions:";
+	private static final String PDuration = "-duration:";
+	private static final String PRampUp = "-rampup:";
+	private static final String PThink = "-think:";
+	private static final String PLines = "-lines:";
+	private static final String PScript = "-script:";
+	private static final String PInputGap = "-inputgap:";
+	private static final String PHandshakeGap = "-handshakegap:";
+	private static final String PNoDynamic = "-nodynamic";
+	private static final String PScreen = "-screen:";
+	private static final String PTimeout = "-timeout:";
+	private static final String PProxy = "-proxy:";
+	private static final String PHostPort = "-hostport:";
+	private static final String PCsv = "-csv:";
+
+	private static final long SampleIntervalMs = 500;
+
+	/*
+	 * the in-process MECAFF listener
+	 */
+
+	private final ServerSocket serviceSocket;
+	private final int hostPort;
+	private final boolean noDynamic;
+	private final long handshakeGapMs;
+	private final long inputGapMs;
+
+	private final List<BaseStreamFilter> filters = new ArrayList<BaseStreamFilter>();
+	private volatile boolean closed = false;
+	private int lastConnNo = 0;
+
+	private LoadHarness(int hostPort, boolean noDynamic, long handshakeGapMs, long inputGapMs) throws IOException {
+		this.serviceSocket = new ServerSocket(0, 50, InetAddress.getByName("127.0.0.1"));
+		this.hostPort = hostPort;
+		this.noDynamic = noDynamic;
+		this.handshakeGapMs = handshakeGapMs;
+		this.inputGapMs = inputGapMs;
+		Thread thr = new Thread(this, "load-mecaff-listener");
+		thr.setDaemon(true);
+		thr.start();
+	}
+
+	private int getPort() {
+		return this.serviceSocket.getLocalPort();
+	}
+
+	/**
+	 * Worker routine for the listener thread, connecting each terminal to the
+	 * simulated host through a new stream filter, as the <code>Mecaff</code> listener does.
+	 */
+	@Override
+	public void run() {
+		while (!this.closed) {
+			Socket terminalSideSocket;
+			try {
+				terminalSideSocket = this.serviceSocket.accept();
+			} catch (IOException exc) {
+				if (this.closed) { return; }
+				continue;
+			}
+			this.startSessionSetup(++this.lastConnNo, terminalSideSocket);
+		}
+	}
+	
+	// connect the host and create the filter in a separate thread, as the Mecaff listener does
+	private void startSessionSetup(final int connNo, final Socket terminalSideSocket) {
+		final IConnectionClosedSink closedSink = this;
+		Thread thr = new Thread(new Runnable() {
+			public void run() {
+				Socket hostSideSocket = new AsyncConnectSocket("127.0.0.1", hostPort);
+				BaseStreamFilter filter = new Tn3270StreamFilter(
+						connNo,
+						null,
+						terminalSideSocket,
+						hostSideSocket,
+						noDynamic,
+						(short)0,
+						(short)4,
+						handshakeGapMs,
+						inputGapMs,
+						closedSink);
+				if (!filter.isClosed()) {
+					synchronized(filters) {
+						filters.add(filter);
+					}
+				}
+			}
+		}, "load-mecaff-setup");
+		thr.setDaemon(true);
+		thr.start();
+	}
+
+	@Override
+	public void ConnectionClosed(BaseStreamFilter connection) {
+		synchronized(this.filters) {
+			this.filters.remove(connection);
+		}
+	}
+
+	private void close() {
+		this.closed = true;
+		try {
+			this.serviceSocket.close();
+		} catch (IOException exc) {
+			// ignored
+		}
+		List<BaseStreamFilter> active;
+		synchronized(this.filters) {
+			active = new ArrayList<BaseStreamFilter>(this.filters);
+			this.filters.clear();
+		}
+		for (BaseStreamFilter filter : active) {
+			filter.shutdown();
+		}
+	}
+
+	/*
+	 * heap and thread sampling
+	 */
+
+	private static class Monitor implements Runnable {
+		private final MemoryMXBean memory = ManagementFactory.getMemoryMXBean();
+		private volatile boolean stopped = false;
+		private volatile long peakHeap = 0;
+
+		@Override
+		public void run() {
+			while (!this.stopped) {
+				this.peakHeap = Math.max(this.peakHeap, this.memory.getHeapMemoryUsage().getUsed());
+				try {
+					Thread.sleep(SampleIntervalMs);
+				} catch (InterruptedException exc) {
+					return;
+				}
+			}
+		}
+	}
+
+	private static long getHeapAfterGc() {
+		for (int i = 0; i < 3; i++) {
+			System.gc();
+			try {
+				Thread.sleep(100);
+			} catch (InterruptedException exc) {
+				break;
+			}
+		}
+		return ManagementFactory.getMemoryMXBean().getHeapMemoryUsage().getUsed();
+	}
+
+	/*
+	 * main line code
+	 */
+
+	private static String getEnvironment() {
+		Runtime rt = Runtime.getRuntime();
+		return System.getProperty("java.vm.name") + " " + System.getProperty("java.version")
+			+ " / " + System.getProperty("os.name") + " " + System.getProperty("os.version")
+			+ " " + System.getProperty("os.arch")
+			+ " / " + rt.availableProcessors() + " cpus, " + (rt.maxMemory() / (1024 * 1024)) + " MB heap";
+	}
+
+	private static int parseNumeric(String arg, String argName, int minValue, int maxValue) {
+		try {
+			int value = Integer.parseInt(arg.substring(argName.length()));
+			if (value >= minValue && value <= maxValue) { return value; }
+		} catch(NumberFormatException exc) {
+			// handled below
+		}
+		System.out.println("Invalid parameter for '" + argName + "' (" + minValue + ".." + maxValue + ")");
+		return -1;
+	}
+
+	private static void usage() {
+		System.out.println(
+			"Usage: LoadHarness [options]\n"
+			+ "\n"
+			+ "with options:\n"
+			+ "\n"
+			+ "  -sessions:<n>\n"
+			+ "     number of concurrent terminal sessions (1..5000), default: 10\n"
+			+ "\n"
+			+ "  -duration:<s>\n"
+			+ "     duration of the measurement in seconds (1..86400), default: 30\n"
+			+ "\n"
+			+ "  -rampUp:<ms>\n"
+			+ "     pause between starting 2 sessions (0..60000), default: 50\n"
+			+ "\n"
+			+ "  -think:<ms>\n"
+			+ "     pause of a session after each operation (0..60000), default: 0\n"
+			+ "\n"
+			+ "  -script:<ops>\n"
+			+ "     operations executed cyclically by each session, default: PTPF\n"
+			+ "     P = ping, T = type output lines, F = fullscreen write and read\n"
+			+ "\n"
+			+ "  -lines:<n>\n"
+			+ "     number of output lines for a T operation (1..100000), default: 200\n"
+			+ "\n"
+			+ "  -screen:<rows>x<cols>\n"
+			+ "     alternate screen size reported by the terminals, default: 43x80\n"
+			+ "\n"
+			+ "  -timeout:<ms>\n"
+			+ "     maximal time for an operation (100..600000), default: 30000\n"
+			+ "\n"
+			+ "  -inputGap:<ms>\n"
+			+ "     minimal gap between user inputs to the host (0..1000), default: "
+			+ Tn3270StreamFilter.DefaultMinInteractionGapMs + "\n"
+			+ "\n"
+			+ "  -handshakeGap:<ms>\n"
+			+ "     minimal gap between internal inputs to the host (0..1000), default: "
+			+ Tn3270StreamFilter.DefaultMinHandshakeGapMs + "\n"
+			+ "\n"
+			+ "  -noDynamic\n"
+			+ "     don't query the terminal characteristics (WSF query)\n"
+			+ "\n"
+			+ "  -proxy:<host>:<port>\n"
+			+ "     test an external MECAFF process listening at host:port instead\n"
+			+ "     of the in-process filters (requires -hostPort:)\n"
+			+ "\n"
+			+ "  -hostPort:<port>\n"
+			+ "     port of the simulated VM/370 host, default: any free port\n"
+			+ "\n"
+			+ "  -csv:<file>\n"
+			+ "     append the operation results to the given CSV file\n"
+			);
+	}
+
+	/**
+	 * Main startup method for the load test.
+	 * @param args the command line parameters.
+	 * @throws Exception
+	 */
+	public static void main(String[] args) throws Exception {
+		int sessions = 10;
+		int durationSecs = 30;
+		int rampUpMs = 50;
+		int thinkMs = 0;
+		String script = "PTPF";
+		int lines = 200;
+		int rows = 43;
+		int cols = 80;
+		int timeoutMs = 30000;
+		int inputGapMs = Tn3270StreamFilter.DefaultMinInteractionGapMs;
+		int handshakeGapMs = Tn3270StreamFilter.DefaultMinHandshakeGapMs;
+		boolean noDynamic = false;
+		String proxyHost = null;
+		int proxyPort = 0;
+		int hostPort = 0;
+		String csvFile = null;
+		boolean hadErrors = false;
+
+		for (String arg : args) {
+			String a = arg.toLowerCase();
+			if (a.equals("-h")) {
+				usage();
+				return;
+			} else if (a.startsWith(PSessions)) {
+				sessions = parseNumeric(a, PSessions, 1, 5000);
+				hadErrors |= (sessions < 0);
+			} else if (a.startsWith(PDuration)) {
+				durationSecs = parseNumeric(a, PDuration, 1, 86400);
+				hadErrors |= (durationSecs < 0);
+			} else if (a.startsWith(PRampUp)) {
+				rampUpMs = parseNumeric(a, PRampUp, 0, 60000);
+				hadErrors |= (rampUpMs < 0);
+			} else if (a.startsWith(PThink)) {
+				thinkMs = parseNumeric(a, PThink, 0, 60000);
+				hadErrors |= (thinkMs < 0);
+			} else if (a.startsWith(PScript)) {
+				script = a.substring(PScript.length()).toUpperCase();
+				for (int i = 0; i < script.length(); i++) {
+					if (SimulatedTerminal.ScriptOps.indexOf(script.charAt(i)) < 0) {
+						System.out.println("Invalid operation in script: '" + script.charAt(i) + "'");
+						hadErrors = true;
+					}
+				}
+				if (script.length() == 0) {
+					System.out.println("Empty script");
+					hadErrors = true;
+				}
+			} else if (a.startsWith(PLines)) {
+				lines = parseNumeric(a, PLines, 1, 100000);
+				hadErrors |= (lines < 0);
+			} else if (a.startsWith(PScreen)) {
+				String[] dims = a.substring(PScreen.length()).split("x");
+				rows = (dims.length == 2) ? parseNumeric(dims[0], "", 24, 62) : -1;
+				cols = (dims.length == 2) ? parseNumeric(dims[1], "", 80, 160) : -1;
+				if (rows < 0 || cols < 0) {
+					System.out.println("Invalid screen size (24..62 x 80..160): '" + arg + "'");
+					hadErrors = true;
+				}
+			} else if (a.startsWith(PTimeout)) {
+				timeoutMs = parseNumeric(a, PTimeout, 100, 600000);
+				hadErrors |= (timeoutMs < 0);
+			} else if (a.startsWith(PInputGap)) {
+				inputGapMs = parseNumeric(a, PInputGap, 0, 1000);
+				hadErrors |= (inputGapMs < 0);
+			} else if (a.startsWith(PHandshakeGap)) {
+				handshakeGapMs = parseNumeric(a, PHandshakeGap, 0, 1000);
+				hadErrors |= (handshakeGapMs < 0);
+			} else if (a.equals(PNoDynamic)) {
+				noDynamic = true;
+			} else if (a.startsWith(PProxy)) {
+				String target = arg.substring(PProxy.length());
+				int colon = target.lastIndexOf(':');
+				proxyPort = (colon > 0) ? parseNumeric(target.substring(colon + 1), "", 1, 65535) : -1;
+				if (proxyPort < 0) {
+					System.out.println("Invalid proxy address: '" + arg + "'");
+					hadErrors = true;
+				} else {
+					proxyHost = target.substring(0, colon);
+				}
+			} else if (a.startsWith(PHostPort)) {
+				hostPort = parseNumeric(a, PHostPort, 1, 65535);
+				hadErrors |= (hostPort < 0);
+			} else if (a.startsWith(PCsv)) {
+				csvFile = arg.substring(PCsv.length());
+			} else {
+				System.out.println("Unknown parameter: '" + arg + "'");
+				hadErrors = true;
+			}
+		}
+		if (proxyHost != null && hostPort == 0) {
+			System.out.println("Parameter -hostPort: is required with -proxy:");
+			hadErrors = true;
+		}
+		if (hadErrors) {
+			usage();
+			return;
+		}
+
+		String env = getEnvironment();
+		String timestamp = new SimpleDateFormat("yyyy-MM-dd HH:mm:ss").format(new Date());
+		System.out.println("MECAFF load test -- " + timestamp);
+		System.out.println(env);
+		System.out.println(String.format(
+				"sessions: %d, duration: %d s, script: %s, lines: %d, screen: %dx%d, think: %d ms, input gap: %d ms%s",
+				sessions, durationSecs, script, lines, rows, cols, thinkMs, inputGapMs,
+				(proxyHost != null) ? ", proxy: " + proxyHost + ":" + proxyPort : ""));
+		System.out.println();
+
+		MemoryMXBean memory = ManagementFactory.getMemoryMXBean();
+		ThreadMXBean threads = ManagementFactory.getThreadMXBean();
+		FakeVmHost host = null;
+		LoadHarness proxy = null;
+		Monitor monitor = new Monitor();
+		List<SimulatedTerminal> terminals = new ArrayList<SimulatedTerminal>();
+		List<Thread> terminalThreads = new ArrayList<Thread>();
+		try {
+			host = new FakeVmHost(hostPort);
+			InetAddress proxyAddress;
+			if (proxyHost == null) {
+				proxy = new LoadHarness(host.getPort(), noDynamic, handshakeGapMs, inputGapMs);
+				proxyAddress = InetAddress.getByName("127.0.0.1");
+				proxyPort = proxy.getPort();
+			} else {
+				proxyAddress = InetAddress.getByName(proxyHost);
+			}
+
+			// baseline before starting the sessions
+			long heapBaseline = getHeapAfterGc();
+			int threadsBaseline = threads.getThreadCount();
+			threads.resetPeakThreadCount();
+			Thread monitorThread = new Thread(monitor, "load-monitor");
+			monitorThread.setDaemon(true);
+			monitorThread.start();
+
+			// start the sessions
+			long startTime = System.currentTimeMillis();
+			for (int i = 1; i <= sessions; i++) {
+				SimulatedTerminal term = new SimulatedTerminal(
+						String.format("LOAD%04d", i),
+						proxyAddress, proxyPort,
+						rows, cols, script, lines, thinkMs, timeoutMs);
+				Thread thr = new Thread(term, "load-terminal-" + i);
+				thr.setDaemon(true);
+				terminals.add(term);
+				terminalThreads.add(thr);
+				thr.start();
+				if (rampUpMs > 0) { Thread.sleep(rampUpMs); }
+			}
+
+			// run for the duration, measure with all sessions up, then stop
+			long remainingMs = durationSecs * 1000L - (System.currentTimeMillis() - startTime);
+			if (remainingMs > 0) { Thread.sleep(remainingMs); }
+			long heapWithSessions = getHeapAfterGc();
+			int threadsWithSessions = threads.getThreadCount();
+			int threadsPeak = threads.getPeakThreadCount();
+			for (SimulatedTerminal term : terminals) { term.stop(); }
+			for (Thread thr : terminalThreads) { thr.join(timeoutMs + 1000L); }
+			monitor.stopped = true;
+			long heapPeak = Math.max(monitor.peakHeap, memory.getHeapMemoryUsage().getUsed());
+
+			// per session results
+			System.out.println(String.format("%-9s %8s %8s %9s %9s %6s %9s %9s %9s  %s",
+					"session", "ops", "ops/s", "lines/s", "KB/s", "errors",
+					"ping p50", "ping p90", "ping p99", "failure"));
+			LatencyStats logon = new LatencyStats();
+			LatencyStats ping = new LatencyStats();
+			LatencyStats type = new LatencyStats();
+			LatencyStats fsWrite = new LatencyStats();
+			LatencyStats fsRead = new LatencyStats();
+			long totalOps = 0;
+			long totalLines = 0;
+			long totalBytes = 0;
+			int totalErrors = 0;
+			for (SimulatedTerminal term : terminals) {
+				double secs = Math.max(term.getElapsedSeconds(), 0.001);
+				System.out.println(String.format("%-9s %8d %8.1f %9.1f %9.1f %6d %9.2f %9.2f %9.2f  %s",
+						term.getUserId(),
+						term.getOperations(),
+						term.getOperations() / secs,
+						term.getLinesReceived() / secs,
+						(term.getBytesReceived() / 1024.0) / secs,
+						term.getErrors(),
+						term.pingStats.getPercentileMs(50),
+						term.pingStats.getPercentileMs(90),
+						term.pingStats.getPercentileMs(99),
+						(term.getFailure() != null) ? term.getFailure() : ""));
+				logon.addAll(term.logonStats);
+				ping.addAll(term.pingStats);
+				type.addAll(term.typeStats);
+				fsWrite.addAll(term.fsWriteStats);
+				fsRead.addAll(term.fsReadStats);
+				totalOps += term.getOperations();
+				totalLines += term.getLinesReceived();
+				totalBytes += term.getBytesReceived();
+				totalErrors += term.getErrors();
+			}
+			System.out.println();
+
+			// operation latencies over all sessions
+			String[] opNames = { "logon", "ping", "type", "fs-write", "fs-read" };
+			LatencyStats[] opStats = { logon, ping, type, fsWrite, fsRead };
+			System.out.println(LatencyStats.getHeader());
+			for (int i = 0; i < opNames.length; i++) {
+				if (opStats[i].getCount() > 0) { System.out.println(opStats[i].format(opNames[i])); }
+			}
+			System.out.println();
+
+			// totals and resources
+			double secs = durationSecs;
+			long heapPerSession = (heapWithSessions - heapBaseline) / sessions;
+			double threadsPerSession = (double)(threadsWithSessions - threadsBaseline) / sessions;
+			System.out.println(String.format(
+					"total: %d ops (%.1f ops/s), %d lines (%.1f lines/s), %.1f KB/s received, %d errors",
+					totalOps, totalOps / secs, totalLines, totalLines / secs, (totalBytes / 1024.0) / secs, totalErrors));
+			System.out.println(String.format(
+					"heap: baseline %d KB, with sessions %d KB, %d KB/session, peak %d KB",
+					heapBaseline / 1024, heapWithSessions / 1024, heapPerSession / 1024, heapPeak / 1024));
+			System.out.println(String.format(
+					"threads: baseline %d, with sessions %d, %.1f/session, peak %d",
+					threadsBaseline, threadsWithSessions, threadsPerSession, threadsPeak));
+			System.out.println(String.format(
+					"host: %d sessions, %d lines written, %d fullscreens",
+					host.getSessionCount(), host.getLinesWritten(), host.getFullscreenCount()));
+
+			if (csvFile != null) {
+				boolean isNew = !new File(csvFile).exists();
+				PrintWriter csv = new PrintWriter(new FileWriter(csvFile, true));
+				try {
+					if (isNew) {
+						csv.println("timestamp,sessions,duration_s,script,operation,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+								+ "ops_s,errors,heap_kb_session,threads_session,environment");
+					}
+					for (int i = 0; i < opNames.length; i++) {
+						csv.println(String.format(
+								"%s,%d,%d,%s,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%d,%d,%.1f,\"%s\"",
+								timestamp, sessions, durationSecs, script, opNames[i],
+								opStats[i].getCount(),
+								opStats[i].getMeanMs(),
+								opStats[i].getPercentileMs(50),
+								opStats[i].getPercentileMs(90),
+								opStats[i].getPercentileMs(99),
+								opStats[i].getMaxMs(),
+								totalOps / secs, totalErrors, heapPerSession / 1024, threadsPerSession, env));
+					}
+				} finally {
+					csv.close();
+				}
+			}
+		} catch(IOException exc) {
+			System.out.println("** load test aborted, IOException: " + exc.getMessage());
+		} finally {
+			monitor.stopped = true;
+			for (SimulatedTerminal term : terminals) { term.stop(); }
+			if (proxy != null) { proxy.close(); }
+			if (host != null) { host.close(); }
+			TimeoutScheduler.shutdown();
+			Log.shutdown();
+		}
+	}
+}
@@ -0,0 +1,334 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.load;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.Socket;
+import java.net.SocketTimeoutException;
+
+import dev.hawala.vm370.ebcdic.Ebcdic;
+
+/**
+ * Scripted TN3270 terminal (IBM-3278-4-E with colors and extended highlighting)
+ * connecting to MECAFF, logging on to the <code>FakeVmHost</code> behind it and
+ * then repeating a script of operations, measuring the latency of each operation.
+ * <p>
+ * The script is a string of operation letters executed cyclically:
+ * <ul>
+ * <li><code>P</code>: send a <code>PING</code> command and wait for the <code>PONG</code></li>
+ * <li><code>T</code>: let the host type a number of output lines and wait for the last one</li>
+ * <li><code>F</code>: let the host write a fullscreen image (latency "fs-write"), then
+ * press PF03 and wait for the host to leave the fullscreen mode (latency "fs-read")</li>
+ * </ul>
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class SimulatedTerminal implements Runnable {
+
+	/** The operation letters allowed in a script. */
+	public static final String ScriptOps = "PTF";
+
+	private static final byte IAC = (byte)0xFF;
+	private static final byte SB = (byte)0xFA;
+	private static final byte SE = (byte)0xF0;
+	private static final byte WILL = (byte)0xFB;
+	private static final byte DO = (byte)0xFD;
+	private static final byte OPT_TERMINAL_TYPE = (byte)0x18;
+
+	private static final byte[] INPUT_START = { (byte)0x7D, (byte)0x40, (byte)0x40, (byte)0x11, (byte)0x40, (byte)0x40 };
+	private static final byte[] PF03_RECORD = { (byte)0xF3, (byte)0x40, (byte)0x40, IAC, (byte)0xEF };
+
+	private static final int TN_REQUEST_COUNT = 6;
+
+	private final String userId;
+	private final InetAddress proxyHost;
+	private final int proxyPort;
+	private final int rows;
+	private final int cols;
+	private final String script;
+	private final int typeLines;
+	private final long thinkMs;
+	private final int timeoutMs;
+
+	private final byte[] wsfQueryReply;
+	private final ByteArrayOutputStream outRecord = new ByteArrayOutputStream(256);
+
+	private Socket socket;
+	private TelnetRecordReader reader;
+	private OutputStream os;
+	private volatile boolean stopped = false;
+	private int sequence = 0;
+
+	/** latencies of the operations of this terminal */
+	public final LatencyStats logonStats = new LatencyStats();
+	public final LatencyStats pingStats = new LatencyStats();
+	public final LatencyStats typeStats = new LatencyStats();
+	public final LatencyStats fsWriteStats = new LatencyStats();
+	public final LatencyStats fsReadStats = new LatencyStats();
+
+	private volatile long operations = 0;
+	private volatile long linesReceived = 0;
+	private volatile long recordsReceived = 0;
+	private volatile long bytesSent = 0;
+	private volatile int errors = 0;
+	private volatile String failure = null;
+	private volatile long startNanos = 0;
+	private volatile long endNanos = 0;
+
+	/**
+	 * Construct the terminal.
+	 * @param userId the user to logon with on the simulated host.
+	 * @param proxyHost the host where MECAFF listens.
+	 * @param proxyPort the port where MECAFF listens.
+	 * @param rows the number of rows of the terminal's alternate screen.
+	 * @param cols the number of columns of the terminal's alternate screen.
+	 * @param script the operations to execute cyclically.
+	 * @param typeLines the number of output lines for a <code>T</code> operation.
+	 * @param thinkMs the pause after each operation.
+	 * @param timeoutMs the maximal time to wait for the result of an operation.
+	 */
+	public SimulatedTerminal(String userId, InetAddress proxyHost, int proxyPort,
+			int rows, int cols, String script, int typeLines, long thinkMs, int timeoutMs) {
+		this.userId = userId;
+		this.proxyHost = proxyHost;
+		this.proxyPort = proxyPort;
+		this.rows = rows;
+		this.cols = cols;
+		this.script = script;
+		this.typeLines = typeLines;
+		this.thinkMs = thinkMs;
+		this.timeoutMs = timeoutMs;
+		this.wsfQueryReply = this.makeWsfQueryReply();
+	}
+
+	// the reply to the WSF query: summary, usable area, 8 colors, 4 highlightings
+	private byte[] makeWsfQueryReply() {
+		ByteArrayOutputStream r = new ByteArrayOutputStream();
+		r.write(0x88); // AID: structured field
+		r.write(new byte[] { 0x00, 0x08, (byte)0x81, (byte)0x80, (byte)0x80, (byte)0x81, (byte)0x86, (byte)0x87 }, 0, 8);
+		r.write(new byte[] { 0x00, 0x0A, (byte)0x81, (byte)0x81, 0x01, 0x00 }, 0, 6);
+		r.write(this.cols >> 8);
+		r.write(this.cols & 0xFF);
+		r.write(this.rows >> 8);
+		r.write(this.rows & 0xFF);
+		r.write(new byte[] { 0x00, 0x16, (byte)0x81, (byte)0x86, 0x00, 0x10 }, 0, 6);
+		r.write(0x00);
+		r.write(0xF4);
+		for (int c = 0xF1; c <= 0xF7; c++) {
+			r.write(c);
+			r.write(c);
+		}
+		r.write(new byte[] {
+				0x00, 0x0D, (byte)0x81, (byte)0x87, 0x04,
+				0x00, (byte)0xF0, (byte)0xF1, (byte)0xF1, (byte)0xF2, (byte)0xF2, (byte)0xF4, (byte)0xF4 }, 0, 13);
+		r.write(IAC);
+		r.write(0xEF);
+		return r.toByteArray();
+	}
+
+	/**
+	 * Ask the terminal to stop after the current operation.
+	 */
+	public void stop() {
+		this.stopped = true;
+	}
+
+	/** @return the user id of this terminal. */
+	public String getUserId() { return this.userId; }
+
+	/** @return the number of operations done (excluding the logon). */
+	public long getOperations() { return this.operations; }
+
+	/** @return the number of output lines requested with <code>T</code> operations and received. */
+	public long getLinesReceived() { return this.linesReceived; }
+
+	/** @return the number of 3270 records received. */
+	public long getRecordsReceived() { return this.recordsReceived; }
+
+	/** @return the number of bytes received. */
+	public long getBytesReceived() { return (this.reader != null) ? this.reader.getBytesRead() : 0; }
+
+	/** @return the number of bytes sent. */
+	public long getBytesSent() { return this.bytesSent; }
+
+	/** @return the number of failed operations. */
+	public int getErrors() { return this.errors; }
+
+	/** @return the reason for the termination of the session or <code>null</code> if stopped normally. */
+	public String getFailure() { return this.failure; }
+
+	/** @return the time the terminal ran in seconds. */
+	public double getElapsedSeconds() {
+		long end = (this.endNanos != 0) ? this.endNanos : System.nanoTime();
+		return (this.startNanos != 0) ? (end - this.startNanos) / 1.0e9 : 0;
+	}
+
+	@Override
+	public void run() {
+		this.startNanos = System.nanoTime();
+		try {
+			this.socket = new Socket(this.proxyHost, this.proxyPort);
+			this.socket.setTcpNoDelay(true);
+			this.socket.setSoTimeout(this.timeoutMs);
+			this.reader = new TelnetRecordReader(this.socket.getInputStream());
+			this.os = this.socket.getOutputStream();
+
+			this.negotiate();
+			if (!this.waitFor("VM/370 ONLINE", null)) { return; }
+
+			long start = System.nanoTime();
+			this.sendInput("LOGON " + this.userId);
+			if (!this.waitFor("SESSION " + this.userId + " READY", null)) { return; }
+			this.logonStats.add(System.nanoTime() - start);
+
+			int step = 0;
+			while (!this.stopped) {
+				char op = this.script.charAt(step++ % this.script.length());
+				String token = this.nextToken();
+				if (op == 'P') {
+					start = System.nanoTime();
+					this.sendInput("PING " + token);
+					if (!this.waitFor("PONG " + token, null)) { return; }
+					this.pingStats.add(System.nanoTime() - start);
+				} else if (op == 'T') {
+					start = System.nanoTime();
+					this.sendInput("TYPE " + token + " " + this.typeLines);
+					if (!this.waitFor("END " + token, null)) { return; }
+					this.typeStats.add(System.nanoTime() - start);
+					this.linesReceived += this.typeLines;
+				} else if (op == 'F') {
+					start = System.nanoTime();
+					this.sendInput("FS " + token);
+					if (!this.waitFor("FSCREEN " + token, "FSERR " + token)) { return; }
+					this.fsWriteStats.add(System.nanoTime() - start);
+					start = System.nanoTime();
+					this.send(PF03_RECORD, PF03_RECORD.length);
+					if (!this.waitFor("FSEND " + token, "FSERR " + token)) { return; }
+					this.fsReadStats.add(System.nanoTime() - start);
+				}
+				this.operations++;
+				if (this.thinkMs > 0) { Thread.sleep(this.thinkMs); }
+			}
+		} catch (SocketTimeoutException exc) {
+			this.fail("timeout after " + this.timeoutMs + " ms");
+		} catch (IOException exc) {
+			if (!this.stopped) { this.fail("I/O error: " + exc.getMessage()); }
+		} catch (InterruptedException exc) {
+			// stopped
+		} finally {
+			this.endNanos = System.nanoTime();
+			if (this.socket != null) {
+				try {
+					this.socket.close();
+				} catch (IOException exc) {
+					// ignored
+				}
+			}
+		}
+	}
+
+	private void fail(String reason) {
+		this.errors++;
+		if (this.failure == null) { this.failure = reason; }
+	}
+
+	private String nextToken() {
+		return String.format("%s-%06d", this.userId, ++this.sequence);
+	}
+
+	// answer the telnet negotiation started by MECAFF
+	private void negotiate() throws IOException {
+		for (int i = 0; i < TN_REQUEST_COUNT; i++) {
+			byte[] cmd = this.reader.readCommand();
+			if (cmd == null) { throw new IOException("Connection closed during TN3270 negotiation"); }
+			this.outRecord.reset();
+			if (cmd.length > 3 && cmd[1] == SB && cmd[2] == OPT_TERMINAL_TYPE) {
+				byte[] termType = "IBM-3278-4-E".getBytes("US-ASCII");
+				this.outRecord.write(new byte[] { IAC, SB, OPT_TERMINAL_TYPE, 0x00 }, 0, 4);
+				this.outRecord.write(termType, 0, termType.length);
+				this.outRecord.write(IAC);
+				this.outRecord.write(SE);
+			} else if (cmd.length == 3 && cmd[1] == DO) {
+				this.outRecord.write(new byte[] { IAC, WILL, cmd[2] }, 0, 3);
+			} else if (cmd.length == 3 && cmd[1] == WILL) {
+				this.outRecord.write(new byte[] { IAC, DO, cmd[2] }, 0, 3);
+			} else {
+				continue;
+			}
+			this.send(this.outRecord.toByteArray(), this.outRecord.size());
+		}
+	}
+
+	private void send(byte[] data, int length) throws IOException {
+		this.os.write(data, 0, length);
+		this.os.flush();
+		this.bytesSent += length;
+	}
+
+	// send an input line as Enter with the text in the input field
+	private void sendInput(String text) throws IOException {
+		byte[] ebcdic = Ebcdic.toEbcdic(text);
+		this.outRecord.reset();
+		this.outRecord.write(INPUT_START, 0, INPUT_START.length);
+		this.outRecord.write(ebcdic, 0, ebcdic.length);
+		this.outRecord.write(IAC);
+		this.outRecord.write(0xEF);
+		this.send(this.outRecord.toByteArray(), this.outRecord.size());
+	}
+
+	private boolean isWsfQuery(byte[] record, int length) {
+		return length >= 6
+			&& record[0] == (byte)0xF3
+			&& record[3] == (byte)0x01
+			&& record[4] == (byte)0xFF
+			&& record[5] == (byte)0x02;
+	}
+
+	private static boolean contains(byte[] record, int length, byte[] pattern) {
+		int last = length - pattern.length;
+		for (int i = 0; i <= last; i++) {
+			int j = 0;
+			while (j < pattern.length && record[i + j] == pattern[j]) { j++; }
+			if (j == pattern.length) { return true; }
+		}
+		return false;
+	}
+
+	// read records (answering a WSF query) until one contains the expected or the failure text
+	private boolean waitFor(String expected, String failureText) throws IOException {
+		byte[] expectedEbcdic = Ebcdic.toEbcdic(expected);
+		byte[] failureEbcdic = (failureText != null) ? Ebcdic.toEbcdic(failureText) : null;
+		while (true) {
+			int length = this.reader.readRecord();
+			if (length < 0) {
+				this.fail("connection closed waiting for '" + expected + "'");
+				return false;
+			}
+			this.recordsReceived++;
+			byte[] record = this.reader.getRecord();
+			if (this.isWsfQuery(record, length)) {
+				this.send(this.wsfQueryReply, this.wsfQueryReply.length);
+			} else if (contains(record, length, expectedEbcdic)) {
+				return true;
+			} else if (failureEbcdic != null && contains(record, length, failureEbcdic)) {
+				this.fail("host reported '" + failureText + "'");
+				return false;
+			}
+		}
+	}
+}
@@ -0,0 +1,168 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.load;
+
+import java.io.IOException;
+import java.io.InputStream;
+
+/**
+ * Buffered reader for a TN3270 connection, delivering the telnet commands
+ * of the negotiation phase and then the (unescaped) 3270 records terminated
+ * by the telnet EOR.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class TelnetRecordReader {
+
+	private static final int IAC = 0xFF;
+	private static final int EOR = 0xEF;
+	private static final int SB = 0xFA;
+	private static final int SE = 0xF0;
+	private static final int WILL = 0xFB;
+	private static final int DONT = 0xFE;
+
+	private final InputStream is;
+
+	private final byte[] inBuffer = new byte[8192];
+	private int inPos = 0;
+	private int inCount = 0;
+	private long bytesRead = 0;
+
+	private byte[] record = new byte[4096];
+	private int recordLength = 0;
+
+	/**
+	 * Construct the reader for the given stream.
+	 * @param is the input stream of the connection.
+	 */
+	public TelnetRecordReader(InputStream is) {
+		this.is = is;
+	}
+
+	// get the next byte from the connection, -1 at end of stream
+	private int nextByte() throws IOException {
+		if (this.inPos >= this.inCount) {
+			int count = this.is.read(this.inBuffer, 0, this.inBuffer.length);
+			if (count < 0) { return -1; }
+			this.inPos = 0;
+			this.inCount = count;
+			this.bytesRead += count;
+			if (count == 0) { return this.nextByte(); }
+		}
+		return this.inBuffer[this.inPos++] & 0xFF;
+	}
+
+	private void append(int b) {
+		if (this.recordLength >= this.record.length) {
+			byte[] newRecord = new byte[this.record.length * 2];
+			System.arraycopy(this.record, 0, newRecord, 0, this.recordLength);
+			this.record = newRecord;
+		}
+		this.record[this.recordLength++] = (byte)b;
+	}
+
+	// skip a subnegotiation up to and including IAC SE, returning false at end of stream
+	private boolean skipSubnegotiation(boolean collect) throws IOException {
+		while (true) {
+			int b = this.nextByte();
+			if (b < 0) { return false; }
+			if (collect) { this.append(b); }
+			if (b == IAC) {
+				b = this.nextByte();
+				if (b < 0) { return false; }
+				if (collect) { this.append(b); }
+				if (b == SE) { return true; }
+			}
+		}
+	}
+
+	/**
+	 * Read the next telnet command (IAC + command [+ option] or a complete
+	 * subnegotiation IAC SB ... IAC SE).
+	 * @return the bytes of the telnet command or <code>null</code> at end of stream.
+	 * @throws IOException if the connection fails or the next byte does not start
+	 *   a telnet command.
+	 */
+	public byte[] readCommand() throws IOException {
+		int b = this.nextByte();
+		if (b < 0) { return null; }
+		if (b != IAC) {
+			throw new IOException(String.format("Telnet command expected, found data byte 0x%02X", b));
+		}
+		int cmd = this.nextByte();
+		if (cmd < 0) { return null; }
+		this.recordLength = 0;
+		this.append(IAC);
+		this.append(cmd);
+		if (cmd == SB) {
+			if (!this.skipSubnegotiation(true)) { return null; }
+		} else if (cmd >= WILL && cmd <= DONT) {
+			int opt = this.nextByte();
+			if (opt < 0) { return null; }
+			this.append(opt);
+		}
+		byte[] command = new byte[this.recordLength];
+		System.arraycopy(this.record, 0, command, 0, this.recordLength);
+		this.recordLength = 0;
+		return command;
+	}
+
+	/**
+	 * Read the next 3270 record, unescaping doubled IAC bytes and skipping
+	 * telnet commands embedded in the data.
+	 * @return the length of the record (without the telnet EOR) available through
+	 *   <code>getRecord()</code>, or -1 at end of stream.
+	 * @throws IOException
+	 */
+	public int readRecord() throws IOException {
+		this.recordLength = 0;
+		while (true) {
+			int b = this.nextByte();
+			if (b < 0) { return -1; }
+			if (b != IAC) {
+				this.append(b);
+				continue;
+			}
+			int cmd = this.nextByte();
+			if (cmd < 0) { return -1; }
+			if (cmd == IAC) {
+				this.append(IAC);
+			} else if (cmd == EOR) {
+				return this.recordLength;
+			} else if (cmd == SB) {
+				if (!this.skipSubnegotiation(false)) { return -1; }
+			} else if (cmd >= WILL && cmd <= DONT) {
+				if (this.nextByte() < 0) { return -1; }
+			} // other telnet commands are ignored
+		}
+	}
+
+	/**
+	 * Get the buffer holding the record read by the last <code>readRecord()</code>,
+	 * the buffer may be longer than the record and is reused by the next read.
+	 * @return the record buffer.
+	 */
+	public byte[] getRecord() {
+		return this.record;
+	}
+
+	/**
+	 * Get the total number of bytes received on the connection.
+	 * @return the byte count.
+	 */
+	public long getBytesRead() {
+		return this.bytesRead;
+	}
+}
@@ -0,0 +1,86 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.IOException;
+import java.io.InterruptedIOException;
+import java.net.InetSocketAddress;
+import java.net.Socket;
+
+/**
+ * Socket connecting to the VM/370 host in a background thread, allowing a
+ * stream filter to negotiate with the terminal while the host connection
+ * is being established.
+ * <p>
+ * The stream filter waits for the connection with <code>awaitConnected()</code>
+ * before using the streams of this socket.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class AsyncConnectSocket extends Socket implements Runnable {
+
+	private final String hostName;
+	private final int hostPort;
+
+	private boolean done = false;
+	private IOException failure = null;
+
+	/**
+	 * Construct the socket and start connecting to the host.
+	 * @param hostName name of the host to connect to (resolved in the background).
+	 * @param hostPort the port to connect to on the host.
+	 */
+	public AsyncConnectSocket(String hostName, int hostPort) {
+		this.hostName = hostName;
+		this.hostPort = hostPort;
+		Thread thread = new Thread(this, "connect " + hostName + ":" + hostPort);
+		thread.setDaemon(true);
+		thread.start();
+	}
+
+	/**
+	 * Worker routine for the connecting thread.
+	 */
+	@Override
+	public void run() {
+		IOException exc = null;
+		try {
+			this.connect(new InetSocketAddress(this.hostName, this.hostPort));
+		} catch (IOException e) {
+			exc = new IOException("unable to connect to '" + this.hostName + "', port " + this.hostPort + ": " + e.getMessage());
+			exc.initCause(e);
+		}
+		synchronized(this) {
+			this.failure = exc;
+			this.done = true;
+			this.notifyAll();
+		}
+	}
+
+	/**
+	 * Wait until the connection to the host is established.
+	 * @throws IOException if the connection to the host failed (or waiting was interrupted).
+	 */
+	public synchronized void awaitConnected() throws IOException {
+		while (!this.done) {
+			try {
+				this.wait();
+			} catch (InterruptedException exc) {
+				throw new InterruptedIOException("interrupted while connecting to '" + this.hostName + "'");
+			}
+		}
+		if (this.failure != null) { throw this.failure; }
+	}
+}
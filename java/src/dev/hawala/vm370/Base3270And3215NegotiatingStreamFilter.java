@@ -17,6 +17,7 @@ package dev.hawala.vm370;
 import java.io.IOException;
 import java.io.InputStream;
 import java.net.Socket;
+import java.util.concurrent.CountDownLatch;
 
 import dev.hawala.vm370.ebcdic.EbcdicHandler;
 
@@ -26,7 +27,13 @@ import dev.hawala.vm370.ebcdic.EbcdicHandler;
  * <p> 
  * On the 3270 terminal side, the terminal characteristics are determined with a
  * WSF-query if the terminal type name indicates that extended functionality is
- * supported (and WSF-querying is not deactivated).
+ * supported (and WSF-querying is not deactivated), the result of the query being
+ * optionally cached for the next connection of the same emulator (except for
+ * IBM-DYNAMIC terminals, whose screen size may change between connections).
+ * <p>
+ * To save round-trips when setting up a session, the telnet options are requested from
+ * the terminal in a single burst and the TN3270 negotiation with the host can run in
+ * parallel to the terminal negotiation (see <code>beginHost3270Negotiation()</code>).
  * 
  * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
  */
@@ -36,6 +43,7 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 	// resp. the WSF-query.
 	protected String terminalType;
 	protected String terminalLuName = null;
+	protected String announcedTerminalType = null; // as sent by the terminal, including the LU-name
 	protected EbcdicHandler ebcdicTerminalType = new EbcdicHandler();
 	protected boolean canExtended = false;
 	protected boolean canColors = false;
@@ -43,9 +51,20 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 	protected boolean canAltScreenSize = false;
 	protected int numAltRows = 0;
 	protected int numAltCols = 0;
+	protected int dftBufferSize = 0; // 0 = no DFT file transfer (no DDM query reply)
 	
 	protected boolean isIn320Mode = false;
 	
+	// the cache key if the terminal characteristics were taken from the cache
+	private String cachedPropertiesKey = null;
+	
+	// signaled when the terminal type (and LU-name) is known or the terminal negotiation failed
+	private final CountDownLatch terminalTypeKnown = new CountDownLatch(1);
+	
+	// the host negotiation running in parallel to the terminal negotiation
+	private Thread hostNegotiationThread = null;
+	private volatile boolean hostNegotiated = false;
+	
 	/**
 	 * Construct and initialize the base filter (parent class) for this instance.
 	 * @param connectionNo the connection counter value of this filter (for logging).
@@ -61,8 +80,6 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		super(connectionNo, terminalSideSocket, hostSideSocket, closedSink);
 	}
 	
-	private static byte[] TN_EOR = { (byte)0xFF, (byte)0xEF };
-	
 	private static byte[] TN_DO_TERMINAL_TYPE 
 							= { (byte)0xFF, (byte)0xFD, (byte)0x18 };
 	private static byte[] TN_WILL_TERMINAL_TYPE 
@@ -108,6 +125,15 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 	private static byte[] TN_WILL_BINARY 
 							= { (byte)0xFF, (byte)0xFB, (byte)0x00 };
 	
+	// the options requested from the terminal once it agreed to send its terminal type
+	private static byte[] TN_BURST_3270_MODE
+							= { (byte)0xFF, (byte)0xFA, (byte)0x18, (byte)0x01, (byte)0xFF, (byte)0xF0, // SB SEND TERMINAL TYPE
+								(byte)0xFF, (byte)0xFD, (byte)0x19, // DO END OF RECORD
+								(byte)0xFF, (byte)0xFB, (byte)0x19, // WILL END OF RECORD
+								(byte)0xFF, (byte)0xFD, (byte)0x00, // DO BINARY
+								(byte)0xFF, (byte)0xFB, (byte)0x00  // WILL BINARY
+							};
+	
 	private static byte[] TN_WONT_ECHO 
 							= { (byte)0xFF, (byte)0xFC, (byte)0x01 };
 	private static byte[] TN_DONT_ECHO 
@@ -164,6 +190,51 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 	protected boolean negotiateTerminal3270Mode(
 			boolean stickToPredefinedTerminalTypes,
 			short minColorCount) throws IOException {
+		try {
+			return this.innerNegotiateTerminal3270Mode(stickToPredefinedTerminalTypes, minColorCount);
+		} finally {
+			// let a parallel host negotiation continue resp. give up if the terminal type is unknown
+			this.terminalTypeKnown.countDown();
+		}
+	}
+	
+	// get the length of the complete telnet command at offset, 0 if incomplete, -1 if not a telnet command
+	private static int getTnCommandLength(byte[] buffer, int offset, int count) {
+		if (offset >= count) { return 0; }
+		if (buffer[offset] != (byte)0xFF) { return -1; }
+		if ((offset + 1) >= count) { return 0; }
+		byte cmd = buffer[offset + 1];
+		if (cmd == (byte)0xFA) { // SB ... IAC SE
+			for (int i = offset + 2; i < (count - 1); i++) {
+				if (buffer[i] == (byte)0xFF) {
+					if (buffer[i + 1] == (byte)0xF0) { return i + 2 - offset; }
+					i++; // escaped 0xFF
+				}
+			}
+			return 0;
+		}
+		if (cmd == (byte)0xFB || cmd == (byte)0xFC || cmd == (byte)0xFD || cmd == (byte)0xFE) { // WILL/WONT/DO/DONT
+			return ((offset + 2) < count) ? 3 : 0;
+		}
+		return 2;
+	}
+	
+	// remember the terminal type (resp. LU-name) sent by the terminal and release a waiting host negotiation
+	private void setTerminalType(String name) {
+		this.logger.info("Terminaltype is: " + name);
+		this.announcedTerminalType = name;
+		this.terminalType = name;
+		String[] luCheck = name.split("@");
+		if (luCheck.length > 1) { 
+			this.terminalType = luCheck[0];
+			this.terminalLuName = luCheck[1];
+		}
+		this.terminalTypeKnown.countDown();
+	}
+	
+	private boolean innerNegotiateTerminal3270Mode(
+			boolean stickToPredefinedTerminalTypes,
+			short minColorCount) throws IOException {
 		byte[] buffer = new byte[256];
 		
 		// reset status info
@@ -171,47 +242,81 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		
 		this.logger.info("Begin of 3270 negotiation with terminal");
 		
-		// get the terminal type
+		// the terminal must agree to send its terminal type before being asked for it
 		if (!this.pingPong(TN_DO_TERMINAL_TYPE, TN_WILL_TERMINAL_TYPE, buffer, "DoTerminalType -> WillTerminalType")) { 
 			return false; 
 		}
-		this.osToTerm.write(TN_SB_SEND_TERMINAL_TYPE);
-		this.osToTerm.flush();
-		this.logger.debug("sent TN_SB_SEND_TERMINAL_TYPE");
-		int termRespLen = this.isFromTerm.read(buffer);
-		this.logger.trace("... response.length: " + termRespLen);
-		if (termRespLen <= (TN_SB_TERMINAL_TYPE_IS.length + TN_SE.length)) {
-			// no space for a terminal name...
-			this.logger.info("... response to TN_SB_SEND_TERMINAL_TYPE is to short, aborted !!");
-			return false;
-		}
-		if (!this.isPresent(TN_SB_TERMINAL_TYPE_IS, buffer, 0, "SB_TERMINAL_TYPE_IS")
-			|| !this.isPresent(TN_SE, buffer, termRespLen-2, "SE")) {
-			return false;
-		}
-		this.terminalType = new String(buffer, TN_SB_TERMINAL_TYPE_IS.length, termRespLen - TN_SB_TERMINAL_TYPE_IS.length - TN_SE.length);
-		this.logger.info("Terminaltype is: " + terminalType);		
-		
-		// begin end-of-record mode
-		if (!this.pingPong(TN_DO_END_OF_RECORD, TN_WILL_END_OF_RECORD, buffer, "DoEndOfRecord -> WillEndOfRecord")
-			|| !this.pingPong(TN_WILL_END_OF_RECORD, TN_DO_END_OF_RECORD, buffer, "WillEndOfRecord -> DoEndOfRecord")) {
-			return false;
-		}
 		
-		// begin end-of-record mode
-		if (!this.pingPong(TN_DO_BINARY, TN_WILL_BINARY, buffer, "DoBinary -> WillBinary")
-			|| !this.pingPong(TN_WILL_BINARY, TN_DO_BINARY, buffer, "WillBinary -> DoBinary")) {
-			return false;
+		// ask for the terminal type and begin end-of-record and binary mode in both directions
+		// with a single transmission, the terminal may answer these requests in any order
+		this.osToTerm.write(TN_BURST_3270_MODE);
+		this.osToTerm.flush();
+		this.logger.debug("sent SB_SEND_TERMINAL_TYPE, DO+WILL END_OF_RECORD, DO+WILL BINARY");
+		
+		boolean haveTerminalType = false;
+		boolean termWillEOR = false;
+		boolean termDoEOR = false;
+		boolean termWillBinary = false;
+		boolean termDoBinary = false;
+		int pending = 0;
+		while(!(haveTerminalType && termWillEOR && termDoEOR && termWillBinary && termDoBinary)) {
+			if (pending >= buffer.length) {
+				this.logger.error("Negotiation response from terminal is too long, aborted !!");
+				return false;
+			}
+			int count = this.isFromTerm.read(buffer, pending, buffer.length - pending);
+			if (count < 0) {
+				this.logger.info("... terminal closed the connection while negotiating, aborted !!");
+				return false;
+			}
+			pending += count;
+			
+			int offset = 0;
+			int cmdLen = getTnCommandLength(buffer, offset, pending);
+			while(cmdLen > 0) {
+				if (cmdLen >= (TN_SB_TERMINAL_TYPE_IS.length + TN_SE.length)
+						&& this.isPresent(TN_SB_TERMINAL_TYPE_IS, buffer, offset)) {
+					int nameLen = cmdLen - TN_SB_TERMINAL_TYPE_IS.length - TN_SE.length;
+					if (nameLen < 1) {
+						// no space for a terminal name...
+						this.logger.info("... response to TN_SB_SEND_TERMINAL_TYPE is to short, aborted !!");
+						return false;
+					}
+					this.setTerminalType(new String(buffer, offset + TN_SB_TERMINAL_TYPE_IS.length, nameLen));
+					haveTerminalType = true;
+				} else if (cmdLen == 3 && this.isPresent(TN_WILL_END_OF_RECORD, buffer, offset)) {
+					this.logger.debug("WillEndOfRecord - OK");
+					termWillEOR = true;
+				} else if (cmdLen == 3 && this.isPresent(TN_DO_END_OF_RECORD, buffer, offset)) {
+					this.logger.debug("DoEndOfRecord - OK");
+					termDoEOR = true;
+				} else if (cmdLen == 3 && this.isPresent(TN_WILL_BINARY, buffer, offset)) {
+					this.logger.debug("WillBinary - OK");
+					termWillBinary = true;
+				} else if (cmdLen == 3 && this.isPresent(TN_DO_BINARY, buffer, offset)) {
+					this.logger.debug("DoBinary - OK");
+					termDoBinary = true;
+				} else if (cmdLen == 3
+						&& (buffer[offset+1] == (byte)0xFC || buffer[offset+1] == (byte)0xFE)
+						&& (buffer[offset+2] == (byte)0x19 || buffer[offset+2] == (byte)0x00)) {
+					this.logger.error("Terminal refused END OF RECORD or BINARY mode, aborted !!");
+					return false;
+				} else {
+					this.logger.debug(String.format("ignored telnet command 0x%02X from terminal", buffer[offset+1]));
+				}
+				offset += cmdLen;
+				cmdLen = getTnCommandLength(buffer, offset, pending);
+			}
+			if (cmdLen < 0) {
+				this.logger.error("Received invalid data while negotiating 3270 mode with terminal");
+				return false;
+			}
+			System.arraycopy(buffer, offset, buffer, 0, pending - offset);
+			pending -= offset;
 		}
 		
 		this.logger.info("End of 3270 negotiation with terminal - 3270 mode entered");
 		
-		String[] luCheck = this.terminalType.split("@");
-		if (luCheck.length > 1) { 
-			this.terminalType = luCheck[0];
-			this.terminalLuName = luCheck[1];
-		}
-		
 		this.ebcdicTerminalType.appendUnicode(this.terminalType);
 		String[] parts = this.terminalType.split("-");
 		if (parts.length > 2 && parts[0].equals("IBM") && parts[1].matches("[0-9]+")) {
@@ -245,7 +350,7 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		} else if (this.terminalType.equals("IBM-DYNAMIC")) {
 			this.canExtended = true;
 	    }
-		if (!stickToPredefinedTerminalTypes && this.canExtended && this.query3270Properties()) {
+		if (!stickToPredefinedTerminalTypes && this.canExtended && this.recallOrQuery3270Properties()) {
 			if (this.pUsableHeight > 23 && this.pUsableWidth > 79) {
 				this.isIn320Mode = true;
 				if (this.pUsableHeight > 24 || this.pUsableWidth > 80) {
@@ -255,21 +360,27 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 				}
 				this.canExtHighLight = (this.pHighlightCount >= 3);
 				this.canColors = (this.pColorCount >= minColorCount);
+				this.dftBufferSize = this.pDdmBufferSize;
 			}
 		}
+		if (!this.isIn320Mode && this.cachedPropertiesKey != null) {
+			// the cached characteristics do not fit, so query again next time
+			TerminalPropertiesCache.invalidate(this.cachedPropertiesKey);
+		}
 		
 		this.logger.info("Terminal props: rows = ", this.numAltRows, ", cols = ", this.numAltCols,
 				", colors: ",(this.canColors) ? "yes":"no",
 				"(color count:", this.pColorCount, ")",
-				", extHighlight: ", (this.canExtHighLight) ? "yes":"no");
+				", extHighlight: ", (this.canExtHighLight) ? "yes":"no",
+				", DFT buffer: ", this.dftBufferSize);
 		
 		if (!this.isIn320Mode) {
 			byte[] cmd = { (byte)0xF5, (byte)0x00 }; // EW, no flags
 			EbcdicHandler msg = new EbcdicHandler("Terminal type '" + this.terminalType + "' not supported (or -noDynamic is used), sorry");
-			this.osToTerm.write(cmd);
-			this.osToTerm.write(msg.getRawBytes(), 0, msg.getLength());
-			this.osToTerm.write(TN_EOR);
-			this.osToTerm.flush();
+			TelnetRecordWriter record = new TelnetRecordWriter(this.osToTerm, 256);
+			record.write(cmd);
+			record.write(msg.getRawBytes(), 0, msg.getLength());
+			record.sendRecord();
 		}
 		return this.isIn320Mode;
 	}
@@ -310,11 +421,73 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		return processed;
 	}
 	
+	/**
+	 * Start the TN3270 negotiation with the host in a separate thread, so it runs in parallel
+	 * to the negotiation with the terminal, including the wait for the host connection if it
+	 * is established in the background. The host negotiation waits for the terminal negotiation
+	 * only when the host asks for the terminal type, as the terminal may specify the LU-name. 
+	 * @param cfgLuName the LU-Name to connect to if the terminal does not specify one (resp.
+	 *   <code>null</code> or empty string for no LU-name).
+	 */
+	protected void beginHost3270Negotiation(final String cfgLuName) {
+		this.hostNegotiationThread = new Thread(this.subThreadsGroup, new Runnable() {
+			public void run() {
+				if (!awaitHostConnection()) { return; }
+				try {
+					negotiateHost3270Mode(cfgLuName);
+					hostNegotiated = true;
+				} catch (IOException exc) {
+					logger.error("Error while negotiating 3270 protocol with host, IOException: ", exc.getMessage());
+				}
+			}
+		});
+		this.hostNegotiationThread.start();
+	}
+	
+	/**
+	 * Wait for the end of the host negotiation started with <code>beginHost3270Negotiation()</code>.
+	 * @param abort if <code>true</code>, the host connection is closed to stop the host
+	 *   negotiation, as the terminal negotiation failed.
+	 * @return <code>true</code> if the host negotiation was successful and not aborted.
+	 */
+	protected boolean endHost3270Negotiation(boolean abort) {
+		if (this.hostNegotiationThread == null) { return false; }
+		if (abort) {
+			this.terminalTypeKnown.countDown();
+			try { this.hostSideSocket.close(); } catch (IOException exc) { /* ignored */ }
+		}
+		try {
+			this.hostNegotiationThread.join();
+		} catch (InterruptedException exc) {
+			return false;
+		}
+		return this.hostNegotiated && !abort;
+	}
+	
+	// wait for the terminal negotiation to get the terminal type and return the LU-name to use
+	private String awaitLuName(String cfgLuName) throws IOException {
+		try {
+			this.terminalTypeKnown.await();
+		} catch (InterruptedException exc) {
+			throw new IOException("Interrupted while waiting for the terminal type");
+		}
+		if (this.terminalType == null) {
+			throw new IOException("Terminal type not available (terminal negotiation failed)");
+		}
+		return (this.terminalLuName != null && this.terminalLuName.length() > 0)
+			? this.terminalLuName
+			: cfgLuName;
+	}
+	
 	/**
 	 * Perform the complete telnet-negotiation with the host to enter the TN3270 binary
 	 * transmission mode, claiming to be an IBM-3278-4-E terminal emulation.
-	 * @param cfgLuName the LU-Name to connect to (resp. <code>null</code> or empty string for
-	 *   no LU-name).
+	 * <p>
+	 * When the host asks for the terminal type, this method waits until the terminal
+	 * negotiation has determined the terminal type, as the LU-name may be given by
+	 * the terminal.
+	 * @param cfgLuName the LU-Name to connect to if the terminal does not specify one (resp.
+	 *   <code>null</code> or empty string for no LU-name).
 	 * @throws IOException
 	 */
 	protected void negotiateHost3270Mode(String cfgLuName) throws IOException {
@@ -325,13 +498,12 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		boolean meEOR = false;
 		boolean hostEOR = false;
 		
-		String luName = (this.terminalLuName != null && this.terminalLuName.length() > 0)
-			? this.terminalLuName
-			: cfgLuName;
-		
 		this.logger.info("Begin of TN3270 mode negotiation with Host");
 		while(!(sentTerminal && meBinary && hostBinary && meEOR && hostEOR)) {
 			int rcvd = this.isFromHost.read(buffer);
+			if (rcvd < 0) {
+				throw new IOException("Host closed the connection while negotiating into TN3270 binary mode");
+			}
 			int offset = 0;
 			while (offset < rcvd) {
 				if (this.isPresent(TN_DO_TERMINAL_TYPE, buffer, offset)) {
@@ -340,6 +512,7 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 					this.logger.debug(" Rcvd: DO TERMINAL TYPE    =>   Sent: WILL TERMINAL TYPE");
 					offset += TN_DO_TERMINAL_TYPE.length;
 				} else if (this.isPresent(TN_SB_SEND_TERMINAL_TYPE, buffer, offset)) {
+					String luName = this.awaitLuName(cfgLuName);
 					byte[] termSeq = TN_SB_TERMINAL_TYPE_IS_3270_4_E;
 					if (luName != null && !luName.isEmpty()) {
 						// insert @<luname> into the predefined terminal name sequence
@@ -460,6 +633,55 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		}
 	}
 	
+	/**
+	 * Get the terminal capabilities from the cache if the same emulator has connected before,
+	 * else do a WSF-query to the terminal and cache the result.
+	 * <p>
+	 * IBM-DYNAMIC terminals are always queried, as the user may have changed the
+	 * screen size of the emulator since the last connection.
+	 * @return <code>true</code> if the capabilities are available.
+	 */
+	private boolean recallOrQuery3270Properties() {
+		boolean cacheable = !this.terminalType.equals("IBM-DYNAMIC");
+		String cacheKey = TerminalPropertiesCache.keyFor(
+				this.announcedTerminalType,
+				this.terminalSideSocket.getInetAddress());
+		TerminalPropertiesCache.Entry cached = (cacheable) ? TerminalPropertiesCache.lookup(cacheKey) : null;
+		if (cached != null) {
+			this.cachedPropertiesKey = cacheKey;
+			this.pAdr14bit = cached.adr14bit;
+			this.pAdr16bit = cached.adr16bit;
+			this.pUsablesInPels = cached.usablesInPels;
+			this.pUsableWidth = cached.usableWidth;
+			this.pUsableHeight = cached.usableHeight;
+			this.pColorCount = cached.colorCount;
+			this.pHighlightCount = cached.highlightCount;
+			this.pDdmBufferSize = cached.ddmBufferSize;
+			this.logger.info("Using cached WSF-query reply for terminal ", cacheKey);
+			this.traceParameter("cachedQueryReply", cached);
+			return true;
+		}
+		
+		if (!this.query3270Properties()) {
+			TerminalPropertiesCache.invalidate(cacheKey);
+			return false;
+		}
+		if (!cacheable || this.pUsableWidth <= 0 || this.pUsableHeight <= 0) {
+			TerminalPropertiesCache.invalidate(cacheKey); // bad query reply
+		} else {
+			TerminalPropertiesCache.store(cacheKey, new TerminalPropertiesCache.Entry(
+					this.pAdr14bit,
+					this.pAdr16bit,
+					this.pUsablesInPels,
+					this.pUsableWidth,
+					this.pUsableHeight,
+					this.pColorCount,
+					this.pHighlightCount,
+					this.pDdmBufferSize));
+		}
+		return true;
+	}
+	
 	private int processSummary(TnBuffer buffer, int len) {
 		this.logger.debug(".. QCode 'Summary', supported QCodes:");
 		while(len > 0) {
@@ -687,6 +909,24 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 		return len;
 	}
 	
+	// collected buffer size for DFT file transfers (min. of the inbound and outbound limits)
+	protected int pDdmBufferSize = 0;
+	
+	private int processDdm(TnBuffer buffer, int len) {
+		this.logger.debug(".. QCode 'Distributed Data Management'");
+		
+		if (len < 6) { return len; }
+		buffer.get16bitUnsigned(); len -= 2; // reserved
+		int limIn = buffer.get16bitUnsigned(); len -= 2;
+		int limOut = buffer.get16bitUnsigned(); len -= 2;
+		this.pDdmBufferSize = Math.min(limIn, limOut);
+		
+		this.logger.debug(String.format("    -> inbound limit  = %d\n", limIn));
+		this.logger.debug(String.format("    -> outbound limit = %d\n", limOut));
+		
+		return len;
+	}
+	
 	private int processAlphaPartitions(TnBuffer buffer, int len) {
 		this.logger.debug(".. QCode 'Alphanumeric partitions'");
 	
@@ -740,6 +980,9 @@ public abstract class Base3270And3215NegotiatingStreamFilter extends BaseStreamF
 				case (byte)0x84:
 					sfLen = this.processAlphaPartitions(buffer, sfLen);
 					break;
+				case (byte)0x95:
+					sfLen = this.processDdm(buffer, sfLen);
+					break;
 				default:
 				}
 			}
@@ -18,6 +18,11 @@ import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
 import java.net.Socket;
+import java.net.SocketException;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import dev.hawala.vm370.stats.ConnectionStats;
+import dev.hawala.vm370.stats.MecaffStats;
 
 /**
  * Basic implementation of a filter connecting 2 network streams, providing 
@@ -38,8 +43,9 @@ public abstract class BaseStreamFilter implements IBufferSink {
 	protected static final String prefixH2T = "  T<-H ";
 	protected static final String prefixT2H = "T->H   ";
 
-	// the sockets for the 2 communication directions 
-	protected final Socket terminalSideSocket;
+	// the sockets for the 2 communication directions (the terminal socket is replaced
+	// when a reconnecting terminal takes over a detached session) 
+	protected Socket terminalSideSocket;
 	protected final Socket hostSideSocket;
 	
 	// an object to inform of closing down this filter
@@ -56,12 +62,24 @@ public abstract class BaseStreamFilter implements IBufferSink {
 	// the threads to read from each of the communication sides
 	protected Thread hostToTermThread = null;
 	protected Thread termToHostThread = null;
+	private StreamDrain hostDrain = null;
+	
+	// the number of listener threads that have ended
+	private final AtomicInteger endedListeners = new AtomicInteger(0);
+	
+	// the recorder for the data read from both sides (null if tracing is not enabled)
+	protected final SessionTrace trace;
+	
+	// the counters for the data transferred and the timings of this connection
+	protected final ConnectionStats stats;
 	
 	/**
 	 * Construct and initialize the base filter.
 	 * @param connectionNo the connection counter value of this filter (for logging).
 	 * @param terminalSideSocket the socket connected to the terminal.
-	 * @param hostSideSocket the socket connected to the host.
+	 * @param hostSideSocket the socket connected to the host (an <code>AsyncConnectSocket</code> if
+	 *   the connection is still being established, the host streams are then opened by
+	 *   <code>awaitHostConnection()</code>).
 	 * @param closedSink the object to be informed about the filter being shut down.
 	 */
 	public BaseStreamFilter(int connectionNo, Socket terminalSideSocket, Socket hostSideSocket, IConnectionClosedSink closedSink) {
@@ -73,17 +91,83 @@ public abstract class BaseStreamFilter implements IBufferSink {
 		this.hostSideSocket = hostSideSocket;
 		
 		this.closedSink = closedSink;
+		
+		this.trace = SessionTrace.open(connectionNo, this.getClass().getName());
+		this.stats = MecaffStats.open(connectionNo, this.getClass().getSimpleName());
 
 		try {
-			this.isFromTerm = this.terminalSideSocket.getInputStream();
-			this.osToTerm = this.terminalSideSocket.getOutputStream();
-			this.isFromHost = this.hostSideSocket.getInputStream();
-			this.osToHost = this.hostSideSocket.getOutputStream();
+			this.isFromTerm = this.stats.wrap(this.terminalSideSocket.getInputStream(), true);
+			this.osToTerm = this.stats.wrap(this.terminalSideSocket.getOutputStream(), true);
+			if (!(this.hostSideSocket instanceof AsyncConnectSocket)) {
+				this.openHostStreams();
+			}
 		} catch (Exception e) {
 			this.logger.error("unable to open streams from sockets");
 			this.closeAll();
 			return;
 		}
+		
+		// record everything read from the sides, including the telnet negotiations
+		if (this.trace != null) {
+			this.isFromTerm = this.trace.wrap(this.isFromTerm, SessionTrace.FromTerminal);
+		}
+		
+		// all data is written as complete records, so delaying small segments
+		// (Nagle's algorithm) would only add latency to each interaction
+		this.setTcpNoDelay(this.terminalSideSocket, "terminal");
+	}
+	
+	// get the streams of the (connected) host socket
+	private void openHostStreams() throws IOException {
+		this.isFromHost = this.stats.wrap(this.hostSideSocket.getInputStream(), false);
+		this.osToHost = this.stats.wrap(this.hostSideSocket.getOutputStream(), false);
+		if (this.trace != null) {
+			this.isFromHost = this.trace.wrap(this.isFromHost, SessionTrace.FromHost);
+		}
+		this.setTcpNoDelay(this.hostSideSocket, "host");
+	}
+	
+	/**
+	 * Wait until the connection to the host is established if it is opened in the
+	 * background and open the streams to the host.
+	 * @return <code>true</code> if the streams to the host are available, <code>false</code>
+	 *   if the host connection failed (the filter is then closed).
+	 */
+	protected boolean awaitHostConnection() {
+		if (this.osToHost != null) { return true; }
+		if (this.closed) { return false; }
+		try {
+			if (this.hostSideSocket instanceof AsyncConnectSocket) {
+				((AsyncConnectSocket)this.hostSideSocket).awaitConnected();
+			}
+			this.openHostStreams();
+			return true;
+		} catch (IOException exc) {
+			this.logger.error("** Unable to setup MECAFF connection to VM/370-Host: ", exc.getMessage());
+			this.closeAll();
+			return false;
+		}
+	}
+	
+	/**
+	 * Record a parameter of the filter in the session trace (if tracing is enabled),
+	 * allowing to setup an equivalent filter when replaying the trace.
+	 * @param name the parameter name.
+	 * @param value the parameter value (<code>null</code> values are not recorded).
+	 */
+	protected void traceParameter(String name, Object value) {
+		if (this.trace != null && value != null) {
+			this.trace.recordParameter(name, value);
+		}
+	}
+	
+	// disable Nagle's algorithm for the socket, logging a failure
+	private void setTcpNoDelay(Socket socket, String side) {
+		try {
+			socket.setTcpNoDelay(true);
+		} catch (SocketException e) {
+			this.logger.warn("unable to set TCP_NODELAY for ", side, " connection: ", e.getMessage());
+		}
 	}
 	
 	/**
@@ -93,18 +177,114 @@ public abstract class BaseStreamFilter implements IBufferSink {
 	protected void startAsyncCommunication() {
 		if (this.hostToTermThread != null) { return; }
 		
-		StreamDrain hostDrain = new StreamDrain(prefixH2T, this.isFromHost, this);
+		this.hostDrain = new StreamDrain(prefixH2T, this.isFromHost, this);
 		StreamDrain termDrain = new StreamDrain(prefixT2H, this.isFromTerm, this);
-		hostDrain.setOtherDirectionFilter(termDrain);
-		termDrain.setOtherDirectionFilter(hostDrain);
+		this.hostDrain.setOtherDirectionFilter(termDrain);
+		termDrain.setOtherDirectionFilter(this.hostDrain);
 		
-		this.hostToTermThread = new Thread(this.subThreadsGroup, hostDrain);
+		this.hostToTermThread = new Thread(this.subThreadsGroup, this.hostDrain);
 		this.termToHostThread = new Thread(this.subThreadsGroup, termDrain);
 		
 		this.hostToTermThread.start();
 		this.termToHostThread.start();
 	}
 	
+	/**
+	 * Connect a reconnected terminal to this (detached) filter and begin listening
+	 * to the terminal again.
+	 * @param socket the socket connected to the terminal, with the telnet negotiations
+	 *   already done.
+	 * @return <code>false</code> if the terminal cannot be used (the filter then
+	 *   stays detached).
+	 */
+	public boolean reattachTerminal(Socket socket) {
+		if (this.closed) { return false; }
+		InputStream is;
+		OutputStream os;
+		try {
+			is = this.stats.wrap(socket.getInputStream(), true);
+			os = this.stats.wrap(socket.getOutputStream(), true);
+		} catch (IOException exc) {
+			this.logger.error("unable to open streams from reconnected terminal socket");
+			return false;
+		}
+		if (this.trace != null) {
+			is = this.trace.wrap(is, SessionTrace.FromTerminal);
+		}
+		
+		this.terminalSideSocket = socket;
+		this.isFromTerm = is;
+		this.osToTerm = os;
+		try {
+			this.terminalReattached();
+		} catch (IOException exc) {
+			this.logger.error("IOException while restoring screen on reconnected terminal: ", exc.getMessage());
+		}
+		
+		StreamDrain termDrain = new StreamDrain(prefixT2H, this.isFromTerm, this);
+		this.hostDrain.setOtherDirectionFilter(termDrain);
+		termDrain.setOtherDirectionFilter(this.hostDrain);
+		this.termToHostThread = new Thread(this.subThreadsGroup, termDrain);
+		this.termToHostThread.start();
+		this.logger.info("Terminal reattached to connection ", this.connectionNo);
+		return true;
+	}
+	
+	/**
+	 * Pass the terminal of this (new) filter to a detached filter taking over the
+	 * terminal, this filter being closed without closing the terminal connection.
+	 * @param target the detached filter to receive the terminal.
+	 * @return <code>true</code> if the terminal was taken over by <code>target</code>.
+	 */
+	protected boolean handOverTerminal(BaseStreamFilter target) {
+		if (!target.reattachTerminal(this.terminalSideSocket)) { return false; }
+		try { if (this.isFromHost != null) { this.isFromHost.close(); } } catch(Exception e) {}
+		try { if (this.osToHost != null) { this.osToHost.close(); } } catch(Exception e) {}
+		try { if (!this.hostSideSocket.isClosed()) { this.hostSideSocket.close(); } } catch(Exception e) {}
+		if (this.trace != null) { this.trace.close(); }
+		MecaffStats.close(this.stats);
+		this.closed = true;
+		return true;
+	}
+	
+	/**
+	 * Event method invoked when the listener thread for the terminal ended, allowing
+	 * sub-classes to keep the host connection for a terminal reconnecting later.
+	 * <p>
+	 * Sub-classes detaching the session must stop writing to the terminal and close the
+	 * terminal side with <code>closeTerminalSide()</code> before the detached session can
+	 * be taken over by a reconnecting terminal.
+	 * @return <code>true</code> if the session was detached from the terminal, i.e.
+	 *   the host connection must stay open.
+	 */
+	protected boolean detachTerminal() {
+		return false;
+	}
+	
+	/**
+	 * Event method invoked after a reconnected terminal replaced the terminal streams,
+	 * allowing sub-classes to restore the screen on the terminal.
+	 * @throws IOException
+	 */
+	protected void terminalReattached() throws IOException { }
+	
+	/**
+	 * End the session after the detached terminal did not reconnect in time, closing
+	 * the connection to the host.
+	 */
+	public void endDetachedSession() {
+		this.connectionClosed();
+	}
+	
+	/**
+	 * Close the streams and the socket to the (dropped) terminal.
+	 */
+	protected void closeTerminalSide() {
+		try { if (this.isFromTerm != null) { this.isFromTerm.close(); } } catch(Exception e) {}
+		try { if (this.osToTerm != null) { this.osToTerm.close(); } } catch(Exception e) {}
+		try { if (!this.terminalSideSocket.isClosed()) { this.terminalSideSocket.close(); } } catch(Exception e) {}
+	}
+	
 	/**
 	 * Stop listening to our communication partners (terminal and host) and
 	 * close all streams.
@@ -120,6 +300,9 @@ public abstract class BaseStreamFilter implements IBufferSink {
 		try { if (!this.terminalSideSocket.isClosed()) { this.terminalSideSocket.close(); } } catch(Exception e) {}
 		try { if (!this.hostSideSocket.isClosed()) { this.hostSideSocket.close(); } } catch(Exception e) {}
 		
+		if (this.trace != null) { this.trace.close(); }
+		MecaffStats.close(this.stats);
+		
 		this.closed = true;	
 	}
 	
@@ -127,7 +310,21 @@ public abstract class BaseStreamFilter implements IBufferSink {
 	 * Event method to be informed that one of the streams listened to have been closed,
 	 * calling this method will stop all listening to the communication partners (terminal and host).
 	 */
-	public void connectionClosed() { this.closeAll(); }
+	public void connectionClosed() {
+		if (!this.closed && Thread.currentThread() == this.termToHostThread && this.detachTerminal()) {
+			return; // only the terminal is gone, the host session waits for the terminal to reconnect
+		}
+		this.closeAll();
+		if (this.endedListeners.incrementAndGet() == 2) {
+			this.releaseResources();
+		}
+	}
+	
+	/**
+	 * Event method invoked once when both listener threads have ended, allowing
+	 * sub-classes to give back the resources used for the connection (like pooled buffers).
+	 */
+	protected void releaseResources() { }
 	
 	/**
 	 * Query the running state of the filter.
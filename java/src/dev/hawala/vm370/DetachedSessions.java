@@ -0,0 +1,121 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.ScheduledFuture;
+
+/**
+ * Registry of the sessions whose terminal connection dropped, keeping the
+ * connection to the host (and the MECAFF-console state) alive for a grace period
+ * so a terminal reconnecting with the same LU-name can take over the session.
+ * <p>
+ * The grace period is set with the MECAFF command line parameter <code>-detachTime:</code>,
+ * sessions not reclaimed within the grace period are ended like before.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class DetachedSessions {
+
+	private static Log logger = Log.getLogger();
+
+	/** Default grace period for detached sessions in seconds (0 = sessions end with the terminal connection). */
+	public static final int DefaultGracePeriodSecs = 0;
+
+	private static long gracePeriodMs = DefaultGracePeriodSecs * 1000L;
+
+	/**
+	 * A detached session waiting for its terminal.
+	 */
+	private static class Detached {
+		private final BaseStreamFilter filter;
+		private ScheduledFuture<?> deadline = null;
+
+		private Detached(BaseStreamFilter filter) {
+			this.filter = filter;
+		}
+	}
+
+	private static final Map<String,Detached> sessions = new HashMap<String,Detached>();
+
+	/**
+	 * Set the time a session is kept after its terminal connection dropped.
+	 * @param seconds the grace period in seconds, 0 disabling detaching sessions.
+	 */
+	public static synchronized void setGracePeriod(int seconds) {
+		gracePeriodMs = Math.max(0, seconds) * 1000L;
+	}
+
+	/**
+	 * Check if sessions are kept after their terminal connection dropped.
+	 * @return <code>true</code> if a grace period is set.
+	 */
+	public static synchronized boolean isEnabled() {
+		return gracePeriodMs > 0;
+	}
+
+	/**
+	 * Keep a session whose terminal connection dropped for the grace period.
+	 * <p>
+	 * A session already detached with the same LU-name is ended.
+	 * @param luName the LU-name of the terminal.
+	 * @param filter the stream filter of the session.
+	 * @return <code>false</code> if the session cannot be detached (detaching disabled
+	 *   or no LU-name), the session must then be ended.
+	 */
+	public static boolean detach(final String luName, final BaseStreamFilter filter) {
+		Detached previous;
+		synchronized(DetachedSessions.class) {
+			if (gracePeriodMs == 0 || luName == null || luName.length() == 0) { return false; }
+			final Detached entry = new Detached(filter);
+			previous = sessions.put(luName, entry);
+			entry.deadline = TimeoutScheduler.schedule(gracePeriodMs, new Runnable() {
+				public void run() { expire(luName, entry); }
+			});
+			logger.info("Session for LU '", luName, "' detached, waiting ", gracePeriodMs / 1000, " secs for reconnection");
+		}
+		if (previous != null) {
+			TimeoutScheduler.cancel(previous.deadline);
+			previous.filter.endDetachedSession();
+		}
+		return true;
+	}
+
+	/**
+	 * Take over the session detached for the LU-name, if any.
+	 * @param luName the LU-name of the reconnecting terminal.
+	 * @return the stream filter of the detached session or <code>null</code> if there
+	 *   is no session waiting for the LU-name.
+	 */
+	public static synchronized BaseStreamFilter claim(String luName) {
+		if (luName == null) { return null; }
+		Detached entry = sessions.remove(luName);
+		if (entry == null) { return null; }
+		TimeoutScheduler.cancel(entry.deadline);
+		logger.info("Session for LU '", luName, "' reclaimed by reconnected terminal");
+		return entry.filter;
+	}
+
+	// end the session if it was not reclaimed in the meantime
+	private static void expire(String luName, Detached entry) {
+		synchronized(DetachedSessions.class) {
+			if (sessions.get(luName) != entry) { return; }
+			sessions.remove(luName);
+			logger.info("Session for LU '", luName, "' not reclaimed in time, ending it");
+		}
+		entry.filter.endDetachedSession();
+	}
+}
@@ -50,9 +50,10 @@ public class IntervalEnsurer {
 	 * If necessary wait until the default wait interval since the last event is elapsed,
 	 * recording the execution timestamp ("now", possibly after the wait period) as last 
 	 * registered event. 
+	 * @return the milliseconds waited.
 	 */
-	public void ensureOpsInterval() {
-		this.ensureOpsInterval(this.defaultInterval);
+	public long ensureOpsInterval() {
+		return this.ensureOpsInterval(this.defaultInterval);
 	}
 
 	/**
@@ -60,8 +61,9 @@ public class IntervalEnsurer {
 	 * recording the execution timestamp ("now", possibly after the wait period) as last 
 	 * registered event.
 	 * @param intervalMs the time interval that has to be elapsed since the last recorded event.
+	 * @return the milliseconds waited.
 	 */
-	public void ensureOpsInterval(long intervalMs) {
+	public long ensureOpsInterval(long intervalMs) {
 		long now = System.currentTimeMillis();
 		long delta = now - this.lastOpTS;
 		if (delta < intervalMs) {
@@ -73,8 +75,9 @@ public class IntervalEnsurer {
 				logger.error("ensureOpsInterval() => InterruptedException");
 			}
 			this.lastOpTS = System.currentTimeMillis();
-		} else {
-			this.lastOpTS = now;
+			return this.lastOpTS - now;
 		}
+		this.lastOpTS = now;
+		return 0;
 	}
 }
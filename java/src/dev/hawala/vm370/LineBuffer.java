@@ -14,8 +14,6 @@
 
 package dev.hawala.vm370;
 
-import java.util.ArrayList;
-
 import dev.hawala.vm370.ebcdic.Ebcdic;
 import dev.hawala.vm370.ebcdic.EbcdicHandler;
 
@@ -28,6 +26,10 @@ import dev.hawala.vm370.ebcdic.EbcdicHandler;
  * color or intensified) and the number of rows needed to display the line
  * on the temrinal's screen (e.g. 130 chars for the line on a 80 wide screen
  * gives 2 lines). 
+ * <p>
+ * The lines are kept in a ring of slots with primitive arrays for the attributes
+ * and row counts, the byte array of a slot is reused when the ring wraps, so appending
+ * lines does not allocate once the line buffer has reached its maximal size.
  * 
  * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
  */
@@ -39,10 +41,14 @@ public class LineBuffer {
 	
 	private final int maxLineLength;
 	
+	private static final int InitialSlots = 256;
+	
 	private int currSize = 0;
-	private ArrayList<byte[]> lines = new ArrayList<byte[]>(); // the texts for the lines
-	private ArrayList<Byte> attrs = new ArrayList<Byte>();     // the attributes for the lines
-	private ArrayList<Integer> rows = new ArrayList<Integer>();// the number of display lines needed for each line
+	private int first = 0;                    // slot of the oldest line in the ring
+	private byte[][] lines = new byte[0][];   // the texts for the lines (slot arrays are reused)
+	private int[] lengths = new int[0];       // the text lengths for the lines
+	private byte[] attrs = new byte[0];       // the attributes for the lines
+	private int[] rows = new int[0];          // the number of display lines needed for each line
 	
 	private int lastVisible = 0;
 	private int countVisible = 0;
@@ -73,6 +79,36 @@ public class LineBuffer {
 		this.colsInRow = Math.max(1, colsInRow);
 		this.rowsInPage = rowsInPage;
 		this.maxLineLength = this.colsInRow * this.rowsInPage;
+		this.grow();
+	}
+	
+	// get the ring slot for the logical line index (0 = oldest line)
+	private int slot(int idx) {
+		int s = this.first + idx;
+		return (s >= this.lines.length) ? s - this.lines.length : s;
+	}
+	
+	// enlarge the ring (geometrically up to 'maxSize' slots), unwrapping it to start at slot 0
+	private void grow() {
+		int oldCapacity = this.lines.length;
+		int newCapacity = (int)Math.min((long)this.maxSize, Math.max((long)InitialSlots, 2L * oldCapacity));
+		if (newCapacity <= oldCapacity) { return; }
+		byte[][] newLines = new byte[newCapacity][];
+		int[] newLengths = new int[newCapacity];
+		byte[] newAttrs = new byte[newCapacity];
+		int[] newRows = new int[newCapacity];
+		for (int i = 0; i < oldCapacity; i++) {
+			int s = this.slot(i);
+			newLines[i] = this.lines[s];
+			newLengths[i] = this.lengths[s];
+			newAttrs[i] = this.attrs[s];
+			newRows[i] = this.rows[s];
+		}
+		this.lines = newLines;
+		this.lengths = newLengths;
+		this.attrs = newAttrs;
+		this.rows = newRows;
+		this.first = 0;
 	}
 	
 	/**
@@ -85,21 +121,27 @@ public class LineBuffer {
 	 */
 	public int append(byte[] line, int offset, int count, byte flags) {
 		if (this.currSize >= this.maxSize) {
-			this.lines.remove(0);
-			this.attrs.remove(0);
-			this.rows.remove(0);
+			// drop the oldest line, its slot will be reused for the new line
+			this.first = this.slot(1);
 			this.currSize--;
+		} else if (this.currSize >= this.lines.length) {
+			this.grow();
 		}
 		offset = Math.max(0, Math.min(line.length - 1, offset));
 		count = Math.min(this.maxLineLength, Math.max(0, Math.min(line.length - offset, count)));
-		byte[] tmp = new byte[count];
-		for (int i = 0; i < count; i++) { tmp[i] = line[offset + i]; } 
-		this.lines.add(tmp);
+		int s = this.slot(this.currSize);
+		byte[] tmp = this.lines[s];
+		if (tmp == null || tmp.length < count) {
+			tmp = new byte[Math.max(count, this.colsInRow)];
+			this.lines[s] = tmp;
+		}
+		System.arraycopy(line, offset, tmp, 0, count);
+		this.lengths[s] = count;
 		this.currSize++;
 		
 		int rows = ((count - 1) / this.colsInRow) + 1;
-		this.attrs.add(flags);
-		this.rows.add(rows);
+		this.attrs[s] = flags;
+		this.rows[s] = rows;
 		
 		this.lastVisible = this.currSize + 2;
 		this.recomputeVisibleFrame();
@@ -128,13 +170,19 @@ public class LineBuffer {
 		return this.append(ebcdicChars, 0, ebcdicChars.length, flags);
 	}
 	
+	/**
+	 * Get the number of lines currently held in the line buffer.
+	 * @return the number of lines.
+	 */
+	public int getSize() {
+		return this.currSize;
+	}
+	
 	/**
 	 * Clear all lines and reset the line buffer states to empty.
 	 */
 	public void clear() {
-		this.lines.clear();
-		this.attrs.clear();
-		this.rows.clear();
+		this.first = 0;
 		this.currSize = 0;
 		this.lastVisible = 0;
 		this.countVisible = 0;
@@ -152,12 +200,8 @@ public class LineBuffer {
 			return;
 		}
 		
-		int toKeepFrom = this.attrs.size() - keep;
-		int toKeepTo = toKeepFrom + keep;
-		
-		this.lines = new ArrayList<byte[]>(this.lines.subList(toKeepFrom, toKeepTo));
-		this.attrs = new ArrayList<Byte>(this.attrs.subList(toKeepFrom, toKeepTo));
-		this.rows = new ArrayList<Integer>(this.rows.subList(toKeepFrom, toKeepTo));
+		keep = Math.min(keep, this.currSize);
+		this.first = this.slot(this.currSize - keep);
 		this.currSize = keep;
 		this.lastVisible = 0;
 		this.recomputeVisibleFrame();
@@ -170,9 +214,9 @@ public class LineBuffer {
 	public void pageTowardsYoungest() {
 		int newRowsVisible = 0;
 		while((this.lastVisible + 1) < this.currSize) {
-			if ((newRowsVisible + this.rows.get(this.lastVisible + 1)) <= this.rowsInPage) {
+			if ((newRowsVisible + this.rows[this.slot(this.lastVisible + 1)]) <= this.rowsInPage) {
 				this.lastVisible++;
-				newRowsVisible += this.rows.get(this.lastVisible);
+				newRowsVisible += this.rows[this.slot(this.lastVisible)];
 			} else {
 				break;
 			}
@@ -209,19 +253,25 @@ public class LineBuffer {
 	
 	/**
 	 * Get the current frame of lines to display.
-	 * @param toLines the list for the line contents where to add the lines of the frame.
-	 * @param toFlags the list for the attributes of the lines in the frame. 
+	 * <p>
+	 * The line contents are the internal byte arrays of the line buffer (with
+	 * possibly more bytes than the line length), which must not be modified and
+	 * are only valid until the next line is appended.
+	 * @param toLines the array (with at least <code>rowsInPage</code> elements) where
+	 *   to put the line contents of the frame.
+	 * @param toLengths the array for the lengths of the lines in the frame.
+	 * @param toFlags the array for the attributes of the lines in the frame. 
 	 * @return the number of lines ion the frame.
 	 */
-	public int getPageLinesAndFlags(ArrayList<byte[]> toLines, ArrayList<Byte> toFlags) {
+	public int getPageLinesAndFlags(byte[][] toLines, int[] toLengths, byte[] toFlags) {
 		int lineCount = this.countVisible;
 		
-		toLines.clear();
-		toFlags.clear();
-		
-		for (int i = this.lastVisible - lineCount + 1; i <= this.lastVisible; i++) {
-			toLines.add(this.lines.get(i));
-			toFlags.add(this.attrs.get(i));
+		int j = 0;
+		for (int i = this.lastVisible - lineCount + 1; i <= this.lastVisible; i++, j++) {
+			int s = this.slot(i);
+			toLines[j] = this.lines[s];
+			toLengths[j] = this.lengths[s];
+			toFlags[j] = this.attrs[s];
 		}		
 		return lineCount;
 	}
@@ -234,10 +284,11 @@ public class LineBuffer {
 	 * @param toFlag attribute to replace with.
 	 */
 	public void updateLastLineFlags(int count, byte fromFlag, byte toFlag) {
-	  int idx = this.attrs.size() - 1;
+	  int idx = this.currSize - 1;
 	  while(count > 0 && idx > 0) {
-		  if (this.attrs.get(idx) == fromFlag) {
-			  this.attrs.set(idx, toFlag);
+		  int s = this.slot(idx);
+		  if (this.attrs[s] == fromFlag) {
+			  this.attrs[s] = toFlag;
 		  }
 		  count--;
 		  idx --;
@@ -254,13 +305,14 @@ public class LineBuffer {
 		this.countVisible = 0;
 		this.rowsVisible = 0;
 		
+		if (this.currSize == 0) { this.lastVisible = 0; return; }
 		if (this.lastVisible < 1) { this.lastVisible = 0; }
 		if (this.lastVisible >= this.currSize) { this.lastVisible = this.currSize - 1; }
 		
 		for (firstVisible = this.lastVisible; firstVisible >= 0; firstVisible--) {
-			if ((this.rowsVisible + this.rows.get(firstVisible)) <= this.rowsInPage) {
+			if ((this.rowsVisible + this.rows[this.slot(firstVisible)]) <= this.rowsInPage) {
 				this.countVisible++;
-				this.rowsVisible += this.rows.get(firstVisible);
+				this.rowsVisible += this.rows[this.slot(firstVisible)];
 			} else {
 				break;
 			}
@@ -270,12 +322,12 @@ public class LineBuffer {
 
 		this.lastVisible = 0;
 		this.countVisible = 1;
-		this.rowsVisible = this.rows.get(this.lastVisible);
+		this.rowsVisible = this.rows[this.slot(this.lastVisible)];
 		while((this.lastVisible + 1) < this.currSize) {
-			if ((this.rowsVisible + this.rows.get(this.lastVisible + 1)) <= this.rowsInPage) {
+			if ((this.rowsVisible + this.rows[this.slot(this.lastVisible + 1)]) <= this.rowsInPage) {
 				this.lastVisible++;
 				this.countVisible++;
-				this.rowsVisible += this.rows.get(this.lastVisible);
+				this.rowsVisible += this.rows[this.slot(this.lastVisible)];
 			} else {
 				break;
 			}
@@ -16,10 +16,17 @@ package dev.hawala.vm370;
 
 import java.util.ArrayList;
 import java.util.HashMap;
-import java.util.Map;import java.io.File;
+import java.util.Map;
+import java.io.BufferedOutputStream;
+import java.io.File;
 import java.io.FileInputStream;
+import java.io.FileOutputStream;
 import java.io.IOException;
+import java.io.PrintStream;
 import java.util.Properties;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.LockSupport;
+
 import dev.hawala.vm370.ebcdic.EbcdicHandler;
 
 /**
@@ -30,6 +37,14 @@ import dev.hawala.vm370.ebcdic.EbcdicHandler;
  * Dynamic configuration is achieved by observing changes to the 
  * properties file <code>mecaff_logging.properties</code> in the 
  * classpath of the running program.
+ * <p>
+ * Issuing a message for a disabled level does not allocate anything as long
+ * as the fixed-arity methods (up to 6 parts) are used and no primitive values
+ * need to be boxed (use the <code>isXxx()</code> methods for guarding such calls
+ * on hot paths). The parts of an enabled message are passed unformatted through
+ * a lock-free ring buffer to a background writer thread, which formats the messages
+ * (including hex dumps) and writes them to <code>System.out</code> and/or a log file
+ * (properties <code>mecaff.logfile</code> and <code>mecaff.logconsole</code>).
  * 
  * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
  */
@@ -105,6 +120,245 @@ public class Log {
 		}
 	}
 	
+	/*
+	 * asynchronous output of the log messages
+	 */
+
+	private static final int EntryText = 0;
+	private static final int EntryHex = 1;
+	private static final int EntrySeparate = 2;
+
+	private static final int InlineParts = 8;
+
+	/**
+	 * Slot in the ring buffer, holding the unformatted parts of a log message.
+	 */
+	private static class LogEntry {
+		public volatile long seq = -1; // sequence number of the message held, published after filling the slot
+		public long claimedSeq; // sequence number the producer filling the slot will publish
+		public int kind;
+		public int level;
+		public Log log;
+		public String threadGroupName;
+		public Object[] parts = new Object[InlineParts];
+		public int partCount;
+		public String hexPrefix;
+		public String hexPostfix;
+		public byte[] hexBytes;
+		public boolean hexDoStr;
+	}
+
+	/**
+	 * Multi-producer/single-consumer ring buffer of log messages with the
+	 * background thread formatting and writing the messages.
+	 * <p>
+	 * A producer claims the next sequence number with an atomic increment, fills
+	 * the slot for this number and publishes it by setting the slot's sequence number;
+	 * the writer consumes the slots strictly in sequence. If the ring is full, the
+	 * producers wait for the writer instead of dropping messages.
+	 */
+	private static class AsyncWriter implements Runnable {
+
+		private static final int RingSize = 4096; // must be a power of 2
+		private static final int RingMask = RingSize - 1;
+
+		private final LogEntry[] ring = new LogEntry[RingSize];
+		private final AtomicLong nextSeq = new AtomicLong(0);
+		private volatile long consumedSeq = 0;
+
+		private final Thread thread;
+		private volatile boolean writerParked = false;
+
+		// the output sinks, only used by the writer thread after (re)configuration
+		private volatile boolean toConsole = true;
+		private volatile String logFileName = null;
+		private String openLogFileName = null;
+		private PrintStream logFile = null;
+
+		private final StringBuilder sb = new StringBuilder();
+
+		public AsyncWriter() {
+			for (int i = 0; i < RingSize; i++) { this.ring[i] = new LogEntry(); }
+			this.thread = new Thread(this, "MECAFF-Log");
+			this.thread.setDaemon(true);
+			this.thread.start();
+			Runtime.getRuntime().addShutdownHook(new Thread() {
+				public void run() { flush(2000); }
+			});
+		}
+
+		public void applyProps(Properties props) {
+			if (props == null) { return; }
+			String fn = props.getProperty("mecaff.logfile");
+			this.logFileName = (fn != null && fn.trim().length() > 0) ? fn.trim() : null;
+			String cons = props.getProperty("mecaff.logconsole");
+			this.toConsole = (cons == null || !cons.trim().toLowerCase().equals("false"));
+		}
+
+		// claim the next free slot, waiting if the ring is full
+		public LogEntry claim() {
+			long seq = this.nextSeq.getAndIncrement();
+			while(seq - this.consumedSeq >= RingSize) {
+				LockSupport.unpark(this.thread);
+				LockSupport.parkNanos(50000L);
+			}
+			LogEntry e = this.ring[(int)(seq & RingMask)];
+			e.claimedSeq = seq;
+			e.partCount = 0;
+			e.hexBytes = null;
+			e.hexPrefix = null;
+			e.hexPostfix = null;
+			return e;
+		}
+
+		// make a filled slot visible to the writer
+		public void publish(LogEntry e) {
+			e.seq = e.claimedSeq;
+			if (this.writerParked) { LockSupport.unpark(this.thread); }
+		}
+
+		// wait until all messages issued so far are written, at most the given time
+		public void flush(long maxWaitMs) {
+			long target = this.nextSeq.get();
+			long limit = System.currentTimeMillis() + maxWaitMs;
+			while(this.consumedSeq < target && System.currentTimeMillis() < limit) {
+				LockSupport.unpark(this.thread);
+				try { Thread.sleep(1); } catch (InterruptedException exc) { return; }
+			}
+		}
+
+		public void run() {
+			long seq = this.consumedSeq;
+			while(true) {
+				LogEntry e = this.ring[(int)(seq & RingMask)];
+				if (e.seq != seq) {
+					this.flushSinks();
+					this.writerParked = true;
+					if (e.seq != seq) { LockSupport.parkNanos(100000000L); } // re-check or max. 100 ms
+					this.writerParked = false;
+					continue;
+				}
+				try {
+					this.write(e);
+				} catch(Exception exc) {
+					// never let a broken message stop logging
+				}
+				e.log = null;
+				for (int i = 0; i < e.partCount; i++) { e.parts[i] = null; }
+				e.hexBytes = null;
+				seq++;
+				this.consumedSeq = seq;
+			}
+		}
+
+		private void write(LogEntry e) {
+			Log log = e.log;
+			if (e.kind == EntrySeparate) {
+				if (!log.lastSep) { this.println(""); }
+				log.lastSep = true;
+				return;
+			}
+
+			this.sb.setLength(0);
+			this.sb.append(e.threadGroupName).append(' ');
+			this.sb.append(log.prefixes[e.level]).append(": ");
+			this.sb.append(log.plainClassname).append(": ");
+			if (e.kind == EntryHex) {
+				this.sb.append(" [ ").append(e.hexBytes.length).append(" bytes ] ");
+				if (e.hexPrefix != null) { this.sb.append(e.hexPrefix); }
+				this.println(this.sb);
+				this.writeHex(e.hexBytes, e.hexDoStr);
+				if (e.hexPostfix != null) {
+					this.sb.setLength(0);
+					this.sb.append(e.threadGroupName).append(' ');
+					this.sb.append(log.prefixes[e.level]).append(": ");
+					this.sb.append(log.plainClassname).append(": ");
+					this.sb.append(e.hexPostfix);
+					this.println(this.sb);
+				}
+			} else {
+				for (int i = 0; i < e.partCount; i++) {
+					Object o = e.parts[i];
+					if (o == null) {
+						this.sb.append("<null>");
+					} else {
+						this.sb.append(o.toString());
+					}
+				}
+				this.println(this.sb);
+			}
+			log.lastSep = false;
+		}
+
+		private final StringBuilder hexSb = new StringBuilder();
+		private final StringBuilder strSb = new StringBuilder();
+		private static final char[] HexDigits = "0123456789ABCDEF".toCharArray();
+
+		private void writeHex(byte[] buffer, boolean doStr) {
+			int count = buffer.length;
+			for (int i = 0; i < count; i++) {
+				if ((i % 16) == 0) {
+					if ( i != 0) {
+						this.println(this.hexSb);
+						if (doStr) {
+							this.print("    Str:");
+							this.println(this.strSb);
+						}
+					}
+					this.strSb.setLength(0);
+					this.hexSb.setLength(0);
+					this.hexSb.append("    Hex: ");
+				}
+				if (buffer[i] >= (byte)0x20 && buffer[i] <= (byte)0x7F) {
+					this.strSb.append(" ").appendCodePoint(buffer[i]).append(" ");
+				} else {
+					this.strSb.append(" . ");
+				}
+				this.hexSb.append(' ').append(HexDigits[(buffer[i] >> 4) & 0x0F]).append(HexDigits[buffer[i] & 0x0F]);
+			}
+			if (count > 0) { this.println(this.hexSb); } else { this.println(""); }
+			if (doStr) {
+				this.print("    Str:");
+				this.println(this.strSb);
+			} else {
+				this.println("");
+			}
+		}
+
+		private void checkLogFile() {
+			String fn = this.logFileName;
+			if (fn == null ? this.openLogFileName == null : fn.equals(this.openLogFileName)) { return; }
+			if (this.logFile != null) { this.logFile.close(); }
+			this.logFile = null;
+			this.openLogFileName = fn;
+			if (fn == null) { return; }
+			try {
+				this.logFile = new PrintStream(new BufferedOutputStream(new FileOutputStream(fn, true), 16384), false);
+			} catch (IOException exc) {
+				System.out.println("***** ERROR - cannot open log file: " + fn);
+			}
+		}
+
+		private void print(CharSequence s) {
+			this.checkLogFile();
+			if (this.toConsole) { System.out.print(s); }
+			if (this.logFile != null) { this.logFile.print(s); }
+		}
+
+		private void println(CharSequence s) {
+			this.checkLogFile();
+			if (this.toConsole) { System.out.println(s); }
+			if (this.logFile != null) { this.logFile.println(s); }
+		}
+
+		private void flushSinks() {
+			if (this.toConsole) { System.out.flush(); }
+			if (this.logFile != null) { this.logFile.flush(); }
+		}
+	}
+
+	private static final AsyncWriter writer = new AsyncWriter();
+
 	private static Map<String, Log> allLogs = new HashMap<String, Log>();
 	
 	private static boolean restartFileWatcher = true;
@@ -118,6 +372,7 @@ public class Log {
 			}
 			currLogProps = props;
 		}
+		writer.applyProps(props);
 	}
 	
 	public static void watchLogConfiguration(String cfgFile) {
@@ -137,6 +392,7 @@ public class Log {
 			fileWatcher = null;
 			restartFileWatcher = false;
 		}
+		writer.flush(2000);
 	}
 	
 	public static Log getLogger() {
@@ -179,12 +435,11 @@ public class Log {
 	private final String plainClassname;
 	private final ArrayList<String> selectors = new ArrayList<String>(); 
 
-	private final StringBuilder sb = new StringBuilder();
-	
-	private boolean lastSep = false;
+	private boolean lastSep = false; // only used by the writer thread
 	
 	private Log(String forClass) {
 		this.forClass = forClass;
+		StringBuilder sb = new StringBuilder();
 		String[] pathElems = forClass.split("\\.");
 		for(int i = pathElems.length - 1; i >= 0; i--) {
 			sb.setLength(0);
@@ -224,31 +479,56 @@ public class Log {
 		}
 	}
 	
-	private void doWriteLn(int level, Object... parts) {
-		this.doOutput(level, parts);
+	// get a message part in a form that can be formatted later in the writer thread,
+	// i.e. immutable objects are passed as is, mutable ones are converted to string now
+	private static Object snapshot(Object o) {
+		if (o == null
+			|| o instanceof String
+			|| o instanceof Integer
+			|| o instanceof Long
+			|| o instanceof Short
+			|| o instanceof Byte
+			|| o instanceof Boolean
+			|| o instanceof Character
+			|| o instanceof Enum<?>) {
+			return o;
+		}
+		String s = o.toString();
+		if (s.length() > 48 && o instanceof EbcdicHandler) {
+			return s.substring(0,48) + "...";
+		}
+		return s;
+	}
+
+	private LogEntry claimEntry(int kind, int level) {
+		LogEntry e = writer.claim();
+		e.kind = kind;
+		e.level = level;
+		e.log = this;
+		ThreadGroup grp = Thread.currentThread().getThreadGroup();
+		e.threadGroupName = (grp != null) ? grp.getName() : "-";
+		return e;
+	}
+
+	private void doOutput(int level, int count, Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) {
+		LogEntry e = this.claimEntry(EntryText, level);
+		Object[] parts = e.parts;
+		parts[0] = snapshot(p1);
+		if (count > 1) { parts[1] = snapshot(p2); }
+		if (count > 2) { parts[2] = snapshot(p3); }
+		if (count > 3) { parts[3] = snapshot(p4); }
+		if (count > 4) { parts[4] = snapshot(p5); }
+		if (count > 5) { parts[5] = snapshot(p6); }
+		e.partCount = count;
+		writer.publish(e);
 	}
 	
 	private void doOutput(int level, Object[] parts) {
-		synchronized(this) {
-			sb.setLength(0);
-			sb.append(Thread.currentThread().getThreadGroup().getName()).append(' ');
-			sb.append(prefixes[level]).append(": ");
-			sb.append(this.plainClassname).append(": ");
-			for(Object o : parts) {
-				if (o == null) {
-					sb.append("<null>");
-					continue;
-				}
-				String s = o.toString();
-				if (s.length() > 48 && o instanceof EbcdicHandler) { 
-					sb.append(s.substring(0,48)).append("..."); 
-				} else {
-					sb.append(s);
-				}
-			}
-			System.out.println(sb.toString());
-		}
-		this.lastSep = false;
+		LogEntry e = this.claimEntry(EntryText, level);
+		if (e.parts.length < parts.length) { e.parts = new Object[parts.length]; }
+		for (int i = 0; i < parts.length; i++) { e.parts[i] = snapshot(parts[i]); }
+		e.partCount = parts.length;
+		writer.publish(e);
 	}
 	
 	public boolean isHex() { return (this.currLevel >= HEX); }
@@ -263,25 +543,64 @@ public class Log {
 	
 	public boolean isError() { return (this.currLevel >= ERROR); }
 		
+	/*
+	 * the fixed-arity variants avoid allocating the varargs array for disabled levels
+	 */
+
+	public void trace(Object p1) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 1, p1, null, null, null, null, null); } }
+	public void trace(Object p1, Object p2) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 2, p1, p2, null, null, null, null); } }
+	public void trace(Object p1, Object p2, Object p3) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 3, p1, p2, p3, null, null, null); } }
+	public void trace(Object p1, Object p2, Object p3, Object p4) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 4, p1, p2, p3, p4, null, null); } }
+	public void trace(Object p1, Object p2, Object p3, Object p4, Object p5) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 5, p1, p2, p3, p4, p5, null); } }
+	public void trace(Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) { if (this.currLevel >= TRACE) { this.doOutput(TRACE, 6, p1, p2, p3, p4, p5, p6); } }
+
 	public void trace(Object... parts) {
 		if (this.currLevel < TRACE) { return; }
 		this.doOutput(TRACE, parts);
 	}
+
+	public void debug(Object p1) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 1, p1, null, null, null, null, null); } }
+	public void debug(Object p1, Object p2) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 2, p1, p2, null, null, null, null); } }
+	public void debug(Object p1, Object p2, Object p3) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 3, p1, p2, p3, null, null, null); } }
+	public void debug(Object p1, Object p2, Object p3, Object p4) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 4, p1, p2, p3, p4, null, null); } }
+	public void debug(Object p1, Object p2, Object p3, Object p4, Object p5) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 5, p1, p2, p3, p4, p5, null); } }
+	public void debug(Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) { if (this.currLevel >= DEBUG) { this.doOutput(DEBUG, 6, p1, p2, p3, p4, p5, p6); } }
 	
 	public void debug(Object... parts) {
 		if (this.currLevel < DEBUG) { return; }	
 		this.doOutput(DEBUG, parts);
 	}
 	
+	public void info(Object p1) { if (this.currLevel >= INFO) { this.doOutput(INFO, 1, p1, null, null, null, null, null); } }
+	public void info(Object p1, Object p2) { if (this.currLevel >= INFO) { this.doOutput(INFO, 2, p1, p2, null, null, null, null); } }
+	public void info(Object p1, Object p2, Object p3) { if (this.currLevel >= INFO) { this.doOutput(INFO, 3, p1, p2, p3, null, null, null); } }
+	public void info(Object p1, Object p2, Object p3, Object p4) { if (this.currLevel >= INFO) { this.doOutput(INFO, 4, p1, p2, p3, p4, null, null); } }
+	public void info(Object p1, Object p2, Object p3, Object p4, Object p5) { if (this.currLevel >= INFO) { this.doOutput(INFO, 5, p1, p2, p3, p4, p5, null); } }
+	public void info(Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) { if (this.currLevel >= INFO) { this.doOutput(INFO, 6, p1, p2, p3, p4, p5, p6); } }
+
 	public void info(Object... parts) {
 		if (this.currLevel < INFO) { return; }
 		this.doOutput(INFO, parts);
 	}
 	
+	public void warn(Object p1) { if (this.currLevel >= WARN) { this.doOutput(WARN, 1, p1, null, null, null, null, null); } }
+	public void warn(Object p1, Object p2) { if (this.currLevel >= WARN) { this.doOutput(WARN, 2, p1, p2, null, null, null, null); } }
+	public void warn(Object p1, Object p2, Object p3) { if (this.currLevel >= WARN) { this.doOutput(WARN, 3, p1, p2, p3, null, null, null); } }
+	public void warn(Object p1, Object p2, Object p3, Object p4) { if (this.currLevel >= WARN) { this.doOutput(WARN, 4, p1, p2, p3, p4, null, null); } }
+	public void warn(Object p1, Object p2, Object p3, Object p4, Object p5) { if (this.currLevel >= WARN) { this.doOutput(WARN, 5, p1, p2, p3, p4, p5, null); } }
+	public void warn(Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) { if (this.currLevel >= WARN) { this.doOutput(WARN, 6, p1, p2, p3, p4, p5, p6); } }
+
 	public void warn(Object... parts) {
 		if (this.currLevel < WARN) { return; }
 		this.doOutput(WARN, parts);
 	}
+
+	public void error(Object p1) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 1, p1, null, null, null, null, null); } }
+	public void error(Object p1, Object p2) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 2, p1, p2, null, null, null, null); } }
+	public void error(Object p1, Object p2, Object p3) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 3, p1, p2, p3, null, null, null); } }
+	public void error(Object p1, Object p2, Object p3, Object p4) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 4, p1, p2, p3, p4, null, null); } }
+	public void error(Object p1, Object p2, Object p3, Object p4, Object p5) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 5, p1, p2, p3, p4, p5, null); } }
+	public void error(Object p1, Object p2, Object p3, Object p4, Object p5, Object p6) { if (this.currLevel >= ERROR) { this.doOutput(ERROR, 6, p1, p2, p3, p4, p5, p6); } }
 	
 	public void error(Object... parts) {
 		if (this.currLevel < ERROR) { return; }
@@ -295,48 +614,24 @@ public class Log {
 	
 	public void logHexBuffer(String prefix, String postfix, byte[] buffer, int count, boolean doStr) {
 		if (this.currLevel < HEX) { return; }
-		if (prefix != null) {
-			this.doWriteLn(HEX, " [ ", count, " bytes ] ", prefix);
-		} else {
-			this.doWriteLn(HEX, " [ ", count, " bytes ] ");
-		}
 		
-		StringBuffer sb = new StringBuffer();
-		for (int i = 0; i < count; i++) {
-			if ((i % 16) == 0) { 
-				if ( i != 0) { 
-					System.out.println();
-					if (doStr) {
-						System.out.println("    Str:" + sb.toString());
-					}
-				}
-				sb.setLength(0);
-				System.out.print("    Hex: ");
-			}
-			if (buffer[i] >= (byte)0x20 && buffer[i] <= (byte)0x7F) {
-				sb.append(" ").appendCodePoint(buffer[i]).append(" ");
-			} else {
-				sb.append(" . ");
-			}
-			System.out.printf(" %02X", buffer[i]);
-		}
-		System.out.println();
-		if (doStr) {
-			System.out.println("    Str:" + sb.toString());
-		} else {
-			System.out.println();
-		}
+		// only copy the data here, the dump is formatted by the writer thread
+		count = Math.max(0, Math.min(count, buffer.length));
+		byte[] copy = new byte[count];
+		System.arraycopy(buffer, 0, copy, 0, count);
 		
-		if (postfix != null) {
-			this.doWriteLn(HEX, postfix); 
-		}
-		this.lastSep = false;
+		LogEntry e = this.claimEntry(EntryHex, HEX);
+		e.hexPrefix = prefix;
+		e.hexPostfix = postfix;
+		e.hexBytes = copy;
+		e.hexDoStr = doStr;
+		writer.publish(e);
 	}
 	
 	public void separate() {
 		if (this.currLevel < DEBUG) { return; }
-		if (!this.lastSep) { System.out.println(); }
-		this.lastSep = true;
+		LogEntry e = this.claimEntry(EntrySeparate, DEBUG);
+		writer.publish(e);
 	}
 
 }
@@ -14,12 +14,15 @@
 
 package dev.hawala.vm370;
 
+import java.io.File;
 import java.io.IOException;
 import java.net.ServerSocket;
 import java.net.Socket;
 import java.util.ArrayList;
 import java.util.List;
 
+import dev.hawala.vm370.stats.MecaffStats;
+
 /**
  * Main class for the MECAFF external process, starting background stream filter
  * instances based on the command line parameters. 
@@ -142,26 +145,35 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 			}
 			
 			// a terminal has connected..
-			try {
-				// open a new connection to the VM/370 host
-				Socket hostSideSocket = new Socket(hostName, hostPort);
-				int connNo = nextConnectionNo();
-				logger.info("New terminal connection initiated => conn. no.:", connNo);
+			int connNo = nextConnectionNo();
+			logger.info("New terminal connection initiated => conn. no.:", connNo);
+			
+			// setup the session in a separate thread, so slow terminals
+			// do not delay the next terminals connecting 
+			this.startSessionSetup(connNo, terminalSideSocket);
+		}
+	}
+	
+	// start the thread opening the host connection and creating the stream filter for a new terminal
+	private void startSessionSetup(final int connNo, final Socket terminalSideSocket) {
+		final IConnectionClosedSink closedSink = this;
+		Runnable setup = new Runnable() {
+			public void run() {
+				// open a new connection to the VM/370 host in the background
+				Socket hostSideSocket = new AsyncConnectSocket(hostName, hostPort);
 				
 				// create a new stream filter connecting the 2 sockets, this will
-				// do the necessary telnet negotiations, create a MECAFF console and
+				// do the necessary telnet negotiations (with the terminal while
+				// the host connection is established), create a MECAFF console and
 				// startup the transmission machinery until on eof the sockets is closed.
-				BaseStreamFilter newFilter = this.creator.create(connNo, terminalSideSocket, hostSideSocket, luName, noDynamic, sendDelayMs, minColorCount, this);
-				addActiveFilter(newFilter);
-			} catch (IOException exc) {
-				logger.error("** Unable to setup MECAFF connection to VM/370-Host '", this.hostName, "', Port ", hostPort);
-				try {
-					terminalSideSocket.close();
-				} catch (Exception subExc) {
-					// ignore any sub-exception when cleaning up
+				BaseStreamFilter newFilter = creator.create(connNo, terminalSideSocket, hostSideSocket, luName, noDynamic, sendDelayMs, minColorCount, closedSink);
+				if (!newFilter.isClosed()) {
+					addActiveFilter(newFilter);
 				}
 			}
-		}
+		};
+		Thread thread = new Thread(this.thread.getThreadGroup(), setup, String.format("setup{%02d}", connNo));
+		thread.start();
 	}
 	
 	@Override
@@ -199,6 +211,29 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 				"\n  -minColorCount:<n> => minimal number of colors the emulator must support" +
 				"\n                        to be recognized as a color terminal (3..9)" +
 				"\n                        (Default: 4)" +
+				"\n  -handshakeGap:<n>  => minimal delay in ms between 2 internal transmissions" +
+				"\n                        to VM in GRAF-mode (0..100)" +
+				"\n                        (Default: " + Tn3270StreamFilter.DefaultMinHandshakeGapMs + ")" +
+				"\n  -inputGap:<n>      => minimal delay in ms between 2 user input transmissions" +
+				"\n                        to VM in GRAF-mode (0..2000)" +
+				"\n                        (Default: " + Tn3270StreamFilter.DefaultMinInteractionGapMs + ")" +
+				"\n  -queryCache:<n>    => seconds to remember the WSF-query reply of an emulator" +
+				"\n                        for its next connection, 0 to always query (0..86400)" +
+				"\n                        (use only if each emulator has its own address;" +
+				"\n                        IBM-DYNAMIC terminals are always queried)" +
+				"\n                        (Default: " + TerminalPropertiesCache.DefaultTimeToLiveSecs + ")" +
+				"\n  -detachTime:<n>    => seconds to keep the VM session of a terminal with LU name" +
+				"\n                        after its connection dropped, for the terminal to" +
+				"\n                        reconnect, 0 to end the session at once (0..86400)" +
+				"\n                        (Default: " + DetachedSessions.DefaultGracePeriodSecs + ")" +
+				"\n  -traceDir:<dir>    => record the data of each connection to a trace file" +
+				"\n                        in this directory (for replaying the session)" +
+				"\n                        WARNING: traces hold the raw terminal input," +
+				"\n                        including passwords typed at LOGON" +
+				"\n                        (Default: no tracing)" +
+				"\n  -statsPort:<num>   => port on localhost where the connection statistics" +
+				"\n                        can be read as plain text (also available as JMX MBeans)" +
+				"\n                        (Default: no statistics port)" +
 				"\n  -dumpParms         => output connection parameters before starting"
 				);
 	}
@@ -212,6 +247,12 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 	private static final String PSendDelay = "-senddelay:";
 	private static final String PMinColorCount = "-mincolorcount:";
 	private static final String PDo = "-do:";
+	private static final String PHandshakeGap = "-handshakegap:";
+	private static final String PInputGap = "-inputgap:";
+	private static final String PTraceDir = "-tracedir:";
+	private static final String PQueryCache = "-querycache:";
+	private static final String PDetachTime = "-detachtime:";
+	private static final String PStatsPort = "-statsport:";
 	
 	/** Main program routine 
 	 * @param args command line parameters.
@@ -233,6 +274,12 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 		boolean noDynamic = false;
 		short sendDelay = 0;
 		short minColorCount = 4;
+		short handshakeGap = Tn3270StreamFilter.DefaultMinHandshakeGapMs;
+		short inputGap = Tn3270StreamFilter.DefaultMinInteractionGapMs;
+		File traceDir = null;
+		int queryCacheSecs = TerminalPropertiesCache.DefaultTimeToLiveSecs;
+		int detachTimeSecs = DetachedSessions.DefaultGracePeriodSecs;
+		int statsPort = 0;
 		boolean doListParms = false;
 		boolean hadErrors = false;
 		
@@ -270,6 +317,12 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 			} else if (a.startsWith(PMinColorCount)) {
 				minColorCount = (short)parseNumeric(arg, PMinColorCount, "count", 3, 8);
 				hadErrors |= (minColorCount < 0);
+			} else if (a.startsWith(PHandshakeGap)) {
+				handshakeGap = (short)parseNumeric(arg, PHandshakeGap, "ms", 0, 100);
+				hadErrors |= (handshakeGap < 0);
+			} else if (a.startsWith(PInputGap)) {
+				inputGap = (short)parseNumeric(arg, PInputGap, "ms", 0, 2000);
+				hadErrors |= (inputGap < 0);
 			} else if (a.startsWith(PDo)) {
 				String val = parseName(a, PDo);
 				if (val == null) {
@@ -289,6 +342,25 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 				}
 			} else if (a.equals(PNoDYNAMIC)) {
 				noDynamic = true;
+			} else if (a.startsWith(PQueryCache)) {
+				queryCacheSecs = parseNumeric(arg, PQueryCache, "seconds", 0, 86400);
+				hadErrors |= (queryCacheSecs < 0);
+			} else if (a.startsWith(PDetachTime)) {
+				detachTimeSecs = parseNumeric(arg, PDetachTime, "seconds", 0, 86400);
+				hadErrors |= (detachTimeSecs < 0);
+			} else if (a.startsWith(PStatsPort)) {
+				statsPort = parsePort(a, PStatsPort, 1024);
+				hadErrors |= (statsPort < 0);
+			} else if (a.startsWith(PTraceDir)) {
+				String dir = parseName(a, PTraceDir);
+				if (dir != null) {
+					traceDir = new File(arg.substring(PTraceDir.length()));
+					if (!traceDir.isDirectory() && !traceDir.mkdirs()) {
+						System.out.println("Unable to create trace directory '" + traceDir.getPath() + "'");
+						dir = null;
+					}
+				}
+				hadErrors |= (dir == null);
 			} else {
 				System.out.println("Unknown parameter ignored: '" + arg + "'");
 			}
@@ -316,6 +388,12 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 					"\n  noDYNAMIC       : " + noDynamic +
 					"\n  sendDelay       : " + sendDelay +
 					"\n  minColorCount   : " + minColorCount +
+					"\n  handshakeGap    : " + handshakeGap +
+					"\n  inputGap        : " + inputGap +
+					"\n  queryCache      : " + queryCacheSecs +
+					"\n  detachTime      : " + detachTimeSecs +
+					"\n  traceDir        : " + ((traceDir != null) ? traceDir.getPath() : "-   (no tracing)") +
+					"\n  statsPort       : " + ((statsPort > 0) ? statsPort : "-   (no statistics port)") +
 					"\n"
 					);
 		}
@@ -323,7 +401,24 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 		/* get our logger */
 		logger = Log.getLogger();
 		
+		/* enable recording the connections if requested */
+		SessionTrace.setDirectory(traceDir);
+		
+		/* set how long terminal characteristics are remembered */
+		TerminalPropertiesCache.setTimeToLive(queryCacheSecs);
+		
+		/* set how long sessions of dropped terminals are kept */
+		DetachedSessions.setGracePeriod(detachTimeSecs);
+		
+		/* publish the connection statistics */
+		MecaffStats.enableJmx();
+		if (statsPort > 0) {
+			MecaffStats.startTextEndpoint(statsPort);
+		}
+		
 		/* start MECAFF-listener for GRAF-mode */
+		final short minHandshakeGapMs = handshakeGap;
+		final short minInteractionGapMs = inputGap;
 		IFilterCreator filterCreator3270 = new IFilterCreator() {
 			public String getFilterName() { return "GRAF"; }
 			public BaseStreamFilter create(
@@ -343,6 +438,8 @@ public class Mecaff implements Runnable, IConnectionClosedSink {
 								noDynamic, 
 								sendDelayMs, 
 								minColorCount, 
+								minHandshakeGapMs,
+								minInteractionGapMs,
 								closedSink);
 			}
 		};
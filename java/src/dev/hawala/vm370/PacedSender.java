@@ -0,0 +1,257 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.util.concurrent.ScheduledFuture;
+
+import dev.hawala.vm370.transport.BufferPool;
+
+/**
+ * Send queue for an output stream ensuring a minimal time interval between
+ * 2 consecutive records written to the stream, without blocking the thread
+ * enqueuing the record.
+ * <p>
+ * A record is written immediately if the queue is empty and the requested interval
+ * since the last event has elapsed, else it is enqueued and written in FIFO order
+ * when its interval has elapsed, using the process-wide <code>TimeoutScheduler</code>.
+ * <br/>
+ * As the records are written asynchronously, an I/O error writing a record is
+ * reported with the next record sent; all records queued at the time of the error
+ * are dropped.
+ * <br/>
+ * A queued record is copied to a byte array from the <code>BufferPool</code>, which
+ * is given back after the record was written, so the caller can reuse its buffer
+ * for the next record.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class PacedSender {
+
+	private static Log logger = Log.getLogger();
+
+	/**
+	 * Internal class of chained records to be written.
+	 */
+	private static class Record {
+		public final byte[] data;
+		public final int length;
+		public final long minIntervalMs;
+		public final IVm3270ConsoleCompletedSink writtenCallBack;
+		public Record next = null;
+
+		public Record(byte[] data, int length, long minIntervalMs, IVm3270ConsoleCompletedSink writtenCallBack) {
+			this.data = data;
+			this.length = length;
+			this.minIntervalMs = minIntervalMs;
+			this.writtenCallBack = writtenCallBack;
+		}
+	}
+
+	private final OutputStream os;
+	private final String prefix;
+
+	private Record queuedRecords = null;
+	private Record queuedTail = null;
+
+	/** timestamp of the last event (record written or external event logged) */
+	private long lastOpTS = System.currentTimeMillis();
+
+	private ScheduledFuture<?> drainDeadline = null;
+	private IOException failure = null;
+	private boolean closed = false;
+
+	private final Runnable drainer = new Runnable() {
+		public void run() {
+			Record written;
+			synchronized(PacedSender.this) {
+				drainDeadline = null;
+				written = drainQueue();
+			}
+			try {
+				notifyWritten(written);
+			} catch (IOException exc) {
+				logger.error(prefix, " IOException in callback for paced record: ", exc.getMessage());
+			}
+		}
+	};
+
+	/**
+	 * Construct the instance for pacing the records written to the given stream.
+	 * @param os the stream to write the records to.
+	 * @param prefix a text to prepend to logged messages.
+	 */
+	public PacedSender(OutputStream os, String prefix) {
+		this.os = os;
+		this.prefix = prefix;
+	}
+
+	/**
+	 * Register an event without sending, setting the time stamp of the last event
+	 * from which the interval for the next record to write will be computed.
+	 */
+	public void logOp() {
+		synchronized(this) {
+			this.lastOpTS = System.currentTimeMillis();
+		}
+	}
+
+	/**
+	 * Write a record to the stream as soon as the specified interval since the
+	 * last event has elapsed and all previously enqueued records are written.
+	 * @param record the complete record to write.
+	 * @param minIntervalMs the time interval that has to be elapsed since the last
+	 *   event before writing the record.
+	 * @throws IOException if writing a previous record failed or the sender is closed.
+	 */
+	public void send(byte[] record, long minIntervalMs) throws IOException {
+		this.send(record, 0, record.length, minIntervalMs, null);
+	}
+
+	/**
+	 * Write a record to the stream as soon as the specified interval since the
+	 * last event has elapsed and all previously enqueued records are written.
+	 * <p>
+	 * The record is written directly from the given buffer if possible, else it is
+	 * copied to a pooled buffer, so the caller's buffer is free again when this
+	 * method returns.
+	 * @param buffer the buffer holding the complete record to write.
+	 * @param offset the offset of the record in the buffer.
+	 * @param length the length of the record.
+	 * @param minIntervalMs the time interval that has to be elapsed since the last
+	 *   event before writing the record.
+	 * @param writtenCallBack the callback (possibly <code>null</code>) to invoke after
+	 *   the record was written and flushed to the stream, this may be in an other thread
+	 *   and is not done if the record is dropped.
+	 * @throws IOException if writing a previous record failed or the sender is closed.
+	 */
+	public void send(byte[] buffer, int offset, int length, long minIntervalMs,
+			IVm3270ConsoleCompletedSink writtenCallBack) throws IOException {
+		Record written;
+		synchronized(this) {
+			if (this.failure != null) { throw this.failure; }
+			if (this.closed) { throw new IOException("PacedSender is closed"); }
+
+			if (this.queuedRecords == null
+					&& (System.currentTimeMillis() - this.lastOpTS) >= minIntervalMs) {
+				// nothing pending and interval elapsed: write without copying
+				this.writeRecord(buffer, offset, length);
+				if (this.failure != null) { throw this.failure; }
+				written = null;
+			} else {
+				byte[] data = BufferPool.acquire(length);
+				System.arraycopy(buffer, offset, data, 0, length);
+				Record newRecord = new Record(data, length, minIntervalMs, writtenCallBack);
+				writtenCallBack = null;
+				if (this.queuedTail == null) {
+					this.queuedRecords = newRecord;
+					this.queuedTail = newRecord;
+				} else {
+					this.queuedTail.next = newRecord;
+					this.queuedTail = newRecord;
+				}
+
+				written = (this.drainDeadline == null) ? this.drainQueue() : null;
+			}
+		}
+		if (writtenCallBack != null) { writtenCallBack.transferCompleted(); }
+		this.notifyWritten(written);
+	}
+
+	/**
+	 * Stop sending, dropping all pending records.
+	 */
+	public void close() {
+		synchronized(this) {
+			this.closed = true;
+			this.dropQueue();
+			this.drainDeadline = TimeoutScheduler.cancel(this.drainDeadline);
+		}
+	}
+
+	// write a record to the stream, recording an I/O error as failure
+	// MUST be called inside synchronized(this)
+	private void writeRecord(byte[] data, int offset, int length) {
+		try {
+			this.os.write(data, offset, length);
+			this.os.flush();
+		} catch (IOException exc) {
+			logger.error(this.prefix, " IOException while sending paced record: ", exc.getMessage());
+			this.failure = exc;
+			this.dropQueue();
+			return;
+		}
+		this.lastOpTS = System.currentTimeMillis();
+	}
+
+	// drop all queued records, giving back their buffers
+	// MUST be called inside synchronized(this)
+	private void dropQueue() {
+		Record rec = this.queuedRecords;
+		while(rec != null) {
+			BufferPool.release(rec.data);
+			rec = rec.next;
+		}
+		this.queuedRecords = null;
+		this.queuedTail = null;
+	}
+
+	// write all records whose interval has elapsed, arming the timeout for the next one,
+	// returning the chain of written records having a callback
+	// MUST be called inside synchronized(this)
+	private Record drainQueue() {
+		Record written = null;
+		Record writtenTail = null;
+		while(this.queuedRecords != null && !this.closed) {
+			Record currRecord = this.queuedRecords;
+			long now = System.currentTimeMillis();
+			long delta = now - this.lastOpTS;
+			if (delta < currRecord.minIntervalMs) {
+				long waitTime = currRecord.minIntervalMs - delta;
+				logger.debug(this.prefix, " ensuring i/o interval ( ", currRecord.minIntervalMs, " ms => deferring ", waitTime, " ms)");
+				this.drainDeadline = TimeoutScheduler.schedule(waitTime, this.drainer);
+				return written;
+			}
+
+			this.queuedRecords = currRecord.next;
+			if (this.queuedRecords == null) { this.queuedTail = null; }
+			currRecord.next = null;
+
+			this.writeRecord(currRecord.data, 0, currRecord.length);
+			BufferPool.release(currRecord.data);
+			if (this.failure != null) { return null; }
+
+			if (currRecord.writtenCallBack != null) {
+				if (writtenTail == null) {
+					written = currRecord;
+				} else {
+					writtenTail.next = currRecord;
+				}
+				writtenTail = currRecord;
+			}
+		}
+		return written;
+	}
+
+	// invoke the callbacks of the written records
+	// MUST NOT be called inside synchronized(this), as the callbacks may lock other objects
+	private void notifyWritten(Record written) throws IOException {
+		while(written != null) {
+			written.writtenCallBack.transferCompleted();
+			written = written.next;
+		}
+	}
+}
@@ -0,0 +1,356 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.FilterInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.text.SimpleDateFormat;
+import java.util.Date;
+
+/**
+ * Recorder for the data received by a stream filter from the terminal and
+ * from the host, written to a compact binary trace file allowing to replay
+ * the session later without terminal and host.
+ * <p>
+ * Tracing is off by default and is enabled for all new connections by setting
+ * a trace directory (MECAFF command line parameter <code>-traceDir:</code>),
+ * each connection then writing its own file <code>mecaff-&lt;timestamp&gt;-&lt;connNo&gt;.trc</code>.
+ * <p>
+ * A trace file starts with a header consisting of:
+ * <ul>
+ * <li>the magic <code>MECAFFTR</code> (8 ASCII bytes) and the format version (1 byte)</li>
+ * <li>the connection number (int) and the wall clock time of the trace start (long, ms)</li>
+ * <li>the class name of the stream filter (as written by <code>DataOutputStream.writeUTF()</code>)</li>
+ * </ul>
+ * followed by the events, each having the event type (1 byte), the microseconds since
+ * the previous event (varint, from the monotonic <code>System.nanoTime()</code>), the data
+ * length (varint) and the data bytes. The event types are:
+ * <ul>
+ * <li><code>'T'</code>: data read from the terminal, length 0 meaning end of stream</li>
+ * <li><code>'H'</code>: data read from the host, length 0 meaning end of stream</li>
+ * <li><code>'P'</code>: a filter parameter as UTF-8 text <i>name</i><code>=</code><i>value</i></li>
+ * </ul>
+ * Varints are unsigned with 7 bits per byte, the least significant group first and the
+ * high bit set if a further byte follows.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class SessionTrace {
+
+	private static Log logger = Log.getLogger();
+
+	private static final String Magic = "MECAFFTR";
+	private static final int Version = 1;
+
+	/** Event type: data read from the terminal. */
+	public static final byte FromTerminal = (byte)'T';
+
+	/** Event type: data read from the host. */
+	public static final byte FromHost = (byte)'H';
+
+	/** Event type: filter parameter. */
+	public static final byte Parameter = (byte)'P';
+
+	private static volatile File traceDirectory = null;
+
+	/**
+	 * Set the directory where to write the trace files for new connections.
+	 * @param directory the trace directory or <code>null</code> to disable tracing.
+	 */
+	public static void setDirectory(File directory) {
+		traceDirectory = directory;
+	}
+
+	/**
+	 * Get the directory where the trace files for new connections are written.
+	 * @return the trace directory or <code>null</code> if tracing is disabled.
+	 */
+	public static File getDirectory() {
+		return traceDirectory;
+	}
+
+	/**
+	 * Create the trace for a new connection if tracing is enabled.
+	 * @param connectionNo the connection counter value of the filter.
+	 * @param filterName the class name of the stream filter.
+	 * @return the new trace or <code>null</code> if tracing is disabled or the
+	 *   trace file cannot be created.
+	 */
+	public static SessionTrace open(int connectionNo, String filterName) {
+		File directory = traceDirectory;
+		if (directory == null) { return null; }
+		String timestamp = new SimpleDateFormat("yyyyMMdd-HHmmss").format(new Date());
+		File file = new File(directory, String.format("mecaff-%s-%02d.trc", timestamp, connectionNo));
+		try {
+			SessionTrace trace = new SessionTrace(file, connectionNo, filterName);
+			logger.info("Tracing connection ", connectionNo, " to file: ", file.getPath());
+			return trace;
+		} catch (IOException exc) {
+			logger.error("** Unable to create trace file '", file.getPath(), "': ", exc.getMessage());
+			return null;
+		}
+	}
+
+	private final File file;
+	private final DataOutputStream out;
+	private final long startNanos;
+	private long lastMicros = 0;
+	private boolean closed = false;
+
+	private SessionTrace(File file, int connectionNo, String filterName) throws IOException {
+		this.file = file;
+		this.out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(file), 65536));
+		this.out.writeBytes(Magic);
+		this.out.writeByte(Version);
+		this.out.writeInt(connectionNo);
+		this.out.writeLong(System.currentTimeMillis());
+		this.out.writeUTF(filterName);
+		this.startNanos = System.nanoTime();
+	}
+
+	/**
+	 * Wrap an input stream of the filter so all data read is recorded.
+	 * @param is the input stream to wrap.
+	 * @param direction the event type for the data read (<code>FromTerminal</code>
+	 *   or <code>FromHost</code>).
+	 * @return the recording input stream.
+	 */
+	public InputStream wrap(InputStream is, byte direction) {
+		return new TracingInputStream(is, direction);
+	}
+
+	/**
+	 * Append an event to the trace.
+	 * @param type the event type.
+	 * @param data the byte array holding the event data.
+	 * @param offset the offset of the event data in <code>data</code>.
+	 * @param length the length of the event data.
+	 */
+	public synchronized void record(byte type, byte[] data, int offset, int length) {
+		if (this.closed) { return; }
+		try {
+			long micros = (System.nanoTime() - this.startNanos) / 1000;
+			this.out.writeByte(type);
+			writeVarint(this.out, Math.max(0, micros - this.lastMicros));
+			writeVarint(this.out, length);
+			this.out.write(data, offset, length);
+			this.lastMicros = Math.max(micros, this.lastMicros);
+		} catch (IOException exc) {
+			logger.error("** Error writing trace file '", this.file.getPath(), "', tracing stopped: ", exc.getMessage());
+			this.close();
+		}
+	}
+
+	/**
+	 * Append a filter parameter to the trace.
+	 * @param name the parameter name.
+	 * @param value the parameter value.
+	 */
+	public void recordParameter(String name, Object value) {
+		try {
+			byte[] text = (name + "=" + value).getBytes("UTF-8");
+			this.record(Parameter, text, 0, text.length);
+		} catch (IOException exc) {
+			// UTF-8 is always supported
+		}
+	}
+
+	/**
+	 * Write the pending events and close the trace file.
+	 */
+	public synchronized void close() {
+		if (this.closed) { return; }
+		this.closed = true;
+		try {
+			this.out.close();
+		} catch (IOException exc) {
+			logger.error("** Error closing trace file '", this.file.getPath(), "': ", exc.getMessage());
+		}
+	}
+
+	private static void writeVarint(OutputStream os, long value) throws IOException {
+		while (value > 0x7F) {
+			os.write((int)((value & 0x7F) | 0x80));
+			value >>>= 7;
+		}
+		os.write((int)value);
+	}
+
+	private static long readVarint(InputStream is) throws IOException {
+		long value = 0;
+		int shift = 0;
+		while (true) {
+			int b = is.read();
+			if (b < 0) { throw new EOFException("Truncated trace event"); }
+			value |= (long)(b & 0x7F) << shift;
+			if ((b & 0x80) == 0) { return value; }
+			shift += 7;
+			if (shift > 63) { throw new IOException("Invalid varint in trace"); }
+		}
+	}
+
+	/**
+	 * Input stream recording all data read from the wrapped stream
+	 * and the end of the stream.
+	 */
+	private class TracingInputStream extends FilterInputStream {
+
+		private final byte direction;
+		private final byte[] single = new byte[1];
+		private boolean atEnd = false;
+
+		public TracingInputStream(InputStream is, byte direction) {
+			super(is);
+			this.direction = direction;
+		}
+
+		private void endOfStream() {
+			if (this.atEnd) { return; }
+			this.atEnd = true;
+			record(this.direction, this.single, 0, 0);
+		}
+
+		@Override
+		public int read() throws IOException {
+			int b = super.read();
+			if (b >= 0) {
+				this.single[0] = (byte)b;
+				record(this.direction, this.single, 0, 1);
+			} else {
+				this.endOfStream();
+			}
+			return b;
+		}
+
+		@Override
+		public int read(byte[] b, int off, int len) throws IOException {
+			int count = super.read(b, off, len);
+			if (count > 0) {
+				record(this.direction, b, off, count);
+			} else if (count < 0) {
+				this.endOfStream();
+			}
+			return count;
+		}
+	}
+
+	/**
+	 * Sequential reader for the events of a trace file.
+	 */
+	public static class Reader {
+
+		private final DataInputStream in;
+
+		private final int connectionNo;
+		private final long startTime;
+		private final String filterName;
+
+		private byte type = 0;
+		private long timeMicros = 0;
+		private byte[] data = new byte[8192];
+		private int length = 0;
+
+		/**
+		 * Open the trace file and read its header.
+		 * @param file the trace file to read.
+		 * @throws IOException if the file cannot be read or is not a trace file.
+		 */
+		public Reader(File file) throws IOException {
+			this.in = new DataInputStream(new BufferedInputStream(new FileInputStream(file), 65536));
+			try {
+				byte[] magic = new byte[Magic.length()];
+				this.in.readFully(magic);
+				if (!Magic.equals(new String(magic, "US-ASCII"))) {
+					throw new IOException("Not a MECAFF trace file: " + file.getPath());
+				}
+				int version = this.in.readUnsignedByte();
+				if (version != Version) {
+					throw new IOException("Unsupported trace file version " + version + ": " + file.getPath());
+				}
+				this.connectionNo = this.in.readInt();
+				this.startTime = this.in.readLong();
+				this.filterName = this.in.readUTF();
+			} catch (IOException exc) {
+				this.in.close();
+				throw exc;
+			}
+		}
+
+		/** @return the connection number of the traced session. */
+		public int getConnectionNo() { return this.connectionNo; }
+
+		/** @return the wall clock time (ms) when the trace was started. */
+		public long getStartTime() { return this.startTime; }
+
+		/** @return the class name of the traced stream filter. */
+		public String getFilterName() { return this.filterName; }
+
+		/**
+		 * Read the next event.
+		 * @return <code>false</code> at the end of the trace (also if the last event
+		 *   is truncated, e.g. after a crash of the traced process).
+		 * @throws IOException
+		 */
+		public boolean next() throws IOException {
+			int t = this.in.read();
+			if (t < 0) { return false; }
+			try {
+				this.type = (byte)t;
+				this.timeMicros += readVarint(this.in);
+				long len = readVarint(this.in);
+				if (len > Integer.MAX_VALUE) { throw new IOException("Invalid trace event length"); }
+				this.length = (int)len;
+				if (this.length > this.data.length) { this.data = new byte[this.length]; }
+				this.in.readFully(this.data, 0, this.length);
+			} catch (EOFException exc) {
+				return false;
+			}
+			return true;
+		}
+
+		/** @return the type of the current event. */
+		public byte getType() { return this.type; }
+
+		/** @return the time of the current event in microseconds since the trace start. */
+		public long getTimeMicros() { return this.timeMicros; }
+
+		/** @return the buffer holding the data of the current event (reused by <code>next()</code>). */
+		public byte[] getData() { return this.data; }
+
+		/** @return the data length of the current event. */
+		public int getLength() { return this.length; }
+
+		/**
+		 * Close the trace file.
+		 */
+		public void close() {
+			try {
+				this.in.close();
+			} catch (IOException exc) {
+				// ignored
+			}
+		}
+	}
+}
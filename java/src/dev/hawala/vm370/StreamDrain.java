@@ -53,6 +53,7 @@ public class StreamDrain implements Runnable, IInterruptibleProcessor {
 	 */
 	public void setOtherDirectionFilter(IInterruptibleProcessor otherDirectionFilter) {
 		this.otherDirectionFilter = otherDirectionFilter;
+		this.otherDirectionIsClosing = false; // a new partner (e.g. a reconnected terminal) is running
 	}	
 
 	/**
@@ -75,7 +76,7 @@ public class StreamDrain implements Runnable, IInterruptibleProcessor {
 			transferred = this.inStream.read(buffer);
 			while(transferred >= 0) {
 				if (transferred > 0) {
-					logger.trace(this.connectionName, transferred, " Bytes");
+					if (logger.isTrace()) { logger.trace(this.connectionName, transferred, " Bytes"); }
 					this.sink.processBytes(buffer, transferred);
 				}
 				transferred = this.inStream.read(buffer);
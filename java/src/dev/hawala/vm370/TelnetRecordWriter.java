@@ -0,0 +1,142 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.io.IOException;
+import java.io.OutputStream;
+
+/**
+ * Writer assembling a complete telnet record in a reusable buffer before sending
+ * it with a single write to the connection's output stream, so each record goes
+ * out with one system call (and usually in one TCP segment).
+ * <p>
+ * The data written to this instance through the <code>OutputStream</code> methods
+ * is only collected, it is transmitted with <code>send()</code> resp. <code>sendRecord()</code>.
+ * <br/>
+ * This class is not synchronized: the owner must ensure that a record is assembled
+ * and sent by one thread at a time.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class TelnetRecordWriter extends OutputStream {
+
+	private static final byte IAC = (byte)0xFF;
+	private static final byte EOR = (byte)0xEF;
+
+	private final OutputStream os;
+
+	private byte[] buffer;
+	private int length = 0;
+
+	/**
+	 * Construct the writer for the given stream.
+	 * @param os the stream to send the records to.
+	 * @param initialCapacity the initial size of the record buffer, the buffer
+	 *   growing as necessary.
+	 */
+	public TelnetRecordWriter(OutputStream os, int initialCapacity) {
+		this.os = os;
+		this.buffer = new byte[Math.max(initialCapacity, 64)];
+	}
+
+	// grow the record buffer to have at least 'minFree' free bytes
+	private void ensureSpace(int minFree) {
+		int reqCapacity = this.length + minFree;
+		if (reqCapacity <= this.buffer.length) { return; }
+		int newCapacity = this.buffer.length * 2;
+		while (newCapacity < reqCapacity) { newCapacity *= 2; }
+		byte[] newBuffer = new byte[newCapacity];
+		System.arraycopy(this.buffer, 0, newBuffer, 0, this.length);
+		this.buffer = newBuffer;
+	}
+
+	@Override
+	public void write(int b) {
+		this.ensureSpace(1);
+		this.buffer[this.length++] = (byte)b;
+	}
+
+	@Override
+	public void write(byte[] b, int off, int len) {
+		if (len < 1) { return; }
+		this.ensureSpace(len);
+		System.arraycopy(b, off, this.buffer, this.length, len);
+		this.length += len;
+	}
+
+	/**
+	 * Append data to the record, escaping the telnet IAC code (0xFF) by doubling it.
+	 * @param b the byte array holding the data.
+	 * @param off the offset of the first byte to append.
+	 * @param len the number of bytes to append.
+	 * @return this instance for function call chaining.
+	 */
+	public TelnetRecordWriter appendEscaped(byte[] b, int off, int len) {
+		if (len < 1) { return this; }
+		this.ensureSpace(len * 2); // worst case: all bytes are IAC
+		byte[] buf = this.buffer;
+		int pos = this.length;
+		int end = off + len;
+		for (int i = off; i < end; i++) {
+			byte c = b[i];
+			buf[pos++] = c;
+			if (c == IAC) { buf[pos++] = IAC; }
+		}
+		this.length = pos;
+		return this;
+	}
+
+	/**
+	 * Get the number of bytes currently collected for the record.
+	 * @return the current record length.
+	 */
+	public int getLength() {
+		return this.length;
+	}
+
+	/**
+	 * Drop the data collected so far.
+	 */
+	public void reset() {
+		this.length = 0;
+	}
+
+	/**
+	 * Send the data collected so far with a single write, the writer being
+	 * empty afterwards (also if sending fails).
+	 * @throws IOException
+	 */
+	public void send() throws IOException {
+		if (this.length == 0) { return; }
+		try {
+			this.os.write(this.buffer, 0, this.length);
+			this.os.flush();
+		} finally {
+			this.length = 0;
+		}
+	}
+
+	/**
+	 * Terminate the record collected so far with the telnet EOR and send it
+	 * with a single write.
+	 * @throws IOException
+	 */
+	public void sendRecord() throws IOException {
+		this.ensureSpace(2);
+		this.buffer[this.length++] = IAC;
+		this.buffer[this.length++] = EOR;
+		this.send();
+	}
+}
@@ -0,0 +1,183 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.net.InetAddress;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+/**
+ * Cache for the terminal characteristics determined with a WSF-query, allowing
+ * a reconnecting terminal emulator to skip the query round-trip.
+ * <p>
+ * The entries are keyed by the terminal type name sent by the emulator (including
+ * an LU-name) and the address of the emulator's host, and expire after a time to
+ * live (MECAFF command line parameter <code>-queryCache:</code>), so a changed
+ * emulator configuration is picked up at the latest when the entry has expired.
+ * <br/>
+ * As different emulators may connect from the same address (e.g. through NAT or
+ * a tunnel), the cache is disabled unless a time to live is given explicitly.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class TerminalPropertiesCache {
+
+	/** Default time to live of the cache entries in seconds. */
+	public static final int DefaultTimeToLiveSecs = 0;
+
+	private static final int MaxEntries = 256;
+
+	/**
+	 * The terminal characteristics from the reply to a WSF-query.
+	 */
+	public static class Entry {
+		public final boolean adr14bit;
+		public final boolean adr16bit;
+		public final boolean usablesInPels;
+		public final int usableWidth;
+		public final int usableHeight;
+		public final int colorCount;
+		public final int highlightCount;
+		public final int ddmBufferSize;
+
+		private final long created = System.currentTimeMillis();
+
+		public Entry(
+				boolean adr14bit,
+				boolean adr16bit,
+				boolean usablesInPels,
+				int usableWidth,
+				int usableHeight,
+				int colorCount,
+				int highlightCount,
+				int ddmBufferSize) {
+			this.adr14bit = adr14bit;
+			this.adr16bit = adr16bit;
+			this.usablesInPels = usablesInPels;
+			this.usableWidth = usableWidth;
+			this.usableHeight = usableHeight;
+			this.colorCount = colorCount;
+			this.highlightCount = highlightCount;
+			this.ddmBufferSize = ddmBufferSize;
+		}
+
+		/**
+		 * Parse the textual form of an entry as produced by <code>toString()</code>
+		 * (the DDM buffer size may be missing in older texts).
+		 * @param text the textual form of the entry.
+		 * @return the entry or <code>null</code> if <code>text</code> is invalid.
+		 */
+		public static Entry parse(String text) {
+			String[] parts = text.split(",");
+			if (parts.length != 7 && parts.length != 8) { return null; }
+			try {
+				return new Entry(
+					parts[0].equals("1"),
+					parts[1].equals("1"),
+					parts[2].equals("1"),
+					Integer.parseInt(parts[3]),
+					Integer.parseInt(parts[4]),
+					Integer.parseInt(parts[5]),
+					Integer.parseInt(parts[6]),
+					(parts.length > 7) ? Integer.parseInt(parts[7]) : 0);
+			} catch (NumberFormatException exc) {
+				return null;
+			}
+		}
+
+		@Override
+		public String toString() {
+			return String.format("%d,%d,%d,%d,%d,%d,%d,%d",
+					(this.adr14bit) ? 1 : 0,
+					(this.adr16bit) ? 1 : 0,
+					(this.usablesInPels) ? 1 : 0,
+					this.usableWidth,
+					this.usableHeight,
+					this.colorCount,
+					this.highlightCount,
+					this.ddmBufferSize);
+		}
+	}
+
+	private static long timeToLiveMs = DefaultTimeToLiveSecs * 1000L;
+
+	private static final Map<String,Entry> entries = new LinkedHashMap<String,Entry>(16, 0.75f, true) {
+		private static final long serialVersionUID = 1L;
+
+		@Override
+		protected boolean removeEldestEntry(Map.Entry<String,Entry> eldest) {
+			return this.size() > MaxEntries;
+		}
+	};
+
+	/**
+	 * Set the time to live for the cache entries, dropping all current entries.
+	 * @param seconds the time to live in seconds, 0 disabling the cache.
+	 */
+	public static synchronized void setTimeToLive(int seconds) {
+		timeToLiveMs = Math.max(0, seconds) * 1000L;
+		entries.clear();
+	}
+
+	/**
+	 * Build the cache key for a terminal.
+	 * @param terminalType the terminal type name as sent by the emulator.
+	 * @param address the address of the emulator's host (may be <code>null</code>).
+	 * @return the cache key.
+	 */
+	public static String keyFor(String terminalType, InetAddress address) {
+		return ((address != null) ? address.getHostAddress() : "") + "/" + terminalType;
+	}
+
+	/**
+	 * Get the characteristics of a terminal if cached and not expired.
+	 * @param key the cache key of the terminal.
+	 * @return the cached characteristics or <code>null</code>.
+	 */
+	public static synchronized Entry lookup(String key) {
+		Entry entry = entries.get(key);
+		if (entry == null) { return null; }
+		if (System.currentTimeMillis() - entry.created >= timeToLiveMs) {
+			entries.remove(key);
+			return null;
+		}
+		return entry;
+	}
+
+	/**
+	 * Cache the characteristics of a terminal (if the cache is enabled).
+	 * @param key the cache key of the terminal.
+	 * @param entry the characteristics to cache.
+	 */
+	public static synchronized void store(String key, Entry entry) {
+		if (timeToLiveMs > 0) { entries.put(key, entry); }
+	}
+
+	/**
+	 * Drop the cached characteristics of a terminal, forcing a new WSF-query
+	 * at the next connection.
+	 * @param key the cache key of the terminal.
+	 */
+	public static synchronized void invalidate(String key) {
+		entries.remove(key);
+	}
+
+	/**
+	 * Drop all cached terminal characteristics.
+	 */
+	public static synchronized void clear() {
+		entries.clear();
+	}
+}
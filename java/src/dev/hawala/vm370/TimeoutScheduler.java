@@ -0,0 +1,130 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370;
+
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.ScheduledThreadPoolExecutor;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Process-wide scheduler for the timeouts of all MECAFF-consoles.
+ * <p>
+ * A single timer thread waits for the earliest armed deadline, so no thread
+ * wakes up as long as no timeout is pending, independently of the number of
+ * connected terminals.
+ * <br/>
+ * The timer thread only recognizes the expiration of a deadline, the timeout
+ * handler itself runs in a thread of a shared (on-demand) pool, so a console
+ * blocked while writing to a slow terminal does not delay the timeouts of the
+ * other consoles.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class TimeoutScheduler {
+
+	private static Log logger = Log.getLogger();
+
+	private static ThreadGroup threadGroup = null;
+	private static ScheduledThreadPoolExecutor timer = null;
+	private static ExecutorService dispatcher = null;
+
+	// cancelled (long) fs-read timeouts stay in the timer queue until they
+	// would expire, so the queue is purged after this many cancellations
+	private static final int PURGE_INTERVAL = 64;
+	private static final AtomicInteger cancelCount = new AtomicInteger(0);
+
+	/**
+	 * Thread factory for the timer and handler threads, creating daemon threads
+	 * so a pending timeout does not prevent the process from terminating.
+	 */
+	private static class DaemonThreadFactory implements ThreadFactory {
+		private final String namePrefix;
+		private int threadCount = 0;
+
+		public DaemonThreadFactory(String namePrefix) {
+			this.namePrefix = namePrefix;
+		}
+
+		public Thread newThread(Runnable r) {
+			Thread thr;
+			synchronized(this) {
+				thr = new Thread(threadGroup, r, this.namePrefix + (++this.threadCount));
+			}
+			thr.setDaemon(true);
+			return thr;
+		}
+	}
+
+	// create the timer machinery when the first timeout is armed
+	private static synchronized void ensureStarted() {
+		if (timer != null) { return; }
+
+		threadGroup = new ThreadGroup("{tm}");
+		timer = new ScheduledThreadPoolExecutor(1, new DaemonThreadFactory("timer-"));
+		dispatcher = Executors.newCachedThreadPool(new DaemonThreadFactory("timeout-"));
+		logger.debug("TimeoutScheduler started");
+	}
+
+	/**
+	 * Arm a deadline, invoking the handler once after the given delay unless
+	 * the deadline is cancelled before.
+	 * <p>
+	 * As cancelling may race with the expiration, the handler should check
+	 * itself (in the monitor protecting its state) if the timeout is still
+	 * relevant.
+	 * @param delayMs the delay in milliseconds until the handler is invoked.
+	 * @param handler the timeout handler to invoke.
+	 * @return the handle allowing to cancel the deadline.
+	 */
+	public static ScheduledFuture<?> schedule(long delayMs, final Runnable handler) {
+		ensureStarted();
+		return timer.schedule(
+				new Runnable() {
+					public void run() { dispatcher.execute(handler); }
+				},
+				Math.max(0, delayMs),
+				TimeUnit.MILLISECONDS);
+	}
+
+	/**
+	 * Cancel a deadline if not already expired.
+	 * @param deadline the deadline handle (possibly <code>null</code>) to cancel.
+	 * @return always <code>null</code>, to allow resetting the handle variable with
+	 *   the same statement.
+	 */
+	public static ScheduledFuture<?> cancel(ScheduledFuture<?> deadline) {
+		if (deadline != null && deadline.cancel(false)
+				&& cancelCount.incrementAndGet() % PURGE_INTERVAL == 0) {
+			ScheduledThreadPoolExecutor t = timer;
+			if (t != null) { t.purge(); }
+		}
+		return null;
+	}
+
+	/**
+	 * Stop the timer machinery, dropping all pending deadlines.
+	 */
+	public static synchronized void shutdown() {
+		if (timer == null) { return; }
+		timer.shutdownNow();
+		dispatcher.shutdown();
+		timer = null;
+		dispatcher = null;
+	}
+}
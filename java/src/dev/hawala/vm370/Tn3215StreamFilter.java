@@ -38,13 +38,17 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 	// our FSIO command interpreter
 	private EncodedTransport encodedTransport = null;
 	
+	// assembles each line to the host for a single write
+	private TelnetRecordWriter hostWriter = null;
+	
 	/**
 	 * Construct and initialize this instance, doing the telnet-negotiations with
 	 * the terminal to enter TN3270 binary mode and the VM/370 host to enter 3215 (plain telnet),
 	 * finally starting up the MECAFF-console and the communication with both parties.
 	 * @param connectionNo the connection counter value of this filter (for logging).
 	 * @param terminalSideSocket the socket connected to the terminal.
-	 * @param hostSideSocket the socket connected to the host.
+	 * @param hostSideSocket the socket connected to the host (resp. an <code>AsyncConnectSocket</code>
+	 *   connecting to the host while negotiating with the terminal).
 	 * @param stickToPredefinedTerminalTypes if <code>false</code>, no WSF-query will be performed
 	 *   to get the detailed terminal's capability information.
 	 * @param minColorCount number of colors the terminal must at least support to be accepted
@@ -64,6 +68,10 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 		// setup the base filter 2 direction communication infrastructure
 		super(connectionNo, terminalSideSocket, hostSideSocket, closedSink);
 		
+		this.traceParameter("noDynamic", stickToPredefinedTerminalTypes);
+		this.traceParameter("sendDelay", termTransmissionDelayMs);
+		this.traceParameter("minColorCount", minColorCount);
+		
 		// initialize the 3270 terminal connection
 		try {
 			this.negotiateTerminal3270Mode(stickToPredefinedTerminalTypes, minColorCount);
@@ -81,8 +89,16 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 		
 		this.logger.info("negotiation of 3270 protocol successfull");
 		
+		// the host connection was established while negotiating with the terminal
+		if (!this.awaitHostConnection()) {
+			this.shutdown();
+			return;
+		}
+		this.hostWriter = new TelnetRecordWriter(this.osToHost, 512);
+		
 		// create the MECAFF-console
 		this.console = new Vm3270Console(this, this.osToTerm, this.numAltRows, this.numAltCols, this.canExtended, termTransmissionDelayMs);
+		this.console.setStats(this.stats);
 		try {
 			this.console.setInputState(InputState.Running);
 		} catch (IOException exc) {
@@ -98,7 +114,9 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 			this.canExtHighLight,
 			this.canAltScreenSize,
 			this.numAltRows,
-			this.numAltCols);
+			this.numAltCols,
+			this.dftBufferSize);
+		this.encodedTransport.setStats(this.stats);
 		
 		// an now start the full communication in both directions
 		this.startAsyncCommunication();
@@ -203,7 +221,7 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 			this.encodedTransport.resetFsInrequest();
 		} else {
 			// a (more or less) normal output line 
-			this.ebcdicString.appendUnicode(lineString);
+			this.ebcdicString.appendAscii(buffer, stringStart, stringLength);
 			this.console.appendHostLine(this.ebcdicString);
 			if (this.lastWasSessionEndStart && (lineString.equals(Vm370Online) || lineString.equals(Vm380Online))) {
 				this.console.endCurrentSession(true);
@@ -297,18 +315,43 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 		super.connectionClosed();
 	}
 	
+	@Override
+	protected void releaseResources() {
+		if (this.encodedTransport != null) { this.encodedTransport.release(); }
+		this.interPacketBuffer.release();
+	}
+	
 	private final static byte[] CRLFBytes = { (byte)0x0D, (byte)0x0A };
+	
+	// buffer for the ASCII conversion of input lines sent to the host
+	private byte[] asciiLine = new byte[256];
 
 	public void sendUserInput(EbcdicHandler inputLine) throws IOException {
-		this.osToHost.write(inputLine.getString().getBytes());
-		this.osToHost.write(CRLFBytes);
-		this.osToHost.flush();
+		synchronized(this.hostWriter) {
+			if (this.asciiLine.length < inputLine.getLength()) {
+				this.asciiLine = new byte[inputLine.getLength()];
+			}
+			int length = inputLine.addAsciiTo(this.asciiLine, 0);
+			this.hostWriter.write(this.asciiLine, 0, length);
+			this.hostWriter.write(CRLFBytes);
+			this.hostWriter.send();
+		}
+	}
+	
+	// send a complete line to the host with a single write
+	private void sendHostLine(byte[] line) throws IOException {
+		synchronized(this.hostWriter) {
+			this.hostWriter.write(line);
+			this.hostWriter.send();
+		}
 	}
 	
 	private void sendEncodedData() throws IOException {
-		this.encodedTransport.writeNextChunkTo(this.osToHost);
-		this.osToHost.write(CRLFBytes);
-		this.osToHost.flush();
+		synchronized(this.hostWriter) {
+			this.encodedTransport.writeNextChunkTo(this.hostWriter);
+			this.hostWriter.write(CRLFBytes);
+			this.hostWriter.send();
+		}
 		if (this.encodedTransport.getAvailableChunks() == 0 && this.fsCompletedCallBack != null) {
 			this.fsCompletedCallBack.transferCompleted();
 			this.fsCompletedCallBack = null;
@@ -337,8 +380,7 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 //		this.osToHost.write(CRLFBytes);
 //		this.osToHost.flush();
 		
-		this.osToHost.write("#cp\r\n".getBytes());
-		this.osToHost.flush();
+		this.sendHostLine("#cp\r\n".getBytes());
 		this.emptyRequestsToSend = 1;
 		
 //		this.drainGuardToEnqueue = drainGuard;
@@ -347,8 +389,7 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 	}
 	
 	public boolean sendInterrupt_HT(EbcdicHandler drainGuard) throws IOException {
-		this.osToHost.write("#cp attn #ht\r\n".getBytes());
-		this.osToHost.flush();
+		this.sendHostLine("#cp attn #ht\r\n".getBytes());
 		
 //		this.osToHost.write("#cp echo".getBytes());
 //		this.osToHost.write(CRLFBytes);
@@ -371,8 +412,7 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 //		this.osToHost.write(CRLFBytes);
 //		this.osToHost.flush();
 		
-		this.osToHost.write("#cp attn #hx\r\n".getBytes());
-		this.osToHost.flush();
+		this.sendHostLine("#cp attn #hx\r\n".getBytes());
 		this.emptyRequestsToSend = 2;
 		
 //		this.drainGuardToEnqueue = drainGuard;
@@ -396,23 +436,27 @@ public class Tn3215StreamFilter extends Base3270And3215NegotiatingStreamFilter i
 
 	@Override
 	public void sendFullScreenDataAvailability(boolean isAvailable) throws IOException {
-		this.encodedTransport.writeFsReadStateTo(
-				this.osToHost, 
-				false, /* not timed out */ 
-				isAvailable, 
-				null);
-		this.osToHost.write("\r\n".getBytes());
-		this.osToHost.flush();
+		synchronized(this.hostWriter) {
+			this.encodedTransport.writeFsReadStateTo(
+					this.hostWriter, 
+					false, /* not timed out */ 
+					isAvailable, 
+					null);
+			this.hostWriter.write(CRLFBytes);
+			this.hostWriter.send();
+		}
 	}
 
 	@Override
 	public void sendFullScreenTimedOut() throws IOException {
-		this.encodedTransport.writeFsReadStateTo(
-				this.osToHost, 
-				true, 
-				false, 
-				null);
-		this.osToHost.write("\r\n".getBytes());
-		this.osToHost.flush();
+		synchronized(this.hostWriter) {
+			this.encodedTransport.writeFsReadStateTo(
+					this.hostWriter, 
+					true, 
+					false, 
+					null);
+			this.hostWriter.write(CRLFBytes);
+			this.hostWriter.send();
+		}
 	}
 }
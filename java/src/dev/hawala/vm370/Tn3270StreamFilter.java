@@ -14,6 +14,7 @@
 
 package dev.hawala.vm370;
 
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.OutputStream;
 import java.net.Socket;
@@ -55,8 +56,10 @@ public class Tn3270StreamFilter
 	// some strings from the host we need to recognize a vm-session end
 	private final static String Vm370LogoffPattern = "LOGOFF AT [0-9]{2}:[0-9]{2}:[0-9]{2} .*";
 	private final static String Vm370DisconnectPattern = "DISCONNECT AT [0-9]{2}:[0-9]{2}:[0-9]{2} .*";
-	private final static String Vm370Online = "VM/370 ONLINE       ";
-	private final static String Vm380Online = "VM/380 ONLINE       ";
+	private final static EbcdicHandler Vm370LogoffStart = new EbcdicHandler("LOGOFF AT ");
+	private final static EbcdicHandler Vm370DisconnectStart = new EbcdicHandler("DISCONNECT AT ");
+	private final static EbcdicHandler Vm370Online = new EbcdicHandler("VM/370 ONLINE       ");
+	private final static EbcdicHandler Vm380Online = new EbcdicHandler("VM/380 ONLINE       ");
 	
 	// has the current vm-session ended?
 	private boolean lastWasSessionEndStart = false;
@@ -67,17 +70,20 @@ public class Tn3270StreamFilter
 	
 	/**
 	 * Construct and initialize this instance, doing the telnet-negotiations with
-	 * the terminal to enter TN3270 binary mode and the VM/370 host also to enter the
-	 * TN3270 binary mode, finally starting up the MECAFF-console and the communication
-	 * with both parties.
+	 * the terminal to enter TN3270 binary mode and (in parallel) with the VM/370 host also
+	 * to enter the TN3270 binary mode, finally starting up the MECAFF-console and the
+	 * communication with both parties.
 	 * @param connectionNo the connection counter value of this filter (for logging).
 	 * @param terminalSideSocket the socket connected to the terminal.
-	 * @param hostSideSocket the socket connected to the host.
+	 * @param hostSideSocket the socket connected to the host (resp. an <code>AsyncConnectSocket</code>
+	 *   connecting to the host while negotiating with the terminal).
 	 * @param stickToPredefinedTerminalTypes if <code>false</code>, no WSF-query will be performed
 	 *   to get the detailed terminal's capability information.
 	 * @param minColorCount number of colors the terminal must at least support to be accepted
 	 *   as color terminal.
 	 * @param termTransmissionDelayMs delay between data sends to the terminal from the MECAFF-console. 
+	 * @param minHandshakeGapMs minimal ms between 2 internal i/o-operations with VM.
+	 * @param minInteractionGapMs minimal ms between 2 user-related i/o-operations with VM.
 	 * @param closedSink the object to be informed about the filter being shut down.
 	 */
 	public Tn3270StreamFilter(
@@ -88,35 +94,57 @@ public class Tn3270StreamFilter
 			boolean stickToPredefinedTerminalTypes,
 			short termTransmissionDelayMs, /* 0..9 ms */
 			short minColorCount,
+			long minHandshakeGapMs,
+			long minInteractionGapMs,
 			IConnectionClosedSink closedSink) {
 		super(connectionNo, terminalSideSocket, hostSideSocket, closedSink);
 		this.logger = Log.getLogger();
+		this.minHandshakeGapMs = minHandshakeGapMs;
+		this.minInteractionGapMs = minInteractionGapMs;
+		
+		this.traceParameter("luName", luName);
+		this.traceParameter("noDynamic", stickToPredefinedTerminalTypes);
+		this.traceParameter("sendDelay", termTransmissionDelayMs);
+		this.traceParameter("minColorCount", minColorCount);
+		this.traceParameter("handshakeGap", minHandshakeGapMs);
+		this.traceParameter("inputGap", minInteractionGapMs);
+		
+		// negotiate with the host while negotiating with the terminal
+		this.beginHost3270Negotiation(luName);
 		
 		try {
 			this.negotiateTerminal3270Mode(stickToPredefinedTerminalTypes, minColorCount);
 		} catch (IOException exc) {
 			this.terminalType = null;
 			this.logger.error("Error while negotiating 3270 protocol with terminal, IOException: ", exc.getMessage());
+			this.endHost3270Negotiation(true);
 			this.shutdown();
 			return;
 		}
 		
 		if (!this.isIn320Mode) {
 			this.logger.error("negotiation of 3270 protocol failed");
+			this.endHost3270Negotiation(true);
 			this.shutdown();
 			return;
 		}
 		
-		try {
-			this.negotiateHost3270Mode(luName);
-		} catch (IOException exc) {
+		// a terminal reconnecting with the LU-name of a detached session takes over that session
+		if (this.takeOverDetachedSession()) {
+			return;
+		}
+		
+		if (!this.endHost3270Negotiation(false)) {
 			this.terminalType = null;
-			this.logger.error("Error while negotiating 3270 protocol with host, IOException: ", exc.getMessage());
+			this.logger.error("negotiation of 3270 protocol with host failed");
 			this.shutdown();
 			return;
 		}
 		
+		this.hostSender = new PacedSender(this.osToHost, prefixT2H);
+		
 		this.console = new Vm3270Console(this, this.osToTerm, this.numAltRows, this.numAltCols, this.canExtended, termTransmissionDelayMs);
+		this.console.setStats(this.stats);
 		this.host2termPipeline = new EbcdicTextPipeline(this.subThreadsGroup, this.console, this, "H->T");
 		this.term2hostPipeline = new EbcdicTextPipeline(this.subThreadsGroup, this, null, "T->H");
 		
@@ -128,7 +156,9 @@ public class Tn3270StreamFilter
 			this.canExtHighLight,
 			this.canAltScreenSize,
 			this.numAltRows,
-			this.numAltCols);
+			this.numAltCols,
+			this.dftBufferSize);
+		this.encodedTransport.setStats(this.stats);
 		
 		this.startAsyncCommunication();
 	}
@@ -136,8 +166,67 @@ public class Tn3270StreamFilter
 	@Override
 	public void shutdown() {
 		if (this.host2termPipeline != null) { this.host2termPipeline.shutdown(); }
+		if (this.term2hostPipeline != null) { this.term2hostPipeline.shutdown(); }
+		if (this.console != null) { this.console.close(); } // disarm pending console timeouts
+		if (this.hostSender != null) { this.hostSender.close(); }
 		super.shutdown();
 	}
+	
+	@Override
+	protected void releaseResources() {
+		if (this.encodedTransport != null) { this.encodedTransport.release(); }
+	}
+	
+	@Override
+	protected boolean detachTerminal() {
+		if (this.console == null 
+				|| this.terminalLuName == null 
+				|| this.terminalLuName.length() == 0 
+				|| !DetachedSessions.isEnabled()) {
+			return false;
+		}
+		this.console.detachTerminal();
+		this.closeTerminalSide();
+		return DetachedSessions.detach(this.terminalLuName, this);
+	}
+	
+	@Override
+	protected void terminalReattached() throws IOException {
+		this.console.reattachTerminal(this.osToTerm);
+	}
+	
+	// pass the terminal to the session detached for the terminal's LU-name (if any),
+	// returning true if this filter is done (terminal handed over or failure)
+	private boolean takeOverDetachedSession() {
+		BaseStreamFilter detached = DetachedSessions.claim(this.terminalLuName);
+		if (detached == null) { return false; }
+		
+		if (!(detached instanceof Tn3270StreamFilter) || !this.hasSameTerminal((Tn3270StreamFilter)detached)) {
+			this.logger.info("reconnected terminal differs from the detached session's terminal, ending the detached session");
+			detached.endDetachedSession();
+			return false;
+		}
+		
+		this.endHost3270Negotiation(true); // the host connection of the detached session is used
+		if (!this.handOverTerminal(detached)) {
+			this.logger.error("unable to reattach terminal to the detached session");
+			detached.endDetachedSession();
+			this.shutdown();
+		}
+		return true;
+	}
+	
+	// has the other filter negotiated the same terminal characteristics as this one?
+	private boolean hasSameTerminal(Tn3270StreamFilter other) {
+		return this.terminalType != null
+			&& this.terminalType.equals(other.terminalType)
+			&& this.numAltRows == other.numAltRows
+			&& this.numAltCols == other.numAltCols
+			&& this.canExtended == other.canExtended
+			&& this.canColors == other.canColors
+			&& this.canExtHighLight == other.canExtHighLight
+			&& this.canAltScreenSize == other.canAltScreenSize;
+	}
 
 	// dismiss a negotiation attempt of any of the sides
 	private void handleOutOfBand(String prefix, byte[] buffer, int count, OutputStream sink) throws IOException {
@@ -146,6 +235,13 @@ public class Tn3270StreamFilter
 		sink.write(buffer, 0, count);
 	}
 	
+	// dismiss a negotiation attempt of the terminal, keeping the order with the paced records to the host
+	private void handleOutOfBandT2H(byte[] buffer, int count) throws IOException {
+		this.logger.logHexBuffer(prefixT2H + " [telnet-out-of-band]", null, buffer, count);
+		this.logger.separate();
+		this.hostSender.send(buffer, 0, count, 0, null);
+	}
+	
 	private byte[] pendingH2Tbytes = new byte[32768];
 	private int pendingH2Tcount = 0;
 	
@@ -185,6 +281,7 @@ public class Tn3270StreamFilter
 	// temp ebcdic strings
 	private final EbcdicHandler blankLine = new EbcdicHandler("                                        ");
 	private final EbcdicHandler tmpLine = new EbcdicHandler();
+	private final EbcdicHandler h2tString = new EbcdicHandler(); // text currently collected from the 3270 output stream
 	
 	// data to recognize/skip the Hercules terminal startup screen
 	private final int hercInitColTitle = 2;
@@ -199,9 +296,12 @@ public class Tn3270StreamFilter
 	private Vm370State vmstate = Vm370State.unknown; // the console state of the host
 	
 	// items to ensure that CP is not overwhelmed by fast data transmissions
-	private static final long MinCommIntervalHandshake = 3; // minimal ms between 2 internal i/o-operations with VM 
-	private static final long MinCommIntervalInteraction = 200; // minimal ms between 2 user-related i/o-operations with VM 
-	private final IntervalEnsurer intervalEnsurer = new IntervalEnsurer(MinCommIntervalHandshake);
+	public static final short DefaultMinHandshakeGapMs = 3; // default minimal ms between 2 internal i/o-operations with VM 
+	public static final short DefaultMinInteractionGapMs = 200; // default minimal ms between 2 user-related i/o-operations with VM 
+	private static final long WSFQueryReplyDelayMs = 5; // ms to wait before answering a WSF-query from VM
+	private final long minHandshakeGapMs;
+	private final long minInteractionGapMs;
+	private PacedSender hostSender = null; // all 3270 records to the host are paced through this queue
 	
 	// inHolding: flow regulation to synchronize the holding state of the MECAFF-console
 	//            and the VM-console, putting the VM-console into "Holding" if the MECAFF-console
@@ -223,6 +323,18 @@ public class Tn3270StreamFilter
 	};
 	private Vm370ClearState clearState = Vm370ClearState.notClearing;
 	
+	// check if the host output line is the CP message for a logoff resp. disconnect,
+	// doing the (costly) unicode conversion and pattern match only for candidate lines
+	private boolean isSessionEndMessage(EbcdicHandler ebcdicString) {
+		if (ebcdicString.startsWith(Vm370LogoffStart)) {
+			return ebcdicString.getString().matches(Vm370LogoffPattern);
+		}
+		if (ebcdicString.startsWith(Vm370DisconnectStart)) {
+			return ebcdicString.getString().matches(Vm370DisconnectPattern);
+		}
+		return false;
+	}
+	
 	/**
 	 * Process an EBCDIC string written to the simulated 3270 terminal 
 	 * at the given screen position, interpreting the data received
@@ -240,7 +352,7 @@ public class Tn3270StreamFilter
 		
 		if (this.hercInitial) {
 			// (still) ignoring the Hercules initial screen
-			this.logger.debug("TXT[col: ", ba.getCol(), "]: ", ebcdicString.getString());
+			this.logger.debug("TXT[col: ", ba.getCol(), "]: ", ebcdicString);
 			if (ba.getCol() == hercInitColTitle) {
 				if (this.tmpLine.getLength() > 0) {
 					this.host2termPipeline.appendLine(this.tmpLine);
@@ -328,11 +440,10 @@ public class Tn3270StreamFilter
 			} else {
 				// this is "real" output sent by VM 
 				this.host2termPipeline.appendLine(ebcdicString);
-				String uniString = ebcdicString.getString();
-				if (this.lastWasSessionEndStart && (uniString.equals(Vm370Online) || uniString.equals(Vm380Online))) {
+				if (this.lastWasSessionEndStart && (ebcdicString.eq(Vm370Online) || ebcdicString.eq(Vm380Online))) {
 					this.console.endCurrentSession(true);
 				}
-				if (uniString.matches(Vm370LogoffPattern) || uniString.matches(Vm370DisconnectPattern)) {
+				if (this.isSessionEndMessage(ebcdicString)) {
 					this.lastWasSessionEndStart = true;
 					this.sendEmptyCmd();
 				} else {
@@ -379,13 +490,8 @@ public class Tn3270StreamFilter
 	}
 	
 	private void sendWSFQueryReply(byte[] reply) throws IOException {
-		try {
-			Thread.sleep(5); // wait 5 ms
-		} catch (InterruptedException e) {
-			// ignored
-		}
-		this.osToHost.write(reply);
-		this.osToHost.flush();
+		this.hostSender.logOp(); // the query just arrived
+		this.hostSender.send(reply, WSFQueryReplyDelayMs);
 	}
 	
 	private int handleWSF(byte[] b, int count) throws IOException {
@@ -451,7 +557,7 @@ public class Tn3270StreamFilter
 		
 		if (trfBuffer != null) {
 			int pos = 0;
-			EbcdicHandler ebcdicString = new EbcdicHandler();
+			EbcdicHandler ebcdicString = this.h2tString.reset();
 			boolean atBeginOfRecord = true;
 			while(pos < count) {
 				byte code = trfBuffer[pos];
@@ -591,7 +697,7 @@ public class Tn3270StreamFilter
 	@Override
 	protected void processTermToHost(byte[] buffer, int count) throws IOException, InterruptedException {
 		if (buffer[0] == (byte)0xFF) {
-			this.handleOutOfBand(prefixT2H, buffer, count, this.osToHost);
+			this.handleOutOfBandT2H(buffer, count);
 		} else {
 			this.handleDataStreamT2H(buffer, count);
 		}
@@ -616,34 +722,56 @@ public class Tn3270StreamFilter
 	private static EbcdicHandler intrHt = new EbcdicHandler("HT");
 	private static EbcdicHandler intrHx = new EbcdicHandler("HX");
 	
-	// make sure that handshaking transmissions (state handing with CLEAR or ENTER)
-	// have a minimal time distance (3 ms, see MinCommIntervalHandshake)
-	private void ensureIntervaledHandshakeOps() { 
-		this.intervalEnsurer.ensureOpsInterval();
+	// buffer for assembling a 3270 record to the host, reused for all records
+	// built by the same thread (the PacedSender copies records it must queue)
+	private static class HostRecord extends ByteArrayOutputStream {
+		public HostRecord() { super(256); }
+		public byte[] getBuffer() { return this.buf; }
+	}
+	
+	private final ThreadLocal<HostRecord> hostRecords = new ThreadLocal<HostRecord>() {
+		@Override
+		protected HostRecord initialValue() { return new HostRecord(); }
+	};
+	
+	// start a new 3270 record to be sent to the host
+	private HostRecord newHostRecord(byte[] aidAndCursor) throws IOException {
+		HostRecord record = this.hostRecords.get();
+		record.reset();
+		record.write(aidAndCursor);
+		return record;
+	}
+	
+	// enqueue handshaking transmissions (state handing with CLEAR or ENTER) ensuring
+	// a minimal time distance (3 ms by default, see DefaultMinHandshakeGapMs)
+	private void sendHandshakeRecord(HostRecord record) throws IOException { 
+		this.sendHandshakeRecord(record, null);
+	}
+	
+	// same, invoking 'writtenCallBack' after the record was written to the host
+	private void sendHandshakeRecord(HostRecord record, IVm3270ConsoleCompletedSink writtenCallBack) throws IOException { 
+		record.write(TN_EOR);
+		this.hostSender.send(record.getBuffer(), 0, record.size(), this.minHandshakeGapMs, writtenCallBack);
 	}
 	
-	// make sure that user input transmissions have a minimal time distance (200 ms, see MinCommIntervalInteraction)
-	private void ensureIntervaledInteractionOps() { 
-		this.intervalEnsurer.ensureOpsInterval(MinCommIntervalInteraction); 
+	// enqueue user input transmissions ensuring a minimal time distance
+	// (200 ms by default, see DefaultMinInteractionGapMs)
+	private void sendInteractionRecord(HostRecord record) throws IOException { 
+		record.write(TN_EOR);
+		this.hostSender.send(record.getBuffer(), 0, record.size(), this.minInteractionGapMs, null);
 	} 
 	
 	// MUST be called inside synchronized(this)
 	private void sendEmptyCmd() throws IOException {
 		this.logger.debug("...sending EmptyCmd");
-		this.ensureIntervaledHandshakeOps();
-		this.osToHost.write(C3270_INPUTSTART);
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		this.sendHandshakeRecord(this.newHostRecord(C3270_INPUTSTART));
 	}
 	
 	// MUST be called inside synchronized(this)
 	private void sendClearCmd() throws IOException {
 		if (this.clearState != Vm370ClearState.clearRequested) {
 			this.logger.debug("...sending ClearCmd");
-			this.ensureIntervaledHandshakeOps();
-			this.osToHost.write(C3270_CLEAR);
-			this.osToHost.write(TN_EOR);
-			this.osToHost.flush();
+			this.sendHandshakeRecord(this.newHostRecord(C3270_CLEAR));
 			this.clearState = Vm370ClearState.clearRequested;
 		} else {
 			this.logger.debug("... Screen-Clear already underway (sending ClearCmd)");
@@ -662,7 +790,7 @@ public class Tn3270StreamFilter
 	// handle event "just received a new CP-console state"
 	private void vmStateArrived() {
 		synchronized(this) {
-			this.intervalEnsurer.logOp();
+			this.hostSender.logOp();
 			if (this.clearState == Vm370ClearState.cleared) {
 				this.logger.debug("vmStateArrived() -> clearState = notClearing");
 				this.clearState = Vm370ClearState.notClearing;
@@ -721,7 +849,6 @@ public class Tn3270StreamFilter
 					}
 					this.logger.debug("pipelineDrained(): reached Vm370State.holding");
 				}
-				this.ensureIntervaledHandshakeOps();
 				this.sendClearCmd();
 			} //else {
 			//	this.logger.debug("pipelineDrained(): --- not in holding state");
@@ -758,28 +885,26 @@ public class Tn3270StreamFilter
 				logger.debug("transmitToHost(): VM-state RUNNING/VMREAD/CPREAD reached");
 			}
 			
-			this.ensureIntervaledInteractionOps();
-			this.osToHost.write(C3270_INPUTSTART);
-			this.osToHost.write(line.getRawBytes(), 0, line.getLength());
-			this.osToHost.write(TN_EOR);
-			this.osToHost.flush();
+			HostRecord record = this.newHostRecord(C3270_INPUTSTART);
+			record.write(line.getRawBytes(), 0, line.getLength());
+			this.sendInteractionRecord(record);
 			this.lastInputlineSent.reset().append(line).strip();
-			logger.debug("transmitToHost(): data transmitted and flushed");
+			logger.debug("transmitToHost(): data enqueued for transmission");
 		}
 	}
 	
 	// transmit the next pending transport-encoded chunk for a 3270 input stream
 	// to the host, informing the MECAFF-console if this was the last chunk
 	private void sendEncodedData() throws IOException {
-		this.ensureIntervaledHandshakeOps();
-		this.osToHost.write(C3270_INPUTSTART);
-		this.encodedTransport.writeNextChunkTo(this.osToHost, this.lastInputlineSent);
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
-		if (this.encodedTransport.getAvailableChunks() == 0 && this.fsCompletedCallBack != null) {
-			this.fsCompletedCallBack.transferCompleted();
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
+		this.encodedTransport.writeNextChunkTo(record, this.lastInputlineSent);
+		IVm3270ConsoleCompletedSink writtenCallBack = null;
+		if (this.encodedTransport.getAvailableChunks() == 0) {
+			// the console is informed when the last chunk has really been written
+			writtenCallBack = this.fsCompletedCallBack;
 			this.fsCompletedCallBack = null;
 		}
+		this.sendHandshakeRecord(record, writtenCallBack);
 	}
 
 	@Override
@@ -796,65 +921,52 @@ public class Tn3270StreamFilter
 
 	@Override
 	public boolean sendInterrupt_CP(EbcdicHandler drainGuard) throws IOException {
-		this.ensureIntervaledInteractionOps();
-		this.osToHost.write(C3270_INPUTSTART);
-		this.osToHost.write(intrCp.getRawBytes(), 0, intrCp.getLength());
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
+		record.write(intrCp.getRawBytes(), 0, intrCp.getLength());
+		this.sendInteractionRecord(record);
 		return false;
 	}
 
 	@Override
 	public boolean sendInterrupt_HT(EbcdicHandler drainGuard) throws IOException {
-		this.ensureIntervaledInteractionOps();
-		this.osToHost.write(C3270_INPUTSTART);
-		this.osToHost.write(intrHt.getRawBytes(), 0, intrHt.getLength());
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
+		record.write(intrHt.getRawBytes(), 0, intrHt.getLength());
+		this.sendInteractionRecord(record);
 		return false;
 	}
 
 	@Override
 	public boolean sendInterrupt_HX(EbcdicHandler drainGuard) throws IOException {
-		this.ensureIntervaledInteractionOps();
-		this.osToHost.write(C3270_INPUTSTART);
-		this.osToHost.write(intrHx.getRawBytes(), 0, intrHx.getLength());
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
+		record.write(intrHx.getRawBytes(), 0, intrHx.getLength());
+		this.sendInteractionRecord(record);
 		return false;
 	}
 	
 	public boolean sendPF03() throws IOException {
-		this.ensureIntervaledInteractionOps();
-		this.osToHost.write(C3270_PF03);
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		this.sendInteractionRecord(this.newHostRecord(C3270_PF03));
 		return false;
 	}
 
 	@Override
 	public void sendFullScreenDataAvailability(boolean isAvailable) throws IOException {
-		this.ensureIntervaledHandshakeOps();
-		this.osToHost.write(C3270_INPUTSTART);
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
 		this.encodedTransport.writeFsReadStateTo(
-				this.osToHost, 
+				record, 
 				false, /* not timed out */ 
 				isAvailable, 
 				this.lastInputlineSent);
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		this.sendHandshakeRecord(record);
 	}
 
 	@Override
 	public void sendFullScreenTimedOut() throws IOException {
-		this.ensureIntervaledHandshakeOps();
-		this.osToHost.write(C3270_INPUTSTART);
+		HostRecord record = this.newHostRecord(C3270_INPUTSTART);
 		this.encodedTransport.writeFsReadStateTo(
-				this.osToHost, 
+				record, 
 				true, 
 				false, 
 				this.lastInputlineSent);
-		this.osToHost.write(TN_EOR);
-		this.osToHost.flush();
+		this.sendHandshakeRecord(record);
 	}
 }
\ No newline at end of file
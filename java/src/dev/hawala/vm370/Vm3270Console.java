@@ -19,16 +19,20 @@ import java.io.OutputStream;
 import java.io.UnsupportedEncodingException;
 import java.util.ArrayList;
 import java.util.Date;
+import java.util.concurrent.ScheduledFuture;
 
 import dev.hawala.vm370.ebcdic.Ebcdic;
 import dev.hawala.vm370.ebcdic.EbcdicHandler;
 import dev.hawala.vm370.ebcdic.EbcdicTextPipeline;
+import dev.hawala.vm370.stats.ConnectionStats;
+import dev.hawala.vm370.stats.StatsCounters.Counter;
 import dev.hawala.vm370.stream3270.AidCode3270;
 import dev.hawala.vm370.stream3270.BufferAddress;
 import dev.hawala.vm370.stream3270.Color3270;
 import dev.hawala.vm370.stream3270.CommandCode3270;
 import dev.hawala.vm370.stream3270.DataOutStream3270;
 import dev.hawala.vm370.stream3270.Ebcdic6BitEncoding;
+import dev.hawala.vm370.stream3270.ScreenImage3270;
 import dev.hawala.vm370.transport.ByteBuffer;
 
 /**
@@ -38,7 +42,7 @@ import dev.hawala.vm370.transport.ByteBuffer;
  * 
  * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
  */
-public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, EbcdicTextPipeline.ITextSink {
+public class Vm3270Console implements IVm3270ConsoleCompletedSink, EbcdicTextPipeline.ITextSink {
 	
 	private static Log logger = Log.getLogger();
 	
@@ -65,7 +69,8 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	private static final String InputFieldIntro = " >>"; // text appended to the status for the prompt string
 	
 	private final IVm3270ConsoleInputSink consoleInputSink; // where to send (processed) data from the terminal 
-	private final OutputStream osToTerm; // output stream for writing to the terminal
+	private OutputStream osToTerm; // output stream for writing to the terminal
+	private TelnetRecordWriter termWriter; // assembles fullscreen records for a single write to the terminal
 	private final int altRows; // height of the alternate screen on the terminal
 	private final int altCols; // width of the alternate screen on the terminal
 	private final boolean doEwa; // use the alternate screen?
@@ -81,7 +86,10 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	private boolean fsRcvComplete = false; /* true if the 3270 input stream is closed, i.e. TnEOR arrived */
 	private int fsRcvTimeout = -1; /* 1/10 secs to timeout, < 0 == not waiting and Last(int) == no timeout */
 	private int fsGracePeriod = -1; /* 1/10 secs until FSIN in released after a fsRcv timeout */
-	private int fsRemainingGrace = -1;
+	private ScheduledFuture<?> fsRcvDeadline = null; /* armed timeout for the current fs-read, if any */
+	private int fsRcvDeadlineGen = 0; /* identification of the currently armed fs-read timeout */
+	private ScheduledFuture<?> fsGraceDeadline = null; /* armed end of the grace period, if any */
+	private int fsGraceDeadlineGen = 0; /* identification of the currently armed grace period */
 	private int fsLockTimeoutValue = 0; /* > 0 => timeout value that lets the ownership stay with fullscreen */
 	private boolean fsLockedToFs = false; // must the console wait for the fs-read-timeout before reacuiring the screen (instead of directly after fs-read)?
 	
@@ -94,8 +102,19 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	private final DataOutStream3270 buf3270; // our 3270 output stream builder
 	private final BufferAddress iba; // input BufferAddress
 	
-	private Thread ticker; // thread to generate our different timeouts
-	private volatile boolean closed = false; // the 'ticker' thread will stop if set to true
+	private volatile boolean closed = false; // no more timeouts will be handled if set to true
+	
+	// output stream replacing the terminal while the session is detached
+	private static final OutputStream DetachedTerminal = new OutputStream() {
+		@Override
+		public void write(int b) { }
+		
+		@Override
+		public void write(byte[] b, int off, int len) { }
+	};
+	
+	private static final long InitialScreenSettleMs = 50; // minimal ms between the initial screen and the first VM state
+	private IntervalEnsurer initialScreenSettle = null; // time since the initial screen was written
 	
 	// structure of our screen
 	private int ifStartRow; // line where the input area starts (where the prompt is written)
@@ -112,13 +131,21 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	private int linesSinceLastUserAction = 0; // how many lines were received from the host since the users last input sent to the host
 	
 	private boolean lastFullScreenOverwritten = true; // must a fullscreen program do a full repaint (EW/EWA) for re-acquiring the screen?
-	private ArrayList<byte[]> fsBacklog = new ArrayList<byte[]>(); // output lines form the host waiting for the fullscreen program losing the screen to be written
+	private final LineQueue fsBacklog = new LineQueue(); // output lines form the host waiting for the fullscreen program losing the screen to be written
 	private boolean consumingFsBacklog = false; // are we currently writing out 'fsBacklog'-entries after re-acquiring the screen?
+	private final ScreenImage3270 fsImage; // last screen content written by the fullscreen program, for restoring it locally
+	private boolean fsStreamOpen = false; // has a fullscreen output stream been partially sent to the terminal?
+	private boolean fsStreamDropped = false; // must the remaining parts of an interrupted fullscreen output stream be ignored? 
+	private long fsInputNanos = 0; // when did the last fullscreen input from the terminal complete (0 = roundtrip already recorded)
+	
+	private ConnectionStats stats = null; // the statistics of the connection (null if not recorded)
 	
 	private boolean drainHostOutput = false; // are we dropping data from the host as the user die PA2/PA3 (HT/HX)
 	private EbcdicHandler drainGuard; // text echoed by the host to signal us that draing has to stop 
 	
-	private int ticksForEndSession = 0; // timeout ticks counter for clear session after a VM logout/disconnect was recognized 
+	private boolean endSessionPending = false; // is the timeout for clearing the session after a VM logout/disconnect running? 
+	private ScheduledFuture<?> endSessionDeadline = null; // the armed timeout for clearing the session
+	private static final int EndSessionDelayMs = 3000;
 	
 	// attribute identifiers set for the remembered lines 
 	private static final byte LineAttrHostOutput = (byte)0;
@@ -155,6 +182,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 			short termTransmissionDelayMs) {
 		this.consoleInputSink = consoleInputSink;
 		this.osToTerm = osToTerm;
+		this.termWriter = new TelnetRecordWriter(osToTerm, 8192);
 		if (altRows > 24 || altCols > 80) {
 			this.altRows = altRows;
 			this.altCols = altCols;
@@ -187,9 +215,13 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				
 		this.ebcdicString = new EbcdicHandler();
 		this.lineBuffer = new LineBuffer(MaxOutputHistory, this.altCols, this.outZoneRows);
+		this.frameLines = new byte[this.outZoneRows][];
+		this.frameLengths = new int[this.outZoneRows];
+		this.frameFlags = new byte[this.outZoneRows];
 		this.inputHistory = new ArrayList<EbcdicHandler>();
 		this.buf3270 = new DataOutStream3270(this.altCols, this.altRows, canExtended);
 		this.iba = new BufferAddress();
+		this.fsImage = new ScreenImage3270(this.altRows, this.altCols);
 		
 		String uniGuard 
 			= "* =-=-=-= " + (Thread.currentThread().getId()% 1234567) + " -=-=- " + ((new Date()).getTime() % 1234567) + " =-=-=-=";
@@ -212,9 +244,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		} catch (IOException exc) {
 			logger.error("IOException while writing to 3270-terminal");
 		}
-		
-		this.ticker = new Thread(this);
-		this.ticker.start();
+		this.initialScreenSettle = new IntervalEnsurer(InitialScreenSettleMs);
 		
 		logger.info("**** Done 3270 screen setup");
 	}
@@ -223,12 +253,89 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	 * Shutdown this MECAFF-console.
 	 */
 	public void close() {
-		if (!this.closed) {
-			logger.info("## Vm3270Console: closing");
-			this.closed = true;
+		synchronized(this) {
+			if (!this.closed) {
+				logger.info("## Vm3270Console: closing");
+				this.closed = true;
+				this.stopFsRcvTimeout();
+				this.stopGracePeriod();
+				this.endSessionDeadline = TimeoutScheduler.cancel(this.endSessionDeadline);
+				this.fsRcvBuffer.release();
+			}
 		}
 	}
 	
+	/**
+	 * Stop writing to the terminal as the terminal connection dropped, the console
+	 * continuing to collect the output from the host for a terminal reconnecting later.
+	 */
+	public void detachTerminal() {
+		synchronized(this) {
+			logger.info("## Vm3270Console: terminal detached");
+			if (this.fsStreamOpen) {
+				// the partially sent fullscreen stream is lost with the terminal
+				this.fsStreamOpen = false;
+				this.fsStreamDropped = true;
+				this.fsImage.invalidate();
+			}
+			this.osToTerm = DetachedTerminal;
+			this.termWriter = new TelnetRecordWriter(DetachedTerminal, 64);
+		}
+	}
+	
+	/**
+	 * Continue the console on a reconnected terminal, repainting the screen from the
+	 * current console state resp. the last content of the fullscreen program.
+	 * @param osToTerm output stream for writing to the reconnected terminal.
+	 * @throws IOException
+	 */
+	public void reattachTerminal(OutputStream osToTerm) throws IOException {
+		synchronized(this) {
+			logger.info("## Vm3270Console: terminal reattached");
+			this.osToTerm = osToTerm;
+			this.termWriter = new TelnetRecordWriter(osToTerm, 8192);
+			if (!this.fsRcvComplete) {
+				this.fsRcvBuffer.clear(); // drop partial input from the dropped terminal
+			}
+			
+			boolean inFullScreen = (this.consoleState == ConsoleState.FSOut || this.consoleState == ConsoleState.FSIn);
+			if (inFullScreen && !this.lastFullScreenOverwritten && this.fsImage.isValid()) {
+				int length = this.fsImage.buildRestoreStream();
+				this.termWriter
+					.appendEscaped(this.fsImage.getRestoreStream(), 0, length)
+					.sendRecord();
+			} else {
+				this.redrawScreen(); // the fullscreen program (if any) will have to repaint
+			}
+		}
+	}
+	
+	/**
+	 * Set the statistics of the connection to record the timings of the console,
+	 * the statistics also querying the console state (fullscreen backlog, output history).
+	 * @param stats the statistics to update.
+	 */
+	public void setStats(ConnectionStats stats) {
+		this.stats = stats;
+		if (stats != null) { stats.setConsole(this); }
+	}
+	
+	/**
+	 * Get the number of host output lines waiting for the fullscreen program to lose the screen.
+	 * @return the number of lines in the fullscreen backlog.
+	 */
+	public int getFsBacklogSize() {
+		return this.fsBacklog.size();
+	}
+	
+	/**
+	 * Get the number of lines in the console output history.
+	 * @return the number of remembered output lines.
+	 */
+	public int getLineBufferSize() {
+		return this.lineBuffer.getSize();
+	}
+	
 	/**
 	 * Reset the MECAFF-console state after the end of a VM session was recognized,
 	 * forgetting all remembered output lines and user input and reinitialize the PF key
@@ -244,7 +351,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		synchronized(this) {
 			if (wait){
 				this.remainingLinesToMore = 0;
-				this.ticksForEndSession = 3;
+				this.startEndSessionTimeout();
 				this.checkForEnterMoreState(0);
 			}
 		
@@ -284,6 +391,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 			this.attrConsoleState = new Attr(Color.Yellow, false);
 			this.attrCmdInput = new Attr(Color.Turquoise, false);
 			
+			this.fsImage.invalidate();
 			this.redrawScreen();
 		}
 	}
@@ -355,7 +463,8 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		ConsoleState newState = InputState2ConsoleState(newInState);
 		logger.debug("::::: setInputState: ", this.consoleState, " ==> ", newState);
 		if (this.consoleState == ConsoleState.Initial) {
-			try { Thread.sleep(50); } catch(InterruptedException exc) { }
+			long waitedMs = this.initialScreenSettle.ensureOpsInterval(); // only waits if the first VM state arrives very fast
+			if (this.stats != null && waitedMs > 0) { this.stats.add(Counter.SettleWaitMicros, waitedMs * 1000); }
 			this.appendHostLine(this.ebcdicString.reset());
 		}
 		synchronized(this) {
@@ -376,6 +485,55 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		}
 	}
 	
+	/**
+	 * FIFO queue for the output lines from the host arriving while a fullscreen
+	 * program owns the screen, holding the lines in a ring of reused byte arrays,
+	 * so queuing a line does not allocate once the queue has reached its working size.
+	 */
+	private static class LineQueue {
+		private byte[][] lines = new byte[16][];
+		private int[] lengths = new int[16];
+		private int first = 0;
+		private int count = 0;
+		
+		public int size() { return this.count; }
+		
+		public byte[] firstBytes() { return this.lines[this.first]; }
+		
+		public int firstLength() { return this.lengths[this.first]; }
+		
+		public void add(byte[] src, int offset, int length) {
+			if (this.count >= this.lines.length) {
+				int capacity = this.lines.length;
+				byte[][] newLines = new byte[capacity * 2][];
+				int[] newLengths = new int[capacity * 2];
+				for (int i = 0; i < capacity; i++) {
+					int s = (this.first + i) % capacity;
+					newLines[i] = this.lines[s];
+					newLengths[i] = this.lengths[s];
+				}
+				this.lines = newLines;
+				this.lengths = newLengths;
+				this.first = 0;
+			}
+			int s = (this.first + this.count) % this.lines.length;
+			byte[] slot = this.lines[s];
+			if (slot == null || slot.length < length) {
+				slot = new byte[Math.max(length, 80)];
+				this.lines[s] = slot;
+			}
+			System.arraycopy(src, offset, slot, 0, length);
+			this.lengths[s] = length;
+			this.count++;
+		}
+		
+		public void removeFirst() {
+			if (this.count == 0) { return; }
+			this.first = (this.first + 1) % this.lines.length;
+			this.count--;
+		}
+	}
+	
 	/**
 	 * Check for lines from the host accumulated while the screen was owned by the
 	 * fullscreen program to the screen, writing them out and entering the More-state
@@ -387,9 +545,8 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		this.consoleState = ConsoleState.Running;
 		this.consumingFsBacklog = false;
 		while (this.fsBacklog.size() > 0 && this.remainingLinesToMore > 1) {
-			byte[] text = this.fsBacklog.get(0);
-			this.fsBacklog.remove(0);
-			int rows = this.lineBuffer.append(text, 0, text.length, LineAttrFScreenBg);
+			int rows = this.lineBuffer.append(this.fsBacklog.firstBytes(), 0, this.fsBacklog.firstLength(), LineAttrFScreenBg);
+			this.fsBacklog.removeFirst();
 			this.remainingLinesToMore -= rows;
 			this.linesSinceLastUserAction++;
 			screenWasAltered = true;
@@ -476,7 +633,8 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	 * ownership.
 	 * @param requiresPreviousFullScreen if <code>true</code>, the screen can only be
 	 *   acquired if it was not modified since the last fullscreen operation, for example
-	 *   by writing out asynchronous output from the host.
+	 *   by writing out asynchronous output from the host, or if the last screen content
+	 *   of the fullscreen program can be restored locally.
 	 * @return <code>true</code> if the screen is now owned by the fullscreen program.
 	 * @throws IOException
 	 */
@@ -486,6 +644,9 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 			// requesting the fullscreen mode automatically ends the flow mode
 			this.inFlowMode = false;
 			
+			// a new fullscreen output stream begins, the previous one was not completed by the host
+			this.closeFullscreenStream(false);
+			
 			if (this.consoleState == ConsoleState.FSOut) {
 				logger.debug("::::: acquireFullScreen(): return TRUE (consoleState was FSOut)");
 				return true; // FSOut(old) -> FSOut(new)
@@ -495,35 +656,32 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				// this.consoleState = ConsoleState.FSOut;
 				return true; // FSIn(old) -> FSIn(new) (premature write after timed out fs-in)
 			}
-			if (requiresPreviousFullScreen && this.lastFullScreenOverwritten) {
-				logger.debug("::::: acquireFullScreen(): return FALSE (requiresPrevious but overwritten)");
-				return false; // FSOut(old) -> FSIn (with async serial output) -> More -> (full-repaint!)
-			}
-			if (requiresPreviousFullScreen && this.linesSinceLastUserAction > 0) {
-					logger.debug("::::: acquireFullScreen(): return FALSE (requiresPrevious but linesSinceLastUserAction)");
+			if (requiresPreviousFullScreen
+					&& (this.lastFullScreenOverwritten || this.linesSinceLastUserAction > 0)) {
+				if (!this.fsImage.isValid()) {
+					if (this.lastFullScreenOverwritten) {
+						logger.debug("::::: acquireFullScreen(): return FALSE (requiresPrevious but overwritten)");
+					} else {
+						logger.debug("::::: acquireFullScreen(): return FALSE (requiresPrevious but linesSinceLastUserAction)");
+					}
 					return false; // FSOut(old) -> FSIn (with async serial output) -> More -> (full-repaint!)
 				}
+				
+				// let the user see the pending output, then put back the program's screen
+				if (this.linesSinceLastUserAction > 0 && !this.runMoreCycles()) {
+					return false; // better do a full repaint
+				}
+				this.restoreFullScreen();
+				logger.debug("::::: acquireFullScreen(): return TRUE (previous fullscreen restored locally)");
+				return true;
+			}
 			if (this.linesSinceLastUserAction == 0 /*&& !this.lastFullScreenOverwritten*/) {
 				if (this.consoleState != ConsoleState.FSIn) { this.consoleState = ConsoleState.FSOut; }
 				logger.debug("::::: acquireFullScreen(): return TRUE (linesSinceLAstUserAction == 0)");
 				return true;
 			}
 			
-			logger.debug("::::: acquireFullScreen(): screen re-used => More-cycle(s)");
-			this.consoleState = ConsoleState.More;
-			this.redrawScreen();
-			try {
-				int waitCycles = 2;
-				int cycles = waitCycles;
-				while (this.consoleState == ConsoleState.More || cycles > 0) { 
-					this.wait(20); 
-					if (this.consoleState == ConsoleState.More) {
-						cycles = waitCycles;
-					} else {
-						cycles--;
-					}
-				}
-			} catch (InterruptedException exc) {
+			if (!this.runMoreCycles()) {
 				return false; // better do a full repaint
 			}
 			this.consoleState = ConsoleState.FSOut;
@@ -532,6 +690,48 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		}
 	}
 	
+	/**
+	 * Show the pending output lines in More-state until the user has seen them all. 
+	 * @return <code>false</code> if waiting for the user was interrupted.
+	 * @throws IOException
+	 */
+	private boolean runMoreCycles() throws IOException { // must be called in "synchronize(this)" !!
+		logger.debug("::::: acquireFullScreen(): screen re-used => More-cycle(s)");
+		this.consoleState = ConsoleState.More;
+		this.redrawScreen();
+		try {
+			int waitCycles = 2;
+			int cycles = waitCycles;
+			while (this.consoleState == ConsoleState.More || cycles > 0) { 
+				this.wait(20); 
+				if (this.consoleState == ConsoleState.More) {
+					cycles = waitCycles;
+				} else {
+					cycles--;
+				}
+			}
+		} catch (InterruptedException exc) {
+			return false;
+		}
+		return true;
+	}
+	
+	/**
+	 * Rebuild the last screen content of the fullscreen program on the terminal, so the
+	 * program can continue with partial updates instead of a full repaint by the host.
+	 * @throws IOException
+	 */
+	private void restoreFullScreen() throws IOException { // must be called in "synchronize(this)" !!
+		int length = this.fsImage.buildRestoreStream();
+		logger.logHexBuffer("restoreFullScreen()", "--------", this.fsImage.getRestoreStream(), length);
+		this.termWriter
+			.appendEscaped(this.fsImage.getRestoreStream(), 0, length)
+			.sendRecord();
+		this.lastFullScreenOverwritten = false;
+		this.linesSinceLastUserAction = 0;
+		this.consoleState = ConsoleState.FSOut;
+	}
+	
 	/**
 	 * Write a 3270 output stream to the terminal, provided the host's program owns the
 	 * screen.
@@ -539,32 +739,92 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	 * @throws IOException
 	 */
 	public void writeFullscreen(ByteBuffer stream3270) throws IOException {
+		this.writeFullscreenPart(stream3270.getInternalBuffer(), stream3270.getLength(), true);
+	}
+	
+	/**
+	 * Write the next part of a 3270 output stream to the terminal, provided the host's
+	 * program owns the screen.
+	 * <p>
+	 * Only the complete 3270 orders at the start of the part are sent to the terminal,
+	 * the caller must pass the remaining bytes (an incomplete order) again in front of the
+	 * next part. The last part completes the record with the telnet EOR.  
+	 * @param rawdata the byte array holding the part, starting with the command byte
+	 *   and WCC for the first part of the stream.
+	 * @param length the length of the part.
+	 * @param isLast is this the last part of the 3270 output stream?
+	 * @return the number of bytes consumed from <code>rawdata</code>.
+	 * @throws IOException
+	 */
+	public int writeFullscreenPart(byte[] rawdata, int length, boolean isLast) throws IOException {
 		synchronized(this) {
+			// ignore the rest of a stream interrupted by the MECAFF console
+			if (this.fsStreamDropped) {
+				logger.debug("::::: writeFullScreen(): DROPPING (stream was interrupted)");
+				if (isLast) { this.fsStreamDropped = false; }
+				return length;
+			}
+			
 			// ignore if not in fullscreen mode (host did not acquire the ownership on the 3270-terminal
 			if (this.consoleState != ConsoleState.FSOut && this.consoleState != ConsoleState.FSIn) {
 				logger.debug("::::: writeFullScreen(): ABORTING (consoleState != {FSOut,FSIn})");
-				return;
+				return length;
 			}
 			
 			// if WCC is present => force it to be 6bit-encoded
-			byte[] rawdata =  stream3270.getInternalBuffer();
-			logger.logHexBuffer("writeFullScreen()", "--------", rawdata, stream3270.getLength());
-			if (stream3270.getLength() > 1 
+			boolean streamStart = !this.fsStreamOpen;
+			logger.logHexBuffer("writeFullScreen()", "--------", rawdata, length);
+			if (streamStart 
+				&& length > 1 
 				&& (rawdata[0] == CommandCode3270.W
 					|| rawdata[0] == CommandCode3270.EW
 					||rawdata[0] == CommandCode3270.EWA)) {
 				/* this CCW has a WCC: force the WCC-byte to be 6bit-encoded */
 				rawdata[1] = Ebcdic6BitEncoding.encode6BitValue(rawdata[1]);
 			}
-
-			// send the stream to the terminal
-			stream3270.writeTo(this.osToTerm, true);
-			this.osToTerm.write(TnEOR);
-			this.osToTerm.flush();
-			this.lastFullScreenOverwritten = false;
-			this.linesSinceLastUserAction = 0;
 			
-			logger.debug("::::: writeFullScreen(): fullscreen written");
+			// find the complete orders to send now
+			int consumed = this.fsImage.applyPart(rawdata, 0, length, streamStart);
+			if (isLast && consumed < length) {
+				this.fsImage.invalidate(); // stream ends with an incomplete order
+				consumed = length;
+			}
+
+			// send the stream (part) to the terminal
+			this.termWriter.appendEscaped(rawdata, 0, consumed);
+			if (isLast) {
+				this.termWriter.sendRecord();
+				if (this.fsInputNanos != 0 && this.stats != null) {
+					this.stats.recordFsRoundtrip(System.nanoTime() - this.fsInputNanos);
+				}
+				this.fsInputNanos = 0;
+				this.fsStreamOpen = false;
+				this.lastFullScreenOverwritten = false;
+				this.linesSinceLastUserAction = 0;
+				logger.debug("::::: writeFullScreen(): fullscreen written");
+			} else if (consumed > 0) {
+				this.termWriter.send();
+				this.fsStreamOpen = true;
+			}
+			return consumed;
+		}
+	}
+	
+	/**
+	 * Terminate a partially sent fullscreen output stream at the last order boundary,
+	 * as something else will be sent to the terminal.
+	 * @param dropRest must the remaining parts of the stream be ignored when coming in? 
+	 * @throws IOException
+	 */
+	private void closeFullscreenStream(boolean dropRest) throws IOException { // must be called in "synchronize(this)" !!
+		if (this.fsStreamOpen) {
+			logger.debug("::::: closeFullscreenStream(): terminating partially sent fullscreen stream");
+			this.fsStreamOpen = false;
+			this.fsStreamDropped = dropRest;
+			this.fsImage.invalidate();
+			this.termWriter.sendRecord();
+		} else if (!dropRest) {
+			this.fsStreamDropped = false;
 		}
 	}
 	
@@ -640,37 +900,38 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 			
 			if (timeout == -42424242) {
 				logger.debug("::::: readFullScreen(): closing fullscreen mode");
-				this.fsRcvTimeout = -1;
-				this.fsRemainingGrace = -1;
+				this.fsImage.invalidate();
+				this.stopFsRcvTimeout();
+				this.stopGracePeriod();
 				this.consoleInputSink.sendFullScreenDataAvailability(false);
 				this.consumeFsBacklog();
 				this.redrawScreen();
 				return;
 			} else if (timeout < 0) {
 				logger.debug("::::: readFullScreen(timeout < 0): fs input available => " + fsInputAvailableNow);
-				this.fsRcvTimeout = -1;
+				this.stopFsRcvTimeout();
 				this.fsGracePeriod = gracePeriod;
-				this.fsRemainingGrace = this.fsGracePeriod;
+				this.startGracePeriod(this.fsGracePeriod);
 				this.consoleInputSink.sendFullScreenDataAvailability(fsInputAvailableNow);
 				return;
 			} else if (timeout >= 0 && fsInputAvailableNow) {
 				logger.debug("::::: readFullScreen(timeout >= 0): fs input IS available, sending buffer");
-				this.fsRcvTimeout = -1;
-				this.fsRemainingGrace = (this.fsLockedToFs) ? this.fsGracePeriod : -1;
+				this.stopFsRcvTimeout();
+				this.startGracePeriod((this.fsLockedToFs) ? this.fsGracePeriod : -1);
 				this.consoleInputSink.sendFullScreenInput(this.fsRcvBuffer, this);
 				this.fsRcvLocked = true;
 				return;
 			} else if (timeout == 0) {
 				logger.debug("::::: readFullScreen(timeout == 0): fs input is NOT available");
-				this.fsRcvTimeout = -1;
-				this.fsRemainingGrace = this.fsGracePeriod;
+				this.stopFsRcvTimeout();
+				this.startGracePeriod(this.fsGracePeriod);
 				this.consoleInputSink.sendFullScreenDataAvailability(false);
 				return;
 			}
 			
-			this.fsRcvTimeout = timeout;
+			this.startFsRcvTimeout(timeout);
 			this.fsGracePeriod = gracePeriod;
-			this.fsRemainingGrace = -1;
+			this.stopGracePeriod();
 			
 			this.fsLockedToFs = (this.fsLockTimeoutValue > 0 && this.fsLockTimeoutValue == timeout);
 			
@@ -694,9 +955,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				|| this.consoleState == ConsoleState.FSIn
 				|| this.fsBacklog.size() > 0
 				|| this.fsLockedToFs) {
-				byte[] copy = new byte[stringLength];
-				System.arraycopy(buffer, stringStart, copy, 0, stringLength);
-				this.fsBacklog.add(ebcdicString.getCopy());
+				this.fsBacklog.add(buffer, stringStart, stringLength);
 				return;
 			}
 			if (this.drainHostOutput && this.drainGuard.eq(buffer, stringStart, stringLength)) {
@@ -722,7 +981,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				|| this.consoleState == ConsoleState.FSIn
 				|| this.fsBacklog.size() > 0
 				|| this.fsLockedToFs) {
-				this.fsBacklog.add(ebcdicString.getCopy());
+				this.fsBacklog.add(ebcdicString.getRawBytes(), 0, ebcdicString.getLength());
 				return;
 			}
 			if (this.drainHostOutput && this.drainGuard.eq(ebcdicString)) {
@@ -809,14 +1068,16 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 					logger.trace("FSIn|FSout, received TnEOR");
 					this.fsRcvBuffer.removeLast(TnEOR.length);
 					this.fsRcvComplete = true; // fs-input is completely transmitted from terminal to us
+					this.fsInputNanos = System.nanoTime();
+					this.fsImage.applyInbound(this.fsRcvBuffer.getInternalBuffer(), this.fsRcvBuffer.getLength());
 					this.fsRcvLocked = false; // fs-input has not yet been sent to the host
 					
 					// if both the console and the host are waiting for the fullscreen response: send it
 					if (this.fsRcvTimeout >= 0 && this.consoleState == ConsoleState.FSIn) {
 						logger.trace("FSIn, timeout not reached, stopping timers and sending to host");
-						this.fsRcvTimeout = -1; // no longer waiting for time-out
-						// this.fsRemainingGrace = -1; // no longer waiting for grace-period end
-						this.fsRemainingGrace = (this.fsLockedToFs) ? this.fsGracePeriod : -1;
+						this.stopFsRcvTimeout(); // no longer waiting for time-out
+						// this.stopGracePeriod(); // no longer waiting for grace-period end
+						this.startGracePeriod((this.fsLockedToFs) ? this.fsGracePeriod : -1);
 						this.fsRcvLocked = true; // fs-input has now been sent to host
 						this.consoleInputSink.sendFullScreenInput(this.fsRcvBuffer, this);
 					}
@@ -937,27 +1198,27 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				this.redrawInputZoneAlone();
 			} else if (aid == AidCode3270.PA01 
 					   && !this.consumingFsBacklog 
-					   && this.ticksForEndSession == 0) {
+					   && !this.endSessionPending) {
 				this.drainHostOutput = this.consoleInputSink.sendInterrupt_CP(this.drainGuard);
 				this.notifyAll();				
 				this.redrawInputZoneAlone(true);
 			} else if (aid == AidCode3270.PA02 
 					   && this.consoleState == ConsoleState.More
 					   && !this.consumingFsBacklog
-					   && this.ticksForEndSession == 0) {
+					   && !this.endSessionPending) {
 				this.drainHostOutput = this.consoleInputSink.sendInterrupt_HT(this.drainGuard);
 				this.notifyAll();
 				this.redrawInputZoneAlone(true);
 			} else if (aid == AidCode3270.PA03
 					   && this.consoleState == ConsoleState.More
 					   && !this.consumingFsBacklog
-					   && this.ticksForEndSession == 0) {
+					   && !this.endSessionPending) {
 				this.drainHostOutput = this.consoleInputSink.sendInterrupt_HX(this.drainGuard);
 				this.notifyAll();
 				this.redrawInputZoneAlone(true);
 			} else if (aid == AidCode3270.PA03
 					   && !this.consumingFsBacklog
-					   && this.ticksForEndSession == 0) {
+					   && !this.endSessionPending) {
 				this.drainHostOutput = this.consoleInputSink.sendPF03();
 				this.notifyAll();
 				this.redrawInputZoneAlone(true);
@@ -978,7 +1239,9 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	// tell our client to send a user command to the host
 	private void sendInputToHost(AidCode3270 aid, byte[] buffer, int stringStart, int stringLength) throws IOException {
 		this.userInputString.reset().appendEbcdic(buffer, stringStart, stringLength);
-		logger.debug("UserInput: ", aid, " : Str<", this.userInputString.getLength(), ">(", this.userInputString.getString(), ")");
+		if (logger.isDebug()) {
+			logger.debug("UserInput: ", aid, " : Str<", this.userInputString.getLength(), ">(", this.userInputString.getString(), ")");
+		}
 		this.consoleInputSink.sendUserInput(this.userInputString);
 	}
 	
@@ -1116,16 +1379,20 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	 * Console output routines
 	 */
 	
-	private ArrayList<byte[]> tmpLines = new ArrayList<byte[]>();
-	private ArrayList<Byte> tmpFlags = new ArrayList<Byte>();
+	// the current output frame, filled with references to the line buffer's arrays when redrawing
+	private final byte[][] frameLines;
+	private final int[] frameLengths;
+	private final byte[] frameFlags;
 	
 	// routine to ensure a pause for terminals needing some time between ingoing 3270 output streams
 	private void OutPause() {
+		long start = System.nanoTime();
 		try {
 			Thread.sleep(this.termTransmissionDelayMs);
 		} catch(InterruptedException exc) {
 			
 		}
+		if (this.stats != null) { this.stats.add(Counter.OutPauseMicros, (System.nanoTime() - start) / 1000); }
 	}
 	
 	/**
@@ -1143,12 +1410,13 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 				.repeatToAddress(this.ifStartRow, 1, (byte)0x00);
 		}
 		
-		int lineCount = this.lineBuffer.getPageLinesAndFlags(this.tmpLines, this.tmpFlags);
+		int lineCount = this.lineBuffer.getPageLinesAndFlags(this.frameLines, this.frameLengths, this.frameFlags);
 		int currRow = 1;
 		for (int i = 0; i < lineCount && currRow <= this.outZoneRows; i++) {
-			byte[] line = this.tmpLines.get(i);
-			byte flag = this.tmpFlags.get(i).byteValue();
-			int supplRows = (line.length - 1) / this.altCols;
+			byte[] line = this.frameLines[i];
+			int lineLength = this.frameLengths[i];
+			byte flag = this.frameFlags[i];
+			int supplRows = (lineLength - 1) / this.altCols;
 			boolean isHighlight = false;
 			this.buf3270.setBufferAddress(currRow, 1);
 			if (flag == LineAttrUserInput) {
@@ -1164,7 +1432,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 			if (isHighlight) {
 				// TODO: use Highlight on 3270 screen
 			}
-			this.buf3270.appendEbcdic(line);
+			if (lineLength > 0) { this.buf3270.appendEbcdic(line, 0, lineLength); }
 			if (isHighlight) {
 				// TODO: reset Highlight on 3270 screen
 			}
@@ -1172,6 +1440,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		}
 		
 		if (flush) {
+			this.closeFullscreenStream(true);
 			this.buf3270
 				.telnetEOR()
 				.writeToSink(this.osToTerm, true);
@@ -1223,6 +1492,7 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 		}
 		
 		if (flush) {
+			this.closeFullscreenStream(true);
 			this.buf3270
 				.telnetEOR()
 				.writeToSink(this.osToTerm, true);
@@ -1294,75 +1564,115 @@ public class Vm3270Console implements IVm3270ConsoleCompletedSink, Runnable, Ebc
 	}
 	
 	/*
-	 * Background timers for different timeouts.
+	 * Timeouts, armed with the process-wide TimeoutScheduler only while running.
+	 * 
+	 * As a timeout may expire while it is cancelled or re-armed, each handler checks
+	 * (in this instance's monitor) if it still is the currently armed one before acting.
 	 */
 	
 	/**
-	 * Handler for 1 second interval ticks, generating the timeout
-	 * events for the MECAFF-console after the VM-session ending. 
+	 * Start the timeout for resetting the MECAFF-console after the VM-session ended.
 	 */
-	private void onSessionTick() {
+	private void startEndSessionTimeout() {
+		TimeoutScheduler.cancel(this.endSessionDeadline);
+		this.endSessionPending = true;
+		this.endSessionDeadline = TimeoutScheduler.schedule(EndSessionDelayMs, new Runnable() {
+			public void run() { onEndSessionTimeout(); }
+		});
+	}
+	
+	/**
+	 * Handler for the timeout after the VM-session ending. 
+	 */
+	private void onEndSessionTimeout() {
 		synchronized(this) {
-			if (this.ticksForEndSession > 1) {
-				this.ticksForEndSession--;
-			} else if (this.ticksForEndSession == 1) {
-				this.ticksForEndSession = 0;			
-				this.remainingLinesToMore = this.outZoneRows;
-				this.linesSinceLastUserAction = 0;
-				this.consoleState = ConsoleState.Running; 
-				this.notifyAll();
-			}			
+			if (!this.endSessionPending || this.closed) { return; }
+			this.endSessionPending = false;
+			this.endSessionDeadline = null;
+			this.remainingLinesToMore = this.outZoneRows;
+			this.linesSinceLastUserAction = 0;
+			this.consoleState = ConsoleState.Running; 
+			this.notifyAll();
+		}
+	}
+	
+	/**
+	 * Start waiting for the fullscreen input from the terminal, arming the
+	 * timeout if one is requested.
+	 * @param timeout the timeout in 1/10 seconds or <code>FsRcvNOTIMEOUT</code>.
+	 */
+	private void startFsRcvTimeout(int timeout) {
+		this.stopFsRcvTimeout();
+		this.fsRcvTimeout = timeout;
+		if (timeout == FsRcvNOTIMEOUT || this.closed) { return; }
+		final int gen = this.fsRcvDeadlineGen;
+		this.fsRcvDeadline = TimeoutScheduler.schedule(timeout * 100L, new Runnable() {
+			public void run() { onFsRcvTimeout(gen); }
+		});
+	}
+	
+	/**
+	 * Stop waiting for the fullscreen input, disarming the timeout if running.
+	 */
+	private void stopFsRcvTimeout() {
+		this.fsRcvTimeout = -1;
+		this.fsRcvDeadlineGen++;
+		this.fsRcvDeadline = TimeoutScheduler.cancel(this.fsRcvDeadline);
+	}
+	
+	/**
+	 * (Re)start the grace period after a fullscreen read, replacing a running one.
+	 * @param gracePeriod the grace period in 1/10 seconds, with values &lt; 1 only stopping
+	 *   a running grace period.
+	 */
+	private void startGracePeriod(int gracePeriod) {
+		this.stopGracePeriod();
+		if (gracePeriod < 1 || this.closed) { return; }
+		final int gen = this.fsGraceDeadlineGen;
+		this.fsGraceDeadline = TimeoutScheduler.schedule(gracePeriod * 100L, new Runnable() {
+			public void run() { onGracePeriodEnd(gen); }
+		});
+	}
+	
+	/**
+	 * Stop the grace period if running.
+	 */
+	private void stopGracePeriod() {
+		this.fsGraceDeadlineGen++;
+		this.fsGraceDeadline = TimeoutScheduler.cancel(this.fsGraceDeadline);
+	}
+	
+	/**
+	 * Handler for the end of the grace period, releasing the screen from fullscreen.
+	 * @param gen the identification of the grace period that ended.
+	 */
+	private void onGracePeriodEnd(int gen) {
+		synchronized(this) {
+			if (gen != this.fsGraceDeadlineGen || this.closed) { return; }
+			this.fsGraceDeadline = null;
+			logger.debug("onGracePeriodEnd: grace period ended, doing: this.consumeFsBacklog()");
+			try { this.consumeFsBacklog(); } catch (IOException e) { }
+			this.fsLockedToFs = false;
 		}
 	}
 	
 	/**
-	 * Handler for 1/10 second interval ticks, generating the timeout
-	 * events for fullscreen read operations
+	 * Handler for the timeout of a fullscreen read operation.
+	 * @param gen the identification of the fs-read timeout that expired.
 	 */
-	private void onTimerTick() {
+	private void onFsRcvTimeout(int gen) {
 		synchronized(this) {
-			if (this.fsRemainingGrace > 0) {
-				this.fsRemainingGrace--;
-				if (this.fsRemainingGrace == 0) {
-					logger.debug("onTimerTick: grace period ended, doing: this.consumeFsBacklog()");
-					try { this.consumeFsBacklog(); } catch (IOException e) { }
-					this.fsRemainingGrace = -1;
-					this.fsLockedToFs = false;
-				}
-			}
-			if (this.fsRcvTimeout < 0 || this.fsRcvTimeout == FsRcvNOTIMEOUT) { return; }
-			this.fsRcvTimeout--;
-			if (this.fsRcvTimeout > 0) { return; } // not timed out yet
+			if (gen != this.fsRcvDeadlineGen || this.closed) { return; }
+			this.fsRcvDeadline = null;
+			this.fsRcvTimeout = -1;
 			try {
-				logger.debug("onTimerTick: reached fsIn timeout, sending timed-out response");
+				logger.debug("onFsRcvTimeout: reached fsIn timeout, sending timed-out response");
 				this.consoleInputSink.sendFullScreenTimedOut();
-				logger.debug("onTimerTick: grace period started");
-				this.fsRemainingGrace = this.fsGracePeriod;
+				logger.debug("onFsRcvTimeout: grace period started");
+				this.startGracePeriod(this.fsGracePeriod);
 			} catch (IOException e) {
 				// simply ignore a broken connection 
 			}
-			this.fsRcvTimeout = -1;
 		}
 	}
-
-	/**
-	 * Background thread implementation allowing for timeouts with 1/10 and 1 second resolution.
-	 */
-	@Override
-	public void run() {
-		try {
-			int sessionCounter = 0;
-			while(!this.closed) {
-				this.onTimerTick();
-				sessionCounter++;
-				if (sessionCounter > 10) {
-					  this.onSessionTick();
-					  sessionCounter = 0;
-				}
-				Thread.sleep(100);
-			}
-		} catch(InterruptedException exc) {
-			// ignored, ticker is stopped when interruption occurs
-		}		
-	}
 }
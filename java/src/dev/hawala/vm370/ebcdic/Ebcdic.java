@@ -268,7 +268,9 @@ public class Ebcdic {
 	 * @return the resulting EBCDIC byte sequence.
 	 */
 	public static byte[] toEbcdic(String s) {
-		return toEbcdic(s.getBytes());
+		byte[] bBytes = new byte[s.length()];
+		unicodeToEbcdic(s, 0, bBytes, 0, bBytes.length);
+		return bBytes;
 	}
 	
 	/**
@@ -278,9 +280,7 @@ public class Ebcdic {
 	 */
 	public static byte[] toEbcdic(byte[] aBytes) {
 		 byte[] bBytes = new byte[aBytes.length];
-		 for (int i = 0; i < aBytes.length; i++) {
-			 bBytes[i] = A2E[aBytes[i]];
-		 }
+		 asciiToEbcdic(aBytes, 0, bBytes, 0, aBytes.length);
 		 return bBytes;
 	}
 	
@@ -292,11 +292,64 @@ public class Ebcdic {
 	 * @return the resulting Java string for the EBCDIC string.
 	 */
 	public static String toAscii(byte[] bBytes, int offset, int length) {
-		 byte[] aBytes = new byte[length];
-		 for (int i = offset; i < offset + length; i++) {
-			 byte b = bBytes[i];
-			 aBytes[i-offset] = E2A[(b < 0) ? 256 + b : b];
+		 char[] chars = new char[length];
+		 for (int i = 0; i < length; i++) {
+			 chars[i] = (char)E2A[bBytes[offset + i] & 0xFF];
 		 }
-		 return new String(aBytes);
+		 return new String(chars);
+	}
+	
+	/*
+	 * bulk conversions on byte array slices, the source and target slices
+	 * may be the same for an in-place conversion
+	 */
+	
+	/**
+	 * Convert an ASCII byte sequence to EBCDIC, bytes outside the ASCII range
+	 * becoming blanks.
+	 * @param src the byte array with the ASCII bytes to convert.
+	 * @param srcOffset the offset of the first byte to convert.
+	 * @param dst the byte array where to put the EBCDIC bytes (may be <code>src</code>).
+	 * @param dstOffset the offset where to put the first converted byte.
+	 * @param length the number of bytes to convert.
+	 */
+	public static void asciiToEbcdic(byte[] src, int srcOffset, byte[] dst, int dstOffset, int length) {
+		final byte[] table = A2E;
+		for (int i = 0; i < length; i++) {
+			dst[dstOffset + i] = table[src[srcOffset + i] & 0xFF];
+		}
+	}
+	
+	/**
+	 * Convert an EBCDIC byte sequence to ASCII, characters without ASCII
+	 * equivalent becoming blanks.
+	 * @param src the byte array with the EBCDIC bytes to convert.
+	 * @param srcOffset the offset of the first byte to convert.
+	 * @param dst the byte array where to put the ASCII bytes (may be <code>src</code>).
+	 * @param dstOffset the offset where to put the first converted byte.
+	 * @param length the number of bytes to convert.
+	 */
+	public static void ebcdicToAscii(byte[] src, int srcOffset, byte[] dst, int dstOffset, int length) {
+		final byte[] table = E2A;
+		for (int i = 0; i < length; i++) {
+			dst[dstOffset + i] = table[src[srcOffset + i] & 0xFF];
+		}
+	}
+	
+	/**
+	 * Convert the characters of a Java string to EBCDIC, characters outside
+	 * the ASCII range becoming blanks.
+	 * @param s the string with the characters to convert.
+	 * @param sOffset the index of the first character to convert.
+	 * @param dst the byte array where to put the EBCDIC bytes.
+	 * @param dstOffset the offset where to put the first converted character.
+	 * @param length the number of characters to convert.
+	 */
+	public static void unicodeToEbcdic(String s, int sOffset, byte[] dst, int dstOffset, int length) {
+		final byte[] table = A2E;
+		for (int i = 0; i < length; i++) {
+			char c = s.charAt(sOffset + i);
+			dst[dstOffset + i] = (c < 256) ? table[c] : _Blank;
+		}
 	}
 }
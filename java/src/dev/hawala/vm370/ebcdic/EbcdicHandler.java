@@ -127,10 +127,29 @@ public class EbcdicHandler {
 	public EbcdicHandler appendEbcdic(byte[] fromBytes, int offset, int length) {
 		if (offset < 0) { offset = 0; }
 		if (offset >= fromBytes.length) { return this; }
-		length = Math.min(fromBytes.length - offset, length);
-		while(this.currLength < this.maxLength && length > 0) {
-			this.buffer[this.currLength++] = fromBytes[offset++];
-			length--;
+		length = Math.min(Math.min(fromBytes.length - offset, length), this.maxLength - this.currLength);
+		if (length > 0) {
+			System.arraycopy(fromBytes, offset, this.buffer, this.currLength, length);
+			this.currLength += length;
+		}
+		this.isoEquiv = null;
+		return this;
+	}
+	
+	/**
+	 * Append an ASCII byte sequence to this instance, converting it to EBCDIC.
+	 * @param fromBytes the byte buffer where to take the ASCII characters to append.
+	 * @param offset the offset of the first character to append.
+	 * @param length the length of the byte sequence to append.
+	 * @return this instance for function call chaining.
+	 */
+	public EbcdicHandler appendAscii(byte[] fromBytes, int offset, int length) {
+		if (offset < 0) { offset = 0; }
+		if (offset >= fromBytes.length) { return this; }
+		length = Math.min(Math.min(fromBytes.length - offset, length), this.maxLength - this.currLength);
+		if (length > 0) {
+			Ebcdic.asciiToEbcdic(fromBytes, offset, this.buffer, this.currLength, length);
+			this.currLength += length;
 		}
 		this.isoEquiv = null;
 		return this;
@@ -142,12 +161,29 @@ public class EbcdicHandler {
 	 * @return this instance for function call chaining.
 	 */
 	public EbcdicHandler appendUnicode(String unicodeString) {
-		byte[] ebcdicChars = Ebcdic.toEbcdic(unicodeString);
-		this.appendEbcdic(ebcdicChars, 0, ebcdicChars.length);
+		int length = Math.min(unicodeString.length(), this.maxLength - this.currLength);
+		if (length > 0) {
+			Ebcdic.unicodeToEbcdic(unicodeString, 0, this.buffer, this.currLength, length);
+			this.currLength += length;
+		}
 		this.isoEquiv = null;
 		return this;
 	}
 	
+	/**
+	 * Append the EBCDIC string in this instance converted to ASCII to a byte buffer.
+	 * @param toBuffer the byte buffer to append to.
+	 * @param atOffset the offset position in the buffer where start appending.
+	 * @return the offset of the first byte in the buffer following the appended ASCII string.
+	 */
+	public int addAsciiTo(byte[] toBuffer, int atOffset) {
+		if (atOffset < 0) { atOffset = 0; }
+		int count = Math.min(this.currLength, toBuffer.length - atOffset);
+		if (count <= 0) { return atOffset; }
+		Ebcdic.ebcdicToAscii(this.buffer, 0, toBuffer, atOffset, count);
+		return atOffset + count;
+	}
+	
 	/**
 	 * Append the EBCDIC string in this instance to a byte buffer.
 	 * @param toBuffer the byte buffer to append to.
@@ -157,10 +193,10 @@ public class EbcdicHandler {
 	public int addTo(byte[] toBuffer, int atOffset) {
 		int lastAllowed = toBuffer.length - 1;
 		if (atOffset < 0) { atOffset = 0; }
-		for (int i = 0; i < this.currLength && atOffset < lastAllowed; i++, atOffset++) {
-			toBuffer[atOffset] = this.buffer[i];
-		}
-		return atOffset;
+		int count = Math.min(this.currLength, lastAllowed - atOffset);
+		if (count <= 0) { return atOffset; }
+		System.arraycopy(this.buffer, 0, toBuffer, atOffset, count);
+		return atOffset + count;
 	}
 	
 	/**
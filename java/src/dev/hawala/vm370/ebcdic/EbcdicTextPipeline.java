@@ -121,16 +121,11 @@ public class EbcdicTextPipeline implements Runnable {
 	 * result is converted to EBCDIC before appending.
 	 */
 	public void appendLine(Object... elems) {
-		logger.trace(this.prefix, " begin appendLine([", elems.length , "]: '", elems[0].toString() ,"'", ((elems.length > 1) ? ",..." : ""),")");
+		if (logger.isTrace()) {
+			logger.trace(this.prefix, " begin appendLine([", elems.length , "]: '", elems[0].toString() ,"'", ((elems.length > 1) ? ",..." : ""),")");
+		}
 		synchronized(this) {			
-			EbcdicLine newLine = this.freeLines;
-			if (newLine == null) {
-				newLine = new EbcdicLine();
-			} else {
-				this.freeLines = this.freeLines.next;
-			}
-			newLine.next = null;
-			
+			EbcdicLine newLine = this.getFreeLine();
 			
 			for(Object elem : elems) {
 				if (elem instanceof EbcdicHandler) {
@@ -143,19 +138,54 @@ public class EbcdicTextPipeline implements Runnable {
 					newLine.appendUnicode(elem.toString());
 				}
 			}
-			if (this.queuedTail == null) {
-				this.queuedTail = newLine;
-				this.queuedLines = newLine;
-			} else {
-				this.queuedTail.next = newLine;
-				this.queuedTail = newLine;
-			}
-			this.queuedCount++;
+			this.enqueue(newLine);
+		}
+		logger.trace(this.prefix, " end appendLine()");
+	}
+	
+	/**
+	 * Send a copy of the EBCDIC line to the target of the pipeline.
+	 * <p>
+	 * Other than the general <code>appendLine()</code>, this method does not
+	 * allocate memory as long as the pipeline has free line buffers.
+	 * @param line the EBCDIC string to enqueue.
+	 */
+	public void appendLine(EbcdicHandler line) {
+		if (logger.isTrace()) {
+			logger.trace(this.prefix, " begin appendLine('", line, "')");
+		}
+		synchronized(this) {
+			EbcdicLine newLine = this.getFreeLine();
+			newLine.append(line);
+			this.enqueue(newLine);
 		}
-		try { Thread.sleep(1); } catch(Exception exc) { }
 		logger.trace(this.prefix, " end appendLine()");
 	}
 	
+	// get an empty line buffer, reusing the lines already delivered (must be called synchronized)
+	private EbcdicLine getFreeLine() {
+		EbcdicLine newLine = this.freeLines;
+		if (newLine == null) {
+			newLine = new EbcdicLine();
+		} else {
+			this.freeLines = this.freeLines.next;
+		}
+		newLine.next = null;
+		return newLine;
+	}
+	
+	// add the line at the end of the queue (must be called synchronized)
+	private void enqueue(EbcdicLine newLine) {
+		if (this.queuedTail == null) {
+			this.queuedTail = newLine;
+			this.queuedLines = newLine;
+		} else {
+			this.queuedTail.next = newLine;
+			this.queuedTail = newLine;
+		}
+		this.queuedCount++;
+	}
+	
 	/**
 	 * Get the first element in the pipeline's queue without removing it. 
 	 * @return the first element or <code>null</code> if the pipeline is empty.
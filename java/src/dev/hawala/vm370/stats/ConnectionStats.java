@@ -0,0 +1,286 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+import java.io.FilterInputStream;
+import java.io.FilterOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.text.SimpleDateFormat;
+import java.util.Date;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicLongArray;
+
+import dev.hawala.vm370.Vm3270Console;
+
+/**
+ * Statistics of a single MECAFF connection.
+ * <p>
+ * All counters are lock-free atomics updated by the threads of the connection,
+ * so recording costs no more than an atomic add and can stay enabled in production.
+ * The gauges (fullscreen backlog, output history) are read from the MECAFF console
+ * when queried.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class ConnectionStats extends StatsCounters implements ConnectionStatsMBean {
+
+	private static final byte IAC = (byte)0xFF;
+	private static final byte EOR = (byte)0xEF;
+
+	private final int connectionNo;
+	private final String filterName;
+	private final long startTime = System.currentTimeMillis();
+
+	private final AtomicLongArray counters = new AtomicLongArray(Counter.values().length);
+	private final AtomicLongArray roundtripBuckets = new AtomicLongArray(RoundtripBuckets);
+	private final AtomicLong roundtripMaxMicros = new AtomicLong(0);
+
+	private volatile Vm3270Console console = null;
+
+	/**
+	 * Construct the statistics for a connection.
+	 * @param connectionNo the connection counter value of the connection.
+	 * @param filterName the (simple) class name of the stream filter.
+	 */
+	public ConnectionStats(int connectionNo, String filterName) {
+		this.connectionNo = connectionNo;
+		this.filterName = filterName;
+	}
+
+	/**
+	 * Set the MECAFF console of the connection, providing the gauge values.
+	 * @param console the console (<code>null</code> when the console is closed).
+	 */
+	public void setConsole(Vm3270Console console) {
+		this.console = console;
+	}
+
+	/**
+	 * Add to a counter.
+	 * @param counter the counter to increment.
+	 * @param delta the value to add.
+	 */
+	public void add(Counter counter, long delta) {
+		this.counters.addAndGet(counter.ordinal(), delta);
+	}
+
+	/**
+	 * Increment a counter by 1.
+	 * @param counter the counter to increment.
+	 */
+	public void increment(Counter counter) {
+		this.counters.incrementAndGet(counter.ordinal());
+	}
+
+	/**
+	 * Record the time of a fullscreen roundtrip, from the input of the terminal
+	 * to the completion of the next fullscreen output.
+	 * @param nanos the roundtrip time in nanoseconds.
+	 */
+	public void recordFsRoundtrip(long nanos) {
+		long micros = nanos / 1000;
+		this.counters.incrementAndGet(Counter.FsRoundtrips.ordinal());
+		this.counters.addAndGet(Counter.FsRoundtripMicros.ordinal(), micros);
+		this.roundtripBuckets.incrementAndGet(bucketFor(micros));
+		long max = this.roundtripMaxMicros.get();
+		while (micros > max && !this.roundtripMaxMicros.compareAndSet(max, micros)) {
+			max = this.roundtripMaxMicros.get();
+		}
+	}
+
+	/**
+	 * Add the counters of a closed connection to these (accumulating) statistics.
+	 * @param other the statistics to add.
+	 */
+	void absorb(ConnectionStats other) {
+		for (int i = 0; i < this.counters.length(); i++) {
+			this.counters.addAndGet(i, other.counters.get(i));
+		}
+		for (int i = 0; i < RoundtripBuckets; i++) {
+			this.roundtripBuckets.addAndGet(i, other.roundtripBuckets.get(i));
+		}
+		long max = other.roundtripMaxMicros.get();
+		if (max > this.roundtripMaxMicros.get()) { this.roundtripMaxMicros.set(max); }
+	}
+
+	@Override
+	public long get(Counter counter) {
+		return this.counters.get(counter.ordinal());
+	}
+
+	@Override
+	public long getRoundtripBucket(int bucket) {
+		return this.roundtripBuckets.get(bucket);
+	}
+
+	@Override
+	public long getRoundtripMaxMicros() {
+		return this.roundtripMaxMicros.get();
+	}
+
+	public int getConnectionNo() { return this.connectionNo; }
+
+	public String getFilterName() { return this.filterName; }
+
+	public String getConnectedSince() {
+		return new SimpleDateFormat("yyyy-MM-dd HH:mm:ss").format(new Date(this.startTime));
+	}
+
+	public int getFsBacklogLines() {
+		Vm3270Console c = this.console;
+		return (c != null) ? c.getFsBacklogSize() : 0;
+	}
+
+	public int getLineBufferLines() {
+		Vm3270Console c = this.console;
+		return (c != null) ? c.getLineBufferSize() : 0;
+	}
+
+	/**
+	 * Wrap an input stream of the connection so the bytes and telnet records
+	 * read are counted.
+	 * @param is the input stream to wrap.
+	 * @param terminalSide is <code>is</code> connected to the terminal (else the host)?
+	 * @return the counting input stream.
+	 */
+	public InputStream wrap(InputStream is, boolean terminalSide) {
+		return (terminalSide)
+			? new CountingInputStream(is, Counter.TerminalBytesIn, Counter.TerminalRecordsIn)
+			: new CountingInputStream(is, Counter.HostBytesIn, Counter.HostRecordsIn);
+	}
+
+	/**
+	 * Wrap an output stream of the connection so the bytes and telnet records
+	 * written are counted.
+	 * @param os the output stream to wrap.
+	 * @param terminalSide is <code>os</code> connected to the terminal (else the host)?
+	 * @return the counting output stream.
+	 */
+	public OutputStream wrap(OutputStream os, boolean terminalSide) {
+		return (terminalSide)
+			? new CountingOutputStream(os, Counter.TerminalBytesOut, Counter.TerminalRecordsOut)
+			: new CountingOutputStream(os, Counter.HostBytesOut, Counter.HostRecordsOut);
+	}
+
+	/**
+	 * Counter for the telnet records in a byte stream, recognizing IAC EOR
+	 * while skipping escaped IAC bytes, also across buffer boundaries.
+	 */
+	private static class RecordScanner {
+		private boolean afterIac = false;
+
+		public int scan(byte[] b, int off, int len) {
+			int records = 0;
+			int end = off + len;
+			boolean iac = this.afterIac;
+			for (int i = off; i < end; i++) {
+				byte c = b[i];
+				if (iac) {
+					if (c == EOR) { records++; }
+					iac = false;
+				} else if (c == IAC) {
+					iac = true;
+				}
+			}
+			this.afterIac = iac;
+			return records;
+		}
+
+		public int scan(byte c) {
+			if (this.afterIac) {
+				this.afterIac = false;
+				return (c == EOR) ? 1 : 0;
+			}
+			this.afterIac = (c == IAC);
+			return 0;
+		}
+	}
+
+	/**
+	 * Input stream counting the bytes and telnet records read.
+	 */
+	private class CountingInputStream extends FilterInputStream {
+
+		private final Counter bytes;
+		private final Counter records;
+		private final RecordScanner scanner = new RecordScanner();
+
+		public CountingInputStream(InputStream is, Counter bytes, Counter records) {
+			super(is);
+			this.bytes = bytes;
+			this.records = records;
+		}
+
+		@Override
+		public int read() throws IOException {
+			int b = super.read();
+			if (b >= 0) {
+				add(this.bytes, 1);
+				if (this.scanner.scan((byte)b) > 0) { increment(this.records); }
+			}
+			return b;
+		}
+
+		@Override
+		public int read(byte[] b, int off, int len) throws IOException {
+			int count = super.read(b, off, len);
+			if (count > 0) { this.count(b, off, count); }
+			return count;
+		}
+
+		private void count(byte[] b, int off, int len) {
+			add(this.bytes, len);
+			int recs = this.scanner.scan(b, off, len);
+			if (recs > 0) { add(this.records, recs); }
+		}
+	}
+
+	/**
+	 * Output stream counting the bytes and telnet records written.
+	 */
+	private class CountingOutputStream extends FilterOutputStream {
+
+		private final Counter bytes;
+		private final Counter records;
+		private final RecordScanner scanner = new RecordScanner();
+
+		public CountingOutputStream(OutputStream os, Counter bytes, Counter records) {
+			super(os);
+			this.bytes = bytes;
+			this.records = records;
+		}
+
+		@Override
+		public void write(int b) throws IOException {
+			this.out.write(b);
+			add(this.bytes, 1);
+			if (this.scanner.scan((byte)b) > 0) { increment(this.records); }
+		}
+
+		@Override
+		public void write(byte[] b, int off, int len) throws IOException {
+			this.out.write(b, off, len); // not byte-wise as in FilterOutputStream
+			this.count(b, off, len);
+		}
+
+		private void count(byte[] b, int off, int len) {
+			add(this.bytes, len);
+			int recs = this.scanner.scan(b, off, len);
+			if (recs > 0) { add(this.records, recs); }
+		}
+	}
+}
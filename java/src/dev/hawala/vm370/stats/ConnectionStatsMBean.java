@@ -0,0 +1,32 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+/**
+ * MBean interface for the statistics of a single MECAFF connection.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public interface ConnectionStatsMBean extends IStatsCounters {
+
+	/** @return the connection counter value of the connection. */
+	public int getConnectionNo();
+
+	/** @return the (simple) class name of the stream filter of the connection. */
+	public String getFilterName();
+
+	/** @return the start time of the connection. */
+	public String getConnectedSince();
+}
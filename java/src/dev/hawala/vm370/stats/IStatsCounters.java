@@ -0,0 +1,78 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+/**
+ * Counters and gauges common to the statistics of a single connection and
+ * the aggregated statistics of all connections, seen as MBean attributes.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public interface IStatsCounters {
+
+	/** @return the number of bytes read from the terminal. */
+	public long getTerminalBytesIn();
+
+	/** @return the number of telnet records (EOR-terminated) read from the terminal. */
+	public long getTerminalRecordsIn();
+
+	/** @return the number of bytes written to the terminal. */
+	public long getTerminalBytesOut();
+
+	/** @return the number of telnet records (EOR-terminated) written to the terminal. */
+	public long getTerminalRecordsOut();
+
+	/** @return the number of bytes read from the host. */
+	public long getHostBytesIn();
+
+	/** @return the number of telnet records (EOR-terminated) read from the host. */
+	public long getHostRecordsIn();
+
+	/** @return the number of bytes written to the host. */
+	public long getHostBytesOut();
+
+	/** @return the number of telnet records (EOR-terminated) written to the host. */
+	public long getHostRecordsOut();
+
+	/** @return the number of encoded transport commands (chunks) received from the host. */
+	public long getTransportChunksIn();
+
+	/** @return the number of encoded chunks sent to the host. */
+	public long getTransportChunksOut();
+
+	/** @return the milliseconds spent sleeping between outputs to the terminal. */
+	public long getOutPauseMillis();
+
+	/** @return the milliseconds spent waiting for the initial screen to settle. */
+	public long getSettleWaitMillis();
+
+	/** @return the number of fullscreen roundtrips (terminal input to completed host output). */
+	public long getFsRoundtrips();
+
+	/** @return the average fullscreen roundtrip time in milliseconds. */
+	public double getFsRoundtripAvgMillis();
+
+	/** @return the longest fullscreen roundtrip time in milliseconds. */
+	public double getFsRoundtripMaxMillis();
+
+	/** @return the fullscreen roundtrip histogram as text ("&lt;5ms:n &lt;10ms:n ..."). */
+	public String getFsRoundtripHistogram();
+
+	/** @return the number of host output lines waiting for the fullscreen program to lose the screen. */
+	public int getFsBacklogLines();
+
+	/** @return the number of lines in the console output history. */
+	public int getLineBufferLines();
+}
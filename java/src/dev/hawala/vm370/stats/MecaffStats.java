@@ -0,0 +1,256 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.lang.management.ManagementFactory;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.util.ArrayList;
+import java.util.List;
+
+import javax.management.JMException;
+import javax.management.MBeanServer;
+import javax.management.ObjectName;
+
+import dev.hawala.vm370.Log;
+
+/**
+ * Registry of the statistics of the MECAFF connections, providing the aggregated
+ * statistics over all connections (open and closed) and publishing the statistics
+ * as JMX MBeans and through an optional plain-text endpoint on the local host.
+ * <p>
+ * The MBeans are registered in the platform MBean server below the domain
+ * <code>dev.hawala.vm370</code>: the aggregated statistics as <code>type=Mecaff</code>,
+ * each open connection as <code>type=Connection,name=NN</code>.
+ * <p>
+ * The plain-text endpoint (MECAFF command line parameter <code>-statsPort:</code>)
+ * writes the report with "key value" lines to each client connecting and closes
+ * the connection, so the statistics can be queried with <code>nc localhost port</code>.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class MecaffStats extends StatsCounters implements MecaffStatsMBean {
+
+	private static Log logger = Log.getLogger();
+
+	private static final String Domain = "dev.hawala.vm370";
+
+	private static final MecaffStats totals = new MecaffStats();
+
+	// the statistics of the open connections
+	private static final List<ConnectionStats> connections = new ArrayList<ConnectionStats>();
+
+	// the accumulated statistics of the closed connections
+	private static final ConnectionStats retired = new ConnectionStats(0, "(closed)");
+
+	private static long connectionCount = 0;
+
+	private static MBeanServer mbeanServer = null;
+
+	private MecaffStats() { }
+
+	/**
+	 * Publish the statistics as MBeans in the platform MBean server.
+	 */
+	public static synchronized void enableJmx() {
+		if (mbeanServer != null) { return; }
+		try {
+			mbeanServer = ManagementFactory.getPlatformMBeanServer();
+			mbeanServer.registerMBean(totals, new ObjectName(Domain + ":type=Mecaff"));
+			for (ConnectionStats stats : connections) {
+				register(stats);
+			}
+		} catch (JMException exc) {
+			logger.warn("unable to register MECAFF statistics MBean: ", exc.getMessage());
+		}
+	}
+
+	/**
+	 * Start the plain-text endpoint listening on the loopback interface.
+	 * @param port the port to listen on.
+	 * @return <code>false</code> if the port could not be opened.
+	 */
+	public static boolean startTextEndpoint(int port) {
+		final ServerSocket server;
+		try {
+			server = new ServerSocket(port, 4, InetAddress.getByName("127.0.0.1"));
+		} catch (IOException exc) {
+			logger.error("** Unable to open statistics port ", port, ": ", exc.getMessage());
+			return false;
+		}
+		Thread thread = new Thread(new Runnable() {
+			public void run() { serveText(server); }
+		}, "statistics :" + port);
+		thread.setDaemon(true);
+		thread.start();
+		logger.info("Statistics available on localhost port ", port);
+		return true;
+	}
+
+	// worker routine for the plain-text endpoint thread
+	private static void serveText(ServerSocket server) {
+		while (true) {
+			Socket client = null;
+			try {
+				client = server.accept();
+				OutputStream os = client.getOutputStream();
+				os.write(getTotals().getReport().getBytes("US-ASCII"));
+				os.flush();
+			} catch (IOException exc) {
+				logger.warn("statistics endpoint: ", exc.getMessage());
+			} finally {
+				try { if (client != null) { client.close(); } } catch(Exception e) {}
+			}
+		}
+	}
+
+	/**
+	 * Get the aggregated statistics.
+	 * @return the aggregated statistics of all connections.
+	 */
+	public static MecaffStats getTotals() {
+		return totals;
+	}
+
+	/**
+	 * Create and register the statistics for a new connection.
+	 * @param connectionNo the connection counter value of the connection.
+	 * @param filterName the (simple) class name of the stream filter.
+	 * @return the statistics of the connection.
+	 */
+	public static synchronized ConnectionStats open(int connectionNo, String filterName) {
+		ConnectionStats stats = new ConnectionStats(connectionNo, filterName);
+		connections.add(stats);
+		connectionCount++;
+		if (mbeanServer != null) {
+			try {
+				register(stats);
+			} catch (JMException exc) {
+				logger.warn("unable to register statistics MBean for connection ", connectionNo, ": ", exc.getMessage());
+			}
+		}
+		return stats;
+	}
+
+	/**
+	 * Unregister the statistics of a closed connection, adding its counters to the
+	 * aggregated statistics of the closed connections.
+	 * @param stats the statistics of the closed connection.
+	 */
+	public static synchronized void close(ConnectionStats stats) {
+		if (!connections.remove(stats)) { return; }
+		stats.setConsole(null);
+		retired.absorb(stats);
+		if (mbeanServer != null) {
+			try {
+				mbeanServer.unregisterMBean(nameFor(stats));
+			} catch (JMException exc) {
+				logger.warn("unable to unregister statistics MBean for connection ", stats.getConnectionNo(), ": ", exc.getMessage());
+			}
+		}
+	}
+
+	private static ObjectName nameFor(ConnectionStats stats) throws JMException {
+		return new ObjectName(String.format("%s:type=Connection,name=%02d", Domain, stats.getConnectionNo()));
+	}
+
+	private static void register(ConnectionStats stats) throws JMException {
+		mbeanServer.registerMBean(stats, nameFor(stats));
+	}
+
+	@Override
+	public long get(Counter counter) {
+		synchronized(MecaffStats.class) {
+			long sum = retired.get(counter);
+			for (ConnectionStats stats : connections) {
+				sum += stats.get(counter);
+			}
+			return sum;
+		}
+	}
+
+	@Override
+	public long getRoundtripBucket(int bucket) {
+		synchronized(MecaffStats.class) {
+			long sum = retired.getRoundtripBucket(bucket);
+			for (ConnectionStats stats : connections) {
+				sum += stats.getRoundtripBucket(bucket);
+			}
+			return sum;
+		}
+	}
+
+	@Override
+	public long getRoundtripMaxMicros() {
+		synchronized(MecaffStats.class) {
+			long max = retired.getRoundtripMaxMicros();
+			for (ConnectionStats stats : connections) {
+				max = Math.max(max, stats.getRoundtripMaxMicros());
+			}
+			return max;
+		}
+	}
+
+	public int getFsBacklogLines() {
+		synchronized(MecaffStats.class) {
+			int sum = 0;
+			for (ConnectionStats stats : connections) {
+				sum += stats.getFsBacklogLines();
+			}
+			return sum;
+		}
+	}
+
+	public int getLineBufferLines() {
+		synchronized(MecaffStats.class) {
+			int sum = 0;
+			for (ConnectionStats stats : connections) {
+				sum += stats.getLineBufferLines();
+			}
+			return sum;
+		}
+	}
+
+	public int getActiveConnections() {
+		synchronized(MecaffStats.class) {
+			return connections.size();
+		}
+	}
+
+	public long getTotalConnections() {
+		synchronized(MecaffStats.class) {
+			return connectionCount;
+		}
+	}
+
+	public String getReport() {
+		StringBuilder sb = new StringBuilder();
+		synchronized(MecaffStats.class) {
+			sb.append("connections.active ").append(connections.size()).append('\n');
+			sb.append("connections.total ").append(connectionCount).append('\n');
+			this.appendText(sb, "total.");
+			for (ConnectionStats stats : connections) {
+				String prefix = String.format("conn.%02d.", stats.getConnectionNo());
+				sb.append(prefix).append("filter ").append(stats.getFilterName()).append('\n');
+				sb.append(prefix).append("since ").append(stats.getConnectedSince()).append('\n');
+				stats.appendText(sb, prefix);
+			}
+		}
+		return sb.toString();
+	}
+}
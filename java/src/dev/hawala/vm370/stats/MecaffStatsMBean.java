@@ -0,0 +1,33 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+/**
+ * MBean interface for the statistics aggregated over all MECAFF connections
+ * (the open connections and the connections closed so far).
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public interface MecaffStatsMBean extends IStatsCounters {
+
+	/** @return the number of currently open connections. */
+	public int getActiveConnections();
+
+	/** @return the number of connections since the MECAFF process was started. */
+	public long getTotalConnections();
+
+	/** @return the statistics of the MECAFF process and all open connections in plain-text form. */
+	public String getReport();
+}
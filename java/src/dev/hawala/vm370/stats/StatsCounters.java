@@ -0,0 +1,156 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stats;
+
+/**
+ * Common base for the connection and the aggregated statistics, implementing
+ * the MBean attributes and the plain-text form on top of the raw counter values
+ * provided by the sub-classes.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public abstract class StatsCounters implements IStatsCounters {
+
+	/**
+	 * The counters kept for a connection, with the key used in the plain-text form.
+	 */
+	public enum Counter {
+		TerminalBytesIn("terminal.bytes.in"),
+		TerminalRecordsIn("terminal.records.in"),
+		TerminalBytesOut("terminal.bytes.out"),
+		TerminalRecordsOut("terminal.records.out"),
+		HostBytesIn("host.bytes.in"),
+		HostRecordsIn("host.records.in"),
+		HostBytesOut("host.bytes.out"),
+		HostRecordsOut("host.records.out"),
+		TransportChunksIn("transport.chunks.in"),
+		TransportChunksOut("transport.chunks.out"),
+		OutPauseMicros("sleep.outpause.us"),
+		SettleWaitMicros("sleep.settle.us"),
+		FsRoundtrips("fs.roundtrips"),
+		FsRoundtripMicros("fs.roundtrip.us");
+
+		public final String key;
+
+		private Counter(String key) {
+			this.key = key;
+		}
+	}
+
+	/** Upper bounds (in milliseconds) of the fullscreen roundtrip histogram buckets, the last bucket being open. */
+	public static final long[] RoundtripBoundsMs = { 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+	/** Number of buckets of the fullscreen roundtrip histogram. */
+	public static final int RoundtripBuckets = RoundtripBoundsMs.length + 1;
+
+	/**
+	 * Get the current value of a counter.
+	 * @param counter the counter to get.
+	 * @return the counter value.
+	 */
+	public abstract long get(Counter counter);
+
+	/**
+	 * Get the number of fullscreen roundtrips in a histogram bucket.
+	 * @param bucket the index of the bucket (<code>0..RoundtripBuckets-1</code>).
+	 * @return the number of roundtrips in the bucket.
+	 */
+	public abstract long getRoundtripBucket(int bucket);
+
+	/**
+	 * Get the longest fullscreen roundtrip time.
+	 * @return the longest roundtrip time in microseconds.
+	 */
+	public abstract long getRoundtripMaxMicros();
+
+	/**
+	 * Get the index of the histogram bucket for a fullscreen roundtrip time.
+	 * @param micros the roundtrip time in microseconds.
+	 * @return the bucket index.
+	 */
+	protected static int bucketFor(long micros) {
+		long ms = micros / 1000;
+		for (int i = 0; i < RoundtripBoundsMs.length; i++) {
+			if (ms < RoundtripBoundsMs[i]) { return i; }
+		}
+		return RoundtripBoundsMs.length;
+	}
+
+	public long getTerminalBytesIn() { return this.get(Counter.TerminalBytesIn); }
+
+	public long getTerminalRecordsIn() { return this.get(Counter.TerminalRecordsIn); }
+
+	public long getTerminalBytesOut() { return this.get(Counter.TerminalBytesOut); }
+
+	public long getTerminalRecordsOut() { return this.get(Counter.TerminalRecordsOut); }
+
+	public long getHostBytesIn() { return this.get(Counter.HostBytesIn); }
+
+	public long getHostRecordsIn() { return this.get(Counter.HostRecordsIn); }
+
+	public long getHostBytesOut() { return this.get(Counter.HostBytesOut); }
+
+	public long getHostRecordsOut() { return this.get(Counter.HostRecordsOut); }
+
+	public long getTransportChunksIn() { return this.get(Counter.TransportChunksIn); }
+
+	public long getTransportChunksOut() { return this.get(Counter.TransportChunksOut); }
+
+	public long getOutPauseMillis() { return this.get(Counter.OutPauseMicros) / 1000; }
+
+	public long getSettleWaitMillis() { return this.get(Counter.SettleWaitMicros) / 1000; }
+
+	public long getFsRoundtrips() { return this.get(Counter.FsRoundtrips); }
+
+	public double getFsRoundtripAvgMillis() {
+		long count = this.get(Counter.FsRoundtrips);
+		if (count == 0) { return 0.0; }
+		return this.get(Counter.FsRoundtripMicros) / (count * 1000.0);
+	}
+
+	public double getFsRoundtripMaxMillis() { return this.getRoundtripMaxMicros() / 1000.0; }
+
+	public String getFsRoundtripHistogram() {
+		StringBuilder sb = new StringBuilder();
+		for (int i = 0; i < RoundtripBuckets; i++) {
+			if (i > 0) { sb.append(' '); }
+			if (i < RoundtripBoundsMs.length) {
+				sb.append("<").append(RoundtripBoundsMs[i]);
+			} else {
+				sb.append(">=").append(RoundtripBoundsMs[RoundtripBoundsMs.length - 1]);
+			}
+			sb.append("ms:").append(this.getRoundtripBucket(i));
+		}
+		return sb.toString();
+	}
+
+	/**
+	 * Append the counters and gauges in plain-text form, one "key value" line each.
+	 * @param sb the string builder to append to.
+	 * @param prefix the prefix for the keys.
+	 */
+	public void appendText(StringBuilder sb, String prefix) {
+		for (Counter counter : Counter.values()) {
+			sb.append(prefix).append(counter.key).append(' ').append(this.get(counter)).append('\n');
+		}
+		sb.append(prefix).append("fs.roundtrip.max.us ").append(this.getRoundtripMaxMicros()).append('\n');
+		for (int i = 0; i < RoundtripBuckets; i++) {
+			String bound = (i < RoundtripBoundsMs.length) ? "lt" + RoundtripBoundsMs[i] : "ge" + RoundtripBoundsMs[RoundtripBoundsMs.length - 1];
+			sb.append(prefix).append("fs.roundtrip.").append(bound).append("ms ").append(this.getRoundtripBucket(i)).append('\n');
+		}
+		sb.append(prefix).append("console.fsbacklog ").append(this.getFsBacklogLines()).append('\n');
+		sb.append(prefix).append("console.linebuffer ").append(this.getLineBufferLines()).append('\n');
+	}
+}
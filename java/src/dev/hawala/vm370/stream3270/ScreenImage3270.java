@@ -0,0 +1,553 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.stream3270;
+
+/**
+ * Decoded image of the 3270 screen content written by a fullscreen program, i.e. the
+ * characters, fields and attributes at each buffer position, kept up to date from the
+ * 3270 output streams sent to the terminal and the user's input read from the terminal.
+ * <p>
+ * The image allows to rebuild the screen of the fullscreen program on the terminal
+ * after the screen was overwritten by the MECAFF console, so the fullscreen program
+ * can continue with a partial update (Write) instead of a full repaint.
+ * <p>
+ * The image becomes invalid if an output stream cannot be interpreted completely
+ * (e.g. a Write without a preceding EraseWrite, a structured field or unsupported orders),
+ * until the next EraseWrite resp. EraseWriteAlternate.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class ScreenImage3270 {
+
+	// order codes interpreted in the 3270 output stream
+	private static final byte PT = (byte)0x05;
+	private static final byte GE = (byte)0x08;
+	private static final byte SBA = (byte)0x11;
+	private static final byte EUA = (byte)0x12;
+	private static final byte IC = (byte)0x13;
+	private static final byte SF = (byte)0x1D;
+	private static final byte SA = (byte)0x28;
+	private static final byte SFE = (byte)0x29;
+	private static final byte MF = (byte)0x2C;
+	private static final byte RA = (byte)0x3C;
+
+	// attribute types for SFE, SA and MF
+	private static final byte AttrAll = (byte)0x00;
+	private static final byte AttrField = (byte)0xC0;
+	private static final byte AttrHighlight = (byte)0x41;
+	private static final byte AttrColor = (byte)0x42;
+
+	// bits of the (6-bit) field attribute
+	private static final int FieldProtected = 0x20;
+	private static final int FieldModified = 0x01;
+
+	// AID of the CLEAR key
+	private static final byte AidClear = (byte)0x6D;
+
+	private final int altRows;
+	private final int altCols;
+
+	private int rows = 24;
+	private int cols = 80;
+	private int size = 1920;
+	private boolean alternate = false;
+
+	private boolean valid = false;
+
+	private byte[] chars; // character at each buffer position, 0x00 = null
+	private boolean[] isField; // is the buffer position a field attribute?
+	private byte[] fieldAttr; // 6-bit field attribute value at field attribute positions
+	private byte[] fieldColor; // extended color of the field (SFE/MF), 0 = default
+	private byte[] fieldHighlight; // extended highlighting of the field (SFE/MF), 0 = default
+	private byte[] charColor; // character color (SA), 0 = field default
+	private byte[] charHighlight; // character highlighting (SA), 0 = field default
+	private int cursor = 0;
+
+	// interpretation state of the current output stream
+	private int streamPosition = 0; // current buffer address
+	private boolean afterData = false; // was the last order a data character?
+	private boolean opaqueStream = false; // is the stream not interpreted (WSF, EAU)?
+	private byte saColor = 0; // character color set by SA-orders
+	private byte saHighlight = 0; // character highlighting set by SA-orders
+
+	// the restore stream being built
+	private byte[] out = new byte[8192];
+	private int outLength = 0;
+
+	/**
+	 * Construct an (invalid) screen image for a terminal with the given
+	 * alternate screen size.
+	 * @param altRows height of the alternate screen of the terminal.
+	 * @param altCols width of the alternate screen of the terminal.
+	 */
+	public ScreenImage3270(int altRows, int altCols) {
+		this.altRows = altRows;
+		this.altCols = altCols;
+		this.allocate(altRows * altCols);
+	}
+
+	private void allocate(int positions) {
+		this.chars = new byte[positions];
+		this.isField = new boolean[positions];
+		this.fieldAttr = new byte[positions];
+		this.fieldColor = new byte[positions];
+		this.fieldHighlight = new byte[positions];
+		this.charColor = new byte[positions];
+		this.charHighlight = new byte[positions];
+	}
+
+	/**
+	 * Check if the image represents the complete screen content written by the
+	 * fullscreen program and can be used to restore the screen.
+	 * @return <code>true</code> if the image is valid.
+	 */
+	public boolean isValid() {
+		return this.valid;
+	}
+
+	/**
+	 * Forget the screen content, the image stays invalid until the next
+	 * EraseWrite resp. EraseWriteAlternate.
+	 */
+	public void invalidate() {
+		this.valid = false;
+	}
+
+	private void erase(boolean useAlternate) {
+		this.alternate = useAlternate;
+		this.rows = (useAlternate) ? this.altRows : 24;
+		this.cols = (useAlternate) ? this.altCols : 80;
+		this.size = this.rows * this.cols;
+		if (this.size > this.chars.length) { this.allocate(this.size); }
+		for (int i = 0; i < this.size; i++) {
+			this.chars[i] = 0;
+			this.isField[i] = false;
+			this.fieldAttr[i] = 0;
+			this.fieldColor[i] = 0;
+			this.fieldHighlight[i] = 0;
+			this.charColor[i] = 0;
+			this.charHighlight[i] = 0;
+		}
+		this.cursor = 0;
+	}
+
+	private int decodeAddress(byte b0, byte b1) {
+		int position;
+		if ((b0 & 0xC0) == 0) {
+			position = ((b0 & 0x3F) << 8) | (b1 & 0xFF); // 14-bit address
+		} else {
+			position = (Ebcdic6BitEncoding.valueOf(b0) * 64) + Ebcdic6BitEncoding.valueOf(b1);
+		}
+		return position % this.size;
+	}
+
+	private int next(int position) {
+		return (position + 1) % this.size;
+	}
+
+	// find the field attribute position for the buffer position, -1 if the screen is unformatted
+	private int fieldOf(int position) {
+		for (int i = 0; i < this.size; i++) {
+			if (this.isField[position]) { return position; }
+			position = (position == 0) ? this.size - 1 : position - 1;
+		}
+		return -1;
+	}
+
+	private boolean isProtected(int position) {
+		int field = this.fieldOf(position);
+		return (field >= 0 && (this.fieldAttr[field] & FieldProtected) != 0);
+	}
+
+	private void putChar(int position, byte ch) {
+		this.chars[position] = ch;
+		this.isField[position] = false;
+		this.charColor[position] = this.saColor;
+		this.charHighlight[position] = this.saHighlight;
+	}
+
+	private void putField(int position, byte attr) {
+		this.chars[position] = 0;
+		this.isField[position] = true;
+		this.fieldAttr[position] = (byte)(attr & 0x3F);
+		this.fieldColor[position] = 0;
+		this.fieldHighlight[position] = 0;
+		this.charColor[position] = 0;
+		this.charHighlight[position] = 0;
+	}
+
+	private void setFieldAttribute(int position, byte type, byte value) {
+		if (type == AttrField) {
+			this.fieldAttr[position] = (byte)(value & 0x3F);
+		} else if (type == AttrHighlight) {
+			this.fieldHighlight[position] = value;
+		} else if (type == AttrColor) {
+			this.fieldColor[position] = value;
+		} else if (type == AttrAll) {
+			this.fieldColor[position] = 0;
+			this.fieldHighlight[position] = 0;
+		}
+	}
+
+	private void eraseUnprotected(int from, int to) {
+		int position = from;
+		do {
+			if (!this.isField[position] && !this.isProtected(position)) {
+				this.chars[position] = 0;
+				this.charColor[position] = 0;
+				this.charHighlight[position] = 0;
+			}
+			position = this.next(position);
+		} while (position != to);
+	}
+
+	private void resetModifiedFlags() {
+		for (int i = 0; i < this.size; i++) {
+			if (this.isField[i]) { this.fieldAttr[i] &= ~FieldModified; }
+		}
+	}
+
+	/**
+	 * Update the image with a complete 3270 output stream sent to the terminal.
+	 * @param stream the byte array holding the output stream, starting with the
+	 *   command byte, followed by the (6-bit encoded) WCC and the orders resp. data.
+	 * @param length length of the output stream.
+	 */
+	public void apply(byte[] stream, int length) {
+		if (this.applyPart(stream, 0, length, true) < length) { this.valid = false; }
+	}
+
+	/**
+	 * Update the image with the next part of a 3270 output stream, interpreting
+	 * only complete orders, so the caller can forward exactly the interpreted bytes to
+	 * the terminal and must pass the remaining bytes again in front of the next part.
+	 * @param stream the byte array holding the part of the output stream.
+	 * @param offset start of the part in <code>stream</code>.
+	 * @param length length of the part.
+	 * @param streamStart is this the first part of the output stream, starting with the
+	 *   command byte (and the WCC if the command has one)?
+	 * @return the number of bytes interpreted, i.e. the length of the complete orders
+	 *   and data at the start of the part.
+	 */
+	public int applyPart(byte[] stream, int offset, int length, boolean streamStart) {
+		int i = offset;
+		int end = offset + length;
+		if (streamStart) {
+			if (length < 1) { return 0; }
+			byte command = stream[i];
+			this.opaqueStream = false;
+			if (command == CommandCode3270.EAU) {
+				if (this.valid) {
+					this.eraseUnprotected(0, 0);
+					this.resetModifiedFlags();
+					this.cursor = this.firstUnprotected(0);
+				}
+				this.opaqueStream = true; // nothing may follow
+				return length;
+			} else if (command != CommandCode3270.W && command != CommandCode3270.EW && command != CommandCode3270.EWA) {
+				this.valid = false; // WSF or unknown command: we cannot follow the screen content
+				this.opaqueStream = true;
+				return length;
+			}
+			if (length < 2) { return 0; } // wait for the WCC
+			if (command == CommandCode3270.EW) {
+				this.erase(false);
+				this.valid = true;
+			} else if (command == CommandCode3270.EWA) {
+				this.erase(true);
+				this.valid = true;
+			}
+			if ((Ebcdic6BitEncoding.valueOf(stream[i+1]) & 0x01) != 0) { this.resetModifiedFlags(); }
+			this.saColor = 0;
+			this.saHighlight = 0;
+			this.streamPosition = 0;
+			this.afterData = false;
+			i += 2;
+		}
+		if (this.opaqueStream) { return length; }
+
+		// without a known screen content (Write without previous EraseWrite), the orders are
+		// still followed to find the order boundaries, the updates being simply irrelevant
+		int position = this.streamPosition;
+		while (i < end) {
+			int orderStart = i;
+			byte b = stream[i++];
+			if (b == SBA) {
+				if (i + 2 > end) { i = orderStart; break; }
+				position = this.decodeAddress(stream[i], stream[i+1]);
+				i += 2;
+				this.afterData = false;
+			} else if (b == SF) {
+				if (i >= end) { i = orderStart; break; }
+				this.putField(position, stream[i++]);
+				position = this.next(position);
+				this.afterData = false;
+			} else if (b == SFE) {
+				if (i >= end) { i = orderStart; break; }
+				int count = stream[i] & 0xFF;
+				if (i + 1 + (2 * count) > end) { i = orderStart; break; }
+				i++;
+				this.putField(position, (byte)0);
+				for (int p = 0; p < count; p++) {
+					this.setFieldAttribute(position, stream[i], stream[i+1]);
+					i += 2;
+				}
+				position = this.next(position);
+				this.afterData = false;
+			} else if (b == MF) {
+				if (i >= end) { i = orderStart; break; }
+				int count = stream[i] & 0xFF;
+				if (i + 1 + (2 * count) > end) { i = orderStart; break; }
+				i++;
+				if (this.isField[position]) {
+					for (int p = 0; p < count; p++) {
+						this.setFieldAttribute(position, stream[i + (2 * p)], stream[i + (2 * p) + 1]);
+					}
+					position = this.next(position);
+				}
+				i += 2 * count;
+				this.afterData = false;
+			} else if (b == SA) {
+				if (i + 2 > end) { i = orderStart; break; }
+				byte type = stream[i];
+				byte value = stream[i+1];
+				i += 2;
+				if (type == AttrColor) {
+					this.saColor = value;
+				} else if (type == AttrHighlight) {
+					this.saHighlight = value;
+				} else if (type == AttrAll) {
+					this.saColor = 0;
+					this.saHighlight = 0;
+				}
+			} else if (b == IC) {
+				this.cursor = position;
+			} else if (b == PT) {
+				if (this.afterData) {
+					// PT following data fills the rest of the field with nulls
+					while (!this.isField[position]) {
+						this.putChar(position, (byte)0);
+						position = this.next(position);
+						if (position == 0) { break; }
+					}
+				}
+				position = this.firstUnprotected(position);
+				this.afterData = false;
+			} else if (b == RA) {
+				if (i + 3 > end || (stream[i+2] == GE && i + 4 > end)) { i = orderStart; break; }
+				int to = this.decodeAddress(stream[i], stream[i+1]);
+				byte ch = stream[i+2];
+				i += 3;
+				if (ch == GE) {
+					this.valid = false; // graphic escape characters are not remembered
+					i++;
+				}
+				do {
+					this.putChar(position, ch);
+					position = this.next(position);
+				} while (position != to);
+				this.afterData = true;
+			} else if (b == EUA) {
+				if (i + 2 > end) { i = orderStart; break; }
+				int to = this.decodeAddress(stream[i], stream[i+1]);
+				i += 2;
+				this.eraseUnprotected(position, to);
+				position = to;
+				this.afterData = false;
+			} else if (b == GE) {
+				if (i >= end) { i = orderStart; break; }
+				this.valid = false; // graphic escape characters are not remembered
+				this.putChar(position, stream[i++]);
+				position = this.next(position);
+				this.afterData = true;
+			} else {
+				this.putChar(position, b);
+				position = this.next(position);
+				this.afterData = true;
+			}
+		}
+		this.streamPosition = position;
+		return i - offset;
+	}
+
+	// get the first character position of the first unprotected field after the position
+	private int firstUnprotected(int position) {
+		int start = position;
+		do {
+			if (this.isField[position] && (this.fieldAttr[position] & FieldProtected) == 0) {
+				return this.next(position);
+			}
+			position = this.next(position);
+		} while (position != start);
+		return 0;
+	}
+
+	/**
+	 * Update the image with the user's input read from the terminal (Read-Modified
+	 * format: AID, cursor address and the modified fields each introduced by SBA).
+	 * @param input the byte array holding the inbound 3270 stream.
+	 * @param length length of the inbound stream.
+	 */
+	public void applyInbound(byte[] input, int length) {
+		if (!this.valid || length < 1) { return; }
+		if (input[0] == AidClear) {
+			this.erase(false);
+			return;
+		}
+		if (length < 3) { return; } // short read (PA keys)
+		this.cursor = this.decodeAddress(input[1], input[2]);
+		int i = 3;
+		while (i < length) {
+			if (input[i] != SBA || i + 3 > length) { return; } // not Read-Modified data
+			int position = this.decodeAddress(input[i+1], input[i+2]);
+			i += 3;
+			int field = this.fieldOf(position);
+			if (field >= 0) { this.fieldAttr[field] |= FieldModified; }
+			while (i < length && input[i] != SBA) {
+				if (!this.isField[position]) { this.putInput(position, input[i]); }
+				position = this.next(position);
+				i++;
+			}
+			// nulls are not transmitted: the rest of the field is empty
+			while (!this.isField[position]) {
+				this.putInput(position, (byte)0);
+				position = this.next(position);
+				if (position == 0) { break; }
+			}
+		}
+	}
+
+	private void putInput(int position, byte ch) {
+		this.chars[position] = ch;
+		this.charColor[position] = 0;
+		this.charHighlight[position] = 0;
+	}
+
+	private void emit(byte b) {
+		if (this.outLength >= this.out.length) {
+			byte[] newOut = new byte[this.out.length * 2];
+			System.arraycopy(this.out, 0, newOut, 0, this.outLength);
+			this.out = newOut;
+		}
+		this.out[this.outLength++] = b;
+	}
+
+	private void emitAddress(int position) {
+		if (this.size > 4095) {
+			this.emit((byte)((position >> 8) & 0x3F));
+			this.emit((byte)(position & 0xFF));
+		} else {
+			this.emit(Ebcdic6BitEncoding.encode6BitValue((byte)(position / 64)));
+			this.emit(Ebcdic6BitEncoding.encode6BitValue((byte)(position % 64)));
+		}
+	}
+
+	/**
+	 * Build the 3270 output stream (EraseWrite resp. EraseWriteAlternate) that restores
+	 * the screen content of this image on the terminal, available with <code>getRestoreStream()</code>.
+	 * @return the length of the output stream or 0 if the image is not valid.
+	 */
+	public int buildRestoreStream() {
+		this.outLength = 0;
+		if (!this.valid) { return 0; }
+		this.emit((this.alternate) ? CommandCode3270.EWA : CommandCode3270.EW);
+		this.emit(CommandCode3270.encodeWccFlags(false, true, false));
+
+		byte color = 0;
+		byte highlight = 0;
+		int position = 0;
+		boolean skipped = false;
+		while (position < this.size) {
+			if (this.isField[position]) {
+				if (skipped) { this.emit(SBA); this.emitAddress(position); skipped = false; }
+				byte attr = Ebcdic6BitEncoding.encode6BitValue(this.fieldAttr[position]);
+				if (this.fieldColor[position] != 0 || this.fieldHighlight[position] != 0) {
+					int count = 1 + ((this.fieldColor[position] != 0) ? 1 : 0) + ((this.fieldHighlight[position] != 0) ? 1 : 0);
+					this.emit(SFE);
+					this.emit((byte)count);
+					this.emit(AttrField);
+					this.emit(attr);
+					if (this.fieldHighlight[position] != 0) { this.emit(AttrHighlight); this.emit(this.fieldHighlight[position]); }
+					if (this.fieldColor[position] != 0) { this.emit(AttrColor); this.emit(this.fieldColor[position]); }
+				} else {
+					this.emit(SF);
+					this.emit(attr);
+				}
+				position++;
+				continue;
+			}
+
+			// count the run of identical characters with identical attributes
+			byte ch = this.chars[position];
+			int runEnd = position + 1;
+			while (runEnd < this.size
+					&& !this.isField[runEnd]
+					&& this.chars[runEnd] == ch
+					&& this.charColor[runEnd] == this.charColor[position]
+					&& this.charHighlight[runEnd] == this.charHighlight[position]) {
+				runEnd++;
+			}
+			int runLength = runEnd - position;
+
+			// nulls are already there after the erase: skip them
+			if (ch == 0 && this.charColor[position] == 0 && this.charHighlight[position] == 0) {
+				if (runLength > 3) {
+					skipped = true;
+				} else {
+					if (skipped) { this.emit(SBA); this.emitAddress(position); skipped = false; }
+					for (int i = 0; i < runLength; i++) { this.emit((byte)0); }
+				}
+				position = runEnd;
+				continue;
+			}
+
+			if (skipped) { this.emit(SBA); this.emitAddress(position); skipped = false; }
+			if (this.charHighlight[position] != highlight) {
+				highlight = this.charHighlight[position];
+				this.emit(SA);
+				this.emit(AttrHighlight);
+				this.emit(highlight);
+			}
+			if (this.charColor[position] != color) {
+				color = this.charColor[position];
+				this.emit(SA);
+				this.emit(AttrColor);
+				this.emit(color);
+			}
+			if (runLength > 4) {
+				this.emit(RA);
+				this.emitAddress(runEnd % this.size);
+				this.emit(ch);
+			} else {
+				for (int i = 0; i < runLength; i++) { this.emit(ch); }
+			}
+			position = runEnd;
+		}
+
+		this.emit(SBA);
+		this.emitAddress(this.cursor);
+		this.emit(IC);
+		return this.outLength;
+	}
+
+	/**
+	 * Get the buffer holding the output stream built by the last <code>buildRestoreStream()</code>,
+	 * the buffer may be longer than the stream and is reused by the next build.
+	 * @return the restore stream buffer.
+	 */
+	public byte[] getRestoreStream() {
+		return this.out;
+	}
+}
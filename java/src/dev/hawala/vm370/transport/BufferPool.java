@@ -0,0 +1,85 @@
+/*
+** This file is part of the external MECAFF process implementation.
+** (MECAFF :: Multiline External Console And Fullscreen Facility
+**            for VM/370 R6 SixPack 1.2)
+**
+** This software is provided "as is" in the hope that it will be useful, with
+** no promise, commitment or even warranty (explicit or implicit) to be
+** suited or usable for any particular purpose.
+** Using this software is at your own risk!
+**
+** Written by Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+** Released to the public domain.
+*/
+
+package dev.hawala.vm370.transport;
+
+/**
+ * Process-wide pool of the byte arrays backing the <code>ByteBuffer</code>s of
+ * the connections, allowing to reuse the buffers grown for large fullscreen
+ * data instead of re-allocating and re-growing them for each new connection.
+ * <p>
+ * The arrays are pooled in power-of-2 size classes from 1 KByte to 1 MByte, with
+ * a limited number of free arrays per size class; requests for larger arrays
+ * are served by plain allocation.
+ *
+ * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
+ */
+public class BufferPool {
+
+	private static final int MinShift = 10; // 1 KByte
+	private static final int MaxShift = 20; // 1 MByte
+	private static final int MaxFreePerClass = 16;
+
+	private static final byte[][][] freeArrays = new byte[MaxShift - MinShift + 1][MaxFreePerClass][];
+	private static final int[] freeCounts = new int[MaxShift - MinShift + 1];
+
+	// get the size class index for the given minimal size, -1 if too large for pooling
+	private static int getSizeClass(int minSize) {
+		int sizeClass = 0;
+		int classSize = 1 << MinShift;
+		while (classSize < minSize) {
+			sizeClass++;
+			if (sizeClass > (MaxShift - MinShift)) { return -1; }
+			classSize <<= 1;
+		}
+		return sizeClass;
+	}
+
+	/**
+	 * Get a byte array with at least the given size, the array having the
+	 * size of the next power of 2 (at least 1 KByte), its content being undefined.
+	 * @param minSize the minimal size of the array.
+	 * @return the byte array.
+	 */
+	public static byte[] acquire(int minSize) {
+		int sizeClass = getSizeClass(minSize);
+		if (sizeClass < 0) { return new byte[minSize]; }
+		synchronized(freeCounts) {
+			if (freeCounts[sizeClass] > 0) {
+				int idx = --freeCounts[sizeClass];
+				byte[] array = freeArrays[sizeClass][idx];
+				freeArrays[sizeClass][idx] = null;
+				return array;
+			}
+		}
+		return new byte[1 << (sizeClass + MinShift)];
+	}
+
+	/**
+	 * Give back a byte array to the pool, the array must not be used any longer
+	 * by the caller.
+	 * @param array the byte array to give back (arrays not obtained from
+	 *   <code>acquire()</code> are ignored).
+	 */
+	public static void release(byte[] array) {
+		if (array == null) { return; }
+		int sizeClass = getSizeClass(array.length);
+		if (sizeClass < 0 || array.length != (1 << (sizeClass + MinShift))) { return; }
+		synchronized(freeCounts) {
+			if (freeCounts[sizeClass] < MaxFreePerClass) {
+				freeArrays[sizeClass][freeCounts[sizeClass]++] = array;
+			}
+		}
+	}
+}
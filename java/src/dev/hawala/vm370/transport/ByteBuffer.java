@@ -21,6 +21,11 @@ import java.io.OutputStream;
  * Mutable and automatically growing byte buffer, allowing to reset it and write to
  * the buffer, read from the buffer and to write the buffer content (at once or segmented)
  * to various sinks.
+ * <p>
+ * The internal byte array is obtained from the <code>BufferPool</code> and grows
+ * geometrically (doubling, but at least by the growing increment), so building large
+ * contents costs linear copying only. A buffer no longer used can give back its
+ * internal array with <code>release()</code>.
  * 
  * @author Dr. Hans-Walter Latz, Berlin (Germany), 2011,2012
  */
@@ -41,17 +46,19 @@ public class ByteBuffer {
 	
 	protected int nextReadPos = 0;
 	
+	private static final byte[] NoBuffer = new byte[0];
+	
 	/**
 	 * Construct the instance with the given initial capacity and growing sizes.
 	 * @param capacity initial size of the buffer in bytes.
-	 * @param growBy growing increment size n bytes.
+	 * @param growBy minimal growing increment size in bytes.
 	 */
 	public ByteBuffer(int capacity, int growBy) {
 		if (capacity < 1) { capacity = 1024; }
 		if (growBy < 1) { growBy = 1024; }
-		this.capacity = capacity;
 		this.growBy = growBy;
-		buffer = new byte[capacity];
+		this.buffer = BufferPool.acquire(capacity);
+		this.capacity = this.buffer.length;
 	}
 	
 	/**
@@ -89,6 +96,20 @@ public class ByteBuffer {
 		return this;
 	}
 	
+	/**
+	 * Give back the internal byte array to the buffer pool, emptying the buffer.
+	 * <p>
+	 * The buffer stays usable, a new internal array being obtained when
+	 * content is appended again.
+	 */
+	public void release() {
+		byte[] oldBuffer = this.buffer;
+		this.buffer = NoBuffer;
+		this.capacity = 0;
+		this.clear();
+		BufferPool.release(oldBuffer);
+	}
+	
 	/**
 	 * Grow the internal buffer to ensure for the passed minimal free space (without
 	 * affecting the current content).
@@ -97,14 +118,13 @@ public class ByteBuffer {
 	protected void ensureSpace(int minFree) {
 		if (minFree < 1) { return; }
 		int reqCapacity = this.length + minFree;
-		if (reqCapacity < this.capacity) {
-			int missingCapacity = reqCapacity - this.capacity;
-			int growByCount = (missingCapacity / this.growBy) + 1;
-			int newCapacity = this.capacity + (growByCount * this.growBy);
-			byte[] newBuffer = new byte[newCapacity];
+		if (reqCapacity > this.capacity) {
+			int newCapacity = this.capacity + Math.max(this.capacity, this.growBy);
+			byte[] newBuffer = BufferPool.acquire(Math.max(newCapacity, reqCapacity));
 			System.arraycopy(this.buffer, 0, newBuffer, 0, this.length);
+			BufferPool.release(this.buffer);
 			this.buffer = newBuffer;
-			this.capacity = newCapacity;
+			this.capacity = newBuffer.length;
 		}
 	}
 	
@@ -351,28 +371,17 @@ public class ByteBuffer {
 		if (count < 1) { return this; }
 		
 		if (asTelnet) {
+			// write the data up to and including each 0xFF, the next segment
+			// starting with the same 0xFF, so each 0xFF costs one write only
 			int currOffset = fromOffset;
-			int currCount = 0;
-			int currByte = currOffset;
-			while(count > 0) {
-				byte b = this.buffer[currByte];
-				if (b == (byte)0xFF) {
-					if (currCount > 0) {
-						os.write(this.buffer, currOffset, currCount);
-					}
-					os.write((byte)0xFF);
-					os.write((byte)0xFF);
-					currOffset = currByte + 1;
-					currCount = 0;
-				} else {
-					currCount++;
+			int endOffset = fromOffset + count;
+			for (int currByte = fromOffset; currByte < endOffset; currByte++) {
+				if (this.buffer[currByte] == (byte)0xFF) {
+					os.write(this.buffer, currOffset, currByte + 1 - currOffset);
+					currOffset = currByte;
 				}
-				currByte++;
-				count--;
-			}
-			if (currCount > 0) {
-				os.write(this.buffer, currOffset, currCount);
 			}
+			os.write(this.buffer, currOffset, endOffset - currOffset);
 		} else {
 			/*
 			String tmp = new String(this.buffer, fromOffset, count);
@@ -64,6 +64,14 @@ public class DataEncoder {
 		this.EncNibble2last = this.transportEncoding.getDataEncNibble2Last();
 	}
 	
+	/**
+	 * Give back the internal buffer to the buffer pool, dropping all pending chunks.
+	 */
+	public void release() {
+		this.reset(null);
+		this.buffer.release();
+	}
+	
 	/**
 	 * Get the current (encoded) buffer data length to send to the host.  
 	 * @return the length of the data to send.
@@ -201,6 +209,8 @@ public class DataEncoder {
 	public DataEncoder encodeData(byte[] data, int dataOffset, int length) {
 		if (length == 0) { return this; }
 		
+		this.buffer.ensureSpace(length * 2); // grow once for the whole data
+		
 		int preLast = dataOffset + length - 1;
 		int currIn = dataOffset;
 		int nibble;
@@ -23,6 +23,8 @@ import dev.hawala.vm370.Log;
 import dev.hawala.vm370.MecaffVersion;
 import dev.hawala.vm370.Vm3270Console;
 import dev.hawala.vm370.ebcdic.EbcdicHandler;
+import dev.hawala.vm370.stats.ConnectionStats;
+import dev.hawala.vm370.stats.StatsCounters.Counter;
 
 /**
  * Interpreter for the MECAFF over the wire protocol, receiving FSIO-commands
@@ -35,7 +37,7 @@ public class EncodedTransport {
 	
 	private static final Log logger = Log.getLogger();
 	
-	private static final int TRANSPORT_VERSION = 3;
+	private static final int TRANSPORT_VERSION = 5;
 	
 	private final byte[] CMDSTART;
 	private final int CHUNKSIZE;
@@ -49,7 +51,7 @@ public class EncodedTransport {
 	private final DataEncoder encoder;
 	private final DataDecoder decoder;
 	
-	private final ByteBuffer fsBuffer = new ByteBuffer(8192, 2048); /* buffer to collect fullscreen-data before sending to terminal */
+	private final ByteBuffer fsBuffer = new ByteBuffer(2048, 1024); /* fullscreen-data chunk being forwarded to the terminal, with the incomplete order left from the previous chunk */
 	
 	private final Vm3270Console console;
 	private final EbcdicHandler ebcdicTerminalType = new EbcdicHandler();
@@ -58,6 +60,7 @@ public class EncodedTransport {
 	private final boolean canAltScreenSize;
 	private final int numAltRows;
 	private final int numAltCols;
+	private final int dftBufferSize;
 	
 	private int fsInTimeout = Vm3270Console.FsRcvNOTIMEOUT;
 	private int fsInGraceperiod = 30; // 3 secs
@@ -65,6 +68,8 @@ public class EncodedTransport {
 	
 	private boolean hasImmediateTransmission = false;
 	
+	private ConnectionStats stats = null;
+	
 	private final byte requGETTERM;
 	private final byte respGETTERM;
 	
@@ -119,7 +124,8 @@ public class EncodedTransport {
 			boolean canExtHighLight,
 			boolean canAltScreenSize,
 			int numAltRows,
-			int numAltCols) {
+			int numAltCols,
+			int dftBufferSize) {
 		this.transportEncoding = transportEncoding;
 		this.console = console;
 		this.ebcdicTerminalType.appendUnicode(terminalType);
@@ -128,6 +134,7 @@ public class EncodedTransport {
 		this.canAltScreenSize = canAltScreenSize;
 		this.numAltRows = numAltRows;
 		this.numAltCols = numAltCols;
+		this.dftBufferSize = dftBufferSize;
 		
 		this.encoder  = new DataEncoder(this.transportEncoding);
 		this.decoder  = new DataDecoder(this.transportEncoding);
@@ -169,6 +176,14 @@ public class EncodedTransport {
 		logger.debug("sessionMode : ", this.sessionMode);
 	}
 	
+	/**
+	 * Set the statistics of the connection, counting the chunks received and sent.
+	 * @param stats the statistics to update.
+	 */
+	public void setStats(ConnectionStats stats) {
+		this.stats = stats;
+	}
+	
 	/**
 	 * Encode the attributes of the passed screen element of the console
 	 * to <code>encoder</code>.
@@ -203,6 +218,25 @@ public class EncodedTransport {
 		}
 	}
 	
+	/**
+	 * Pass the fullscreen data decoded so far to the console, which sends the complete
+	 * 3270 orders to the terminal at once, and keep the incomplete order at the end
+	 * in <code>fsBuffer</code> for the next chunk.
+	 * @param isLast is this the final chunk of the 3270 output stream?
+	 * @throws IOException
+	 */
+	private void forwardFullscreenData(boolean isLast) throws IOException {
+		byte[] data = this.fsBuffer.getInternalBuffer();
+		int length = this.fsBuffer.getLength();
+		int consumed = this.console.writeFullscreenPart(data, length, isLast);
+		if (consumed >= length) {
+			this.fsBuffer.clear();
+		} else if (consumed > 0) {
+			System.arraycopy(data, consumed, data, 0, length - consumed);
+			this.fsBuffer.setLength(length - consumed);
+		}
+	}
+	
 	/**
 	 * Check the passed buffer for a FSIO-command and create the response chunks in <code>encoder</code>
 	 * if necessary.
@@ -219,6 +253,7 @@ public class EncodedTransport {
 		
 		byte cmd = this.decoder.getNextByte();
 		if (this.decoder.hasParseError()) { return false; }
+		if (this.stats != null) { this.stats.increment(Counter.TransportChunksIn); }
 		int testSessionId;
 
 		if (cmd == this.requGETTERM) {
@@ -259,6 +294,13 @@ public class EncodedTransport {
 			this.encoder.encodeInt(MecaffVersion.Major);
 			this.encoder.encodeInt(MecaffVersion.Minor);
 			this.encoder.encodeInt(MecaffVersion.Sub);
+			
+			// transport version 4: an overwritten fullscreen is restored locally, so the program
+			// may continue with Write (deltas only) instead of repainting with EraseWrite
+			this.encoder.encodeInt(1);
+			
+			// transport version 5: buffer size for DFT file transfers with WSF (0 = not supported by the terminal)
+			this.encoder.encodeInt(this.dftBufferSize);
 				
 			return true;
 		} else if (cmd == this.requGETTERMPF) {
@@ -350,22 +392,27 @@ public class EncodedTransport {
 			return true;
 		} else if (cmd == this.requWRFSCHUNK) {
 			// non-final write-fullscreen buffer chunk
+			int carried = this.fsBuffer.getLength();
 			this.decoder.decodeData(this.fsBuffer);
 			if (this.decoder.hasParseError()) {
 				logger.debug("FSCmd('f') => decoder.hasParseError() !!");
+				this.fsBuffer.setLength(carried);
 				return false; // this wasn't a real fs-command...?
 			}
-			logger.debug("FSCmd('f') -> fsBuffer length is now : ", this.fsBuffer.getLength(), " bytes");
+			logger.debug("FSCmd('f') -> fsBuffer length is now : ", this.fsBuffer.getLength(), " bytes, forwarding to console");
+			this.forwardFullscreenData(false);
 			return true;
 		} else if (cmd == this.requWRFSCHUNKFINAL) {
 			// final write-fullscreen buffer chunk
+			int carried = this.fsBuffer.getLength();
 			this.decoder.decodeData(this.fsBuffer);
 			if (this.decoder.hasParseError()) {
 				logger.debug("FSCmd('F') => decoder.hasParseError() !!");
+				this.fsBuffer.setLength(carried);
 				return false; // this wasn't a real fs-command...?
 			}
 			logger.debug("FSCmd('F') -> fsBuffer final length : ", this.fsBuffer.getLength(), " bytes, writing to console");
-			this.console.writeFullscreen(this.fsBuffer);
+			this.forwardFullscreenData(true);
 			logger.debug("FSCmd('F') : done");
 			return true;
 		} else if (cmd == this.requREADFS) {
@@ -493,6 +540,7 @@ public class EncodedTransport {
 	public void writeNextChunkTo(OutputStream os) throws IOException {
 		this.encoder.writeNextChunkTo(os);
 		this.hasImmediateTransmission = false;
+		if (this.stats != null) { this.stats.increment(Counter.TransportChunksOut); }
 	}
 	
 	/**
@@ -505,6 +553,7 @@ public class EncodedTransport {
 	public void writeNextChunkTo(OutputStream os, EbcdicHandler copy) throws IOException {
 		this.encoder.writeNextChunkTo(os, copy);
 		this.hasImmediateTransmission = false;
+		if (this.stats != null) { this.stats.increment(Counter.TransportChunksOut); }
 	}
 	
 	/**
@@ -531,6 +580,7 @@ public class EncodedTransport {
 			.encodeInt(rc)
 			.writeNextChunkTo(os, copy);
 		this.hasImmediateTransmission = false;
+		if (this.stats != null) { this.stats.increment(Counter.TransportChunksOut); }
 	}
 	
 	/**
@@ -564,4 +614,13 @@ public class EncodedTransport {
 	public void resetFsInrequest() {
 		this.lastWasFSInRequest = false;
 	}
+	
+	/**
+	 * Give back the internal buffers to the buffer pool when the connection
+	 * is closed, dropping all pending data.
+	 */
+	public void release() {
+		this.encoder.release();
+		this.fsBuffer.release();
+	}
 }